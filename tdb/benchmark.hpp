@@ -66,9 +66,600 @@ namespace tdb
 
             if(total != S * s.iterations()) std::cout << total << std::endl;
         }
+
+        template <template <typename> typename P, size_t S> void surrogate_find(picobench::state& s)
+        {
+            using R = AsyncMap<>;
+            using Database = DatabaseBuilder < R, BTree< R, P<R> > >;
+
+            std::filesystem::remove_all("db.dat");
+            Database db("db.dat");
+            auto& dx = db.template Table<0>();
+            std::vector<std::string> names(S);
+
+            for (size_t i = 0; i < S; i++)
+            {
+                names[i] = std::to_string((i * 2654435761ull) % 1000000007ull) + " Brook Way " + std::to_string(i);
+                dx.Insert(db.SetObject(std::string_view(names[i].c_str(), names[i].size() + 1)).second, uint64_t(i));
+            }
+
+            size_t total = 0;
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    for (size_t i = 0; i < S; i++)
+                        dx.MultiFind([&](auto* v) { total++; return true; }, 0, (void*)names[i].c_str());
+                }
+            }
+
+            progressBar += s.iterations();  progressBar.display();
+
+            if (total != S * s.iterations()) std::cout << total << std::endl;
+        }
     
 
      
+        template <typename I, size_t S> void miss(picobench::state& s)
+        {
+            using R = AsyncMap<>;
+            using Database = DatabaseBuilder < R, I >;
+
+            auto& keys = singleton<std::array<RandomKeyT<Key32>, S>>();
+            auto& missing = singleton<std::array<RandomKeyT<Key32>, S * 2>>();
+
+            std::filesystem::remove_all("db.dat");
+            Database db("db.dat");
+            auto& dx = db.template Table<0>();
+
+            for (size_t i = 0; i < S; i++)
+                dx.Insert(keys[i], uint64_t(i));
+
+            size_t total = 0;
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    for (size_t i = 0; i < S; i++)
+                        if (dx.Find(missing[i]))
+                            total++;
+                }
+            }
+
+            progressBar += s.iterations();  progressBar.display();
+
+            if (total) std::cout << total << std::endl;
+        }
+
+        template <typename N, size_t H, size_t S> void hot(picobench::state& s)
+        {
+            using R = AsyncMap<>;
+            using Database = DatabaseBuilder < R, BTree< R, N, 1, (size_t)-1, H > >;
+
+            auto& keys = singleton<std::array<RandomKeyT<Key32>, S>>();
+
+            std::filesystem::remove_all("db.dat");
+            Database db("db.dat");
+            auto& dx = db.template Table<0>();
+
+            for (size_t i = 0; i < S; i++)
+                dx.Insert(keys[i], uint64_t(i));
+
+            size_t total = 0;
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    for (size_t i = 0; i < S; i++)
+                        if (dx.Find(keys[i]))
+                            total++;
+                }
+            }
+
+            progressBar += s.iterations();  progressBar.display();
+
+            if (total != S * s.iterations()) std::cout << total << std::endl;
+        }
+
+        template <typename N, size_t S, size_t T> void insert_lock(picobench::state& s)
+        {
+            using R = AsyncMap<>;
+            using Database = DatabaseBuilder < R, BTree< R, N > >;
+
+            auto& keys = singleton<std::array<RandomKeyT<Key32>, S>>();
+            std::atomic<size_t> total = 0;
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    std::filesystem::remove_all("db.dat");
+                    Database db("db.dat");
+                    auto& dx = db.template Table<0>();
+
+                    std::vector<std::thread> threads;
+                    for (size_t t = 0; t < T; t++)
+                    {
+                        threads.emplace_back([&, t]()
+                        {
+                            for (size_t i = t; i < S; i += T)
+                                if (dx.InsertLock(keys[i], uint64_t(i)).first)
+                                    total++;
+                        });
+                    }
+
+                    for (auto& t : threads)
+                        t.join();
+                }
+            }
+
+            progressBar += s.iterations();  progressBar.display();
+
+            if (total != S * s.iterations()) std::cout << total << std::endl;
+        }
+
+#pragma pack(push, 1)
+        struct _Row
+        {
+            _Row() {}
+
+            _Row(uint64_t _id) : id(_id) {}
+
+            auto Keys(uint64_t n)
+            {
+                return std::make_tuple(_IntWrapper<uint64_t>(id * 0x9e3779b97f4a7c15ull), _IntWrapper<uint64_t>(id % 256));
+            }
+
+            uint64_t id = 0;
+            uint8_t payload[56] = {};
+        };
+#pragma pack(pop)
+
+        template <size_t S, size_t T> void emplace_lock(picobench::state& s)
+        {
+            using R = AsyncMap<>;
+            using U = BTree< R, SimpleOrderedListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+            using G = BPlusTree< R, SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+            using Database = DatabaseBuilder < R, FixedTable<R, SimpleTableElementBuilder<_Row>, U, G> >;
+
+            size_t total = 0;
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    std::filesystem::remove_all("db.dat");
+                    Database db("db.dat");
+                    auto& table = db.template Table<0>();
+
+                    std::vector<std::thread> threads;
+                    for (size_t t = 0; t < T; t++)
+                    {
+                        threads.emplace_back([&, t]()
+                        {
+                            for (size_t i = t; i < S; i += T)
+                                table.EmplaceLock(uint64_t(i));
+                        });
+                    }
+
+                    for (auto& t : threads)
+                        t.join();
+
+                    total += table.size();
+                }
+            }
+
+            progressBar += s.iterations();  progressBar.display();
+
+            if (total != S * s.iterations()) std::cout << total << std::endl;
+        }
+
+        template <size_t S, bool pipeline_v> void pipeline_emplace(picobench::state& s)
+        {
+            using R = AsyncMap<>;
+            using U = BTree< R, SimpleOrderedListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+            using G = BPlusTree< R, SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+            using Database = DatabaseBuilder < R, FixedTable<R, SimpleTableElementBuilder<_Row>, U, G> >;
+
+            size_t total = 0;
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    std::filesystem::remove_all("db.dat");
+                    Database db("db.dat");
+                    auto& table = db.template Table<0>();
+
+                    if constexpr (pipeline_v)
+                        table.PipelineIndexes();
+
+                    for (size_t i = 0; i < S; i++)
+                        table.Emplace(uint64_t(i));
+
+                    table.Sync();
+
+                    total += table.size();
+                }
+            }
+
+            progressBar += s.iterations();  progressBar.display();
+
+            if (total != S * s.iterations()) std::cout << total << std::endl;
+        }
+
+        template <size_t S, bool deferred_v> void deferred_emplace(picobench::state& s)
+        {
+            using R = AsyncMap<>;
+            using U = BTree< R, SimpleOrderedListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+            using G = BPlusTree< R, SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+            using Database = DatabaseBuilder < R, FixedTable<R, SimpleTableElementBuilder<_Row>, U, G> >;
+
+            size_t total = 0;
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    std::filesystem::remove_all("db.dat");
+                    Database db("db.dat");
+                    auto& table = db.template Table<0>();
+
+                    if constexpr (deferred_v)
+                        table.DeferIndexes(3);
+
+                    for (size_t i = 0; i < S; i++)
+                        table.Emplace(uint64_t(i));
+
+                    table.BuildIndexes();
+
+                    total += table.size();
+                }
+            }
+
+            progressBar += s.iterations();  progressBar.display();
+
+            if (total != S * s.iterations()) std::cout << total << std::endl;
+        }
+
+        template <size_t S, bool attach_v> void attach_index(picobench::state& s)
+        {
+            using R = AsyncMap<>;
+            using U = BTree< R, SimpleOrderedListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+            using M = BTree< R, SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+            using Reserved = DatabaseBuilder < R, FixedTable<R, SimpleTableElementBuilder<_Row>, U, ReserveTables<R, 1>> >;
+            using Database = DatabaseBuilder < R, FixedTable<R, SimpleTableElementBuilder<_Row>, U, M> >;
+
+            size_t total = 0;
+
+            std::filesystem::remove_all("db.dat");
+
+            if constexpr (attach_v)
+            {
+                Reserved db("db.dat");
+                auto& table = db.template Table<0>();
+
+                for (size_t i = 0; i < S; i++)
+                    table.Emplace(uint64_t(i));
+            }
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    if constexpr (attach_v)
+                    {
+                        Database db("db.dat");
+                        auto& table = db.template Table<0>();
+
+                        total += table.template CreateIndex<1>();
+                        table.template DropIndex<1>();
+                    }
+                    else
+                    {
+                        std::filesystem::remove_all("db.dat");
+                        Database db("db.dat");
+                        auto& table = db.template Table<0>();
+
+                        for (size_t i = 0; i < S; i++)
+                            table.Emplace(uint64_t(i));
+
+                        total += table.size();
+                    }
+                }
+            }
+
+            progressBar += s.iterations();  progressBar.display();
+
+            if (total != S * s.iterations()) std::cout << total << std::endl;
+        }
+
+        template <typename N, size_t S, bool pinned_v> void snapshot_insert(picobench::state& s)
+        {
+            using R = AsyncMap<>;
+            using Database = DatabaseBuilder < R, BTree< R, N > >;
+
+            auto& keys = singleton<std::array<RandomKeyT<Key32>, S * 2>>();
+            size_t total = 0;
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    std::filesystem::remove_all("db.dat");
+                    Database db("db.dat");
+                    auto& dx = db.template Table<0>();
+
+                    for (size_t i = 0; i < S; i++)
+                        dx.Insert(keys[i], uint64_t(i));
+
+                    std::atomic<bool> done = false;
+                    std::thread reader;
+                    typename Database::_Snapshot snapshot;
+
+                    if constexpr (pinned_v)
+                    {
+                        snapshot = db.Snapshot();
+
+                        reader = std::thread([&]()
+                        {
+                            while (!done)
+                                snapshot.template Table<0>().IterateKV([&](auto& k, auto& v) { return !done; });
+                        });
+                    }
+
+                    for (size_t i = S; i < S * 2; i++)
+                        if (dx.Insert(keys[i], uint64_t(i)).first)
+                            total++;
+
+                    done = true;
+
+                    if constexpr (pinned_v)
+                        reader.join();
+                }
+            }
+
+            progressBar += s.iterations();  progressBar.display();
+
+            if (total != S * s.iterations()) std::cout << total << std::endl;
+        }
+
+        template <typename I, size_t S, bool sequential_v> void int_insert(picobench::state& s)
+        {
+            using R = AsyncMap<>;
+            using Database = DatabaseBuilder < R, I >;
+
+            Key32 value;
+            size_t total = 0;
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    std::filesystem::remove_all("db.dat");
+                    Database db("db.dat");
+                    auto& dx = db.template Table<0>();
+
+                    for (uint64_t i = 0; i < S; i++)
+                        if (dx.Insert(_IntWrapper<uint64_t>((sequential_v) ? i : i * 0x9e3779b97f4a7c15ull), value).first)
+                            total++;
+                }
+            }
+
+            progressBar += s.iterations();  progressBar.display();
+
+            if (total != S * s.iterations()) std::cout << total << std::endl;
+        }
+
+        template <typename I, size_t S, bool sequential_v> void int_find(picobench::state& s)
+        {
+            using R = AsyncMap<>;
+            using Database = DatabaseBuilder < R, I >;
+
+            std::filesystem::remove_all("db.dat");
+            Database db("db.dat");
+            auto& dx = db.template Table<0>();
+            Key32 value;
+
+            for (uint64_t i = 0; i < S; i++)
+                dx.Insert(_IntWrapper<uint64_t>((sequential_v) ? i : i * 0x9e3779b97f4a7c15ull), value);
+
+            size_t total = 0;
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    for (uint64_t i = 0; i < S; i++)
+                        if (dx.Find(_IntWrapper<uint64_t>((sequential_v) ? i : i * 0x9e3779b97f4a7c15ull)))
+                            total++;
+                }
+            }
+
+            progressBar += s.iterations();  progressBar.display();
+
+            if (total != S * s.iterations()) std::cout << total << std::endl;
+        }
+
+        template <typename I, size_t S, bool sequential_v> void learned_find(picobench::state& s)
+        {
+            using R = AsyncMap<>;
+            using Database = DatabaseBuilder < R, BTree< R, OrderedIntKey<uint64_t> >, I >;
+
+            std::filesystem::remove_all("db.dat");
+            Database db("db.dat");
+            auto& tree = db.template Table<0>();
+            auto& dx = db.template Table<1>();
+            Key32 value;
+
+            for (uint64_t i = 0; i < S; i++)
+                tree.Insert(_IntWrapper<uint64_t>((sequential_v) ? i : i * 0x9e3779b97f4a7c15ull), value);
+
+            dx.Build(tree);
+
+            size_t total = 0;
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    for (uint64_t i = 0; i < S; i++)
+                        if (dx.Find(_IntWrapper<uint64_t>((sequential_v) ? i : i * 0x9e3779b97f4a7c15ull)))
+                            total++;
+                }
+            }
+
+            progressBar += s.iterations();  progressBar.display();
+
+            if (total != S * s.iterations()) std::cout << total << std::endl;
+        }
+
+        //Millions of disjoint runs shuffled into one extent map per index type, built on first use:
+        //
+
+        template <typename I> auto& extent_map()
+        {
+            using R = AsyncMap<>;
+            using Database = DatabaseBuilder < R, I >;
+
+            constexpr uint64_t run_c = 2 * 1000 * 1000;
+
+            static std::unique_ptr<Database> db;
+
+            if (!db)
+            {
+                auto file = "extents" + std::to_string(typeid(I).hash_code()) + ".dat";
+
+                std::filesystem::remove_all(file);
+                db = std::make_unique<Database>(file);
+
+                auto& dx = db->template Table<0>();
+
+                for (uint64_t i = 0; i < run_c; i++)
+                {
+                    uint32_t r = (uint32_t)((i * 7919) % run_c);
+                    dx.Insert(_Segment<uint32_t>(r * 16, 1 + r % 15), r);
+                }
+            }
+
+            return db->template Table<0>();
+        }
+
+        template <typename I, size_t S> void stab(picobench::state& s)
+        {
+            auto& dx = extent_map<I>();
+            size_t total = 0;
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    for (uint64_t i = 0; i < S; i++)
+                        dx.MultiFind([&](auto* v) { total++; return true; }, _Segment<uint32_t>((uint32_t)((i * 104729) % (32 * 1000 * 1000)), 1));
+                }
+            }
+
+            progressBar += s.iterations();  progressBar.display();
+
+            if (!total) std::cout << total << std::endl;
+        }
+
+        template <typename I, size_t S, uint32_t L> void overlap(picobench::state& s)
+        {
+            auto& dx = extent_map<I>();
+            size_t total = 0;
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    for (uint64_t i = 0; i < S; i++)
+                    {
+                        uint32_t low = (uint32_t)((i * 104729) % (32 * 1000 * 1000));
+                        dx.RangeFind([&](auto& k, auto& v) { total++; }, _Segment<uint32_t>(low, 1), _Segment<uint32_t>(low + L, 1));
+                    }
+                }
+            }
+
+            progressBar += s.iterations();  progressBar.display();
+
+            if (!total) std::cout << total << std::endl;
+        }
+
+        template <typename K, size_t S, size_t L> void hash(picobench::state& s)
+        {
+            std::string text(L * 2, 'x');
+
+            for (size_t i = 0; i < text.size(); i++)
+                text[i] = char('a' + (i * 7) % 26);
+
+            uint64_t total = 0;
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    for (size_t i = 0; i < S; i++)
+                    {
+                        K k(std::string_view(text.data() + i % L, L));
+                        total += *(uint64_t*)&k;
+                    }
+                }
+            }
+
+            progressBar += s.iterations();  progressBar.display();
+
+            if (!total) std::cout << total << std::endl;
+        }
+
+        template <typename K, size_t S, size_t L> void hash_batch(picobench::state& s)
+        {
+            std::string text(L * 2, 'x');
+
+            for (size_t i = 0; i < text.size(); i++)
+                text[i] = char('a' + (i * 7) % 26);
+
+            std::vector<std::string_view> in(S);
+            std::vector<K> out(S);
+
+            for (size_t i = 0; i < S; i++)
+                in[i] = std::string_view(text.data() + i % L, L);
+
+            uint64_t total = 0;
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    HashBatch(gsl::span<const std::string_view>(in), gsl::span<K>(out));
+                    total += *(uint64_t*)&out[0];
+                }
+            }
+
+            progressBar += s.iterations();  progressBar.display();
+
+            if (!total) std::cout << total << std::endl;
+        }
+
        auto hashi100k = insert<LargeHashmap, 8000>;
        auto hashf100k = find<LargeHashmap, 8000>;
 
@@ -81,9 +672,88 @@ namespace tdb
        auto hashi100kl = insert<LargeHashmapL, 8000>;
        auto hashf100kl = find<LargeHashmapL, 8000>;
 
+       auto taggedi100k = insert<LargeTaggedHashmap, 8000>;
+       auto taggedf100k = find<LargeTaggedHashmap, 8000>;
+
+       auto taggedi100kw = insert<LargeTaggedHashmapW, 8000>;
+       auto taggedf100kw = find<LargeTaggedHashmapW, 8000>;
+
        auto bsi100k = insert<LargeIndex, 8000>;
        auto bsf100k = find<LargeIndex, 8000>;
 
+       auto sha2h64 = hash<Key32, 8000, 64>;
+       auto fasth64 = hash<FastKey32, 8000, 64>;
+       auto hashm100k = miss<BTree<AsyncMap<>, FuzzyHashPointer>, 8000>;
+       auto bloomm100k = miss<BloomTree<AsyncMap<>, FuzzyHashPointer>, 8000>;
+       auto orderedm100k = miss<BTree<AsyncMap<>, OrderedListPointer>, 8000>;
+       auto bloomorderedm100k = miss<BloomTree<AsyncMap<>, OrderedListPointer>, 8000>;
+
+       auto sha2b64 = hash_batch<Key32, 8000, 64>;
+       auto sha2h4k = hash<Key32, 8000, 4096>;
+       auto fasth4k = hash<FastKey32, 8000, 4096>;
+
+       auto fasthashi100k = insert<LargeFastHashmap, 8000>;
+       auto fasthashf100k = find<LargeFastHashmap, 8000>;
+
+       auto coldf100k = hot<FuzzyHashPointer, 0, 8000>;
+       auto hotf100k = hot<FuzzyHashPointer, 3, 8000>;
+       auto coldorderedf100k = hot<OrderedListPointer, 0, 8000>;
+       auto hotorderedf100k = hot<OrderedListPointer, 3, 8000>;
+
+       auto packedorderedf100k = hot<OrderedListPointer, 3, 8000>;
+       auto alignedorderedf100k = hot<AlignedOrderedListPointer, 3, 8000>;
+       auto packedtaggedf100k = hot<TaggedHashPointer, 3, 8000>;
+       auto alignedtaggedf100k = hot<AlignedTaggedHashPointer, 3, 8000>;
+       auto packedorderedil100k = insert_lock<OrderedListPointer, 8000, 4>;
+       auto alignedorderedil100k = insert_lock<AlignedOrderedListPointer, 8000, 4>;
+       auto packedhashil100k = insert_lock<FuzzyHashPointer, 8000, 4>;
+       auto alignedhashil100k = insert_lock<AlignedFuzzyHashPointer, 8000, 4>;
+
+       auto emplacel1 = emplace_lock<8000, 1>;
+       auto emplacel2 = emplace_lock<8000, 2>;
+       auto emplacel4 = emplace_lock<8000, 4>;
+       auto emplacel8 = emplace_lock<8000, 8>;
+       auto emplacel16 = emplace_lock<8000, 16>;
+       auto emplacel32 = emplace_lock<8000, 32>;
+
+       auto serialemplace = pipeline_emplace<8000, false>;
+       auto pipelineemplace = pipeline_emplace<8000, true>;
+       auto inlineemplace = deferred_emplace<8000, false>;
+       auto deferredemplace = deferred_emplace<8000, true>;
+       auto reingestindex = attach_index<8000, false>;
+       auto attachindex = attach_index<8000, true>;
+
+       auto orderedi100k = snapshot_insert<OrderedListPointer, 8000, false>;
+       auto snapshotorderedi100k = snapshot_insert<OrderedListPointer, 8000, true>;
+       auto hashi100kp = snapshot_insert<FuzzyHashPointer, 8000, false>;
+       auto snapshothashi100k = snapshot_insert<FuzzyHashPointer, 8000, true>;
+
+       auto ordintsi100k = int_insert<BTree< AsyncMap<>, OrderedIntKey<uint64_t> >, 8000, true>;
+       auto radixsi100k = int_insert<RadixIntKey< AsyncMap<>, uint64_t >, 8000, true>;
+       auto ordintri100k = int_insert<BTree< AsyncMap<>, OrderedIntKey<uint64_t> >, 8000, false>;
+       auto radixri100k = int_insert<RadixIntKey< AsyncMap<>, uint64_t >, 8000, false>;
+
+       auto ordintsf100k = int_find<BTree< AsyncMap<>, OrderedIntKey<uint64_t> >, 8000, true>;
+       auto radixsf100k = int_find<RadixIntKey< AsyncMap<>, uint64_t >, 8000, true>;
+       auto ordintrf100k = int_find<BTree< AsyncMap<>, OrderedIntKey<uint64_t> >, 8000, false>;
+       auto radixrf100k = int_find<RadixIntKey< AsyncMap<>, uint64_t >, 8000, false>;
+
+       auto packedsi100k = int_insert<PackedIntKey< AsyncMap<>, uint64_t >, 8000, true>;
+       auto packedri100k = int_insert<PackedIntKey< AsyncMap<>, uint64_t >, 8000, false>;
+       auto packedsf100k = int_find<PackedIntKey< AsyncMap<>, uint64_t >, 8000, true>;
+       auto packedrf100k = int_find<PackedIntKey< AsyncMap<>, uint64_t >, 8000, false>;
+
+       auto learnedsf100k = learned_find<LearnedIntKey< AsyncMap<>, uint64_t >, 8000, true>;
+       auto learnedrf100k = learned_find<LearnedIntKey< AsyncMap<>, uint64_t >, 8000, false>;
+
+       auto segmentstab = stab<BTree< AsyncMap<>, OrderedSegmentPointer32 >, 8000>;
+       auto intervalstab = stab<IntervalIndex32< AsyncMap<> >, 8000>;
+       auto segmentoverlap = overlap<BTree< AsyncMap<>, OrderedSegmentPointer32 >, 8000, 4096>;
+       auto intervaloverlap = overlap<IntervalIndex32< AsyncMap<> >, 8000, 4096>;
+
+       auto surrogatef100k = surrogate_find<MultiSurrogateStringPointer, 8000>;
+       auto localf100k = surrogate_find<MultiLocalSurrogateStringPointer, 8000>;
+
         PICOBENCH_SUITE("Fuzzy hashmap vs binary tree insert");
 
 
@@ -91,6 +761,9 @@ namespace tdb
         PICOBENCH(hashi100ks);
         PICOBENCH(hashi100km);
         PICOBENCH(hashi100kl);
+        PICOBENCH(taggedi100k);
+        PICOBENCH(taggedi100kw);
+        PICOBENCH(fasthashi100k);
         PICOBENCH(bsi100k);
 
         PICOBENCH_SUITE("Fuzzy hashmap vs binary tree finds");
@@ -99,7 +772,121 @@ namespace tdb
         PICOBENCH(hashf100ks);
         PICOBENCH(hashf100km);
         PICOBENCH(hashf100kl);
+        PICOBENCH(taggedf100k);
+        PICOBENCH(taggedf100kw);
+        PICOBENCH(fasthashf100k);
+        PICOBENCH(bsf100k);
+
+        PICOBENCH_SUITE("Missing key finds with and without a Bloom filter");
+
+        PICOBENCH(hashm100k);
+        PICOBENCH(bloomm100k);
+        PICOBENCH(orderedm100k);
+        PICOBENCH(bloomorderedm100k);
+
+        PICOBENCH_SUITE("Finds with and without cached top levels");
+
+        PICOBENCH(coldf100k);
+        PICOBENCH(hotf100k);
+        PICOBENCH(coldorderedf100k);
+        PICOBENCH(hotorderedf100k);
+
+        PICOBENCH_SUITE("Packed vs cache line aligned nodes");
+
+        PICOBENCH(packedorderedf100k);
+        PICOBENCH(alignedorderedf100k);
+        PICOBENCH(packedtaggedf100k);
+        PICOBENCH(alignedtaggedf100k);
+        PICOBENCH(packedorderedil100k);
+        PICOBENCH(alignedorderedil100k);
+        PICOBENCH(packedhashil100k);
+        PICOBENCH(alignedhashil100k);
+
+        PICOBENCH_SUITE("Fixed table EmplaceLock from 1 to 32 threads");
+
+        PICOBENCH(emplacel1);
+        PICOBENCH(emplacel2);
+        PICOBENCH(emplacel4);
+        PICOBENCH(emplacel8);
+        PICOBENCH(emplacel16);
+        PICOBENCH(emplacel32);
+
+        PICOBENCH_SUITE("Table appends with inline vs pipelined index maintenance");
+
+        PICOBENCH(serialemplace);
+        PICOBENCH(pipelineemplace);
+
+        PICOBENCH_SUITE("Table appends with inline index maintenance vs a deferred bulk build");
+
+        PICOBENCH(inlineemplace);
+        PICOBENCH(deferredemplace);
+
+        PICOBENCH_SUITE("Re-ingesting every row vs attaching an index to the populated table");
+
+        PICOBENCH(reingestindex);
+        PICOBENCH(attachindex);
+
+        PICOBENCH_SUITE("Inserts with and without a pinned snapshot being scanned");
+
+        PICOBENCH(orderedi100k);
+        PICOBENCH(snapshotorderedi100k);
+        PICOBENCH(hashi100kp);
+        PICOBENCH(snapshothashi100k);
+
+        PICOBENCH_SUITE("Ordered int keys vs radix tree, sequential and random ids");
+
+        PICOBENCH(ordintsi100k);
+        PICOBENCH(radixsi100k);
+        PICOBENCH(ordintri100k);
+        PICOBENCH(radixri100k);
+        PICOBENCH(ordintsf100k);
+        PICOBENCH(radixsf100k);
+        PICOBENCH(ordintrf100k);
+        PICOBENCH(radixrf100k);
+
+        PICOBENCH_SUITE("Appending ascending ids vs inserting random ids");
+
+        PICOBENCH(ordintsi100k);
+        PICOBENCH(ordintri100k);
+
+        PICOBENCH_SUITE("Ordered int keys vs bit packed leaf B+tree");
+
+        PICOBENCH(ordintsi100k);
+        PICOBENCH(packedsi100k);
+        PICOBENCH(ordintri100k);
+        PICOBENCH(packedri100k);
+        PICOBENCH(ordintsf100k);
+        PICOBENCH(packedsf100k);
+        PICOBENCH(ordintrf100k);
+        PICOBENCH(packedrf100k);
+
+        PICOBENCH_SUITE("Binary search index vs ordered int keys vs learned index finds");
+
         PICOBENCH(bsf100k);
+        PICOBENCH(ordintsf100k);
+        PICOBENCH(learnedsf100k);
+        PICOBENCH(ordintrf100k);
+        PICOBENCH(learnedrf100k);
+
+        PICOBENCH_SUITE("Segment btree vs interval index on a 2M run extent map");
+
+        PICOBENCH(segmentstab);
+        PICOBENCH(intervalstab);
+        PICOBENCH(segmentoverlap);
+        PICOBENCH(intervaloverlap);
+
+        PICOBENCH_SUITE("SHA-2 vs fast key hashing");
+
+        PICOBENCH(sha2h64);
+        PICOBENCH(sha2b64);
+        PICOBENCH(fasth64);
+        PICOBENCH(sha2h4k);
+        PICOBENCH(fasth4k);
+
+        PICOBENCH_SUITE("Surrogate vs local surrogate string finds");
+
+        PICOBENCH(surrogatef100k);
+        PICOBENCH(localf100k);
         
 
 
@@ -0,0 +1,522 @@
+/* Copyright (C) 2020 D8DATAWORKS - All Rights Reserved */
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "btree.hpp"
+#include "hash.hpp"
+
+namespace tdb
+{
+	/*
+		Split block Bloom filter, each key sets one bit in every 32 bit word of a single 32 byte block.
+		A probe touches one cache line and never reports a present key as missing.
+	*/
+
+	struct _FilterBlock
+	{
+		uint32_t words[8];
+
+		static uint32_t Bit(uint32_t h, size_t i)
+		{
+			static const uint32_t salt[8] = { 0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d, 0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31 };
+
+			return 1u << ((h * salt[i]) >> 27);
+		}
+
+		bool Contains(uint32_t h) const
+		{
+			uint32_t miss = 0;
+
+			for (size_t i = 0; i < 8; i++)
+				miss |= ~words[i] & Bit(h, i);
+
+			return !miss;
+		}
+
+		void Add(uint32_t h)
+		{
+			for (size_t i = 0; i < 8; i++)
+				words[i] |= Bit(h, i);
+		}
+
+		void AddLock(uint32_t h)
+		{
+			for (size_t i = 0; i < 8; i++)
+				((std::atomic<uint32_t>*)(words + i))->fetch_or(Bit(h, i), std::memory_order_relaxed);
+		}
+	};
+
+	static_assert(sizeof(_FilterBlock) == 32);
+
+	/*
+		_BTree with a persistent Bloom filter beside it, misses are answered without descending the tree.
+
+		The filter lives in a contiguous span of recycler units, its header takes the index slot after the root.
+		Inserts set the key's bits before the key reaches the tree, so a key that can be found always passes the filter.
+		Erased keys keep their bits until the filter is rebuilt.
+
+		Insert grows the filter by rebuilding it when the population passes capacity. The lock variants can't rescan the
+		tree under concurrent writers, they double the filter in place instead ( see _Grow ) and only mark it saturated
+		once the span can't grow further, every probe then passes until RebuildFilter runs.
+		RebuildFilter scans the tree in parallel and must not race writers.
+	*/
+
+	template < typename R, typename node_t, size_t bits_per_key_c = 12, size_t double_stall_s = 1, size_t double_max_s = -1 > class _BloomBTree : public _BTree<R, node_t, double_stall_s, double_max_s>
+	{
+		using base_t = _BTree<R, node_t, double_stall_s, double_max_s>;
+		using key_t = typename node_t::Key;
+		using pointer_t = typename node_t::Pointer;
+
+		static_assert(key_t::mode == KeyMode::key_mode_direct, "The filter hashes key bytes, surrogate keys compare by what they point to");
+
+		static const size_t block_c = R::UnitSize / sizeof(_FilterBlock);
+
+		/*
+			The span packs the first unit and the unit count into one word so a probe never sees half a swap.
+			It is allocated by the first insert, allocating in Open would take the slots of the tables opened after this one.
+			A rebuild or growth retires the old span and frees it at the next one, probes still reading it stay correct.
+		*/
+
+		static const uint64_t span_bits_s = 24;
+
+		struct _FilterHeader
+		{
+			std::atomic<uint64_t> span = 0;
+			uint64_t retired = 0;
+			uint64_t capacity = 0;
+			std::atomic<uint64_t> population = 0;
+			std::atomic<uint32_t> saturated = 0;
+			std::atomic<uint32_t> allocating = 0;
+			std::atomic<uint32_t> growing = 0;
+		};
+
+		R* io = nullptr;
+		uint64_t filter_n = 0;
+
+		_FilterHeader& Header() const
+		{
+			return io->template Lookup<_FilterHeader>(filter_n);
+		}
+
+		//Distributed keys are hashes already, their first word is used as is:
+		//
+
+		static uint64_t Hash(const key_t& k)
+		{
+			uint64_t h;
+
+			if constexpr (key_t::type == KeyType::key_type_distributed && sizeof(key_t) >= sizeof(uint64_t))
+				std::memcpy(&h, &k, sizeof(h));
+			else
+				FastHashWords<1>(&h, (const uint8_t*)&k, sizeof(key_t));
+
+			return h;
+		}
+
+		//The high half of the hash picks the block, blocks stays below 2^32 so the product fits:
+		//
+
+		_FilterBlock& Block(uint64_t span, uint64_t h) const
+		{
+			uint64_t blocks = (span & ((1ull << span_bits_s) - 1)) * block_c;
+
+			return (&io->template Lookup<_FilterBlock>(span >> span_bits_s))[((h >> 32) * blocks) >> 32];
+		}
+
+		template < bool lock_v > uint64_t _AllocateSpan(uint64_t units)
+		{
+			typename R::Unit* first;
+
+			if constexpr (lock_v)
+				first = io->AllocateSpanLock(units);
+			else
+				first = io->AllocateSpan(units);
+
+			uint64_t n = io->IndexUnit(*first);
+			std::memset(&io->template Lookup<_FilterBlock>(n), 0, units * R::UnitSize);
+
+			return (n << span_bits_s) | units;
+		}
+
+		template < bool lock_v > uint64_t _Span()
+		{
+			auto& header = Header();
+			uint64_t span = header.span.load();
+
+			if (span)
+				return span;
+
+			uint32_t expected = 0;
+
+			if (!header.allocating.compare_exchange_strong(expected, 1))
+			{
+				while (!(span = header.span.load()))
+					std::this_thread::yield();
+
+				return span;
+			}
+
+			span = _AllocateSpan<lock_v>(1);
+
+			auto& fresh = Header();
+			fresh.capacity = block_c * 256 / bits_per_key_c;
+			fresh.span = span;
+
+			return span;
+		}
+
+		//A locked add that raced _Grow adds again to the span that replaced the one it wrote:
+		//
+
+		template < bool lock_v > void _Add(const key_t& k)
+		{
+			uint64_t h = Hash(k);
+			uint64_t span = _Span<lock_v>();
+
+			if constexpr (lock_v)
+			{
+				for (uint64_t next = span;; span = next)
+				{
+					Block(span, h).AddLock((uint32_t)h);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+
+					if ((next = Header().span.load()) == span)
+						break;
+				}
+			}
+			else
+				Block(span, h).Add((uint32_t)h);
+		}
+
+		template < bool lock_v > void _Added(size_t n)
+		{
+			auto& header = Header();
+
+			if ((header.population += n) <= header.capacity)
+				return;
+
+			if constexpr (lock_v)
+				_Grow();
+			else
+				RebuildFilter(1);
+		}
+
+		//ORs block b of from into blocks 2b and 2b + 1 of to, a span twice its size:
+		//
+
+		void _Merge(uint64_t from, uint64_t to)
+		{
+			_FilterBlock* src = &io->template Lookup<_FilterBlock>(from >> span_bits_s);
+			_FilterBlock* dst = &io->template Lookup<_FilterBlock>(to >> span_bits_s);
+
+			uint64_t blocks = (from & ((1ull << span_bits_s) - 1)) * block_c;
+
+			for (uint64_t b = 0; b < blocks; b++)
+			{
+				for (size_t i = 0; i < 8; i++)
+				{
+					uint32_t w = ((std::atomic<uint32_t>*)(src[b].words + i))->load();
+
+					((std::atomic<uint32_t>*)(dst[2 * b].words + i))->fetch_or(w);
+					((std::atomic<uint32_t>*)(dst[2 * b + 1].words + i))->fetch_or(w);
+				}
+			}
+		}
+
+		/*
+			Doubles the filter beside concurrent writers and probes. A hash in block b of a span lands in block 2b or 2b + 1
+			of one twice its size, so the new span starts as two copies of every old block and no added key is lost.
+			The old span is merged again after the swap for adds that reached it during the copy, later ones see the swap in _Add.
+
+			Old keys keep their density in the copies, each doubling raises the false positive rate a little until
+			RebuildFilter sizes the filter from the tree again.
+		*/
+
+		void _Grow()
+		{
+			uint32_t expected = 0;
+
+			if (!Header().growing.compare_exchange_strong(expected, 1))
+				return;
+
+			uint64_t old = Header().span.load();
+			uint64_t units = (old & ((1ull << span_bits_s) - 1)) * 2;
+
+			if (units >= (1ull << span_bits_s))
+			{
+				Header().saturated = 1;
+				return;
+			}
+
+			uint64_t retired = Header().retired;
+
+			if (retired)
+				for (uint64_t i = 0; i < (retired & ((1ull << span_bits_s) - 1)); i++)
+					io->FreeUnitLock(io->template Lookup<typename R::Unit>((retired >> span_bits_s) + i));
+
+			uint64_t span = _AllocateSpan<true>(units);
+
+			_Merge(old, span);
+
+			auto& header = Header();
+
+			header.retired = old;
+			header.capacity = units * block_c * 256 / bits_per_key_c;
+			header.span = span;
+
+			_Merge(old, span);
+
+			header.growing = 0;
+		}
+
+	public:
+		_BloomBTree() {}
+
+		void Open(R* _io, size_t& _n)
+		{
+			base_t::Open(_io, _n);
+
+			io = _io;
+			filter_n = _n++;
+
+			if (io->size() <= filter_n)
+				io->template Allocate<_FilterHeader>();
+		}
+
+		//The filter's slot and span would outlive a dropped tree, so dropping is left to plain trees:
+		//
+
+		void Drop() = delete;
+
+		//False when k was never inserted, true when it may have been:
+		//
+
+		bool MayContain(const key_t& k) const
+		{
+			auto& header = Header();
+			uint64_t span = header.span.load();
+
+			if (!span)
+				return false;
+
+			if (header.saturated)
+				return true;
+
+			uint64_t h = Hash(k);
+
+			return Block(span, h).Contains((uint32_t)h);
+		}
+
+		//Keys counted by the filter and how many it holds before growing:
+		//
+
+		std::pair<uint64_t, uint64_t> FilterPopulation() const
+		{
+			auto& header = Header();
+
+			return { header.population.load(), header.capacity };
+		}
+
+		bool FilterSaturated() const
+		{
+			return Header().saturated != 0;
+		}
+
+		/*
+			Sizes a new filter for twice the population and fills it from the tree in parallel.
+			Probes may run meanwhile, writers may not.
+		*/
+
+		void RebuildFilter(size_t threads = 0)
+		{
+			uint64_t retired = Header().retired;
+
+			if (retired)
+				for (uint64_t i = 0; i < (retired & ((1ull << span_bits_s) - 1)); i++)
+					io->FreeUnit(io->template Lookup<typename R::Unit>((retired >> span_bits_s) + i));
+
+			uint64_t bytes = (std::max)(Header().population.load(), (uint64_t)1) * 2 * bits_per_key_c / 8;
+			uint64_t units = (std::min)((std::max)((uint64_t)io->MapLength(bytes), (uint64_t)1), (uint64_t)((1ull << span_bits_s) - 1));
+			uint64_t span = _AllocateSpan<false>(units);
+
+			size_t count = base_t::ParallelIterateKV([&](auto& k, auto& v)
+			{
+				uint64_t h = Hash(k);
+				Block(span, h).AddLock((uint32_t)h);
+
+				return true;
+			}, threads);
+
+			auto& header = Header();
+
+			header.retired = header.span.load();
+			header.capacity = units * block_c * 256 / bits_per_key_c;
+			header.population = count;
+			header.allocating = 1;
+			header.span = span;
+			header.saturated = 0;
+			header.growing = 0;
+		}
+
+		pointer_t* Find(const key_t& k, void* ref_page = nullptr) const
+		{
+			if (!MayContain(k))
+				return nullptr;
+
+			return base_t::Find(k, ref_page);
+		}
+
+		pointer_t* FindLock(const key_t& k, void* ref_page = nullptr) const
+		{
+			if (!MayContain(k))
+				return nullptr;
+
+			return base_t::FindLock(k, ref_page);
+		}
+
+		template <typename F> void MultiFind(F&& f, const key_t& k, void* ref_page = nullptr) const
+		{
+			if (MayContain(k))
+				base_t::MultiFind(f, k, ref_page);
+		}
+
+		//Only keys passing the filter go down the tree:
+		//
+
+		void FindBatch(gsl::span<const key_t> ks, gsl::span<pointer_t*> results, void* ref_page = nullptr) const
+		{
+			_FindBatch<false>(ks, results, ref_page);
+		}
+
+		void FindBatchLock(gsl::span<const key_t> ks, gsl::span<pointer_t*> results, void* ref_page = nullptr) const
+		{
+			_FindBatch<true>(ks, results, ref_page);
+		}
+
+		template < bool lock_v > void _FindBatch(gsl::span<const key_t> ks, gsl::span<pointer_t*> results, void* ref_page) const
+		{
+			if (results.size() < ks.size())
+				throw std::runtime_error("Batch results are too small");
+
+			std::vector<key_t> maybe;
+			std::vector<size_t> where;
+
+			for (size_t i = 0; i < ks.size(); i++)
+			{
+				results[i] = nullptr;
+
+				if (MayContain(ks[i]))
+				{
+					maybe.push_back(ks[i]);
+					where.push_back(i);
+				}
+			}
+
+			std::vector<pointer_t*> found(maybe.size());
+
+			if constexpr (lock_v)
+				base_t::FindBatchLock(gsl::span<const key_t>(maybe), gsl::span<pointer_t*>(found), ref_page);
+			else
+				base_t::FindBatch(gsl::span<const key_t>(maybe), gsl::span<pointer_t*>(found), ref_page);
+
+			for (size_t i = 0; i < found.size(); i++)
+				results[where[i]] = found[i];
+		}
+
+		void Insert(const gsl::span<key_t>& ks, const pointer_t& p)
+		{
+			for (auto& k : ks)
+				Insert(k, p);
+		}
+
+		pair<pointer_t*, bool> Insert(const key_t& k, const pointer_t& p)
+		{
+			_Add<false>(k);
+
+			auto result = base_t::Insert(k, p);
+
+			if (result.first && !result.second)
+				_Added<false>(1);
+
+			return result;
+		}
+
+		void InsertLock(const gsl::span<key_t>& ks, const pointer_t& p)
+		{
+			for (auto& k : ks)
+				InsertLock(k, p);
+		}
+
+		pair<pointer_t*, bool> InsertLock(const key_t& k, const pointer_t& p)
+		{
+			_Add<true>(k);
+
+			auto result = base_t::InsertLock(k, p);
+
+			if (result.first && !result.second)
+				_Added<true>(1);
+
+			return result;
+		}
+
+		template <typename F> pair<pointer_t*, bool> InsertLockContext(const key_t& k, const pointer_t& p, F&& f)
+		{
+			_Add<true>(k);
+
+			bool added = false;
+
+			auto result = base_t::InsertLockContext(k, p, [&](auto r)
+			{
+				added = r.first && !r.second;
+				return f(r);
+			});
+
+			if (added)
+				_Added<true>(1);
+
+			return result;
+		}
+
+		template < typename T > void InsertBatch(gsl::span<T> kv, gsl::span<pair<pointer_t*, bool>> results)
+		{
+			_InsertBatch<false>(kv, results);
+		}
+
+		template < typename T > void InsertBatchLock(gsl::span<T> kv, gsl::span<pair<pointer_t*, bool>> results)
+		{
+			_InsertBatch<true>(kv, results);
+		}
+
+		template < bool lock_v, typename T > void _InsertBatch(gsl::span<T> kv, gsl::span<pair<pointer_t*, bool>> results)
+		{
+			for (auto& e : kv)
+				_Add<lock_v>(e.first);
+
+			if constexpr (lock_v)
+				base_t::InsertBatchLock(kv, results);
+			else
+				base_t::InsertBatch(kv, results);
+
+			size_t added = 0;
+
+			for (size_t i = 0; i < kv.size(); i++)
+				if (results[i].first && !results[i].second)
+					added++;
+
+			_Added<lock_v>(added);
+		}
+
+		template < typename T > void BulkLoad(gsl::span<T> kv, bool sorted = true)
+		{
+			Header().population = base_t::BulkLoad(kv, sorted);
+			RebuildFilter();
+		}
+	};
+
+	template < typename R, typename N, size_t bits_per_key = 12 > using BloomTree = _BloomBTree<R, N, bits_per_key>;
+}
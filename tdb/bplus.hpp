@@ -0,0 +1,803 @@
+/* Copyright (C) 2020 D8DATAWORKS - All Rights Reserved */
+
+#pragma once
+
+#include "btree.hpp"
+
+namespace tdb
+{
+	/*
+		Self balancing B+tree over the ordered and multi list nodes.
+
+		_BTree places keys by their position in a node, which needs distributed keys: sequential keys pile into one
+		child per level and the tree turns into a chain. This engine splits full nodes and merges thin ones instead,
+		so every leaf sits at the same depth whatever order the keys arrive in.
+
+		Inner nodes reuse the node layout, keys[j] is the lowest key under child j and pointers[j] is the child unit.
+		links[0] and links[1] chain the leaves in key order, links[2] holds the level of the node ( 0 for leaves ).
+
+		The root never moves: a full root is copied into a fresh unit and becomes the only parent of that copy.
+		Splits and merges are done on the way down, so a writer only ever holds a parent and the children it edits.
+		Locks are taken top down and left to right along a level, readers couple locks the same way.
+	*/
+
+	template < typename R, typename node_t > class _BPlusTree
+	{
+		using key_t = typename node_t::Key;
+		using pointer_t = typename node_t::Pointer;
+		using link_t = typename node_t::Link;
+		using int_t = typename node_t::Int;
+		static const int link_c = node_t::Links;
+		static const int bin_c = node_t::Bins;
+
+		static const int next_l = 0;
+		static const int prev_l = 1;
+		static const int level_l = 2;
+
+		//An erase passing through a node this thin refills it from a neighbour:
+		//
+
+		static const int thin_c = bin_c / 4;
+
+		static_assert(node_t::type == TableType::btree_sorted_list || node_t::type == TableType::btree_sorted_multilist, "Balanced trees need ordered nodes");
+		static_assert(link_c >= 3, "Balanced trees keep the leaf chain and the level in the links");
+		static_assert(std::is_integral<pointer_t>::value && sizeof(pointer_t) >= sizeof(link_t), "Inner nodes keep child units in the pointers");
+
+		R* io = nullptr;
+		link_t root_n;
+
+		node_t* Node(link_t id) const
+		{
+			return &io->template Lookup<node_t>(id);
+		}
+
+		auto Root() const
+		{
+			return Node(root_n);
+		}
+
+		static size_t Level(const node_t* n)
+		{
+			return (size_t)n->links[level_l];
+		}
+
+	public:
+		_BPlusTree() {}
+
+		void Open(R* _io, size_t& _n)
+		{
+			root_n = _n++;
+			io = _io;
+
+			if (io->size() <= root_n)
+			{
+				auto r = &io->template Allocate<node_t>();
+				r->Init();
+
+				/*
+					Runtime Introspection:
+				*/
+
+				auto& desc = io->GetDescriptor(root_n);
+
+				desc.type = node_t::type;
+
+				desc.standard_index.self_balanced = (uint32_t)true;
+				desc.standard_index.requires_distributed_key = (uint32_t)false;
+
+				desc.standard_index.key_sz = sizeof(key_t);
+				desc.standard_index.link_sz = sizeof(link_t);
+				desc.standard_index.pointer_sz = sizeof(pointer_t);
+				desc.standard_index.key_mode = key_t::mode;
+				desc.standard_index.key_type = key_t::type;
+				desc.standard_index.hash_policy = _KeyHashPolicy<key_t>::value;
+
+				desc.standard_index.max_capacity = (uint32_t)node_t::Bins;
+				desc.standard_index.min_capacity = (uint16_t)thin_c;
+
+				desc.standard_index.max_page = (uint32_t)sizeof(node_t);
+				desc.standard_index.min_page = (uint16_t)-1;
+
+				desc.standard_index.link_count = node_t::Links;
+			}
+			else if (!io->GetDescriptor(root_n).standard_index.self_balanced)
+				throw std::runtime_error("Index was built by an unbalanced tree");
+			else if (!HashPolicyMatches(io->GetDescriptor(root_n).standard_index.hash_policy, _KeyHashPolicy<key_t>::value))
+				throw std::runtime_error("Index was built with a different key hash");
+		}
+
+	private:
+
+		template < bool lock_v > static void _Lock(node_t* n)
+		{
+			if constexpr (lock_v)
+				n->Lock();
+		}
+
+		template < bool lock_v > static void _Unlock(node_t* n)
+		{
+			if constexpr (lock_v)
+				n->Unlock();
+		}
+
+		//Entries move between nodes in bulk, so checked nodes recompute their checksum afterwards:
+		//
+
+		static void _Rehash(node_t* n)
+		{
+			n->checksum = (int_t)0;
+
+			for (int i = 0; i < (int)n->count; i++)
+				n->CheckKey(n->keys[i]);
+		}
+
+		int _Compare(node_t* n, int i, const key_t& k, void* ref_page) const
+		{
+			return n->keys[i].Compare(k, (void*)io, ref_page);
+		}
+
+		/*
+			Child j holds the keys from keys[j] up to keys[j+1], keys[0] bounds nothing.
+			Inserts take the last child whose separator is <= k, lookups the last one that is < k and walk right from there,
+			which reaches the first of a run of equal keys spanning several leaves.
+		*/
+
+		template < bool upper_v > int _Route(node_t* n, const key_t& k, void* ref_page) const
+		{
+			int low = 1;
+			int high = (int)n->count - 1;
+
+			while (low <= high)
+			{
+				int middle = (low + high) >> 1;
+				int c = _Compare(n, middle, k, ref_page);
+
+				if (c < 0 || (upper_v && c == 0))
+					low = middle + 1;
+				else
+					high = middle - 1;
+			}
+
+			return low - 1;
+		}
+
+		int _LowerBound(node_t* n, const key_t& k, void* ref_page) const
+		{
+			int low = 0;
+			int high = (int)n->count - 1;
+
+			while (low <= high)
+			{
+				int middle = (low + high) >> 1;
+
+				if (_Compare(n, middle, k, ref_page) < 0)
+					low = middle + 1;
+				else
+					high = middle - 1;
+			}
+
+			return low;
+		}
+
+		template < bool lock_v > link_t _Allocate(size_t level)
+		{
+			node_t* n;
+
+			if constexpr (lock_v)
+				n = &io->template RecycleLock<node_t>();
+			else
+				n = &io->template Recycle<node_t>();
+
+			n->Init();
+			n->links[level_l] = (link_t)level;
+
+			return (link_t)io->template Index<node_t>(*n);
+		}
+
+		template < bool lock_v > void _Free(node_t* n)
+		{
+			if constexpr (lock_v)
+				io->FreeUnitLock(*((typename R::Unit*)n));
+			else
+				io->FreeUnit(*((typename R::Unit*)n));
+		}
+
+		//Returns the locked leaf where a lookup of k starts:
+		//
+
+		template < bool lock_v > node_t* _Leaf(const key_t& k, void* ref_page) const
+		{
+			node_t* n = Root();
+			_Lock<lock_v>(n);
+
+			while (Level(n))
+			{
+				node_t* child = Node((link_t)n->pointers[_Route<false>(n, k, ref_page)]);
+
+				_Lock<lock_v>(child);
+				_Unlock<lock_v>(n);
+
+				n = child;
+			}
+
+			return n;
+		}
+
+		//Moves to the next leaf holding both locks, returns nullptr and keeps n locked at the end of the chain:
+		//
+
+		template < bool lock_v > node_t* _Next(node_t* n) const
+		{
+			if (!n->links[next_l])
+				return nullptr;
+
+			node_t* next = Node(n->links[next_l]);
+
+			_Lock<lock_v>(next);
+			_Unlock<lock_v>(n);
+
+			return next;
+		}
+
+		template < bool lock_v > pointer_t* _Find(const key_t& _k, void* ref_page) const
+		{
+			auto&& k = BindKey(_k, (void*)io, ref_page);
+			node_t* n = _Leaf<lock_v>(k, ref_page);
+			int i = _LowerBound(n, k, ref_page);
+
+			while (i == (int)n->count)
+			{
+				node_t* next = _Next<lock_v>(n);
+
+				if (!next)
+					break;
+
+				n = next;
+				i = _LowerBound(n, k, ref_page);
+			}
+
+			pointer_t* result = (i < (int)n->count && _Compare(n, i, k, ref_page) == 0) ? n->pointers + i : nullptr;
+
+			_Unlock<lock_v>(n);
+
+			return result;
+		}
+
+		/*
+			The locked root is full, copy it into a new unit and make the root its parent.
+		*/
+
+		template < bool lock_v > void _Grow()
+		{
+			link_t copy_id = _Allocate<lock_v>(Level(Root()));
+
+			node_t* root = Root();
+			node_t* copy = Node(copy_id);
+
+			memcpy(copy->keys, root->keys, sizeof(key_t) * root->count);
+			memcpy(copy->pointers, root->pointers, sizeof(pointer_t) * root->count);
+			copy->count = root->count;
+			copy->checksum = root->checksum;
+
+			root->count = 1;
+			root->pointers[0] = (pointer_t)copy_id;
+			root->links[level_l]++;
+
+			_Rehash(root);
+		}
+
+		/*
+			Moves the upper entries of the locked child j into a new locked sibling placed after it in the parent.
+			Tail splits keep the child full and start the sibling with a single entry, ascending keys then fill every node.
+			The allocation can remap, callers refresh their node pointers.
+		*/
+
+		template < bool lock_v > link_t _Split(link_t parent_id, int j, link_t id, bool tail)
+		{
+			link_t sibling_id = _Allocate<lock_v>(Level(Node(id)));
+
+			node_t* parent = Node(parent_id);
+			node_t* n = Node(id);
+			node_t* s = Node(sibling_id);
+
+			_Lock<lock_v>(s);
+
+			int keep = (tail) ? bin_c - 1 : bin_c / 2;
+			int moved = (int)n->count - keep;
+
+			memcpy(s->keys, n->keys + keep, sizeof(key_t) * moved);
+			memcpy(s->pointers, n->pointers + keep, sizeof(pointer_t) * moved);
+			s->count = moved;
+			n->count = keep;
+
+			_Rehash(n);
+			_Rehash(s);
+
+			if (!Level(n))
+			{
+				s->links[next_l] = n->links[next_l];
+				s->links[prev_l] = id;
+
+				if (s->links[next_l])
+				{
+					node_t* next = Node(s->links[next_l]);
+
+					_Lock<lock_v>(next);
+					next->links[prev_l] = sibling_id;
+					_Unlock<lock_v>(next);
+				}
+
+				n->links[next_l] = sibling_id;
+			}
+
+			parent->Expand(j + 1);
+			parent->keys[j + 1] = s->keys[0];
+			parent->pointers[j + 1] = (pointer_t)sibling_id;
+			parent->CheckKey(parent->keys[j + 1]);
+
+			return sibling_id;
+		}
+
+		template < bool lock_v, typename F > auto _Insert(const key_t& _k, const pointer_t& p, F&& f)
+		{
+			auto&& k = BindKey(_k, (void*)io, nullptr);
+
+			link_t id = root_n;
+
+			_Lock<lock_v>(Root());
+
+			if ((int)Root()->count == bin_c)
+				_Grow<lock_v>();
+
+			bool tail = true;
+
+			while (Level(Node(id)))
+			{
+				node_t* n = Node(id);
+				int j = _Route<true>(n, k, nullptr);
+				link_t child_id = (link_t)n->pointers[j];
+				node_t* child = Node(child_id);
+
+				_Lock<lock_v>(child);
+
+				if ((int)child->count == bin_c)
+				{
+					bool append = tail && j == (int)n->count - 1 && child->keys[bin_c - 1].Compare(k, (void*)io, nullptr) < 0;
+					link_t sibling_id = _Split<lock_v>(id, j, child_id, append);
+
+					n = Node(id);
+
+					if (n->keys[j + 1].Compare(k, (void*)io, nullptr) <= 0)
+					{
+						_Unlock<lock_v>(Node(child_id));
+						child_id = sibling_id;
+						j++;
+					}
+					else
+						_Unlock<lock_v>(Node(sibling_id));
+				}
+
+				tail = tail && j == (int)n->count - 1;
+
+				_Unlock<lock_v>(n);
+				id = child_id;
+			}
+
+			node_t* leaf = Node(id);
+
+			pair<pointer_t*, bool> overwrite;
+			leaf->Insert(k, p, overwrite, 0, (void*)io);
+
+			auto result = f(overwrite);
+
+			_Unlock<lock_v>(leaf);
+
+			return result;
+		}
+
+		/*
+			A locked inner root with a single child takes over the content of that child.
+		*/
+
+		template < bool lock_v > void _Collapse()
+		{
+			node_t* root = Root();
+
+			while (Level(root) && root->count == 1)
+			{
+				node_t* child = Node((link_t)root->pointers[0]);
+
+				_Lock<lock_v>(child);
+
+				memcpy(root->keys, child->keys, sizeof(key_t) * child->count);
+				memcpy(root->pointers, child->pointers, sizeof(pointer_t) * child->count);
+				root->count = child->count;
+				root->checksum = child->checksum;
+				root->links[level_l] = child->links[level_l];
+
+				_Unlock<lock_v>(child);
+				_Free<lock_v>(child);
+			}
+		}
+
+		/*
+			Child j of the locked parent is thin, pair it with a neighbour and either merge the two or share their entries evenly.
+			Merges always fold the right node into the left one.
+		*/
+
+		template < bool lock_v > void _Refill(link_t parent_id, int j)
+		{
+			node_t* parent = Node(parent_id);
+
+			if (parent->count < 2)
+				return;
+
+			int l = (j + 1 < (int)parent->count) ? j : j - 1;
+
+			link_t left_id = (link_t)parent->pointers[l];
+			node_t* left = Node(left_id);
+			node_t* right = Node((link_t)parent->pointers[l + 1]);
+
+			_Lock<lock_v>(left);
+			_Lock<lock_v>(right);
+
+			int total = (int)left->count + (int)right->count;
+
+			if (total <= bin_c)
+			{
+				memcpy(left->keys + left->count, right->keys, sizeof(key_t) * right->count);
+				memcpy(left->pointers + left->count, right->pointers, sizeof(pointer_t) * right->count);
+				left->count = total;
+
+				if (!Level(left))
+				{
+					left->links[next_l] = right->links[next_l];
+
+					if (left->links[next_l])
+					{
+						node_t* next = Node(left->links[next_l]);
+
+						_Lock<lock_v>(next);
+						next->links[prev_l] = left_id;
+						_Unlock<lock_v>(next);
+					}
+				}
+
+				_Rehash(left);
+				parent->Shrink(l + 1);
+
+				_Unlock<lock_v>(right);
+				_Free<lock_v>(right);
+			}
+			else
+			{
+				int half = total / 2;
+
+				if ((int)left->count > half)
+				{
+					int m = (int)left->count - half;
+
+					memmove(right->keys + m, right->keys, sizeof(key_t) * right->count);
+					memmove(right->pointers + m, right->pointers, sizeof(pointer_t) * right->count);
+					memcpy(right->keys, left->keys + half, sizeof(key_t) * m);
+					memcpy(right->pointers, left->pointers + half, sizeof(pointer_t) * m);
+					right->count += m;
+					left->count = half;
+				}
+				else
+				{
+					int m = half - (int)left->count;
+
+					memcpy(left->keys + left->count, right->keys, sizeof(key_t) * m);
+					memcpy(left->pointers + left->count, right->pointers, sizeof(pointer_t) * m);
+					memmove(right->keys, right->keys + m, sizeof(key_t) * (right->count - m));
+					memmove(right->pointers, right->pointers + m, sizeof(pointer_t) * (right->count - m));
+					right->count -= m;
+					left->count = half;
+				}
+
+				_Rehash(left);
+				_Rehash(right);
+
+				parent->CheckKey(parent->keys[l + 1]);
+				parent->keys[l + 1] = right->keys[0];
+				parent->CheckKey(parent->keys[l + 1]);
+
+				_Unlock<lock_v>(right);
+			}
+
+			_Unlock<lock_v>(left);
+		}
+
+		template < bool lock_v, typename F > size_t _EraseIf(F&& f, const key_t& k, void* ref_page)
+		{
+			link_t id = root_n;
+			node_t* n = Root();
+
+			_Lock<lock_v>(n);
+			_Collapse<lock_v>();
+
+			while (Level(n))
+			{
+				int j = _Route<false>(n, k, ref_page);
+				node_t* child = Node((link_t)n->pointers[j]);
+
+				_Lock<lock_v>(child);
+
+				if ((int)child->count <= thin_c && n->count > 1)
+				{
+					_Unlock<lock_v>(child);
+					_Refill<lock_v>(id, j);
+
+					if (id == root_n)
+						_Collapse<lock_v>();
+
+					//The separators moved, route again:
+					//
+
+					continue;
+				}
+
+				_Unlock<lock_v>(n);
+
+				id = (link_t)n->pointers[j];
+				n = child;
+			}
+
+			size_t erased = 0;
+
+			for (int i = _LowerBound(n, k, ref_page);;)
+			{
+				while (i < (int)n->count && _Compare(n, i, k, ref_page) == 0)
+				{
+					if (f(n->pointers + i))
+					{
+						n->Shrink(i);
+						erased++;
+					}
+					else
+						i++;
+				}
+
+				if (i < (int)n->count)
+					break;
+
+				node_t* next = _Next<lock_v>(n);
+
+				if (!next)
+					break;
+
+				n = next;
+				i = 0;
+			}
+
+			_Unlock<lock_v>(n);
+
+			return erased;
+		}
+
+		node_t* _First() const
+		{
+			node_t* n = Root();
+
+			while (Level(n))
+				n = Node((link_t)n->pointers[0]);
+
+			return n;
+		}
+
+		bool _Validate(link_t id, size_t level, const key_t* low, const key_t* high, link_t& last) const
+		{
+			node_t* n = Node(id);
+
+			if (Level(n) != level || !n->Validate())
+				return false;
+
+			if (id != root_n && !n->count && level)
+				return false;
+
+			//keys[0] of an inner node is not a separator and can be stale:
+			//
+
+			for (int i = (level) ? 1 : 0; i < (int)n->count; i++)
+			{
+				if (i > ((level) ? 1 : 0))
+				{
+					int c = _Compare(n, i - 1, n->keys[i], nullptr);
+
+					if (c > 0 || (c == 0 && node_t::type == TableType::btree_sorted_list))
+						return false;
+				}
+
+				if (low && _Compare(n, i, *low, nullptr) < 0)
+					return false;
+
+				if (high && _Compare(n, i, *high, nullptr) > 0)
+					return false;
+			}
+
+			if (!level)
+			{
+				if (n->links[prev_l] != last || (last && Node(last)->links[next_l] != id))
+					return false;
+
+				last = id;
+
+				return true;
+			}
+
+			for (int j = 0; j < (int)n->count; j++)
+				if (!_Validate((link_t)n->pointers[j], level - 1, (j) ? n->keys + j : low, (j + 1 < (int)n->count) ? n->keys + j + 1 : high, last))
+					return false;
+
+			return true;
+		}
+
+	public:
+
+		bool Validate() const
+		{
+			link_t last = 0;
+
+			if (!_Validate(root_n, Level(Root()), nullptr, nullptr, last))
+				return false;
+
+			return !last || !Node(last)->links[next_l];
+		}
+
+		//Levels from the root to the leaves, the same for every leaf:
+		//
+
+		size_t Depth() const
+		{
+			return Level(Root()) + 1;
+		}
+
+		std::pair<uint64_t, uint64_t> Population() const
+		{
+			auto sum = std::make_pair(uint64_t(0), uint64_t(0));
+
+			std::vector<link_t> stack = { root_n };
+
+			while (stack.size())
+			{
+				node_t* n = Node(stack.back());
+				stack.pop_back();
+
+				sum.first += n->count;
+				sum.second += node_t::Bins;
+
+				if (Level(n))
+					for (int j = 0; j < (int)n->count; j++)
+						stack.push_back((link_t)n->pointers[j]);
+			}
+
+			return sum;
+		}
+
+		//Leaves are chained, iteration is in key order:
+		//
+
+		template < typename F > int Iterate(F&& f) const
+		{
+			int count = 0;
+
+			for (node_t* n = _First(); n; n = (n->links[next_l]) ? Node(n->links[next_l]) : nullptr)
+				for (int i = 0; i < (int)n->count; i++, count++)
+					if (!f(n->pointers[i]))
+						return count + 1;
+
+			return count;
+		}
+
+		template < typename F > int IterateKV(F&& f) const
+		{
+			int count = 0;
+
+			for (node_t* n = _First(); n; n = (n->links[next_l]) ? Node(n->links[next_l]) : nullptr)
+				for (int i = 0; i < (int)n->count; i++, count++)
+					if (!f(n->keys[i], n->pointers[i]))
+						return count + 1;
+
+			return count;
+		}
+
+		pointer_t* Find(const key_t& k, void* ref_page = nullptr) const
+		{
+			return _Find<false>(k, ref_page);
+		}
+
+		pointer_t* FindLock(const key_t& k, void* ref_page = nullptr) const
+		{
+			return _Find<true>(k, ref_page);
+		}
+
+		template <typename F> void MultiFind(F&& f, const key_t& _k, void* ref_page = nullptr) const
+		{
+			auto&& k = BindKey(_k, (void*)io, ref_page);
+			node_t* n = _Leaf<false>(k, ref_page);
+
+			for (int i = _LowerBound(n, k, ref_page); n; n = _Next<false>(n), i = 0)
+			{
+				for (; i < (int)n->count; i++)
+				{
+					if (_Compare(n, i, k, ref_page) != 0)
+						return;
+
+					if (!f(n->pointers + i))
+						return;
+				}
+			}
+		}
+
+		template <typename F> void RangeFind(F&& f, const key_t& low_k, const key_t& high_k, void* ref_page = nullptr) const
+		{
+			node_t* n = _Leaf<false>(low_k, ref_page);
+
+			for (int i = _LowerBound(n, low_k, ref_page); n; n = _Next<false>(n), i = 0)
+			{
+				for (; i < (int)n->count; i++)
+				{
+					if (_Compare(n, i, high_k, ref_page) > 0)
+						return;
+
+					f(n->keys[i], n->pointers[i]);
+				}
+			}
+		}
+
+		void Insert(const gsl::span<key_t>& ks, const pointer_t& p)
+		{
+			for (auto& k : ks)
+				Insert(k, p);
+		}
+
+		pair<pointer_t*, bool> Insert(const key_t& k, const pointer_t& p)
+		{
+			return _Insert<false>(k, p, [](auto r) { return r; });
+		}
+
+		void InsertLock(const gsl::span<key_t>& ks, const pointer_t& p)
+		{
+			for (auto& k : ks)
+				InsertLock(k, p);
+		}
+
+		pair<pointer_t*, bool> InsertLock(const key_t& k, const pointer_t& p)
+		{
+			return _Insert<true>(k, p, [](auto r) { return r; });
+		}
+
+		template <typename F> pair<pointer_t*, bool> InsertLockContext(const key_t& k, const pointer_t& p, F&& f)
+		{
+			return _Insert<true>(k, p, f);
+		}
+
+		/*
+			Erase removes every entry matching the key, EraseIf only those accepted by the predicate ( f(pointer_t*) -> bool ).
+			Both return the number of entries removed, thin nodes met on the way down are merged or refilled.
+		*/
+
+		size_t Erase(const key_t& k, void* ref_page = nullptr)
+		{
+			return _EraseIf<false>([](auto*) { return true; }, k, ref_page);
+		}
+
+		template <typename F> size_t EraseIf(F&& f, const key_t& k, void* ref_page = nullptr)
+		{
+			return _EraseIf<false>(f, k, ref_page);
+		}
+
+		size_t EraseLock(const key_t& k, void* ref_page = nullptr)
+		{
+			return _EraseIf<true>([](auto*) { return true; }, k, ref_page);
+		}
+
+		template <typename F> size_t EraseIfLock(F&& f, const key_t& k, void* ref_page = nullptr)
+		{
+			return _EraseIf<true>(f, k, ref_page);
+		}
+	};
+
+	template < typename R, typename N > using BPlusTree = _BPlusTree<R, N>;
+}
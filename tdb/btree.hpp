@@ -7,10 +7,26 @@
 #include <utility>
 #include <thread>
 #include <chrono>
+#include <vector>
+#include <memory>
+#include <map>
+#include <optional>
+#include <mutex>
+#include <unordered_set>
+#include <type_traits>
+#include <algorithm>
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #include "../gsl-lite.hpp"
 
 #include "keys.hpp"
+#include "parallel.hpp"
 #include "types.hpp"
 
 namespace tdb
@@ -41,10 +57,68 @@ namespace tdb
 		}
 	};
 
-	template < typename int_t, typename key_t, typename pointer_t, typename link_t, size_t bin_c, size_t link_c, bool check_v = false > struct _BaseNode
+	/*
+		Node layouts, align_c of 0 packs the arrays edge to edge.
+
+		Aligned layouts start the key and pointer arrays on align_c boundaries and give the lock word a line of its own,
+		writers spinning on it don't evict the count and links readers are loading. An array already on a boundary gets no pad,
+		the layers below leave an empty pad out instead of declaring a zero length array.
+	*/
+
+	constexpr size_t _AlignPad(size_t offset, size_t align_c) { return (align_c - offset % align_c) % align_c; }
+
+	template < typename base_t, size_t pad_c > struct _Padded : base_t
+	{
+		uint8_t padding[pad_c];
+	};
+
+	template < typename base_t > struct _Padded<base_t, 0> : base_t {};
+
+	template < typename key_t, size_t bin_c > struct _LayoutKeys
+	{
+		key_t keys[bin_c];
+	};
+
+	template < typename int_t, typename key_t, typename pointer_t, typename link_t, size_t bin_c, size_t link_c, size_t align_c > struct _LayoutBody
+		: _Padded< _LayoutKeys<key_t, bin_c>, _AlignPad(sizeof(key_t) * bin_c, align_c) >
+	{
+		pointer_t pointers[bin_c];
+
+		link_t links[link_c] = { 0 };
+
+		int_t count = 0;
+
+		int_t checksum = (int_t)0;
+	};
+
+	template < typename int_t, typename key_t, typename pointer_t, typename link_t, size_t bin_c, size_t link_c, size_t align_c > struct _NodeLayout
+		: _Padded< _LayoutBody<int_t, key_t, pointer_t, link_t, bin_c, link_c, align_c>, _AlignPad(sizeof(_LayoutBody<int_t, key_t, pointer_t, link_t, bin_c, link_c, align_c>), align_c) >
+	{
+		using body_t = _LayoutBody<int_t, key_t, pointer_t, link_t, bin_c, link_c, align_c>;
+
+		static const uint64_t _guard = 0xfe3451dceabc45afull;
+
+		static const size_t key_padding_c = _AlignPad(sizeof(key_t) * bin_c, align_c);
+		static const size_t pointers_offset_c = sizeof(key_t) * bin_c + key_padding_c;
+		static const size_t lock_padding_c = _AlignPad(sizeof(body_t), align_c);
+		static const size_t lock_offset_c = sizeof(body_t) + lock_padding_c;
+		static const size_t size_c = lock_offset_c + align_c;
+
+		static_assert(sizeof(body_t) == pointers_offset_c + sizeof(pointer_t) * bin_c + sizeof(link_t) * link_c + sizeof(int_t) * 2);
+		static_assert(pointers_offset_c % align_c == 0 && lock_offset_c % align_c == 0);
+		static_assert(align_c > sizeof(int_t));
+
+		int_t footer_guard = (int_t)_guard;
+
+		uint8_t lock_tail[align_c - sizeof(int_t)];
+	};
+
+	template < typename int_t, typename key_t, typename pointer_t, typename link_t, size_t bin_c, size_t link_c > struct _NodeLayout<int_t, key_t, pointer_t, link_t, bin_c, link_c, 0>
 	{
 		static const uint64_t _guard = 0xfe3451dceabc45afull;
 
+		static const size_t size_c = (sizeof(key_t) + sizeof(pointer_t)) * bin_c + sizeof(link_t) * link_c + sizeof(int_t) * 3;
+
 		key_t keys[bin_c];
 
 		pointer_t pointers[bin_c];
@@ -56,6 +130,19 @@ namespace tdb
 		int_t checksum = (int_t)0;
 
 		int_t footer_guard = (int_t)_guard;
+	};
+
+	template < typename int_t, typename key_t, typename pointer_t, typename link_t, size_t bin_c, size_t link_c, bool check_v = false, size_t align_c = 0 > struct _BaseNode : public _NodeLayout<int_t, key_t, pointer_t, link_t, bin_c, link_c, align_c>
+	{
+		using layout_t = _NodeLayout<int_t, key_t, pointer_t, link_t, bin_c, link_c, align_c>;
+
+		using layout_t::_guard;
+		using layout_t::keys;
+		using layout_t::pointers;
+		using layout_t::links;
+		using layout_t::count;
+		using layout_t::checksum;
+		using layout_t::footer_guard;
 
 		void Lock()
 		{
@@ -91,6 +178,20 @@ namespace tdb
 			lock->store((int_t)_guard, std::memory_order_release);
 		}
 
+		static void _Prefetch(const void* p)
+		{
+			_mm_prefetch((const char*)p, _MM_HINT_T0);
+		}
+
+		//Warm the lines a lookup touches first, the count and the middle of the binary search:
+		//
+
+		void Prefetch(const key_t& k, size_t depth) const
+		{
+			_Prefetch(&count);
+			_Prefetch(keys + (bin_c - 1) / 2);
+		}
+
 		void Expand(int c)
 		{
 			for (int i = (int)count - 1; i >= c; i--)
@@ -102,6 +203,294 @@ namespace tdb
 			count++;
 		}
 
+		void Shrink(int c)
+		{
+			CheckKey(keys[c]);
+
+			for (int i = c; i < (int)count - 1; i++)
+				memcpy(keys + i, keys + (i + 1), sizeof(key_t));
+
+			for (int i = c; i < (int)count - 1; i++)
+				memcpy(pointers + i, pointers + (i + 1), sizeof(pointer_t));
+
+			count--;
+		}
+
+		/*
+			Erased entries in nodes with children keep their key so routing below them is unchanged. Full leaves keep theirs too,
+			a locked insert may be passing through one unlocked and is about to hang a child off its layout. Hash nodes keep
+			every erased bin until the node empties, their inserts stop probing at the first never used bin.
+			The pointer is replaced with a tombstone that lookups skip and inserts of the same key revive.
+			For integral pointer_t the tombstone is (pointer_t)-2, a value the tree won't store: inserting it throws.
+		*/
+
+		static pointer_t Tombstone() { return (pointer_t)-2; }
+
+		static bool Erased(const pointer_t& p)
+		{
+			if constexpr (std::is_integral<pointer_t>::value)
+				return p == (pointer_t)-2;
+			else
+				return false;
+		}
+
+		template < typename F > bool Visit(F&& f, int c)
+		{
+			return Erased(pointers[c]) || f(pointers + c);
+		}
+
+		bool Leaf() const
+		{
+			for (size_t i = 0; i < link_c; i++)
+				if (links[i])
+					return false;
+
+			return true;
+		}
+
+		void Compact()
+		{
+			int j = 0;
+
+			for (int i = 0; i < (int)count; i++)
+			{
+				if (Erased(pointers[i]))
+				{
+					CheckKey(keys[i]);
+					continue;
+				}
+
+				if (i != j)
+				{
+					memcpy(keys + j, keys + i, sizeof(key_t));
+					memcpy(pointers + j, pointers + i, sizeof(pointer_t));
+				}
+
+				j++;
+			}
+
+			count = j;
+		}
+
+		/*
+			Bulk load of a sorted run into an empty node. Runs larger than the node keep bin_c keys as separators
+			and hand every child one contiguous run, placed in the first gap that routes to that child.
+		*/
+
+		template < typename T, typename F > void Load(T* kv, size_t n, size_t depth, void* ref_pages, F&& child)
+		{
+			if (n <= bin_c)
+			{
+				for (size_t i = 0; i < n; i++)
+				{
+					CheckKey(kv[i].first);
+
+					keys[i] = kv[i].first;
+					pointers[i] = kv[i].second;
+				}
+
+				count = (int_t)n;
+
+				return;
+			}
+
+			size_t gap[link_c], run[link_c], size[link_c], start[link_c];
+			size_t spill = n - bin_c;
+
+			for (size_t c = 0; c < link_c; c++)
+				gap[c] = (c * bin_c + link_c - 1) / link_c;
+
+			for (size_t c = 0; c < link_c; c++)
+			{
+				run[c] = ((c + 1 < link_c) ? gap[c + 1] : bin_c) - gap[c];
+				size[c] = spill / link_c + ((c < spill % link_c) ? 1 : 0);
+			}
+
+			//Equal keys can't open a child run, lookups would route them through the separator on their left. They go to the
+			//nearest child on the left that can take them, an empty child whose run would also open on that key is passed over:
+			//
+
+			for (size_t c = 0; c < link_c; c++)
+			{
+				start[c] = (c) ? start[c - 1] + size[c - 1] + run[c - 1] : 0;
+
+				while (c && size[c] && kv[start[c]].first.Compare(kv[start[c] - 1].first, ref_pages, nullptr) == 0)
+				{
+					size_t t = c - 1;
+
+					while (t && !size[t] && kv[start[t]].first.Compare(kv[start[t] - 1].first, ref_pages, nullptr) == 0)
+						t--;
+
+					size[t]++;
+					size[c]--;
+
+					for (size_t u = t + 1; u <= c; u++)
+						start[u]++;
+				}
+			}
+
+			for (size_t c = 0; c < link_c; c++)
+			{
+				for (size_t i = 0; i < run[c]; i++)
+				{
+					auto& e = kv[start[c] + size[c] + i];
+
+					CheckKey(e.first);
+
+					keys[gap[c] + i] = e.first;
+					pointers[gap[c] + i] = e.second;
+				}
+
+				child((int)c, kv + start[c], size[c]);
+			}
+
+			count = (int_t)bin_c;
+		}
+
+		/*
+			Batch insert of a sorted run, kv[order[0..n)] are key / pointer pairs. New keys are merged into the node with one
+			backwards shift, the rest are reported through f(i, result, slot, overwrite) like Insert would ( result > 0 is the child ).
+		*/
+
+		template < bool multi_v, typename T, typename F > void _InsertBatch(T* kv, const size_t* order, size_t n, void* ref_pages, F&& f)
+		{
+			auto search = [&](key_t& k, bool& found)
+			{
+				int low = 0;
+				int high = (int)count - 1;
+
+				found = false;
+
+				while (low <= high)
+				{
+					int middle = (low + high) >> 1;
+
+					switch (keys[middle].Compare(k, ref_pages, nullptr))
+					{
+					case -1:
+						low = middle + 1;
+						break;
+					case 1:
+						high = middle - 1;
+						break;
+					case 0:
+						if constexpr (multi_v)
+						{
+							while (middle > 0 && keys[middle - 1].Compare(k, ref_pages, nullptr) == 0)
+								middle--;
+						}
+
+						found = true;
+						return middle;
+					}
+				}
+
+				return low;
+			};
+
+			auto route = [&](int low)
+			{
+				if (low == (int)bin_c)
+					low--;
+
+				return (low * link_c / bin_c) + 1;
+			};
+
+			std::vector<size_t> fresh;
+			std::vector<int> slot(n, -1);
+			std::vector<uint8_t> inserted(n, 0);
+
+			fresh.reserve(n);
+
+			for (size_t i = 0; i < n; i++)
+			{
+				auto& e = kv[order[i]];
+
+				if constexpr (!multi_v)
+				{
+					//Repeated keys and keys already here are resolved by the lookup pass:
+					//
+
+					if (i && e.first.Compare(kv[order[i - 1]].first, ref_pages, nullptr) == 0)
+						continue;
+
+					bool found;
+					int c = search(e.first, found);
+
+					if (found)
+					{
+						if (Erased(pointers[c]))
+						{
+							pointers[c] = e.second;
+							inserted[i] = 1;
+						}
+
+						continue;
+					}
+				}
+
+				fresh.push_back(i);
+			}
+
+			size_t take = (bin_c - count < fresh.size()) ? bin_c - count : fresh.size();
+
+			if (take)
+			{
+				int a = (int)count - 1;
+				int b = (int)take - 1;
+				int w = (int)(count + take) - 1;
+
+				while (b >= 0)
+				{
+					auto& e = kv[order[fresh[b]]];
+
+					if (a >= 0 && keys[a].Compare(e.first, ref_pages, nullptr) == 1)
+					{
+						memcpy(keys + w, keys + a, sizeof(key_t));
+						memcpy(pointers + w, pointers + a, sizeof(pointer_t));
+						a--;
+					}
+					else
+					{
+						CheckKey(e.first);
+
+						keys[w] = e.first;
+						pointers[w] = e.second;
+
+						slot[fresh[b]] = w;
+						inserted[fresh[b]] = 1;
+						b--;
+					}
+
+					w--;
+				}
+
+				count += (int_t)take;
+			}
+
+			for (size_t i = 0; i < n; i++)
+			{
+				auto& e = kv[order[i]];
+
+				if constexpr (multi_v)
+				{
+					if (slot[i] != -1)
+					{
+						f(i, 0, slot[i], false);
+						continue;
+					}
+				}
+
+				bool found;
+				int c = search(e.first, found);
+
+				if (found && !multi_v)
+					f(i, 0, c, !inserted[i]);
+				else
+					f(i, route(c), -1, false);
+			}
+		}
+
 		bool Validate()
 		{
 			if constexpr (check_v)
@@ -197,7 +586,7 @@ namespace tdb
 		}
 	};*/
 
-	template < typename int_t, typename key_t, typename pointer_t, typename link_t, size_t bin_c, size_t link_c, size_t padding_c = 0, bool check_v = false > struct _OrderedListNode : public _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>
+	template < typename int_t, typename key_t, typename pointer_t, typename link_t, size_t bin_c, size_t link_c, size_t padding_c = 0, bool check_v = false, size_t align_c = 0 > struct _OrderedListNode : public _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>
 	{
 		static const uint32_t type = TableType::btree_sorted_list;
 
@@ -211,17 +600,26 @@ namespace tdb
 		static const int Links = link_c;
 		static const int Padding = padding_c;
 
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::keys;
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::pointers;
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::links;
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::count;
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::CheckKey;
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::Expand;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::keys;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::pointers;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::links;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::count;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::CheckKey;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Expand;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Shrink;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Leaf;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Erased;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Tombstone;
 
 		void Init() {}
 
 		size_t max_rec() { return (size_t)-1; }
 
+		template < typename T, typename F > void InsertBatch(T* kv, const size_t* order, size_t n, size_t depth, void* ref_pages, F&& f)
+		{
+			this->template _InsertBatch<false>(kv, order, n, ref_pages, f);
+		}
+
 		int Insert(const key_t& k, const pointer_t& p, pair<pointer_t*, bool>& overwrite, size_t depth,void*ref_pages)
 		{
 			overwrite = { nullptr,false };
@@ -254,6 +652,14 @@ namespace tdb
 					high = middle - 1;
 					break;
 				case 0:
+					if (Erased(pointers[middle]))
+					{
+						pointers[middle] = p;
+						overwrite = { pointers + middle, false };
+
+						return 0;
+					}
+
 					overwrite = { pointers + middle,true };
 					//pointers[middle] = p; // We allow the call to update the existing object if needed / wanted.
 					return 0;
@@ -307,7 +713,7 @@ namespace tdb
 					high = middle - 1;
 					break;
 				case 0:
-					*pr = pointers + middle;
+					*pr = (Erased(pointers[middle])) ? nullptr : pointers + middle;
 					return 0;
 				}
 			}
@@ -360,7 +766,8 @@ namespace tdb
 				low++;
 
 			for (high = low; high < count && keys[high].Compare(low_k, ref_pages, ref_page2) >= 0 && keys[high].Compare(high_k, ref_pages, ref_page2) <= 0; high++)
-				f(keys[high],pointers[high]);
+				if (!Erased(pointers[high]))
+					f(keys[high],pointers[high]);
 
 			if (count == bin_c)
 			{
@@ -374,6 +781,56 @@ namespace tdb
 			else
 				return std::make_pair(0, 0);			
 		}
+
+		template < typename F > int Erase(F&& f, const key_t& k, size_t& erased, size_t depth, void* ref_pages, void* ref_page2)
+		{
+			static_assert(std::is_integral<pointer_t>::value, "Erase requires integral pointers");
+
+			if (!count)
+				return 0;
+
+			int low = 0;
+			int high = (int)count - 1;
+
+			while (low <= high)
+			{
+				int middle = (low + high) >> 1;
+
+				switch (keys[middle].Compare(k, ref_pages, ref_page2))
+				{
+				case -1:
+					low = middle + 1;
+					break;
+				case 1:
+					high = middle - 1;
+					break;
+				case 0:
+					if (!Erased(pointers[middle]) && f(pointers + middle))
+					{
+						erased++;
+
+						if (Leaf() && (size_t)count != bin_c)
+							Shrink(middle);
+						else
+							pointers[middle] = Tombstone();
+					}
+
+					return 0;
+				}
+			}
+
+			if ((size_t)count == bin_c)
+			{
+				if (low == (int)bin_c)
+					low--;
+				else if (low == -1)
+					low++;
+
+				return (low * link_c / bin_c) + 1;
+			}
+			else
+				return 0;
+		}
 	};
 
 	//TODO LOCAL SURROGATE, benchmark
@@ -500,7 +957,7 @@ namespace tdb
 	};*/
 
 
-	template < typename int_t, typename key_t, typename pointer_t, typename link_t, size_t bin_c, size_t link_c, size_t padding_c = 0, bool check_v = false > struct _OrderedMultiListNode : public _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>
+	template < typename int_t, typename key_t, typename pointer_t, typename link_t, size_t bin_c, size_t link_c, size_t padding_c = 0, bool check_v = false, size_t align_c = 0 > struct _OrderedMultiListNode : public _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>
 	{
 		static const uint32_t type = TableType::btree_sorted_multilist;
 
@@ -514,17 +971,27 @@ namespace tdb
 		static const int Links = link_c;
 		static const int Padding = padding_c;
 
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::keys;
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::pointers;
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::links;
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::count;
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::Expand;
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::CheckKey;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::keys;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::pointers;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::links;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::count;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Expand;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::CheckKey;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Shrink;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Leaf;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Erased;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Tombstone;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Visit;
 
 		void Init() {}
 
 		size_t max_rec() { return (size_t)-1; }
 
+		template < typename T, typename F > void InsertBatch(T* kv, const size_t* order, size_t n, size_t depth, void* ref_pages, F&& f)
+		{
+			this->template _InsertBatch<true>(kv, order, n, ref_pages, f);
+		}
+
 		int Insert(const key_t& k, const pointer_t& p, pair<pointer_t*, bool>& overwrite, size_t depth, void* ref_pages)
 		{
 			overwrite = { nullptr,false };
@@ -636,15 +1103,15 @@ namespace tdb
 
 						auto upper = middle;
 
-						if (!f(pointers + middle))
+						if (!Visit(f, middle))
 							return 0;
 
 						while (upper < bin_c - 1 && keys[upper + 1].Compare(k, ref_pages, ref_page2) == 0)
-							if (!f(pointers + ++upper))
+							if (!Visit(f, ++upper))
 								return 0;
 
 						while (middle > 0 && keys[middle - 1].Compare(k, ref_pages, ref_page2) == 0)
-							if (!f(pointers + --middle))
+							if (!Visit(f, --middle))
 								return 0;
 
 						return (middle * link_c / bin_c) + 1;
@@ -653,15 +1120,15 @@ namespace tdb
 					{
 						auto upper = middle;
 
-						if (!f(pointers + middle))
+						if (!Visit(f, middle))
 							return 0;
 
 						while (upper < count - 1 && keys[upper + 1].Compare(k, ref_pages, ref_page2) == 0)
-							if (!f(pointers + ++upper))
+							if (!Visit(f, ++upper))
 								return 0;
 
 						while (middle > 0 && keys[middle - 1].Compare(k, ref_pages, ref_page2) == 0)
-							if (!f(pointers + --middle))
+							if (!Visit(f, --middle))
 								return 0;
 
 						return 0;
@@ -705,8 +1172,34 @@ namespace tdb
 					high = middle - 1;
 					break;
 				case 0:
-					*pr = pointers + middle;
-					return 0;
+					if (!Erased(pointers[middle]))
+					{
+						*pr = pointers + middle;
+						return 0;
+					}
+
+					//Erased duplicates stay in place, look for a live neighbour before descending:
+					//
+
+					for (high = middle + 1; high < (int)count && keys[high].Compare(k, ref_pages, ref_page2) == 0; high++)
+					{
+						if (!Erased(pointers[high]))
+						{
+							*pr = pointers + high;
+							return 0;
+						}
+					}
+
+					for (; middle > 0 && keys[middle - 1].Compare(k, ref_pages, ref_page2) == 0; middle--)
+					{
+						if (!Erased(pointers[middle - 1]))
+						{
+							*pr = pointers + middle - 1;
+							return 0;
+						}
+					}
+
+					return ((size_t)count == bin_c) ? (middle * link_c / bin_c) + 1 : 0;
 				}
 			}
 
@@ -757,7 +1250,8 @@ namespace tdb
 				low++;
 
 			for (high = low; high < count && keys[high].Compare(low_k, ref_pages, ref_page2) >= 0 && keys[high].Compare(high_k, ref_pages, ref_page2) <= 0; high++)
-				f(keys[high],pointers[high]);
+				if (!Erased(pointers[high]))
+					f(keys[high],pointers[high]);
 
 			if (count == bin_c)
 			{
@@ -771,11 +1265,79 @@ namespace tdb
 			else
 				return std::make_pair(0, 0);
 		}
-	};
 
-	template < typename int_t, typename key_t, typename pointer_t, typename link_t, size_t bin_c, size_t link_c, size_t fuzz_c, size_t padding_c = 0, bool check_v = false > struct _FuzzyHashNode : public _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>
-	{
-		static const uint32_t type = TableType::btree_fuzzymap;
+		template < typename F > int Erase(F&& f, const key_t& k, size_t& erased, size_t depth, void* ref_pages, void* ref_page2)
+		{
+			static_assert(std::is_integral<pointer_t>::value, "Erase requires integral pointers");
+
+			if (!count)
+				return 0;
+
+			int low = 0;
+			int high = (int)count - 1;
+
+			while (low <= high)
+			{
+				int middle = (low + high) >> 1;
+
+				switch (keys[middle].Compare(k, ref_pages, ref_page2))
+				{
+				case -1:
+					low = middle + 1;
+					break;
+				case 1:
+					high = middle - 1;
+					break;
+				case 0:
+				{
+					int upper = middle;
+
+					while (middle > 0 && keys[middle - 1].Compare(k, ref_pages, ref_page2) == 0)
+						middle--;
+
+					while (upper < (int)count - 1 && keys[upper + 1].Compare(k, ref_pages, ref_page2) == 0)
+						upper++;
+
+					bool leaf = Leaf() && (size_t)count != bin_c;
+
+					for (int i = upper; i >= middle; i--)
+					{
+						if (!Erased(pointers[i]) && f(pointers + i))
+						{
+							erased++;
+
+							if (leaf)
+								Shrink(i);
+							else
+								pointers[i] = Tombstone();
+						}
+					}
+
+					//Duplicates that overflowed this node were routed through the lower bound:
+					//
+
+					return ((size_t)count == bin_c) ? (middle * link_c / bin_c) + 1 : 0;
+				}
+				}
+			}
+
+			if ((size_t)count == bin_c)
+			{
+				if (low == (int)bin_c)
+					low--;
+				else if (low == -1)
+					low++;
+
+				return (low * link_c / bin_c) + 1;
+			}
+			else
+				return 0;
+		}
+	};
+
+	template < typename int_t, typename key_t, typename pointer_t, typename link_t, size_t bin_c, size_t link_c, size_t fuzz_c, size_t padding_c = 0, bool check_v = false, size_t align_c = 0 > struct _FuzzyHashNode : public _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>
+	{
+		static const uint32_t type = TableType::btree_fuzzymap;
 
 		uint8_t padding[padding_c];
 
@@ -788,11 +1350,14 @@ namespace tdb
 		static const size_t Links = link_c;
 		static const size_t Padding = padding_c;
 
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::keys;
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::pointers;
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::links;
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::count;
-		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v>::CheckKey;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::keys;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::pointers;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::links;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::count;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::CheckKey;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Leaf;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Erased;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Tombstone;
 
 		void Init()
 		{
@@ -802,22 +1367,44 @@ namespace tdb
 
 		size_t max_rec() { return sizeof(key_t)/2; }
 
-		int Insert(const key_t& k, const pointer_t& p, pair<pointer_t*, bool>& overwrite, size_t depth, void* ref_pages)
+		void Prefetch(const key_t& k, size_t depth) const
 		{
-			int bin = (*(((uint16_t*)&k) + (depth % max_rec())) % bin_c);
+			int bin = (*(((uint16_t*)&k) + (depth % (sizeof(key_t) / 2))) % bin_c);
 
-			if (pointers[bin] == (pointer_t)-1)
-			{
-				CheckKey(k);
+			this->_Prefetch(keys + bin);
+			this->_Prefetch(pointers + bin);
+		}
 
-				keys[bin] = k;
-				pointers[bin] = p;
-				count++;
+		//Hash slots never move, so batches go through Insert one key at a time under the caller's single lock.
+		//
 
-				overwrite = { pointers + bin, false };
+		template < typename T, typename F > void InsertBatch(T* kv, const size_t* order, size_t n, size_t depth, void* ref_pages, F&& f)
+		{
+			pair<pointer_t*, bool> overwrite;
 
-				return 0;
+			for (size_t i = 0; i < n; i++)
+			{
+				auto& e = kv[order[i]];
+
+				int result = Insert(e.first, e.second, overwrite, depth, ref_pages);
+
+				if (result)
+					f(i, result, -1, false);
+				else
+					f(i, 0, (int)(overwrite.first - pointers), overwrite.second);
 			}
+		}
+
+		/*
+			A key goes to its home bin, or when that is taken to the highest free bin of its window. Bins only return to
+			(pointer_t)-1 when Compact empties the whole node, so a key is never found below a never used bin and the scan down
+			from the top of the window stops at the first one. Leaves that aren't full reuse tombstones the same way,
+			a full node is left alone for inserts routing through it unlocked.
+		*/
+
+		int Insert(const key_t& k, const pointer_t& p, pair<pointer_t*, bool>& overwrite, size_t depth, void* ref_pages)
+		{
+			int bin = (*(((uint16_t*)&k) + (depth % max_rec())) % bin_c);
 
 			overwrite = { nullptr,false };
 
@@ -826,24 +1413,60 @@ namespace tdb
 			int z = -1;
 
 			if (low < 0) low = 0;
-			if (high > bin_c) high = bin_c;
+			if (high > (int)bin_c) high = (int)bin_c;
 
-			while (low < high)
+			auto match = [&](int i)
 			{
-				if (pointers[low] == (pointer_t)-1)
+				if (!keys[i].Equal(k, ref_pages, nullptr))
+					return false;
+
+				//pointers[middle] = p; // We allow the call to update the existing object if needed.
+				overwrite = { pointers + i, !Erased(pointers[i]) };
+
+				if (Erased(pointers[i]))
+					pointers[i] = p;
+
+				return true;
+			};
+
+			if (pointers[bin] == (pointer_t)-1)
+				z = bin;
+			else if (match(bin))
+				return 0;
+			else
+			{
+				int reuse = -1;
+
+				for (int i = high - 1; i >= low; i--)
 				{
-					z = low++;
-					continue;
+					if (pointers[i] == (pointer_t)-1)
+					{
+						z = i;
+						break;
+					}
+
+					if (i == bin)
+						continue;
+
+					if (match(i))
+						return 0;
+
+					if (reuse == -1 && Erased(pointers[i]))
+						reuse = i;
 				}
 
-				if (keys[low].Equal(k, ref_pages,nullptr))
+				if (reuse != -1 && (size_t)count != bin_c && Leaf())
 				{
-					overwrite = { pointers + low,true };
-					//pointers[middle] = p; // We allow the call to update the existing object if needed.
+					CheckKey(keys[reuse]);
+					CheckKey(k);
+
+					keys[reuse] = k;
+					pointers[reuse] = p;
+
+					overwrite = { pointers + reuse, false };
+
 					return 0;
 				}
-
-				low++;
 			}
 
 			if (z != -1)
@@ -859,7 +1482,7 @@ namespace tdb
 				return 0;
 			}
 			else
-				return ((low-1) * link_c / bin_c) + 1;
+				return ((high - 1) * link_c / bin_c) + 1;
 		}
 
 		int Find(const key_t& k, pointer_t** pr, size_t depth, void* ref_pages, void* ref_page2)
@@ -871,9 +1494,9 @@ namespace tdb
 
 			int bin = (*(((uint16_t*)&k) + depth) % bin_c);
 
-			if (keys[bin].Equal(k,ref_pages,ref_page2))
+			if (pointers[bin] != (pointer_t)-1 && keys[bin].Equal(k,ref_pages,ref_page2))
 			{
-				*pr = pointers + bin;
+				*pr = (Erased(pointers[bin])) ? nullptr : pointers + bin;
 				return 0;
 			}
 
@@ -894,7 +1517,7 @@ namespace tdb
 
 				if (keys[low].Equal(k, ref_pages, ref_page2))
 				{
-					*pr = pointers + low;
+					*pr = (Erased(pointers[low])) ? nullptr : pointers + low;
 					return 0;
 				}
 
@@ -906,308 +1529,2265 @@ namespace tdb
 			else
 				return ((low - 1) * link_c / bin_c) + 1;
 		}
-	};
 
-#pragma warning( pop )
-#pragma pack(pop)
+		template < typename F > int Erase(F&& f, const key_t& k, size_t& erased, size_t depth, void* ref_pages, void* ref_page2)
+		{
+			static_assert(std::is_integral<pointer_t>::value, "Erase requires integral pointers");
 
+			if (!count)
+				return 0;
 
+			int bin = (*(((uint16_t*)&k) + (depth % max_rec())) % bin_c);
 
-	template < typename R, typename node_t, size_t double_stall_s = 1, size_t double_max_s = -1 > class _BTree
-	{
-		using key_t = typename node_t::Key;
-		using pointer_t = typename node_t::Pointer;
-		using link_t = typename node_t::Link;
-		static const int link_c = node_t::Links;
+			int low = bin - fuzz_c / 2;
+			int high = low + fuzz_c;
+			int z = -1;
 
-		R* io = nullptr;
-		link_t root_n;
+			if (low < 0) low = 0;
+			if (high > (int)bin_c) high = (int)bin_c;
 
-		auto Root() const
-		{
-			return &io->template Lookup<node_t>(root_n);
+			while (low < high)
+			{
+				if (pointers[low] == (pointer_t)-1)
+				{
+					z = low++;
+					continue;
+				}
+
+				if (keys[low].Equal(k, ref_pages, ref_page2))
+				{
+					if (!Erased(pointers[low]) && f(pointers + low))
+					{
+						erased++;
+						pointers[low] = Tombstone();
+					}
+
+					return 0;
+				}
+
+				low++;
+			}
+
+			if (z != -1)
+				return 0;
+			else
+				return ((low - 1) * link_c / bin_c) + 1;
 		}
 
-	public:
-		_BTree() {}
+		//Insert stops at the first never used bin, so tombstones only go once nothing is left alive:
+		//
 
-		_BTree(R* _io)
+		void Compact()
 		{
-			Open(_io);
+			for (size_t i = 0; i < bin_c; i++)
+				if (pointers[i] != (pointer_t)-1 && !Erased(pointers[i]))
+					return;
+
+			for (size_t i = 0; i < bin_c; i++)
+			{
+				if (Erased(pointers[i]))
+				{
+					CheckKey(keys[i]);
+					pointers[i] = (pointer_t)-1;
+					count--;
+				}
+			}
 		}
 
-		void Open(R* _io, size_t & _n)
+		/*
+			Bulk load places keys exactly as Insert would and pre-partitions the overflow by the child it routes to.
+			Keys must be unique.
+		*/
+
+		template < typename T, typename F > void Load(T* kv, size_t n, size_t depth, void* ref_pages, F&& child)
 		{
-			root_n = _n++;
-			io = _io;
+			std::vector<T> spill[link_c];
 
-			if (io->size() <= root_n)
+			for (size_t i = 0; i < n; i++)
 			{
-				auto r = &io->template Allocate<node_t>();
-				r->Init();
+				auto& k = kv[i].first;
 
-				/*
-					Runtime Introspection:
-				*/
+				int bin = (*(((uint16_t*)&k) + (depth % max_rec())) % bin_c);
 
-				auto & desc = io->GetDescriptor(root_n);
+				int low = bin - fuzz_c / 2;
+				int high = low + fuzz_c;
+				int z = -1;
 
-				desc.type = node_t::type;
+				if (low < 0) low = 0;
+				if (high > (int)bin_c) high = (int)bin_c;
+
+				if (pointers[bin] == (pointer_t)-1)
+					z = bin;
+				else
+				{
+					for (; low < high; low++)
+						if (pointers[low] == (pointer_t)-1)
+							z = low;
+				}
 
-				desc.standard_index.self_balanced = (uint32_t)false;
-				desc.standard_index.requires_distributed_key = (uint32_t)true;
+				if (z != -1)
+				{
+					CheckKey(k);
 
-				desc.standard_index.key_sz = sizeof(key_t);
-				desc.standard_index.link_sz = sizeof(link_t);
-				desc.standard_index.pointer_sz = sizeof(pointer_t);
-				desc.standard_index.key_mode = key_t::mode;
-				desc.standard_index.key_type = key_t::type;
+					keys[z] = k;
+					pointers[z] = kv[i].second;
+					count++;
+				}
+				else
+					spill[(high - 1) * link_c / bin_c].push_back(kv[i]);
+			}
 
-				desc.standard_index.max_capacity = (uint32_t)node_t::Bins;
-				desc.standard_index.min_capacity = (uint16_t)-1;
+			size_t start = 0;
 
-				desc.standard_index.max_page = (uint32_t)sizeof(node_t);
-				desc.standard_index.min_page = (uint16_t)-1;
+			for (size_t c = 0; c < link_c; c++)
+			{
+				std::copy(spill[c].begin(), spill[c].end(), kv + start);
+				child((int)c, kv + start, spill[c].size());
 
-				desc.standard_index.link_count = node_t::Links;
+				start += spill[c].size();
 			}
 		}
+	};
 
-private: 
-		
-		void _Population(node_t* node, std::pair<uint64_t,uint64_t> & sum) const
+	/*
+		Hash node with a one byte tag per bin, a fragment of the key hash taken from bytes the bin was not chosen by.
+
+		A lookup compares the tags of its whole window at once ( 16 or 32 bins with SSE2 / AVX2 ) and only reads the keys
+		whose tag matches, so a probe touches one line of tags instead of a window of keys and pointers.
+		Tag 0 marks an empty bin, empty bins also keep the (pointer_t)-1 marker so tree walks treat this node like _FuzzyHashNode.
+	*/
+
+	template < typename int_t, typename key_t, typename pointer_t, typename link_t, size_t bin_c, size_t link_c, size_t fuzz_c, size_t padding_c = 0, bool check_v = false, size_t align_c = 0 > struct _TaggedHashNode : public _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>
+	{
+		static const uint32_t type = TableType::btree_taggedmap;
+
+		static_assert(fuzz_c == 16 || fuzz_c == 32, "Tag windows are one or two SIMD groups");
+		static_assert(bin_c >= fuzz_c);
+
+		uint8_t tags[bin_c];
+
+		uint8_t padding[padding_c];
+
+		using Pointer = pointer_t;
+		using Key = key_t;
+		using Int = int_t;
+		using Link = link_t;
+		static const size_t Fuzz = fuzz_c;
+		static const size_t Bins = bin_c;
+		static const size_t Links = link_c;
+		static const size_t Padding = padding_c;
+
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::keys;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::pointers;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::links;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::count;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::CheckKey;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Leaf;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Erased;
+		using _BaseNode<int_t, key_t, pointer_t, link_t, bin_c, link_c, check_v, align_c>::Tombstone;
+
+		static const size_t rec_c = sizeof(key_t) / 2;
+
+		void Init()
 		{
-			if (!node->count)
-				return;
+			for (size_t i = 0; i < bin_c; i++)
+				pointers[i] = (pointer_t)-1;
 
-			sum.first += node->count;
-			sum.second += node_t::Bins;
+			memset(tags, 0, sizeof(tags));
+		}
 
-			for (int i = 0; i < link_c; i++)
-				if (node->links[i])
-					_Population(&io->template Lookup<node_t>((uint64_t)node->links[i]), sum);
+		size_t max_rec() { return rec_c; }
+
+		static int Bin(const key_t& k, size_t depth)
+		{
+			return (int)(*(((uint16_t*)&k) + (depth % rec_c)) % bin_c);
 		}
 
-		template < typename F > void _IterateNodes(node_t* node, F&& f) const
+		//The tag comes from the next level's bin bytes, which are independent of the bin chosen here:
+		//
+
+		static uint8_t Tag(const key_t& k, size_t depth)
 		{
-			f(*node);
+			return *(((uint8_t*)&k) + ((depth + 1) % rec_c) * 2) | 0x80;
+		}
 
-			for (int i = 0; i < link_c; i++)
-				if (node->links[i])
-					_IterateNodes(&io->template Lookup<node_t>((uint64_t)node->links[i]), f);
+		static int Window(int bin)
+		{
+			int low = bin - (int)fuzz_c / 2;
+
+			if (low < 0) low = 0;
+			if (low > (int)(bin_c - fuzz_c)) low = (int)(bin_c - fuzz_c);
+
+			return low;
 		}
 
-		template < typename F > void IterateNodes(F&& f) const
+		//One bit per bin of the window, set where the tag equals t:
+		//
+
+		uint32_t Match(int low, uint8_t t) const
 		{
-			if (Root())
-				_IterateNodes(Root(), std::move(f));
+			if constexpr (fuzz_c == 16)
+			{
+				__m128i group = _mm_loadu_si128((const __m128i*)(tags + low));
+
+				return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)t)));
+			}
+			else
+			{
+#ifdef __AVX2__
+				__m256i group = _mm256_loadu_si256((const __m256i*)(tags + low));
+
+				return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(group, _mm256_set1_epi8((char)t)));
+#else
+				__m128i lo = _mm_loadu_si128((const __m128i*)(tags + low));
+				__m128i hi = _mm_loadu_si128((const __m128i*)(tags + low + 16));
+				__m128i v = _mm_set1_epi8((char)t);
+
+				return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(lo, v)) | ((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(hi, v)) << 16);
+#endif
+			}
 		}
 
-		template < typename F > int _Iterate(node_t* node, F && f) const
+		static int Lowest(uint32_t mask)
 		{
-			int count = node->count;
+#ifdef _MSC_VER
+			unsigned long r;
+			_BitScanForward(&r, mask);
+			return (int)r;
+#else
+			return __builtin_ctz(mask);
+#endif
+		}
+
+		//Returns the bin holding k, or -1:
+		//
+
+		int Search(const key_t& k, int low, uint8_t t, void* ref_pages, void* ref_page2)
+		{
+			for (uint32_t mask = Match(low, t); mask; mask &= mask - 1)
+			{
+				int i = low + Lowest(mask);
+
+				if (keys[i].Equal(k, ref_pages, ref_page2))
+					return i;
+			}
+
+			return -1;
+		}
+
+		void Prefetch(const key_t& k, size_t depth) const
+		{
+			int bin = Bin(k, depth);
+
+			this->_Prefetch(tags + Window(bin));
+			this->_Prefetch(keys + bin);
+		}
+
+		template < typename T, typename F > void InsertBatch(T* kv, const size_t* order, size_t n, size_t depth, void* ref_pages, F&& f)
+		{
+			pair<pointer_t*, bool> overwrite;
+
+			for (size_t i = 0; i < n; i++)
+			{
+				auto& e = kv[order[i]];
+
+				int result = Insert(e.first, e.second, overwrite, depth, ref_pages);
+
+				if (result)
+					f(i, result, -1, false);
+				else
+					f(i, 0, (int)(overwrite.first - pointers), overwrite.second);
+			}
+		}
+
+		int Insert(const key_t& k, const pointer_t& p, pair<pointer_t*, bool>& overwrite, size_t depth, void* ref_pages)
+		{
+			int bin = Bin(k, depth);
+			int low = Window(bin);
+			uint8_t t = Tag(k, depth);
+
+			overwrite = { nullptr,false };
+
+			int i = Search(k, low, t, ref_pages, nullptr);
+
+			if (i != -1)
+			{
+				if (Erased(pointers[i]))
+				{
+					pointers[i] = p;
+					overwrite = { pointers + i, false };
+
+					return 0;
+				}
+
+				overwrite = { pointers + i,true };
+				return 0;
+			}
+
+			uint32_t empty = Match(low, 0);
+
+			if (!empty)
+				return (bin * (int)link_c / (int)bin_c) + 1;
+
+			int z = (!tags[bin]) ? bin : low + Lowest(empty);
+
+			CheckKey(k);
+
+			keys[z] = k;
+			pointers[z] = p;
+			tags[z] = t;
+			count++;
+
+			overwrite = { pointers + z, false };
+
+			return 0;
+		}
+
+		int Find(const key_t& k, pointer_t** pr, size_t depth, void* ref_pages, void* ref_page2)
+		{
+			*pr = nullptr;
+
+			if (!count)
+				return 0;
+
+			int bin = Bin(k, depth);
+			int low = Window(bin);
+
+			int i = Search(k, low, Tag(k, depth), ref_pages, ref_page2);
+
+			if (i != -1)
+			{
+				*pr = (Erased(pointers[i])) ? nullptr : pointers + i;
+				return 0;
+			}
+
+			if (Match(low, 0))
+				return 0;
+			else
+				return (bin * (int)link_c / (int)bin_c) + 1;
+		}
+
+		template < typename F > int Erase(F&& f, const key_t& k, size_t& erased, size_t depth, void* ref_pages, void* ref_page2)
+		{
+			static_assert(std::is_integral<pointer_t>::value, "Erase requires integral pointers");
+
+			if (!count)
+				return 0;
+
+			int bin = Bin(k, depth);
+			int low = Window(bin);
+
+			int i = Search(k, low, Tag(k, depth), ref_pages, ref_page2);
+
+			if (i != -1)
+			{
+				if (!Erased(pointers[i]) && f(pointers + i))
+				{
+					erased++;
+
+					if (Leaf() && (size_t)count != bin_c)
+					{
+						CheckKey(keys[i]);
+						pointers[i] = (pointer_t)-1;
+						tags[i] = 0;
+						count--;
+					}
+					else
+						pointers[i] = Tombstone();
+				}
+
+				return 0;
+			}
+
+			if (Match(low, 0))
+				return 0;
+			else
+				return (bin * (int)link_c / (int)bin_c) + 1;
+		}
+
+		void Compact()
+		{
+			for (size_t i = 0; i < bin_c; i++)
+			{
+				if (Erased(pointers[i]))
+				{
+					CheckKey(keys[i]);
+					pointers[i] = (pointer_t)-1;
+					tags[i] = 0;
+					count--;
+				}
+			}
+		}
+
+		/*
+			Bulk load places keys exactly as Insert would and pre-partitions the overflow by the child it routes to.
+			Keys must be unique.
+		*/
+
+		template < typename T, typename F > void Load(T* kv, size_t n, size_t depth, void* ref_pages, F&& child)
+		{
+			std::vector<T> spill[link_c];
+
+			for (size_t i = 0; i < n; i++)
+			{
+				auto& k = kv[i].first;
+
+				int bin = Bin(k, depth);
+				uint32_t empty = Match(Window(bin), 0);
+
+				if (empty)
+				{
+					int z = (!tags[bin]) ? bin : Window(bin) + Lowest(empty);
+
+					CheckKey(k);
+
+					keys[z] = k;
+					pointers[z] = kv[i].second;
+					tags[z] = Tag(k, depth);
+					count++;
+				}
+				else
+					spill[bin * link_c / bin_c].push_back(kv[i]);
+			}
+
+			size_t start = 0;
+
+			for (size_t c = 0; c < link_c; c++)
+			{
+				std::copy(spill[c].begin(), spill[c].end(), kv + start);
+				child((int)c, kv + start, spill[c].size());
+
+				start += spill[c].size();
+			}
+		}
+	};
+
+#pragma warning( pop )
+#pragma pack(pop)
+
+
+
+	template < typename R, typename node_t, size_t double_stall_s = 1, size_t double_max_s = -1, size_t hot_levels_s = 3 > class _BTree
+	{
+		using key_t = typename node_t::Key;
+		using pointer_t = typename node_t::Pointer;
+		using link_t = typename node_t::Link;
+		static const int link_c = node_t::Links;
+
+		R* io = nullptr;
+		link_t root_n;
+
+		/*
+			Hot descents, every lookup crosses the top levels and io->Lookup walks the map list to resolve each of them.
+			The nodes of the top hot_levels_c levels are resolved once into a cache aligned table, slot s holds the children
+			of the node at breadth first position s. Links only go from null to set outside of reclamation and copy on write,
+			which clear it. A clear bumps the epoch first, a fill that raced it sees the new epoch and takes its entry back.
+
+			The table belongs to this instance and its copies. Another _BTree opened over the same slots has its own and never
+			hears of this one's reclamation, so such instances must not write while the other reads.
+
+			Only maps whose addresses survive growth keep the table. PinHot can also lock those nodes into memory.
+		*/
+
+		static const size_t hot_levels_c = (R::StableAddresses) ? hot_levels_s : 0;
+
+		static constexpr size_t _HotSlots()
+		{
+			size_t slots = 0, width = 1;
+
+			for (size_t l = 0; l + 1 < hot_levels_c; l++, width *= link_c)
+				slots += width;
+
+			return slots;
+		}
+
+		static const size_t hot_slots_c = _HotSlots();
+
+		struct alignas(64) _HotSlot
+		{
+			std::atomic<node_t*> children[link_c];
+		};
+
+		struct _Hot
+		{
+			node_t* root = nullptr;
+			std::unique_ptr<_HotSlot[]> slots;
+			std::atomic<uint64_t> epoch = 0;
+			std::vector<node_t*> pinned;
+
+			_Hot() : slots(new _HotSlot[(hot_slots_c) ? hot_slots_c : 1]) 
+			{
+				Clear();
+			}
+
+			~_Hot()
+			{
+				for (auto node : pinned)
+					UnlockPages(node, sizeof(node_t));
+			}
+
+			void Clear()
+			{
+				epoch.fetch_add(1);
+
+				for (size_t i = 0; i < hot_slots_c; i++)
+					for (int c = 0; c < link_c; c++)
+						slots[i].children[c].store(nullptr, std::memory_order_relaxed);
+			}
+		};
+
+		std::shared_ptr<_Hot> hot;
+
+		auto Root() const
+		{
+			if constexpr (hot_levels_c > 0)
+				return hot->root;
+			else
+				return &io->template Lookup<node_t>(root_n);
+		}
+
+		//Follows link c of current, slot is the breadth first position of current and becomes that of the child:
+		//
+
+		node_t* _Descend(node_t* current, size_t& slot, int c) const
+		{
+			if constexpr (hot_slots_c > 0)
+			{
+				if (slot < hot_slots_c)
+				{
+					auto& cached = hot->slots[slot].children[c];
+					slot = slot * link_c + 1 + c;
+
+					node_t* next = cached.load(std::memory_order_acquire);
+
+					if (next)
+						return next;
+
+					uint64_t epoch = hot->epoch.load();
+					link_t id = current->links[c];
+
+					if (!id)
+						return nullptr;
+
+					next = &io->template Lookup<node_t>(id);
+
+					node_t* empty = nullptr, *filled = next;
+
+					if (cached.compare_exchange_strong(empty, next) && hot->epoch.load() != epoch)
+						cached.compare_exchange_strong(filled, nullptr);
+
+					return next;
+				}
+			}
+
+			slot = (size_t)-1;
+
+			return (current->links[c]) ? &io->template Lookup<node_t>(current->links[c]) : nullptr;
+		}
+
+		void _ForgetHot()
+		{
+			if constexpr (hot_slots_c > 0)
+				hot->Clear();
+		}
+
+		/*
+			Appends, following the link a key above every key routes to gives the rightmost path. A key above the highest key of
+			every full node on that path walks it to its end, so the deepest node reached on it is kept as the tail together with
+			that bound. Ascending keys pass the bound check and start at the tail, anything else starts at the root.
+
+			Only ordered nodes route by key order. Only Insert keeps and reads the tail, a single writer's hint in plain fields
+			shared with copies of the tree, InsertLock and the other locked writers always descend from the root.
+			Reclamation and copy on write can replace path nodes and forget it, the next descent along the path finds it again.
+		*/
+
+		static constexpr bool appends_c = (node_t::type == TableType::btree_sorted_list || node_t::type == TableType::btree_sorted_multilist)
+			&& double_stall_s == 1 && double_max_s == (size_t)-1;
+
+		static constexpr int last_c = (node_t::Bins - 1) * link_c / node_t::Bins;
+
+		struct _Tail
+		{
+			std::atomic<bool> valid = false;
+			link_t id = 0;
+			size_t depth = 0;
+			size_t slot = 0;
+			std::optional<key_t> bound;
+		};
+
+		std::shared_ptr<_Tail> tail;
+
+		void _ForgetTail()
+		{
+			if constexpr (appends_c)
+				tail->valid.store(false, std::memory_order_relaxed);
+		}
+
+		//Moves the start of a descent for k to the tail when k is above its bound:
+		//
+
+		template < typename K > void _FromTail(const K& k, link_t& id, size_t& depth, size_t& slot, std::optional<key_t>& bound)
+		{
+			if constexpr (appends_c)
+			{
+				if (!tail->valid.load(std::memory_order_relaxed))
+					return;
+
+				if (tail->bound && tail->bound->Compare(k, (void*)io, nullptr) >= 0)
+					return;
+
+				id = tail->id;
+				depth = tail->depth;
+				slot = tail->slot;
+				bound = tail->bound;
+			}
+		}
+
+		//The descent left node through link c to child id, false once it leaves the rightmost path:
+		//
+
+		bool _Extend(node_t& node, int c, link_t id, size_t depth, size_t slot, std::optional<key_t>& bound)
+		{
+			if (c != last_c)
+				return false;
+
+			auto& high = node.keys[node_t::Bins - 1];
+
+			if (!bound || bound->Compare(high, (void*)io, nullptr) < 0)
+				bound = high;
+
+			if (!tail->valid.load(std::memory_order_relaxed) || depth > tail->depth)
+			{
+				tail->id = id;
+				tail->depth = depth;
+				tail->slot = slot;
+				tail->bound = bound;
+				tail->valid.store(true, std::memory_order_relaxed);
+			}
+
+			return true;
+		}
+
+		/*
+			Copy on write, a snapshot copies the root into a unit of its own and freezes every node the tree had.
+			While any snapshot is pinned writers copy a frozen node before changing it, parents first, and swing the link to the copy.
+			Nodes written since the newest snapshot are fresh and change in place.
+
+			Replaced nodes are retired with the newest epoch that can still reach them and freed once every snapshot at or before it
+			is released. Freeing happens on the writer side, a reader releasing its snapshot never races an allocation.
+			While pinned, erased leaves are not reclaimed and locked writers take turns on the tree.
+		*/
+
+		struct _Cow
+		{
+			std::mutex writer;
+			std::atomic<bool> active = false;
+			uint64_t epoch = 0;
+			std::map<uint64_t, link_t> roots;
+			std::unordered_set<link_t> fresh;
+			std::vector<std::pair<link_t, uint64_t>> retired;
+			bool released = false;
+
+			//Path of the current write, writers hold the lock so one is enough:
+			//
+
+			std::vector<link_t> ids;
+			std::vector<int> slots;
+		};
+
+		std::shared_ptr<_Cow> cow;
+
+		template < bool lock_v > void _Collect()
+		{
+			if (!cow->released)
+				return;
+
+			cow->released = false;
+
+			uint64_t oldest = (cow->roots.size()) ? cow->roots.begin()->first : (uint64_t)-1;
+			size_t w = 0;
+
+			for (auto& r : cow->retired)
+			{
+				if (r.second >= oldest)
+					cow->retired[w++] = r;
+				else if constexpr (lock_v)
+					io->FreeUnitLock(io->template Lookup<typename R::Unit>(r.first));
+				else
+					io->FreeUnit(io->template Lookup<typename R::Unit>(r.first));
+			}
+
+			cow->retired.resize(w);
+
+			if (!cow->roots.size())
+				cow->fresh.clear();
+
+			cow->active = cow->roots.size() || cow->retired.size();
+		}
+
+		template < bool lock_v > node_t& _Recycle()
+		{
+			if constexpr (lock_v)
+				return io->template RecycleLock<node_t>();
+			else
+				return io->template Recycle<node_t>();
+		}
+
+		//Makes the node at depth d of a descent writable, ids[ d ] is replaced by its copy:
+		//
+
+		template < bool lock_v > void _Thaw(std::vector<link_t>& ids, const std::vector<int>& slots, size_t d)
+		{
+			if (!d || cow->fresh.count(ids[d]))
+				return;
+
+			_Thaw<lock_v>(ids, slots, d - 1);
+
+			link_t id = (link_t)io->template Index<node_t>(_Recycle<lock_v>());
+			node_t* copy = &io->template Lookup<node_t>(id);
+
+			std::memcpy((void*)copy, (void*)&io->template Lookup<node_t>(ids[d]), sizeof(node_t));
+			copy->Unlock();
+
+			io->template Lookup<node_t>(ids[d - 1]).links[slots[d - 1]] = id;
+			_ForgetHot();
+			_ForgetTail();
+
+			cow->retired.emplace_back(ids[d], cow->epoch);
+			cow->fresh.insert(id);
+			ids[d] = id;
+		}
+
+		//Whether writing k at this node can change it, full nodes only change when k is already here, erased or not:
+		//
+
+		bool _Touches(node_t* node, const key_t& k, size_t depth, void* ref_page) const
+		{
+			if ((size_t)node->count != node_t::Bins)
+				return true;
+
+			pointer_t* pr = nullptr;
+
+			return !node->Find(k, &pr, depth, (void*)io, ref_page);
+		}
+
+		template < bool lock_v > pair<pointer_t*, bool> _InsertCow(const key_t& _k, const pointer_t& p)
+		{
+			auto&& k = BindKey(_k, (void*)io, nullptr);
+
+			auto& ids = cow->ids;
+			auto& slots = cow->slots;
+
+			ids.assign(1, root_n);
+			slots.clear();
+
+			node_t* current = Root();
+			size_t slot = 0;
+
+			for (size_t depth = 0;;)
+			{
+				if (ids.size() > 1 && !cow->fresh.count(ids.back()) && _Touches(current, k, depth, nullptr))
+				{
+					_Thaw<lock_v>(ids, slots, ids.size() - 1);
+					current = &io->template Lookup<node_t>(ids.back());
+				}
+
+				if constexpr (lock_v)
+					current->Lock();
+
+				pair<pointer_t*, bool> overwrite;
+				int result = current->Insert(k, p, overwrite, depth++, (void*)io);
+
+				if constexpr (lock_v)
+					current->Unlock();
+
+				if (!result)
+					return overwrite;
+
+				if (depth % double_stall_s != 0 || depth > double_max_s)
+					result = 1;
+
+				result--;
+				slots.push_back(result);
+
+				node_t* next = _Descend(current, slot, result);
+
+				if (!next)
+				{
+					_Thaw<lock_v>(ids, slots, ids.size() - 1);
+
+					next = &_Recycle<lock_v>();
+					next->Init();
+
+					link_t id = (link_t)io->template Index<node_t>(*next);
+					cow->fresh.insert(id);
+
+					current = &io->template Lookup<node_t>(ids.back());
+
+					if constexpr (lock_v)
+						current->Lock();
+
+					current->links[result] = id;
+
+					if constexpr (lock_v)
+						current->Unlock();
+				}
+
+				ids.push_back(current->links[result]);
+				current = next;
+			}
+		}
+
+		template < bool lock_v, typename F > size_t _EraseCow(F&& f, const key_t& k, void* ref_page)
+		{
+			auto& ids = cow->ids;
+			auto& slots = cow->slots;
+
+			ids.assign(1, root_n);
+			slots.clear();
+			size_t erased = 0;
+
+			for (size_t depth = 0;;)
+			{
+				node_t* current = &io->template Lookup<node_t>(ids.back());
+				pointer_t* pr = nullptr;
+
+				if (current->count && !current->Find(k, &pr, depth, (void*)io, ref_page))
+				{
+					_Thaw<lock_v>(ids, slots, ids.size() - 1);
+					current = &io->template Lookup<node_t>(ids.back());
+				}
+
+				if constexpr (lock_v)
+					current->Lock();
+
+				int result = current->Erase(f, k, erased, depth++, (void*)io, ref_page);
+
+				if constexpr (lock_v)
+					current->Unlock();
+
+				if (!result)
+					return erased;
+
+				if (depth % double_stall_s != 0 || depth > double_max_s)
+					result = 1;
+
+				result--;
+
+				if (!current->links[result])
+					return erased;
+
+				slots.push_back(result);
+				ids.push_back(current->links[result]);
+			}
+		}
+
+		//Writers check here first, true when the write was done copy on write:
+		//
+
+		template < bool lock_v, typename F > bool _Cowrite(F&& f)
+		{
+			if (!cow->active.load(std::memory_order_acquire))
+				return false;
+
+			std::lock_guard<std::mutex> lock(cow->writer);
+
+			_Collect<lock_v>();
+
+			if (!cow->roots.size())
+				return false;
+
+			f();
+
+			return true;
+		}
+
+	public:
+
+		//Lets tables hand BulkLoad pairs built from their rows, and tell the trees that hold duplicate keys:
+		//
+
+		using Key = key_t;
+		static const bool bulk_load_c = double_stall_s == 1 && double_max_s == (size_t)-1;
+		static const bool multi_c = node_t::type == TableType::btree_sorted_multilist;
+
+		_BTree() {}
+
+		_BTree(R* _io)
+		{
+			Open(_io);
+		}
+
+		void Open(R* _io, size_t & _n)
+		{
+			root_n = _n++;
+			io = _io;
+			hot = std::make_shared<_Hot>();
+			cow = std::make_shared<_Cow>();
+			tail = std::make_shared<_Tail>();
+
+			//A slot held by ReserveTables is taken over as an empty index:
+			//
+
+			if (io->size() > root_n && io->GetDescriptor(root_n).type == TableType::reserved_slot)
+			{
+				auto r = new(&io->template Lookup<node_t>(root_n)) node_t();
+				r->Init();
+
+				_Describe();
+			}
+			else if (io->size() <= root_n)
+			{
+				auto r = &io->template Allocate<node_t>();
+				r->Init();
+
+				_Describe();
+			}
+			else if (io->GetDescriptor(root_n).standard_index.self_balanced)
+				throw std::runtime_error("Index was built by a balanced tree");
+			else if (!HashPolicyMatches(io->GetDescriptor(root_n).standard_index.hash_policy, _KeyHashPolicy<key_t>::value))
+				throw std::runtime_error("Index was built with a different key hash");
+
+			hot->root = &io->template Lookup<node_t>(root_n);
+		}
+
+		/*
+			Frees every node but the root and hands the root's slot back to a later schema as reserved, this object reads as empty
+			until it is opened again. Must not race readers, writers or snapshots.
+		*/
+
+		void Drop()
+		{
+			_Collect<false>();
+
+			if (cow->active)
+				throw std::runtime_error("Can't drop an index with snapshots pinned");
+
+			std::vector<link_t> stack = { root_n }, nodes;
+
+			while (stack.size())
+			{
+				link_t id = stack.back();
+				stack.pop_back();
+
+				node_t* node = &io->template Lookup<node_t>(id);
+
+				for (int i = 0; i < link_c; i++)
+					if (node->links[i])
+						stack.push_back(node->links[i]);
+
+				if (id != root_n)
+					nodes.push_back(id);
+			}
+
+			for (auto id : nodes)
+				io->FreeUnit(io->template Lookup<typename R::Unit>(id));
+
+			new(&io->template Lookup<node_t>(root_n)) node_t();
+			io->template Lookup<node_t>(root_n).Init();
+
+			_ForgetHot();
+			_ForgetTail();
+
+			io->GetDescriptor(root_n).type = TableType::reserved_slot;
+		}
+
+	private:
+
+		void _Describe()
+		{
+			/*
+				Runtime Introspection:
+			*/
+
+			auto & desc = io->GetDescriptor(root_n);
+
+			desc.type = node_t::type;
+
+			desc.standard_index.self_balanced = (uint32_t)false;
+			desc.standard_index.requires_distributed_key = (uint32_t)true;
+
+			desc.standard_index.key_sz = sizeof(key_t);
+			desc.standard_index.link_sz = sizeof(link_t);
+			desc.standard_index.pointer_sz = sizeof(pointer_t);
+			desc.standard_index.key_mode = key_t::mode;
+			desc.standard_index.key_type = key_t::type;
+			desc.standard_index.hash_policy = _KeyHashPolicy<key_t>::value;
+
+			desc.standard_index.max_capacity = (uint32_t)node_t::Bins;
+			desc.standard_index.min_capacity = (uint16_t)-1;
+
+			desc.standard_index.max_page = (uint32_t)sizeof(node_t);
+			desc.standard_index.min_page = (uint16_t)-1;
+
+			desc.standard_index.link_count = node_t::Links;
+		}
+
+	public:
+
+		/*
+			Resolves every node of the hot levels and, with lock_pages, locks them into memory so they are never paged out.
+			Returns how many nodes were locked, the operating system may refuse past its locked memory limit.
+		*/
+
+		size_t PinHot(bool lock_pages = true)
+		{
+			if constexpr (hot_levels_c == 0)
+				return 0;
+			else
+			{
+				std::vector<std::pair<node_t*, size_t>> level = { { Root(), 0 } };
+				size_t locked = 0;
+
+				for (size_t l = 0; l < hot_levels_c && level.size(); l++)
+				{
+					std::vector<std::pair<node_t*, size_t>> next;
+
+					for (auto [node, slot] : level)
+					{
+						if (lock_pages && std::find(hot->pinned.begin(), hot->pinned.end(), node) == hot->pinned.end() && LockPages(node, sizeof(node_t)))
+						{
+							hot->pinned.push_back(node);
+							locked++;
+						}
+
+						if (l + 1 == hot_levels_c)
+							continue;
+
+						for (int c = 0; c < link_c; c++)
+						{
+							size_t child = slot;
+
+							if (auto n = _Descend(node, child, c))
+								next.emplace_back(n, child);
+						}
+					}
+
+					level = std::move(next);
+				}
+
+				return locked;
+			}
+		}
+
+		void UnpinHot()
+		{
+			for (auto node : hot->pinned)
+				UnlockPages(node, sizeof(node_t));
+
+			hot->pinned.clear();
+		}
+
+		/*
+			Snapshots, Pin copies the root for epoch and ViewSnapshot points a copy of this tree at it.
+			Pin must not race writers, once pinned writers and snapshot readers run side by side.
+		*/
+
+		void Pin(uint64_t epoch)
+		{
+			std::lock_guard<std::mutex> lock(cow->writer);
+
+			_Collect<true>();
+
+			link_t id = (link_t)io->template Index<node_t>(io->template RecycleLock<node_t>());
+			node_t* copy = &io->template Lookup<node_t>(id);
+
+			std::memcpy((void*)copy, (void*)&io->template Lookup<node_t>(root_n), sizeof(node_t));
+			copy->Unlock();
+
+			cow->roots[epoch] = id;
+			cow->epoch = epoch;
+			cow->fresh.clear();
+			cow->active = true;
+		}
+
+		//The root copy and the nodes only the snapshot reached are freed by the next write:
+		//
+
+		void Release(uint64_t epoch)
+		{
+			std::lock_guard<std::mutex> lock(cow->writer);
+
+			auto i = cow->roots.find(epoch);
+
+			if (i == cow->roots.end())
+				return;
+
+			cow->retired.emplace_back(i->second, 0);
+			cow->roots.erase(i);
+			cow->released = true;
+		}
+
+		void ViewSnapshot(uint64_t epoch)
+		{
+			{
+				std::lock_guard<std::mutex> lock(cow->writer);
+
+				root_n = cow->roots.at(epoch);
+			}
+
+			hot = std::make_shared<_Hot>();
+			hot->root = &io->template Lookup<node_t>(root_n);
+			tail = std::make_shared<_Tail>();
+		}
+
+		size_t Snapshots() const
+		{
+			std::lock_guard<std::mutex> lock(cow->writer);
+
+			return cow->roots.size();
+		}
+
+private: 
+		
+		void _Population(node_t* node, std::pair<uint64_t,uint64_t> & sum) const
+		{
+			if (!node->count)
+				return;
+
+			sum.first += node->count;
+			sum.second += node_t::Bins;
+
+			for (int i = 0; i < link_c; i++)
+				if (node->links[i])
+					_Population(&io->template Lookup<node_t>((uint64_t)node->links[i]), sum);
+		}
+
+		template < typename F > void _IterateNodes(node_t* node, F&& f) const
+		{
+			f(*node);
+
+			for (int i = 0; i < link_c; i++)
+				if (node->links[i])
+					_IterateNodes(&io->template Lookup<node_t>((uint64_t)node->links[i]), f);
+		}
+
+		template < typename F > void IterateNodes(F&& f) const
+		{
+			if (Root())
+				_IterateNodes(Root(), std::move(f));
+		}
+
+		template < typename F > int _Iterate(node_t* node, F && f) const
+		{
+			int count = node->count;
+
+			if (!count)
+				return 0;
+
+			for (int i = 0, c = 0; i < (int)node->count && c < (int)node_t::Bins; c++)
+			{
+				if(node->pointers[c] != (pointer_t)-1 && !node_t::Erased(node->pointers[c])) // this is designed to filter out unused type in fuzzy map. Doesn't work with non int value types.
+				{ 
+					i++;
+					if (!f(node->pointers[c]))
+						return i;
+				}
+			}
+
+			for (int i = 0; i < link_c; i++)
+				if (node->links[i])
+					count += _Iterate(&io->template Lookup<node_t>((uint64_t)node->links[i]), f);
+
+			return count;
+		}
+
+		template < typename F > int _IterateKV(node_t* node, F&& f) const
+		{
+			int count = node->count;
+
+			if (!count)
+				return 0;
+
+			for (int i = 0, c = 0; i < (int)node->count && c < (int)node_t::Bins; c++)
+			{
+				//if (node->pointers[c] != (pointer_t)-1) //Disabling fuzzy map filtering for K/V version
+				if (!node_t::Erased(node->pointers[c]))
+				{
+					i++;
+					if (!f(node->keys[c],node->pointers[c]))
+						return i;
+				}
+			}
+
+			for (int i = 0; i < link_c; i++)
+				if (node->links[i])
+					count += _IterateKV(&io->template Lookup<node_t>((uint64_t)node->links[i]), f);
+
+			return count;
+		}
+
+		template < typename F > bool _ParallelNodes(F&& f, size_t threads) const
+		{
+			if (!Root())
+				return true;
+
+			return WorkStealing(root_n, [&](size_t w, link_t id, auto&& push)
+			{
+				node_t* node = &io->template Lookup<node_t>(id);
+
+				if (!f(w, *node))
+					return false;
+
+				for (int i = 0; i < link_c; i++)
+					if (node->links[i])
+						push(node->links[i]);
+
+				return true;
+			}, threads);
+		}
+
+		template < typename T > struct alignas(64) _Reduction
+		{
+			T value;
+		};
+
+		static bool _Live(const pointer_t& p)
+		{
+			if constexpr (node_t::type == TableType::btree_fuzzymap || node_t::type == TableType::btree_taggedmap)
+				return p != (pointer_t)-1 && !node_t::Erased(p);
+			else
+				return !node_t::Erased(p);
+		}
+
+		//A stored tombstone would read as erased, and an erase could not tell it from a live entry:
+		//
+
+		static void _Storable(const pointer_t& p)
+		{
+			if (node_t::Erased(p))
+				throw std::runtime_error("Pointer value is reserved for erased entries");
+		}
+
+		/*
+			Walks back up an erase path returning emptied leaves to the recycler.
+			A node left without children no longer needs tombstones and is compacted before it is checked.
+
+			Only Erase reclaims. Locked erases run beside lock free readers that may already be inside a leaf they reached
+			through its parent link, and nothing tracks when they leave. They also can't shrink a full leaf an insert may be
+			routing through, so their tombstones stay until an unlocked Erase passes by.
+		*/
+
+		void _Reclaim(std::vector<std::pair<link_t, int>>& path, link_t current_id)
+		{
+			node_t* current = &io->template Lookup<node_t>(current_id);
+
+			while (true)
+			{
+				bool empty = false;
+
+				if (current->Leaf())
+				{
+					current->Compact();
+					empty = !current->count;
+				}
+
+				if (!empty || !path.size())
+					return;
+
+				auto [parent_id, slot] = path.back();
+				path.pop_back();
+
+				node_t* parent = &io->template Lookup<node_t>(parent_id);
+
+				parent->links[slot] = 0;
+				_ForgetHot();
+				_ForgetTail();
+
+				io->FreeUnit(*((typename R::Unit*)current));
+
+				current = parent;
+				current_id = parent_id;
+			}
+		}
+
+		template < bool lock_v, typename F > size_t _EraseIf(F&& f, const key_t& k, void* ref_page)
+		{
+			size_t cowed = 0;
+
+			if (_Cowrite<lock_v>([&]() { cowed = _EraseCow<lock_v>(f, k, ref_page); }))
+				return cowed;
+
+			node_t* current = Root();
+			link_t current_id = root_n;
+
+			if (!current)
+				return 0;
+
+			std::vector<std::pair<link_t, int>> path;
+			size_t depth = 0, erased = 0;
+
+			while (current)
+			{
+				if constexpr (lock_v)
+					current->Lock();
+
+				int result = current->Erase(f, k, erased, depth++, (void*)io, ref_page);
+
+				if constexpr (lock_v)
+					current->Unlock();
+
+				if (!result)
+					break;
+
+				if (depth % double_stall_s != 0 || depth > double_max_s)
+					result = 1;
+
+				result--;
+
+				if (!current->links[result])
+					break;
+
+				path.emplace_back(current_id, result);
+
+				current_id = current->links[result];
+				current = &io->template Lookup<node_t>(current_id);
+			}
+
+			if (!lock_v && erased)
+				_Reclaim(path, current_id);
+
+			return erased;
+		}
+
+		template < bool lock_v > void _FindBatch(gsl::span<const key_t> ks, gsl::span<pointer_t*> results, void* ref_page) const
+		{
+			if (results.size() < ks.size())
+				throw std::runtime_error("Batch results are too small");
+
+			std::vector<size_t> active(ks.size()), slots(ks.size(), 0);
+			std::vector<node_t*> current(ks.size(), Root());
+
+			for (size_t i = 0; i < active.size(); i++)
+			{
+				active[i] = i;
+				results[i] = nullptr;
+			}
+
+			for (size_t depth = 0; active.size(); depth++)
+			{
+				size_t w = 0;
+
+				for (auto i : active)
+				{
+					pointer_t* pr;
+					int result;
+
+					if constexpr (lock_v)
+					{
+						ScopedLock lock(*current[i]); //Only works if no remap is allowed
+						result = current[i]->Find(ks[i], &pr, depth, (void*)io, ref_page);
+					}
+					else
+						result = current[i]->Find(ks[i], &pr, depth, (void*)io, ref_page);
+
+					if (!result)
+					{
+						results[i] = pr;
+						continue;
+					}
+
+					if ((depth + 1) % double_stall_s != 0 || depth + 1 > double_max_s)
+						result = 1;
+
+					result--;
+
+					auto next = _Descend(current[i], slots[i], result);
+
+					if (!next)
+						continue;
+
+					current[i] = next;
+					current[i]->Prefetch(ks[i], depth + 1);
+
+					active[w++] = i;
+				}
+
+				active.resize(w);
+			}
+		}
+
+		template < bool lock_v, typename T > void _InsertBatch(gsl::span<T> kv, gsl::span<pair<pointer_t*, bool>> results)
+		{
+			if (results.size() < kv.size())
+				throw std::runtime_error("Batch results are too small");
+
+			for (auto& e : kv)
+				_Storable(e.second);
+
+			if (_Cowrite<lock_v>([&]() { for (size_t i = 0; i < kv.size(); i++) results[i] = _InsertCow<lock_v>(kv[i].first, kv[i].second); }))
+				return;
+
+			if constexpr (key_t::mode == KeyMode::key_mode_local_surrogate)
+				for (auto& e : kv)
+					e.first = BindKey(e.first, (void*)io, nullptr);
+
+			std::vector<size_t> order(kv.size()), scratch(kv.size());
+			std::vector<std::pair<link_t, int>> where(kv.size());
+			std::vector<uint8_t> overwrite(kv.size());
+			std::vector<int> child(kv.size());
+
+			for (size_t i = 0; i < order.size(); i++)
+				order[i] = i;
+
+			if constexpr (node_t::type != TableType::btree_fuzzymap && node_t::type != TableType::btree_taggedmap)
+			{
+				std::stable_sort(order.begin(), order.end(), [&](size_t l, size_t r)
+				{
+					return kv[l].first.Compare(kv[r].first, (void*)io, nullptr) < 0;
+				});
+			}
+
+			struct task_t
+			{
+				link_t id;
+				size_t begin;
+				size_t end;
+				size_t depth;
+			};
+
+			std::vector<task_t> tasks;
+
+			if (order.size())
+				tasks.push_back({ root_n, 0, order.size(), 0 });
+
+			while (tasks.size())
+			{
+				auto t = tasks.back();
+				tasks.pop_back();
+
+				node_t* current = &io->template Lookup<node_t>(t.id);
+
+				if constexpr (lock_v)
+					current->Lock();
+
+				size_t routed[node_t::Links] = { 0 };
+
+				current->InsertBatch(kv.data(), order.data() + t.begin, t.end - t.begin, t.depth, (void*)io, [&](size_t i, int result, int slot, bool ow)
+				{
+					auto o = order[t.begin + i];
+
+					if (!result)
+					{
+						where[o] = { t.id, slot };
+						overwrite[o] = ow;
+						child[o] = -1;
+
+						return;
+					}
+
+					if ((t.depth + 1) % double_stall_s != 0 || t.depth + 1 > double_max_s)
+						result = 1;
+
+					child[o] = result - 1;
+					routed[result - 1]++;
+				});
+
+				//Stable partition by child keeps the run of every child sorted:
+				//
+
+				size_t start[node_t::Links];
+
+				for (size_t c = 0, s = t.begin; c < node_t::Links; s += routed[c++])
+					start[c] = s;
+
+				size_t end = start[node_t::Links - 1] + routed[node_t::Links - 1];
+
+				for (size_t i = t.begin; i < t.end; i++)
+					if (child[order[i]] != -1)
+						scratch[start[child[order[i]]]++] = order[i];
+
+				std::copy(scratch.begin() + t.begin, scratch.begin() + end, order.begin() + t.begin);
+
+				for (size_t c = 0; c < node_t::Links; c++)
+				{
+					if (!routed[c])
+						continue;
+
+					if (!current->links[c])
+					{
+						node_t* next;
+
+						if constexpr (lock_v)
+							next = &io->template RecycleLock<node_t>();
+						else
+							next = &io->template Recycle<node_t>();
+
+						next->Init();
+
+						//If the file was remapped, then this must be refreshed
+						current = &io->template Lookup<node_t>(t.id);
+
+						current->links[c] = (link_t)io->template Index<node_t>(*next);
+					}
+
+					tasks.push_back({ current->links[c], start[c] - routed[c], start[c], t.depth + 1 });
+				}
+
+				if constexpr (lock_v)
+					current->Unlock();
+			}
+
+			for (size_t i = 0; i < kv.size(); i++)
+				results[i] = { io->template Lookup<node_t>(where[i].first).pointers + where[i].second, (bool)overwrite[i] };
+		}
+
+public: 
+
+		bool Validate() const
+		{
+			return ParallelValidate();
+		}
+
+		//Unlocked nodes hold the guard value, anything else is a lock left behind:
+		//
+
+		int ResetNodeLocks()
+		{
+			std::atomic<int> result(0);
+
+			ParallelIterateNodes([&](auto & node)
+			{
+				if (node.footer_guard != (typename node_t::Int)node_t::_guard)
+				{
+					result++;
+					node.footer_guard = (typename node_t::Int)node_t::_guard;
+				}
+			});
+
+			return result;
+		}
+
+		/*
+			Parallel walks fan the subtrees out over a work stealing pool ( threads = 0 uses every core ), callbacks run concurrently
+			and in no particular order. Returning false from a callback stops the walk.
+
+			The reduce variant gives every worker its own accumulator, f(T&, key, pointer), and folds them with reduce(T&, const T&).
+		*/
+
+		template < typename F > void ParallelIterateNodes(F&& f, size_t threads = 0) const
+		{
+			_ParallelNodes([&](size_t w, node_t& node)
+			{
+				f(node);
+				return true;
+			}, threads);
+		}
+
+		template < typename F > size_t ParallelIterate(F&& f, size_t threads = 0) const
+		{
+			std::vector<_Reduction<size_t>> count(WorkStealingThreads(threads), { 0 });
+
+			_ParallelNodes([&](size_t w, node_t& node)
+			{
+				for (int i = 0, c = 0; i < (int)node.count && c < (int)node_t::Bins; c++)
+				{
+					if (node.pointers[c] != (pointer_t)-1 && !node_t::Erased(node.pointers[c]))
+					{
+						i++;
+						count[w].value++;
+
+						if (!f(node.pointers[c]))
+							return false;
+					}
+				}
+
+				return true;
+			}, threads);
+
+			size_t total = 0;
+			for (auto& c : count)
+				total += c.value;
+
+			return total;
+		}
+
+		template < typename F > size_t ParallelIterateKV(F&& f, size_t threads = 0) const
+		{
+			std::vector<_Reduction<size_t>> count(WorkStealingThreads(threads), { 0 });
+
+			_ParallelNodes([&](size_t w, node_t& node)
+			{
+				for (int i = 0, c = 0; i < (int)node.count && c < (int)node_t::Bins; c++)
+				{
+					if (_Live(node.pointers[c]))
+					{
+						i++;
+						count[w].value++;
+
+						if (!f(node.keys[c], node.pointers[c]))
+							return false;
+					}
+				}
+
+				return true;
+			}, threads);
+
+			size_t total = 0;
+			for (auto& c : count)
+				total += c.value;
+
+			return total;
+		}
+
+		template < typename T, typename F, typename G > T ParallelReduceKV(const T& init, F&& f, G&& reduce, size_t threads = 0) const
+		{
+			std::vector<_Reduction<T>> partial(WorkStealingThreads(threads), { init });
+
+			_ParallelNodes([&](size_t w, node_t& node)
+			{
+				for (int i = 0, c = 0; i < (int)node.count && c < (int)node_t::Bins; c++)
+				{
+					if (_Live(node.pointers[c]))
+					{
+						i++;
+						f(partial[w].value, node.keys[c], node.pointers[c]);
+					}
+				}
+
+				return true;
+			}, threads);
+
+			T result = init;
+			for (auto& p : partial)
+				reduce(result, p.value);
+
+			return result;
+		}
+
+		std::pair<uint64_t, uint64_t> ParallelPopulation(size_t threads = 0) const
+		{
+			std::vector<_Reduction<std::pair<uint64_t, uint64_t>>> partial(WorkStealingThreads(threads), { { 0, 0 } });
+
+			_ParallelNodes([&](size_t w, node_t& node)
+			{
+				if (node.count)
+				{
+					partial[w].value.first += node.count;
+					partial[w].value.second += node_t::Bins;
+				}
+
+				return true;
+			}, threads);
+
+			auto sum = std::make_pair(uint64_t(0), uint64_t(0));
+			for (auto& p : partial)
+			{
+				sum.first += p.value.first;
+				sum.second += p.value.second;
+			}
+
+			return sum;
+		}
+
+		bool ParallelValidate(size_t threads = 0) const
+		{
+			return _ParallelNodes([&](size_t w, node_t& node)
+			{
+				return node.Validate();
+			}, threads);
+		}
+
+		std::pair<uint64_t, uint64_t> Population()
+		{
+			auto sum = std::make_pair(uint64_t(0), uint64_t(0));
+
+			_Population(Root(), sum);
+
+			return sum;
+		}
+		
+		template < typename F > int Iterate(F &&f) const
+		{
+			if (!Root())
+				return 0;
+			else
+				return _Iterate(Root(),std::move(f));
+		}
+
+		template < typename F > int IterateKV(F&& f) const
+		{
+			if (!Root())
+				return 0;
+			else
+				return _IterateKV(Root(), std::move(f));
+		}
+
+		pointer_t* Find(const key_t& _k, void* ref_page=nullptr) const
+		{
+			auto&& k = BindKey(_k, (void*)io, ref_page);
+			node_t* current = Root();
+
+			if (!current)
+				return nullptr;
+
+			node_t* next = nullptr;
+			size_t depth = 0, slot = 0;
+
+			while (current)
+			{
+				pointer_t* pr;
+				int result = current->Find(k, &pr, depth++, (void*)io,ref_page);
+
+				if (!result)
+					return pr;
+				else
+				{
+					if (depth % double_stall_s != 0 || depth > double_max_s)
+						result = 1;
+
+					result--;
+
+					next = _Descend(current, slot, result);
+
+					if (!next)
+						return nullptr;
+					else
+						current = next;
+				}
+			}
+
+			return nullptr;
+		}
+
+		template <typename F> void MultiFind(F && f, const key_t& _k, void* ref_page = nullptr) const
+		{
+			auto&& k = BindKey(_k, (void*)io, ref_page);
+			node_t* current = Root();
+
+			if (!current)
+				return;
+
+			node_t* next = nullptr;
+			size_t depth = 0, slot = 0;
+
+			while (current)
+			{
+				int result = current->MultiFind(f, k, depth++, (void*)io, ref_page);
+
+				if (!result)
+					return;
+				else
+				{
+					if (depth % double_stall_s != 0 || depth > double_max_s)
+						result = 1;
+
+					result--;
+
+					next = _Descend(current, slot, result);
+
+					if (!next)
+						return;
+					else
+						current = next;
+				}
+			}
+		}
+
+		template <typename F> void RangeFind(F&& f, const key_t& low_k, const key_t& high_k, void* ref_page = nullptr, node_t* current = nullptr) const
+		{
+			if (!current)
+				current = Root();
+
+			auto [low,high] = current->FindRange(f, low_k, high_k, 0, (void*)io, ref_page);
+
+			if (!low && !high)
+				return;
+			else
+			{
+				low--; high--;
+
+				for (;low <= high;low++)
+				{
+					auto next = (current->links[low]) ? &io->template Lookup<node_t>(current->links[low]) : nullptr;
+					if(next)
+						RangeFind(f, low_k, high_k, ref_page, next);
+				}
+
+			}
+		}
+
+		/*
+			Stateful cursor over ordered and multi list trees, entries come out in key order.
+
+			A full node interleaves its keys with its children, child c holds the keys routed from positions
+			[ c * bin_c / link_c, ( c + 1 ) * bin_c / link_c ) so its entries fall between those separators.
+			The cursor keeps one frame ( node, segment, key ) per level and merges every level with the one below it.
+			Nothing is materialized. Stepping against the direction of travel re-seeks the current entry.
+		*/
+
+		class _Cursor
+		{
+			struct frame_t
+			{
+				link_t id;
+				int c;
+				int j;
+			};
+
+			const _BTree* tree = nullptr;
+			std::vector<frame_t> stack;
+			bool forward = true;
+			int at = -1;
+
+			//Index of the current entry inside its run of equal keys, counted in the direction of travel:
+			//
+
+			size_t rank = 0;
+
+			node_t& Node(size_t d) const
+			{
+				return tree->io->template Lookup<node_t>(stack[d].id);
+			}
+
+			static bool Full(const node_t& n)
+			{
+				return (size_t)n.count == node_t::Bins;
+			}
+
+			static int Segments(const node_t& n)
+			{
+				return (Full(n)) ? link_c : 1;
+			}
+
+			static int Start(const node_t& n, int c)
+			{
+				return (Full(n)) ? (int)((c * node_t::Bins + link_c - 1) / link_c) : 0;
+			}
+
+			static int End(const node_t& n, int c)
+			{
+				return (Full(n) && c + 1 < link_c) ? Start(n, c + 1) - 1 : (int)n.count - 1;
+			}
+
+			static link_t Child(const node_t& n, int c)
+			{
+				return (Full(n)) ? n.links[c] : 0;
+			}
+
+			static bool Own(const node_t& n, const frame_t& f)
+			{
+				return f.j >= Start(n, f.c) && f.j <= End(n, f.c);
+			}
+
+			void _Push(link_t id)
+			{
+				auto& n = tree->io->template Lookup<node_t>(id);
+
+				if (!n.count)
+					return;
+
+				int c = (forward) ? 0 : Segments(n) - 1;
+
+				stack.push_back({ id, c, (forward) ? Start(n, c) : End(n, c) });
+
+				if (auto l = Child(n, c))
+					_Push(l);
+			}
+
+			//Forward lands on the first entry >= k ( > k when strict ), reverse on the last entry <= k ( < k when strict ):
+			//
+
+			void _Seek(link_t id, const key_t& k, void* ref_page, bool strict)
+			{
+				auto& n = tree->io->template Lookup<node_t>(id);
+
+				if (!n.count)
+					return;
+
+				bool upper = (forward == strict);
+				int low = 0, high = (int)n.count;
+
+				while (low < high)
+				{
+					int middle = (low + high) >> 1;
+					int r = n.keys[middle].Compare(k, (void*)tree->io, ref_page);
+
+					if (r < 0 || (upper && r == 0))
+						low = middle + 1;
+					else
+						high = middle;
+				}
+
+				int c = (Full(n)) ? ((low == (int)node_t::Bins) ? low - 1 : low) * link_c / node_t::Bins : 0;
+
+				stack.push_back({ id, c, (forward) ? low : low - 1 });
+
+				if (auto l = Child(n, c))
+					_Seek(l, k, ref_page, strict);
+			}
+
+			void _Skip(frame_t& f, node_t& n)
+			{
+				while (Own(n, f) && node_t::Erased(n.pointers[f.j]))
+					f.j += (forward) ? 1 : -1;
+			}
+
+			void _Settle()
+			{
+				while (stack.size())
+				{
+					auto& f = stack.back();
+					auto& n = Node(stack.size() - 1);
+
+					_Skip(f, n);
+
+					if (Own(n, f))
+						break;
+
+					//The deepest frame ran out of entries in this segment, move on to the next segment and its child:
+					//
+
+					if ((forward) ? f.c + 1 < Segments(n) : f.c > 0)
+					{
+						f.c += (forward) ? 1 : -1;
+
+						if (auto l = Child(n, f.c))
+							_Push(l);
+
+						continue;
+					}
+
+					stack.pop_back();
+				}
+
+				for (size_t d = 0; d + 1 < stack.size(); d++)
+					_Skip(stack[d], Node(d));
+
+				//Ties go to the deeper level going forward and to the shallower one in reverse, so reverse order mirrors forward order:
+				//
+
+				at = -1;
+
+				for (int d = (int)stack.size() - 1; d >= 0; d--)
+				{
+					auto& n = Node(d);
+
+					if (!Own(n, stack[d]))
+						continue;
+
+					if (at == -1)
+					{
+						at = d;
+						continue;
+					}
+
+					int r = n.keys[stack[d].j].Compare(Key(), (void*)tree->io, nullptr);
+
+					if ((forward) ? r < 0 : r >= 0)
+						at = d;
+				}
+			}
+
+			bool _Step()
+			{
+				key_t k = Key();
+
+				stack[at].j += (forward) ? 1 : -1;
+
+				_Settle();
+
+				if (Valid() && Key().Compare(k, (void*)tree->io, nullptr) == 0)
+					rank++;
+				else
+					rank = 0;
+
+				return Valid();
+			}
+
+			//Re-seek the current entry traveling the other way, counting its run of equal keys when the ranks don't line up:
+			//
+
+			void _Turn()
+			{
+				key_t k = Key();
+				size_t index = rank, run = 0;
+				bool was = forward;
+
+				forward = true;
+				stack.clear();
+				_Seek(tree->root_n, k, nullptr, false);
+				_Settle();
+
+				while (Valid() && Key().Compare(k, (void*)tree->io, nullptr) == 0)
+				{
+					run++;
+
+					stack[at].j++;
+					_Settle();
+				}
+
+				index = run - 1 - index;
+
+				forward = !was;
+				stack.clear();
+				_Seek(tree->root_n, k, nullptr, false);
+				_Settle();
+
+				for (rank = 0; rank < index; rank++)
+				{
+					stack[at].j += (forward) ? 1 : -1;
+					_Settle();
+				}
+			}
+
+		public:
+
+			_Cursor(const _BTree* _tree) : tree(_tree)
+			{
+				static_assert(node_t::type != TableType::btree_fuzzymap && node_t::type != TableType::btree_taggedmap, "Cursors require ordered nodes");
+				static_assert(double_stall_s == 1 && double_max_s == (size_t)-1, "Cursors don't support stalled doubling");
+			}
+
+			bool Valid() const
+			{
+				return at != -1;
+			}
+
+			key_t& Key() const
+			{
+				return Node(at).keys[stack[at].j];
+			}
+
+			pointer_t& Pointer() const
+			{
+				return Node(at).pointers[stack[at].j];
+			}
+
+			bool SeekFirst()
+			{
+				forward = true;
+				rank = 0;
+				stack.clear();
+				_Push(tree->root_n);
+				_Settle();
+
+				return Valid();
+			}
+
+			bool SeekLast()
+			{
+				forward = false;
+				rank = 0;
+				stack.clear();
+				_Push(tree->root_n);
+				_Settle();
+
+				return Valid();
+			}
 
-			if (!count)
-				return 0;
+			//First entry >= k:
+			//
 
-			for (int i = 0, c = 0; i < (int)node->count; c++)
+			bool Seek(const key_t& k, void* ref_page = nullptr)
 			{
-				if(node->pointers[c] != (pointer_t)-1) // this is designed to filter out unused type in fuzzy map. Doesn't work with non int value types.
-				{ 
-					i++;
-					if (!f(node->pointers[c]))
-						return i;
-				}
-			}
+				forward = true;
+				rank = 0;
+				stack.clear();
+				_Seek(tree->root_n, k, ref_page, false);
+				_Settle();
 
-			for (int i = 0; i < link_c; i++)
-				if (node->links[i])
-					count += _Iterate(&io->template Lookup<node_t>((uint64_t)node->links[i]), f);
+				return Valid();
+			}
 
-			return count;
-		}
+			//Last entry <= k:
+			//
 
-		template < typename F > int _IterateKV(node_t* node, F&& f) const
-		{
-			int count = node->count;
+			bool SeekReverse(const key_t& k, void* ref_page = nullptr)
+			{
+				forward = false;
+				rank = 0;
+				stack.clear();
+				_Seek(tree->root_n, k, ref_page, false);
+				_Settle();
 
-			if (!count)
-				return 0;
+				return Valid();
+			}
 
-			for (int i = 0, c = 0; i < (int)node->count; c++)
+			bool Next()
 			{
-				//if (node->pointers[c] != (pointer_t)-1) //Disabling fuzzy map filtering for K/V version
+				if (!Valid())
+					return false;
+
+				if (!forward)
 				{
-					i++;
-					if (!f(node->keys[c],node->pointers[c]))
-						return i;
-				}
-			}
+					//The entry after the first of a run is the first entry > k:
+					//
 
-			for (int i = 0; i < link_c; i++)
-				if (node->links[i])
-					count += _IterateKV(&io->template Lookup<node_t>((uint64_t)node->links[i]), f);
+					if (!rank)
+					{
+						key_t k = Key();
 
-			return count;
-		}
+						forward = true;
+						stack.clear();
+						_Seek(tree->root_n, k, nullptr, true);
+						_Settle();
 
-		bool _Validate(node_t* node) const
-		{
-			if (!node->Validate()) 
-				return false;
+						return Valid();
+					}
 
-			for (int i = 0; i < link_c; i++)
+					_Turn();
+				}
+
+				return _Step();
+			}
+
+			bool Prev()
 			{
-				if (node->links[i])
+				if (!Valid())
+					return false;
+
+				if (forward)
 				{
-					if (!_Validate(&io->template Lookup<node_t>((uint64_t)node->links[i]))) 
-						return false;
+					if (!rank)
+					{
+						key_t k = Key();
+
+						forward = false;
+						stack.clear();
+						_Seek(tree->root_n, k, nullptr, true);
+						_Settle();
+
+						return Valid();
+					}
+
+					_Turn();
 				}
+
+				return _Step();
 			}
 
-			return true;
-		}
+			size_t Skip(size_t offset)
+			{
+				size_t i = 0;
 
-public: 
+				for (; i < offset && Valid(); i++)
+					Next();
 
-		bool Validate() const
-		{
-			if (!Root())
-				return true;
-			else
-				return _Validate(Root());
-		}
+				return i;
+			}
 
-		int ResetNodeLocks()
-		{
-			int result = 0;
-			IterateNodes([&](auto & node)
+			//f(key, pointer) for up to limit entries from the current one, returning false stops early:
+			//
+
+			template < typename F > size_t Take(size_t limit, F&& f)
 			{
-				if (node.footer_guard)
+				size_t i = 0;
+
+				for (; i < limit && Valid(); i++)
 				{
-					result++;
-					node.footer_guard = 0;
+					if (!f(Key(), Pointer()))
+						return i + 1;
+
+					Next();
 				}
-			});
 
-			return result;
+				return i;
+			}
+		};
+
+		_Cursor Cursor() const
+		{
+			return _Cursor(this);
 		}
 
-		std::pair<uint64_t, uint64_t> Population()
+		template < typename F > size_t Page(const key_t& k, size_t offset, size_t limit, F&& f, void* ref_page = nullptr) const
 		{
-			auto sum = std::make_pair(uint64_t(0), uint64_t(0));
+			auto cursor = Cursor();
 
-			_Population(Root(), sum);
+			cursor.Seek(k, ref_page);
+			cursor.Skip(offset);
 
-			return sum;
-		}
-		
-		template < typename F > int Iterate(F &&f) const
-		{
-			if (!Root())
-				return 0;
-			else
-				return _Iterate(Root(),std::move(f));
+			return cursor.Take(limit, f);
 		}
 
-		template < typename F > int IterateKV(F&& f) const
-		{
-			if (!Root())
-				return 0;
-			else
-				return _IterateKV(Root(), std::move(f));
-		}
+		/*
+			Bottom up bulk load into an empty index from key / pointer pairs ( std::pair<key_t, pointer_t> ).
 
-		pointer_t* Find(const key_t& k, void* ref_page=nullptr) const
-		{
-			node_t* current = Root();
+			Ordered nodes expect the input sorted by key ( pass sorted = false to sort it here ), hash nodes take any order.
+			Every level is written into one contiguous AllocateSpan with links filled directly, the input span is reordered.
+			Ordered trees without duplicate keys load only the first pair of each key in input order, as Insert would keep it.
+			Returns the pairs loaded.
+		*/
 
-			if (!current)
-				return nullptr;
+		template < typename T > size_t BulkLoad(gsl::span<T> kv, bool sorted = true)
+		{
+			static_assert(double_stall_s == 1 && double_max_s == (size_t)-1, "Bulk load doesn't support stalled doubling");
 
-			node_t* next = nullptr;
-			size_t depth = 0;
+			if (Root()->count || !Root()->Leaf())
+				throw std::runtime_error("Bulk load requires an empty index");
 
-			while (current)
-			{
-				pointer_t* pr;
-				int result = current->Find(k, &pr, depth++, (void*)io,ref_page);
+			_ForgetTail();
 
-				if (!result)
-					return pr;
-				else
-				{
-					if (depth % double_stall_s != 0 || depth > double_max_s)
-						result = 1;
+			for (auto& e : kv)
+				_Storable(e.second);
 
-					result--;
+			if constexpr (key_t::mode == KeyMode::key_mode_local_surrogate)
+				for (auto& e : kv)
+					e.first = BindKey(e.first, (void*)io, nullptr);
 
-					next = (current->links[result]) ? &io->template Lookup<node_t>(current->links[result]) : nullptr;
+			size_t n = kv.size();
 
-					if (!next)
-						return nullptr;
-					else
-						current = next;
-				}
-			}
+			if (node_t::type != TableType::btree_fuzzymap && node_t::type != TableType::btree_taggedmap)
+			{
+				auto compare = [&](auto& l, auto& r)
+				{
+					return const_cast<key_t&>(l.first).Compare(r.first, (void*)io, nullptr);
+				};
 
-			return nullptr;
-		}
+				if (!sorted && multi_c)
+					std::sort(kv.begin(), kv.end(), [&](auto& l, auto& r) { return compare(l, r) < 0; });
+				else if (!sorted)
+					std::stable_sort(kv.begin(), kv.end(), [&](auto& l, auto& r) { return compare(l, r) < 0; });
 
-		template <typename F> void MultiFind(F && f, const key_t& k, void* ref_page = nullptr) const
-		{
-			node_t* current = Root();
+				if (!multi_c)
+					n = std::unique(kv.begin(), kv.end(), [&](auto& l, auto& r) { return !compare(l, r); }) - kv.begin();
+			}
 
-			if (!current)
-				return;
+			struct task_t
+			{
+				T* kv;
+				size_t n;
+				link_t parent;
+				int slot;
+			};
 
-			node_t* next = nullptr;
-			size_t depth = 0;
+			std::vector<task_t> level, next;
+			level.push_back({ kv.data(), n, 0, -1 });
 
-			while (current)
+			for (size_t depth = 0; level.size(); depth++)
 			{
-				int result = current->MultiFind(f, k, depth++, (void*)io, ref_page);
+				link_t first = root_n;
 
-				if (!result)
-					return;
-				else
+				if (depth)
 				{
-					if (depth % double_stall_s != 0 || depth > double_max_s)
-						result = 1;
-
-					result--;
+					first = (link_t)io->IndexUnit(*io->AllocateSpan(level.size()));
 
-					next = (current->links[result]) ? &io->template Lookup<node_t>(current->links[result]) : nullptr;
-
-					if (!next)
-						return;
-					else
-						current = next;
+					for (size_t i = 0; i < level.size(); i++)
+						io->template Lookup<node_t>(level[i].parent).links[level[i].slot] = (link_t)(first + i);
 				}
-			}
-		}
-
-		template <typename F> void RangeFind(F&& f, const key_t& low_k, const key_t& high_k, void* ref_page = nullptr, node_t* current = nullptr) const
-		{
-			if (!current)
-				current = Root();
 
-			auto [low,high] = current->FindRange(f, low_k, high_k, 0, (void*)io, ref_page);
+				for (size_t i = 0; i < level.size(); i++)
+				{
+					link_t id = (link_t)(first + i);
+					node_t* node = &io->template Lookup<node_t>(id);
 
-			if (!low && !high)
-				return;
-			else
-			{
-				low--; high--;
+					if (depth)
+						new(node) node_t();
 
-				for (;low <= high;low++)
-				{
-					auto next = (current->links[low]) ? &io->template Lookup<node_t>(current->links[low]) : nullptr;
-					if(next)
-						RangeFind(f, low_k, high_k, ref_page, next);
+					node->Init();
+					node->Load(level[i].kv, level[i].n, depth, (void*)io, [&](int slot, T* _kv, size_t _n)
+					{
+						if (_n)
+							next.push_back({ _kv, _n, id, slot });
+					});
 				}
 
+				level.swap(next);
+				next.clear();
 			}
+
+			return n;
 		}
 
 		void Insert(const gsl::span<key_t> & ks, const pointer_t &p)
@@ -1216,16 +3796,31 @@ public:
 				Insert(k,p);
 		}
 
-		pair<pointer_t*, bool> Insert(const key_t& k, const pointer_t& p)
+		pair<pointer_t*, bool> Insert(const key_t& _k, const pointer_t& p)
 		{
-			node_t* current = Root();
+			_Storable(p);
+
+			pair<pointer_t*, bool> cowed;
+
+			if (_Cowrite<false>([&]() { cowed = _InsertCow<false>(_k, p); }))
+				return cowed;
+
+			auto&& k = BindKey(_k, (void*)io, nullptr);
+
 			link_t current_id = root_n;
+			size_t depth = 0, slot = 0;
+
+			std::optional<key_t> bound;
+			bool rightmost = appends_c;
+
+			_FromTail(k, current_id, depth, slot, bound);
+
+			node_t* current = (current_id == root_n) ? Root() : &io->template Lookup<node_t>(current_id);
 
 			if (!current)
 				return { nullptr,false };
 
 			node_t* next = nullptr;
-			size_t depth = 0;
 
 			while (current)
 			{
@@ -1244,11 +3839,11 @@ public:
 
 					result--;
 
-					next = (current->links[result]) ? &io->template Lookup<node_t>(current->links[result]) : nullptr;
+					next = _Descend(current, slot, result);
 
 					if (!next)
 					{
-						next = &io->template Allocate<node_t>();
+						next = &io->template Recycle<node_t>();
 						next->Init();
 
 						//If the file was remapped, then this must be refreshed
@@ -1258,6 +3853,11 @@ public:
 					}
 
 					current_id = current->links[result];
+
+					if constexpr (appends_c)
+						if (rightmost)
+							rightmost = _Extend(*current, result, current_id, depth, slot, bound);
+
 					current = next;
 				}
 			}
@@ -1265,15 +3865,31 @@ public:
 			return { nullptr,false };
 		}
 
-		pointer_t* FindLock(const key_t& k, void* ref_page = nullptr) const
+		/*
+			Batched lookups advance every key one level per round and prefetch the node each key visits next,
+			so the misses of the whole batch overlap instead of being paid one key at a time.
+		*/
+
+		void FindBatch(gsl::span<const key_t> ks, gsl::span<pointer_t*> results, void* ref_page = nullptr) const
+		{
+			_FindBatch<false>(ks, results, ref_page);
+		}
+
+		void FindBatchLock(gsl::span<const key_t> ks, gsl::span<pointer_t*> results, void* ref_page = nullptr) const
+		{
+			_FindBatch<true>(ks, results, ref_page);
+		}
+
+		pointer_t* FindLock(const key_t& _k, void* ref_page = nullptr) const
 		{
+			auto&& k = BindKey(_k, (void*)io, ref_page);
 			node_t* current = Root();
 
 			if (!current)
 				return nullptr;
 
 			node_t* next = nullptr;
-			size_t depth = 0;
+			size_t depth = 0, slot = 0;
 
 			while (current)
 			{
@@ -1291,7 +3907,7 @@ public:
 
 					result--;
 
-					next = (current->links[result]) ? &io->template Lookup<node_t>(current->links[result]) : nullptr;
+					next = _Descend(current, slot, result);
 
 					if (!next)
 						return nullptr;
@@ -1309,8 +3925,17 @@ public:
 				InsertLock(k, p);
 		}
 
-		pair<pointer_t*, bool> InsertLock(const key_t& k, const pointer_t& p)
+		pair<pointer_t*, bool> InsertLock(const key_t& _k, const pointer_t& p)
 		{
+			_Storable(p);
+
+			pair<pointer_t*, bool> cowed;
+
+			if (_Cowrite<true>([&]() { cowed = _InsertCow<true>(_k, p); }))
+				return cowed;
+
+			auto&& k = BindKey(_k, (void*)io, nullptr);
+
 			node_t* current = Root();
 			link_t current_id = root_n;
 
@@ -1318,7 +3943,7 @@ public:
 				return { nullptr,false };
 
 			node_t* next = nullptr;
-			size_t depth = 0;
+			size_t depth = 0, slot = 0;
 
 			while (current)
 			{
@@ -1326,9 +3951,9 @@ public:
 				//	return { nullptr,false };
 
 				bool locked = false;
-				if (current->count != node_t::Bins) //Must be locked to insert
+				if (_Touches(current, k, depth, nullptr)) //Must be locked to insert, or to revive k in a full node
 				{
-					current->Lock(); 
+					current->Lock();
 					locked = true;
 				}
 
@@ -1347,7 +3972,7 @@ public:
 
 					result--;
 
-					next = (current->links[result]) ? &io->template Lookup<node_t>(current->links[result]) : nullptr;
+					next = _Descend(current, slot, result);
 
 					if (!next)
 					{ 
@@ -1361,7 +3986,7 @@ public:
 
 						if (!next)
 						{
-							next = &io->template AllocateLock<node_t>();
+							next = &io->template RecycleLock<node_t>();
 							next->Init();
 
 							//If the file was remapped, then this must be refreshed
@@ -1381,8 +4006,60 @@ public:
 			return { nullptr,false };
 		}
 
-		template <typename F> pair<pointer_t*, bool> InsertLockContext(const key_t& k, const pointer_t& p, F && f)
+		/*
+			Batch insert of key / pointer pairs ( std::pair<key_t, pointer_t> ), results[i] receives what Insert returns for kv[i].
+			The batch is sorted once and each node is visited once with every key that lands in it, the lock variant locks it once.
+		*/
+
+		template < typename T > void InsertBatch(gsl::span<T> kv, gsl::span<pair<pointer_t*, bool>> results)
+		{
+			_InsertBatch<false>(kv, results);
+		}
+
+		template < typename T > void InsertBatchLock(gsl::span<T> kv, gsl::span<pair<pointer_t*, bool>> results)
+		{
+			_InsertBatch<true>(kv, results);
+		}
+
+		/*
+			Erase removes every entry matching the key, EraseIf only those accepted by the predicate ( f(pointer_t*) -> bool ).
+			Both return the number of entries removed.
+
+			The lock variants lock each node while it is edited and run alongside InsertLock and lock free readers, an insert
+			locks any full node that already holds its key. They leave full nodes their layout and free nothing, see _Reclaim.
+		*/
+
+		size_t Erase(const key_t& k, void* ref_page = nullptr)
+		{
+			return _EraseIf<false>([](auto*) { return true; }, k, ref_page);
+		}
+
+		template <typename F> size_t EraseIf(F&& f, const key_t& k, void* ref_page = nullptr)
+		{
+			return _EraseIf<false>(f, k, ref_page);
+		}
+
+		size_t EraseLock(const key_t& k, void* ref_page = nullptr)
+		{
+			return _EraseIf<true>([](auto*) { return true; }, k, ref_page);
+		}
+
+		template <typename F> size_t EraseIfLock(F&& f, const key_t& k, void* ref_page = nullptr)
+		{
+			return _EraseIf<true>(f, k, ref_page);
+		}
+
+		template <typename F> pair<pointer_t*, bool> InsertLockContext(const key_t& _k, const pointer_t& p, F && f)
 		{
+			_Storable(p);
+
+			pair<pointer_t*, bool> cowed;
+
+			if (_Cowrite<true>([&]() { cowed = f(_InsertCow<true>(_k, p)); }))
+				return cowed;
+
+			auto&& k = BindKey(_k, (void*)io, nullptr);
+
 			node_t* current = Root();
 			link_t current_id = root_n;
 
@@ -1390,7 +4067,7 @@ public:
 				return f(pair<pointer_t*, bool>{ nullptr, false });
 
 			node_t* next = nullptr;
-			size_t depth = 0;
+			size_t depth = 0, slot = 0;
 
 			while (current)
 			{
@@ -1398,7 +4075,7 @@ public:
 				//	return f(pair<pointer_t*, bool>{ nullptr, false });
 
 				bool locked = false;
-				if (current->count != node_t::Bins) //Must be locked to insert
+				if (_Touches(current, k, depth, nullptr)) //Must be locked to insert, or to revive k in a full node
 				{
 					current->Lock();
 					locked = true;
@@ -1420,7 +4097,7 @@ public:
 
 					result--;
 
-					next = (current->links[result]) ? &io->template Lookup<node_t>(current->links[result]) : nullptr;
+					next = _Descend(current, slot, result);
 
 					if (!next)
 					{
@@ -1434,7 +4111,7 @@ public:
 
 						if (!next)
 						{
-							next = &io->template AllocateLock<node_t>();
+							next = &io->template RecycleLock<node_t>();
 							next->Init();
 
 							//If the file was remapped, then this must be refreshed
@@ -1499,5 +4176,111 @@ public:
 
 
 
-	template < typename R, typename N, size_t doubling_stall = 1, size_t doubling_max = -1 > using BTree = _BTree<R, N, doubling_stall, doubling_max>;
+	template <size_t page_s, typename int_t, typename key_t, typename pointer_t, typename link_t, size_t link_c, size_t fuzzy_c, bool check_v = false>
+	using TaggedHashBuilder = _TaggedHashNode <	int_t,
+												key_t,
+												pointer_t,
+												link_t,
+												(page_s - sizeof(int_t) * 3 - sizeof(link_t) * link_c) / (sizeof(key_t) + sizeof(pointer_t) + 1),
+												link_c,
+												fuzzy_c,
+												(page_s - sizeof(int_t) * 3 - sizeof(link_t) * link_c) % (sizeof(key_t) + sizeof(pointer_t) + 1), check_v >;
+
+	template <size_t page_s, typename int_t, typename key_t, size_t fuzzy_c = 16, size_t link_c = 4, bool check_v = false> using SimpleTaggedHashBuilder = TaggedHashBuilder<page_s, int_t, key_t, int_t, int_t, link_c, fuzzy_c, check_v>;
+
+
+
+	/*
+		Aligned builders, the most bins whose aligned layout and extra_c bytes per bin still fit the page.
+	*/
+
+	template <size_t page_s, typename int_t, typename key_t, typename pointer_t, typename link_t, size_t link_c, size_t extra_c, size_t align_c> struct _AlignedBins
+	{
+		template < size_t bin_c > using layout_t = _NodeLayout<int_t, key_t, pointer_t, link_t, bin_c, link_c, align_c>;
+
+		static constexpr size_t Size(size_t bins)
+		{
+			size_t pointers = sizeof(key_t) * bins;
+			pointers += _AlignPad(pointers, align_c);
+
+			size_t lock = pointers + sizeof(pointer_t) * bins + sizeof(link_t) * link_c + sizeof(int_t) * 2;
+			lock += _AlignPad(lock, align_c);
+
+			return lock + align_c + extra_c * bins;
+		}
+
+		static constexpr size_t Bins()
+		{
+			size_t bins = (page_s - sizeof(link_t) * link_c - sizeof(int_t) * 2) / (sizeof(key_t) + sizeof(pointer_t) + extra_c);
+
+			while (bins && Size(bins) > page_s)
+				bins--;
+
+			return bins;
+		}
+
+		static const size_t bins = Bins();
+		static const size_t padding = page_s - Size(bins);
+
+		static_assert(layout_t<bins>::size_c + extra_c * bins == Size(bins));
+	};
+
+	template <size_t page_s, typename int_t, typename key_t, typename pointer_t, typename link_t, size_t link_c, bool check_v = false, size_t align_c = 64>
+	using AlignedOrderedListBuilder = _OrderedListNode<	int_t,
+														key_t,
+														pointer_t,
+														link_t,
+														_AlignedBins<page_s, int_t, key_t, pointer_t, link_t, link_c, 0, align_c>::bins,
+														link_c,
+														_AlignedBins<page_s, int_t, key_t, pointer_t, link_t, link_c, 0, align_c>::padding, check_v, align_c >;
+
+	template <size_t page_s, typename int_t, typename key_t, size_t link_c = 4, bool check_v = false> using SimpleAlignedOrderedListBuilder = AlignedOrderedListBuilder<page_s, int_t, key_t, int_t, int_t, link_c, check_v>;
+
+
+
+	template <size_t page_s, typename int_t, typename key_t, typename pointer_t, typename link_t, size_t link_c = 4, bool check_v = false, size_t align_c = 64>
+	using AlignedMultiListBuilder = _OrderedMultiListNode<	int_t,
+															key_t,
+															pointer_t,
+															link_t,
+															_AlignedBins<page_s, int_t, key_t, pointer_t, link_t, link_c, 0, align_c>::bins,
+															link_c,
+															_AlignedBins<page_s, int_t, key_t, pointer_t, link_t, link_c, 0, align_c>::padding, check_v, align_c >;
+
+	template <size_t page_s, typename int_t, typename key_t, size_t link_c = 4, bool check_v = false> using SimpleAlignedMultiListBuilder = AlignedMultiListBuilder<page_s, int_t, key_t, int_t, int_t, link_c, check_v>;
+
+
+
+	template <size_t page_s, typename int_t, typename key_t, typename pointer_t, typename link_t, size_t link_c, size_t fuzzy_c, bool check_v = false, size_t align_c = 64>
+	using AlignedFuzzyHashBuilder = _FuzzyHashNode <	int_t,
+														key_t,
+														pointer_t,
+														link_t,
+														_AlignedBins<page_s, int_t, key_t, pointer_t, link_t, link_c, 0, align_c>::bins,
+														link_c,
+														fuzzy_c,
+														_AlignedBins<page_s, int_t, key_t, pointer_t, link_t, link_c, 0, align_c>::padding, check_v, align_c >;
+
+	template <size_t page_s, typename int_t, typename key_t, size_t fuzzy_c = 4, size_t link_c = 4, bool check_v = false> using SimpleAlignedFuzzyHashBuilder = AlignedFuzzyHashBuilder<page_s, int_t, key_t, int_t, int_t, link_c, fuzzy_c, check_v>;
+
+
+
+	//Tags follow the lock line, so they start on a boundary too:
+	//
+
+	template <size_t page_s, typename int_t, typename key_t, typename pointer_t, typename link_t, size_t link_c, size_t fuzzy_c, bool check_v = false, size_t align_c = 64>
+	using AlignedTaggedHashBuilder = _TaggedHashNode <	int_t,
+														key_t,
+														pointer_t,
+														link_t,
+														_AlignedBins<page_s, int_t, key_t, pointer_t, link_t, link_c, 1, align_c>::bins,
+														link_c,
+														fuzzy_c,
+														_AlignedBins<page_s, int_t, key_t, pointer_t, link_t, link_c, 1, align_c>::padding, check_v, align_c >;
+
+	template <size_t page_s, typename int_t, typename key_t, size_t fuzzy_c = 16, size_t link_c = 4, bool check_v = false> using SimpleAlignedTaggedHashBuilder = AlignedTaggedHashBuilder<page_s, int_t, key_t, int_t, int_t, link_c, fuzzy_c, check_v>;
+
+
+
+	template < typename R, typename N, size_t doubling_stall = 1, size_t doubling_max = -1, size_t hot_levels = 3 > using BTree = _BTree<R, N, doubling_stall, doubling_max, hot_levels>;
 }
\ No newline at end of file
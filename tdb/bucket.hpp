@@ -4,6 +4,8 @@
 
 #include "types.hpp"
 
+#include <vector>
+
 namespace tdb
 {
 	using namespace std;
@@ -218,8 +220,21 @@ namespace tdb
 
 		template < typename K, typename F > void Stream(const K& k, F && f) // todo when needed, locking version.
 		{
-			auto ptr = index.Find(k);
+			_Stream(index.Find(k), f);
+		}
+
+		template < typename K, typename F > void StreamBatch(gsl::span<const K> ks, F && f)
+		{
+			std::vector<decltype(index.Find(ks[0]))> ptrs(ks.size());
 
+			index.FindBatch(ks, gsl::span<decltype(index.Find(ks[0]))>(ptrs));
+
+			for (auto ptr : ptrs)
+				_Stream(ptr, f);
+		}
+
+		template < typename P, typename F > void _Stream(P* ptr, F && f)
+		{
 			if (!ptr) return;
 
 			auto _header = io->GetObject(*ptr);
@@ -55,6 +55,7 @@ namespace tdb
 				desc.standard_index.pointer_sz = sizeof(pointer_t);
 				desc.standard_index.key_mode = key_t::mode;
 				desc.standard_index.key_type = key_t::type;
+				desc.standard_index.hash_policy = _KeyHashPolicy<key_t>::value;
 
 				desc.standard_index.max_capacity = (uint32_t)node_t::Bins;
 				desc.standard_index.min_capacity = (uint16_t)-1;
@@ -64,6 +65,8 @@ namespace tdb
 
 				desc.standard_index.link_count = node_t::Links;
 			}
+			else if (!HashPolicyMatches(io->GetDescriptor(root_n).standard_index.hash_policy, _KeyHashPolicy<key_t>::value))
+				throw std::runtime_error("Index was built with a different key hash");
 		}
 
 	private:
@@ -159,6 +159,7 @@ namespace tdb
 		using NameSearch = StringSearch32<R>;
 		using HashSearch = BTree< R, MultiSurrogateKeyPointer32v<R> >;
 		using MountSearch = BTree< R, OrderedSegmentPointer32 >;
+		using MountIntervals = IntervalIndex32<R>; //Every run overlapping a query is found, a segment btree treats overlapping runs as one key.
 		using NonFileComponent = BTree< R, OrderedIntKey<uint32_t> >;
 
 		using NameNull = NullStringSearch32<R>;
@@ -166,11 +167,17 @@ namespace tdb
 		using MountNull = NullIndex< R, OrderedSegmentPointer32 >;
 		using NonFileComponentNull = NullIndex< R, OrderedIntKey<uint32_t> >;
 
-		using FullIndex32 = DatabaseBuilder < R, SurrogateTable<R, E, NameSearch, HashSearch, MountSearch >, NonFileComponent >; //This is too expensive ATM, todo optimize.
+		using FullIndex32 = DatabaseBuilder < R, SurrogateTable<R, E, NameSearch, HashSearch, MountSearch >, NonFileComponent >; //Too expensive to maintain per row, bulk ingests DeferIndexes then BuildIndexes.
 		using NoIndex32 = DatabaseBuilder < R, SurrogateTable<R, E, NameNull, HashNull, MountNull >, NonFileComponentNull >;
 		using HalfIndex32 = DatabaseBuilder < R, SurrogateTable<R, E, NameNull, HashSearch, MountSearch >, NonFileComponent >;
 		using MinimalIndex32 = DatabaseBuilder < R, SurrogateTable<R, E, NameNull, HashSearch, MountNull >, NonFileComponentNull >;
 
+		//Interval mount indexes lay out their slot differently, a file keeps the flavor it was created with:
+		//
+
+		using FullIntervalIndex32 = DatabaseBuilder < R, SurrogateTable<R, E, NameSearch, HashSearch, MountIntervals >, NonFileComponent >;
+		using HalfIntervalIndex32 = DatabaseBuilder < R, SurrogateTable<R, E, NameNull, HashSearch, MountIntervals >, NonFileComponent >;
+
 
 
 		//Read Only Memory:
@@ -180,6 +187,7 @@ namespace tdb
 		using NameSearchM = StringSearch32<MRO>;
 		using HashSearchM = BTree< MRO, MultiSurrogateKeyPointer32v<R> >;
 		using MountSearchM = BTree< MRO, OrderedSegmentPointer32 >;
+		using MountIntervalsM = IntervalIndex32<MRO>;
 		using NonFileComponentM = BTree< MRO, OrderedIntKey<uint32_t> >;
 
 		using NameNullM = NullStringSearch32<MRO>;
@@ -192,6 +200,9 @@ namespace tdb
 		using HalfIndex32M = DatabaseBuilder < MRO, SurrogateTable<MRO, E, NameNullM, HashSearchM, MountSearchM >, NonFileComponentM >;
 		using MinimalIndex32M = DatabaseBuilder < MRO, SurrogateTable<MRO, E, NameNullM, HashSearchM, MountNullM >, NonFileComponentNullM >;
 
+		using FullIntervalIndex32M = DatabaseBuilder < MRO, SurrogateTable<MRO, E, NameSearchM, HashSearchM, MountIntervalsM >, NonFileComponentM >;
+		using HalfIntervalIndex32M = DatabaseBuilder < MRO, SurrogateTable<MRO, E, NameNullM, HashSearchM, MountIntervalsM >, NonFileComponentM >;
+
 		enum Tables { Files, Blocks };
 		enum Indexes { Names, Hash, Disk };
 		enum Values { Size, Time, NameList,Parent,Keys,Runs,Name };
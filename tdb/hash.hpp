@@ -3,8 +3,23 @@
 #pragma once
 
 #include <array>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
 #include <type_traits>
 #include <cryptopp/sha.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#include "../gsl-lite.hpp"
+#include "types.hpp"
 
 namespace tdb
 {
@@ -39,4 +54,390 @@ namespace tdb
 		CryptoPP::SHA512 hh;
 		hh.CalculateDigest((uint8_t *)&t, (CryptoPP::byte*)h.data(), h.size());
 	}
+
+	/*
+		Multi-buffer SHA-256, one message per 32 bit lane of a vector register.
+
+		A single SHA-256 is a serial chain of rounds, hashing many small blocks one at a time leaves most of the core idle.
+		Lanes hash independent messages in lockstep, messages are grouped by block count so few lanes sit idle.
+		When the CPU has the SHA extensions the scalar path is faster per message and HashBatchT defers to it.
+	*/
+
+	inline constexpr uint32_t sha256_k[64] =
+	{
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+	};
+
+	inline constexpr uint32_t sha256_h[8] = 
+	{ 
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 
+	};
+
+	inline bool HasShaExtensions()
+	{
+		static const bool sha = []()
+		{
+#ifdef _MSC_VER
+			int r[4];
+			__cpuidex(r, 7, 0);
+
+			return (r[1] & (1 << 29)) != 0;
+#else
+			unsigned int a, b, c, d;
+
+			if (!__get_cpuid_count(7, 0, &a, &b, &c, &d))
+				return false;
+
+			return (b & (1u << 29)) != 0;
+#endif
+		}();
+
+		return sha;
+	}
+
+	inline uint32_t _ByteSwap32(uint32_t v)
+	{
+#ifdef _MSC_VER
+		return _byteswap_ulong(v);
+#else
+		return __builtin_bswap32(v);
+#endif
+	}
+
+	struct _Sha256Lanes4
+	{
+		using v_t = __m128i;
+		static const size_t lanes_c = 4;
+
+		static v_t Load(const uint32_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+		static void Store(uint32_t* p, v_t v) { _mm_storeu_si128((__m128i*)p, v); }
+		static v_t Set(uint32_t v) { return _mm_set1_epi32((int)v); }
+		static v_t Add(v_t a, v_t b) { return _mm_add_epi32(a, b); }
+		static v_t Xor(v_t a, v_t b) { return _mm_xor_si128(a, b); }
+		static v_t And(v_t a, v_t b) { return _mm_and_si128(a, b); }
+		static v_t AndNot(v_t a, v_t b) { return _mm_andnot_si128(a, b); }
+		static v_t Or(v_t a, v_t b) { return _mm_or_si128(a, b); }
+		template < int n > static v_t Shr(v_t a) { return _mm_srli_epi32(a, n); }
+		template < int n > static v_t Rotr(v_t a) { return _mm_or_si128(_mm_srli_epi32(a, n), _mm_slli_epi32(a, 32 - n)); }
+	};
+
+#ifdef __AVX2__
+	struct _Sha256Lanes8
+	{
+		using v_t = __m256i;
+		static const size_t lanes_c = 8;
+
+		static v_t Load(const uint32_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+		static void Store(uint32_t* p, v_t v) { _mm256_storeu_si256((__m256i*)p, v); }
+		static v_t Set(uint32_t v) { return _mm256_set1_epi32((int)v); }
+		static v_t Add(v_t a, v_t b) { return _mm256_add_epi32(a, b); }
+		static v_t Xor(v_t a, v_t b) { return _mm256_xor_si256(a, b); }
+		static v_t And(v_t a, v_t b) { return _mm256_and_si256(a, b); }
+		static v_t AndNot(v_t a, v_t b) { return _mm256_andnot_si256(a, b); }
+		static v_t Or(v_t a, v_t b) { return _mm256_or_si256(a, b); }
+		template < int n > static v_t Shr(v_t a) { return _mm256_srli_epi32(a, n); }
+		template < int n > static v_t Rotr(v_t a) { return _mm256_or_si256(_mm256_srli_epi32(a, n), _mm256_slli_epi32(a, 32 - n)); }
+	};
+
+	using _Sha256Lanes = _Sha256Lanes8;
+#else
+	using _Sha256Lanes = _Sha256Lanes4;
+#endif
+
+	/*
+		One 64 byte block of every lane, words[t][lane] holds message word t.
+		Lanes outside active keep their state.
+	*/
+
+	template < typename L > void _Sha256Compress(typename L::v_t* state, const uint32_t (*words)[L::lanes_c], typename L::v_t active)
+	{
+		using v_t = typename L::v_t;
+
+		v_t w[16];
+
+		for (size_t t = 0; t < 16; t++)
+			w[t] = L::Load(words[t]);
+
+		v_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+
+		for (size_t t = 0; t < 64; t++)
+		{
+			if (t >= 16)
+			{
+				v_t w15 = w[(t - 15) & 15], w2 = w[(t - 2) & 15];
+
+				v_t s0 = L::Xor(L::Xor(L::template Rotr<7>(w15), L::template Rotr<18>(w15)), L::template Shr<3>(w15));
+				v_t s1 = L::Xor(L::Xor(L::template Rotr<17>(w2), L::template Rotr<19>(w2)), L::template Shr<10>(w2));
+
+				w[t & 15] = L::Add(L::Add(w[t & 15], s0), L::Add(w[(t - 7) & 15], s1));
+			}
+
+			v_t S1 = L::Xor(L::Xor(L::template Rotr<6>(e), L::template Rotr<11>(e)), L::template Rotr<25>(e));
+			v_t ch = L::Xor(L::And(e, f), L::AndNot(e, g));
+			v_t t1 = L::Add(L::Add(L::Add(h, S1), L::Add(ch, L::Set(sha256_k[t]))), w[t & 15]);
+
+			v_t S0 = L::Xor(L::Xor(L::template Rotr<2>(a), L::template Rotr<13>(a)), L::template Rotr<22>(a));
+			v_t maj = L::Or(L::And(a, b), L::And(c, L::Or(a, b)));
+			v_t t2 = L::Add(S0, maj);
+
+			h = g; g = f; f = e; e = L::Add(d, t1);
+			d = c; c = b; b = a; a = L::Add(t1, t2);
+		}
+
+		v_t next[8] = { a, b, c, d, e, f, g, h };
+
+		for (size_t i = 0; i < 8; i++)
+			state[i] = L::Or(L::And(active, L::Add(state[i], next[i])), L::AndNot(active, state[i]));
+	}
+
+	//Block b of a message with SHA-256 padding applied, tail blocks are built in scratch:
+	//
+
+	inline const uint8_t* _Sha256Block(const uint8_t* p, size_t n, size_t b, uint8_t* scratch)
+	{
+		size_t offset = b * 64;
+
+		if (offset + 64 <= n)
+			return p + offset;
+
+		std::memset(scratch, 0, 64);
+
+		if (offset < n)
+			std::memcpy(scratch, p + offset, n - offset);
+
+		if (offset <= n)
+			scratch[n - offset] = 0x80;
+
+		if (b + 1 == (n + 8) / 64 + 1)
+		{
+			uint64_t bits = (uint64_t)n * 8;
+
+			for (size_t i = 0; i < 8; i++)
+				scratch[63 - i] = (uint8_t)(bits >> (8 * i));
+		}
+
+		return scratch;
+	}
+
+	template < typename L = _Sha256Lanes, typename T, typename H > void Sha256Multibuffer(gsl::span<const H> in, gsl::span<T> out)
+	{
+		static_assert(sizeof(T) <= 32, "SHA-256 produces 32 bytes");
+
+		const size_t lanes_c = L::lanes_c;
+		using v_t = typename L::v_t;
+
+		auto blocks = [&](size_t i) { return (in[i].size() + 8) / 64 + 1; };
+
+		std::vector<size_t> order(in.size());
+
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = i;
+
+		std::stable_sort(order.begin(), order.end(), [&](size_t l, size_t r) { return blocks(l) < blocks(r); });
+
+		alignas(64) uint32_t words[16][lanes_c];
+		alignas(64) uint32_t mask[lanes_c];
+		alignas(64) uint8_t scratch[lanes_c][64];
+		alignas(64) uint32_t digest[8][lanes_c];
+
+		for (size_t g = 0; g < order.size(); g += lanes_c)
+		{
+			size_t used = std::min(lanes_c, order.size() - g), block_c = 0;
+
+			for (size_t l = 0; l < used; l++)
+				block_c = std::max(block_c, blocks(order[g + l]));
+
+			v_t state[8];
+
+			for (size_t i = 0; i < 8; i++)
+				state[i] = L::Set(sha256_h[i]);
+
+			for (size_t b = 0; b < block_c; b++)
+			{
+				for (size_t l = 0; l < lanes_c; l++)
+				{
+					bool live = l < used && b < blocks(order[g + l]);
+					mask[l] = (live) ? 0xffffffff : 0;
+
+					if (!live)
+						continue;
+
+					auto& m = in[order[g + l]];
+					auto block = _Sha256Block((const uint8_t*)m.data(), m.size(), b, scratch[l]);
+
+					for (size_t t = 0; t < 16; t++)
+					{
+						uint32_t word;
+						std::memcpy(&word, block + 4 * t, 4);
+						words[t][l] = _ByteSwap32(word);
+					}
+				}
+
+				_Sha256Compress<L>(state, words, L::Load(mask));
+			}
+
+			for (size_t i = 0; i < 8; i++)
+				L::Store(digest[i], state[i]);
+
+			for (size_t l = 0; l < used; l++)
+			{
+				uint32_t be[8];
+
+				for (size_t i = 0; i < 8; i++)
+					be[i] = _ByteSwap32(digest[i][l]);
+
+				std::memcpy(&out[order[g + l]], be, sizeof(T));
+			}
+		}
+	}
+
+	/*
+		Batched HashT, out[i] is the hash of in[i].
+	*/
+
+	template < typename T, typename H > void HashBatchT(gsl::span<const H> in, gsl::span<T> out)
+	{
+		if (out.size() < in.size())
+			throw std::runtime_error("Hash batch output is too small");
+
+		if constexpr (sizeof(T) <= 32)
+		{
+			if (!HasShaExtensions() && in.size() > 1)
+			{
+				Sha256Multibuffer(in, out);
+				return;
+			}
+		}
+
+		for (size_t i = 0; i < in.size(); i++)
+			HashT(out[i], in[i]);
+	}
+
+	/*
+		Non cryptographic hashing in the wyhash family, for keys that only need a good spread.
+
+		Four lanes take 16 bytes each per 64 byte stripe through a 64x64 -> 128 bit multiply folded back to 64 bits.
+		The lanes don't depend on each other so their multiplies overlap, short keys cost a single stripe.
+		An adversary choosing the keys can force collisions, keep the SHA-2 policy for those.
+	*/
+
+	inline constexpr uint64_t fast_secret[8] = 
+	{ 
+		0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull,
+		0x1d8e4e27c47d124full, 0xeb44accab455d165ull, 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull 
+	};
+
+	inline uint64_t _FastMix(uint64_t a, uint64_t b)
+	{
+#ifdef _MSC_VER
+		uint64_t high;
+		uint64_t low = _umul128(a, b, &high);
+
+		return low ^ high;
+#else
+		__uint128_t r = (__uint128_t)a * b;
+
+		return (uint64_t)r ^ (uint64_t)(r >> 64);
+#endif
+	}
+
+	inline uint64_t _FastRead(const uint8_t* p)
+	{
+		uint64_t v;
+		memcpy(&v, p, sizeof(v));
+
+		return v;
+	}
+
+	inline void _FastStripe(uint64_t* lanes, const uint8_t* p)
+	{
+		for (size_t l = 0; l < 4; l++)
+			lanes[l] = _FastMix(_FastRead(p + 16 * l) ^ fast_secret[l + 4], _FastRead(p + 16 * l + 8) ^ lanes[l]);
+	}
+
+	template < size_t words_c > void FastHashWords(uint64_t* out, const uint8_t* p, size_t n)
+	{
+		uint64_t lanes[4] = { fast_secret[0], fast_secret[1], fast_secret[2], fast_secret[3] };
+
+		size_t i = 0;
+
+		for (; i + 64 <= n; i += 64)
+			_FastStripe(lanes, p + i);
+
+		//The zero padding is told apart by the length, mixed into every word:
+		//
+
+		if (i < n)
+		{
+			uint8_t tail[64] = {};
+			memcpy(tail, p + i, n - i);
+
+			_FastStripe(lanes, tail);
+		}
+
+		for (size_t w = 0; w < words_c; w++)
+		{
+			uint64_t h = _FastMix(lanes[0] ^ fast_secret[w & 7], lanes[1] ^ (uint64_t)(n + w));
+			out[w] = _FastMix(h ^ lanes[2], lanes[3] ^ fast_secret[(w + 4) & 7]);
+		}
+	}
+
+	template < typename T, typename H > void FastHashT(T& t, const H& h)
+	{
+		static_assert(sizeof(T) % sizeof(uint64_t) == 0, "Fast hashes fill whole words");
+
+		uint64_t words[sizeof(T) / sizeof(uint64_t)];
+		FastHashWords<sizeof(T) / sizeof(uint64_t)>(words, (const uint8_t*)h.data(), h.size());
+
+		memcpy(&t, words, sizeof(T));
+	}
+
+	template < typename T, typename H > void FastHashBatchT(gsl::span<const H> in, gsl::span<T> out)
+	{
+		if (out.size() < in.size())
+			throw std::runtime_error("Hash batch output is too small");
+
+		for (size_t i = 0; i < in.size(); i++)
+			FastHashT(out[i], in[i]);
+	}
+
+	//Hash policies for KeyT, the policy is recorded in the index descriptor:
+	//
+
+	struct Sha2Hash
+	{
+		static const uint8_t policy = HashPolicy::hash_policy_sha2;
+
+		template < typename T, typename H > static void Hash(T& t, const H& h)
+		{
+			HashT(t, h);
+		}
+
+		template < typename T, typename H > static void Batch(gsl::span<const H> in, gsl::span<T> out)
+		{
+			HashBatchT(in, out);
+		}
+	};
+
+	struct FastHash
+	{
+		static const uint8_t policy = HashPolicy::hash_policy_fast;
+
+		template < typename T, typename H > static void Hash(T& t, const H& h)
+		{
+			FastHashT(t, h);
+		}
+
+		template < typename T, typename H > static void Batch(gsl::span<const H> in, gsl::span<T> out)
+		{
+			FastHashBatchT(in, out);
+		}
+	};
 }
\ No newline at end of file
@@ -3,7 +3,11 @@
 #pragma once
 
 #include <tuple>
+#include <mutex>
+#include <atomic>
+#include <optional>
 #include <utility>
+#include <type_traits>
 
 #include "runtime_description.hpp"
 
@@ -11,10 +15,19 @@ namespace tdb
 {
 	using namespace std;
 
+	//Tables that can pin a snapshot of themselves:
+	//
+
+	template < typename T, typename = void > struct _Snapshots : std::false_type {};
+	template < typename T > struct _Snapshots< T, std::void_t<decltype(std::declval<T&>().Pin(uint64_t()))> > : std::true_type {};
+
 	template < typename R, typename ... tables_t> class _Database : public R
 	{
 		std::tuple<tables_t...> tables;
 
+		std::mutex snapshot_lock;
+		uint64_t epoch = 0;
+
 		template < typename T > void InstallTable(T& t, size_t &n)
 		{
 			t.Open(this, n);
@@ -27,6 +40,120 @@ namespace tdb
 
 			r = t.Validate();
 		}
+
+		void Release(uint64_t e)
+		{
+			std::apply([&](auto& ...x) {(ReleaseTable(x, e), ...); }, tables);
+		}
+
+		template < typename T > void ReleaseTable(T& t, uint64_t e)
+		{
+			if constexpr (_Snapshots<T>::value)
+				t.Release(e);
+		}
+	public:
+		/*
+			A consistent read only view of every table that supports snapshots, as of when it was taken.
+			Writers keep going while it is held, the units it alone reaches are freed after it is destroyed.
+		*/
+
+		class _Snapshot
+		{
+			friend class _Database;
+
+			_Database* db = nullptr;
+			uint64_t epoch = 0;
+			std::tuple<std::optional<tables_t>...> views;
+
+		public:
+			_Snapshot() {}
+
+			_Snapshot(_Snapshot&& r) noexcept : db(r.db), epoch(r.epoch), views(std::move(r.views))
+			{
+				r.db = nullptr;
+			}
+
+			_Snapshot& operator=(_Snapshot&& r) noexcept
+			{
+				if (this != &r)
+				{
+					Release();
+
+					db = r.db;
+					epoch = r.epoch;
+					views = std::move(r.views);
+
+					r.db = nullptr;
+				}
+
+				return *this;
+			}
+
+			_Snapshot(const _Snapshot&) = delete;
+			_Snapshot& operator=(const _Snapshot&) = delete;
+
+			~_Snapshot()
+			{
+				Release();
+			}
+
+			void Release()
+			{
+				if (db)
+					db->Release(epoch);
+
+				db = nullptr;
+			}
+
+			uint64_t Epoch() const
+			{
+				return epoch;
+			}
+
+			template <size_t I > const auto& Table() const
+			{
+				static_assert(_Snapshots< std::tuple_element_t<I, std::tuple<tables_t...>> >::value, "Table doesn't support snapshots");
+
+				return *get<I>(views);
+			}
+		};
+
+		/*
+			Pins a new epoch on every table that supports it. Must not race writers, readers of the snapshot may.
+		*/
+
+		_Snapshot Snapshot()
+		{
+			std::lock_guard<std::mutex> lock(snapshot_lock);
+
+			_Snapshot result;
+
+			result.db = this;
+			result.epoch = ++epoch;
+
+			PinTables(result, std::index_sequence_for<tables_t...>());
+
+			return result;
+		}
+
+	private:
+		template < size_t ... I > void PinTables(_Snapshot& s, std::index_sequence<I...>)
+		{
+			(PinTable<I>(s), ...);
+		}
+
+		template < size_t I > void PinTable(_Snapshot& s)
+		{
+			auto& t = get<I>(tables);
+
+			if constexpr (_Snapshots< std::decay_t<decltype(t)> >::value)
+			{
+				t.Pin(s.epoch);
+				get<I>(s.views).emplace(t);
+				get<I>(s.views)->ViewSnapshot(s.epoch);
+			}
+		}
+
 	public:
 		std::string About()
 		{
@@ -91,6 +218,13 @@ namespace tdb
 		}
 	};
 
+	/*
+		Holds slots for tables or indexes a later version of the schema puts in its place. Indexes that can attach take the slot
+		over as an empty index ( see _BTree::Open ), a dropped index hands its slot back.
+
+		It also stands in a table's index list, taking whatever key the rows give it.
+	*/
+
 	template < typename R, size_t reserve_c > class ReserveTables
 	{
 
@@ -105,10 +239,21 @@ namespace tdb
 				auto s = io->AllocateSpan(reserve_c);
 
 				for (size_t i = 0; i < reserve_c; i++, s++)
+				{
 					std::fill(s->begin(), s->end(), 0x77);
+					io->GetDescriptor(_n + i).type = TableType::reserved_slot;
+				}
 			}
 
 			_n += reserve_c;
 		}
+
+		bool Validate() { return true; }
+
+		template < typename K, typename V > void Insert(const K& k, const V& v) { }
+		template < typename K, typename V > void InsertLock(const K& k, const V& v) { }
 	};
+
+	template < typename T > struct _Reserves : std::false_type {};
+	template < typename R, size_t reserve_c > struct _Reserves< ReserveTables<R, reserve_c> > : std::true_type {};
 }
\ No newline at end of file
@@ -165,6 +165,92 @@ namespace tdb
 			return true;
 		}
 
+		/*
+			Batched InsertSizedObject, the keys of every name are hashed together with HashBatch.
+			Names already present are skipped, returns how many objects were stored.
+		*/
+
+		template <typename K, typename S, typename V, typename SZ = uint16_t> size_t InsertSizedObjectBatch(gsl::span<const S> names, gsl::span<const V> values)
+		{
+			return _InsertSizedObjectBatch<false, K, S, V, SZ>(names, values, gsl::span<K>());
+		}
+
+		template <typename K, typename S, typename V, typename SZ = uint16_t> size_t InsertSizedObjectBatchLock(gsl::span<const S> names, gsl::span<const V> values)
+		{
+			return _InsertSizedObjectBatch<true, K, S, V, SZ>(names, values, gsl::span<K>());
+		}
+
+		/*
+			Content addressed objects, every value is keyed by its own hash, keys receives them.
+		*/
+
+		template <typename K, typename V, typename SZ = uint16_t> size_t InsertContentBatchLock(gsl::span<const V> values, gsl::span<K> keys)
+		{
+			return _InsertSizedObjectBatch<true, K, V, V, SZ>(values, values, keys);
+		}
+
+		template <bool lock_v, typename K, typename S, typename V, typename SZ> size_t _InsertSizedObjectBatch(gsl::span<const S> names, gsl::span<const V> values, gsl::span<K> keys)
+		{
+			if (values.size() < names.size())
+				throw std::runtime_error("Every name needs a value");
+
+			std::vector<K> hashed;
+
+			if (keys.size() < names.size())
+			{
+				hashed.resize(names.size());
+				keys = gsl::span<K>(hashed);
+			}
+
+			HashBatch(names, keys.first(names.size()));
+
+			//Objects are written before the keys are inserted, so no index pointer is held across an allocation:
+			//
+
+			std::vector<uint64_t*> present(names.size());
+
+			if constexpr (lock_v)
+				_INDEX::FindBatchLock(gsl::span<const K>(keys.data(), names.size()), gsl::span<uint64_t*>(present));
+			else
+				_INDEX::FindBatch(gsl::span<const K>(keys.data(), names.size()), gsl::span<uint64_t*>(present));
+
+			std::vector<std::pair<K, uint64_t>> kv;
+			kv.reserve(names.size());
+
+			for (size_t i = 0; i < names.size(); i++)
+			{
+				if (present[i])
+					continue;
+
+				auto& v = values[i];
+				auto [iptr, offset] = db.Incidental(v.size() + sizeof(SZ));
+
+				if (!iptr)
+					continue;
+
+				auto sz = (SZ*)iptr;
+				*sz = (SZ)v.size();
+				std::copy(v.begin(), v.end(), iptr + sizeof(SZ));
+
+				kv.emplace_back(keys[i], offset);
+			}
+
+			std::vector<std::pair<uint64_t*, bool>> results(kv.size());
+
+			if constexpr (lock_v)
+				_INDEX::InsertBatchLock(gsl::span<std::pair<K, uint64_t>>(kv), gsl::span<std::pair<uint64_t*, bool>>(results));
+			else
+				_INDEX::InsertBatch(gsl::span<std::pair<K, uint64_t>>(kv), gsl::span<std::pair<uint64_t*, bool>>(results));
+
+			size_t stored = 0;
+
+			for (auto& r : results)
+				if (r.first && !r.second)
+					stored++;
+
+			return stored;
+		}
+
 		template <typename K> uint8_t* FindObject(const K& k, void* ref = nullptr)
 		{
 			auto ptr = _INDEX::Find(k, ref);
@@ -185,6 +271,15 @@ namespace tdb
 			return db.GetObject(*ptr);
 		}
 
+		template <typename K> void FindObjectBatchLock(gsl::span<const K> ks, gsl::span<uint8_t*> objects, void* ref = nullptr)
+		{
+			std::vector<uint64_t*> ptrs(ks.size());
+			_INDEX::FindBatchLock(ks, gsl::span<uint64_t*>(ptrs), ref);
+
+			for (size_t i = 0; i < ks.size(); i++)
+				objects[i] = (ptrs[i]) ? db.GetObject(*ptrs[i]) : nullptr;
+		}
+
 		template <typename K, typename SZ = uint16_t> gsl::span<uint8_t> FindSizedObject(const K& k, void* ref = nullptr)
 		{
 			auto ptr = _INDEX::Find(k, ref);
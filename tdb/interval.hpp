@@ -0,0 +1,553 @@
+/* Copyright (C) 2020 D8DATAWORKS - All Rights Reserved */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+
+#include "keys.hpp"
+#include "types.hpp"
+
+namespace tdb
+{
+	using namespace std;
+
+	/*
+		Interval index over segments, overlapping segments are all kept and all found.
+
+		_Segment compares any overlap as equal, so a tree ordered by it only answers correctly when segments are disjoint.
+		This is an AVL tree ordered by ( start, end ), every node also holds the largest end below it.
+		A query skips any subtree ending before the range and stops at the first node starting after it, results stream in start order.
+
+		Segments are half open, [ start, start + length ). Empty segments cover their start.
+		The header takes the index slot. There is no erase.
+		InsertLock writers serialize on the header, rotations move nodes in place so queries must not race writers.
+	*/
+
+	template < typename R, typename int_t, typename pointer_t = uint64_t > class _IntervalIndex
+	{
+		using key_t = _Segment<int_t>;
+
+		static constexpr size_t _Shift(size_t v)
+		{
+			size_t s = 0;
+
+			while ((1ull << s) < v)
+				s++;
+
+			return s;
+		}
+
+		static const size_t unit_shift_c = _Shift(R::UnitSize);
+
+		static_assert((1ull << unit_shift_c) == R::UnitSize, "Units must be a power of two");
+
+		/*
+			Nodes live in slabs of contiguous units, 1, 2, 4 ... up to 64 units each, listed in a directory behind the header.
+			A reference is ( slab + 1, offset ). Maps whose addresses never move keep the slab addresses in memory,
+			so following a link doesn't walk the map list.
+		*/
+
+		static constexpr size_t max_slab_shift_c = 6;
+		static const size_t slab_shift_c = unit_shift_c + max_slab_shift_c;
+		static const uint64_t slab_mask_c = (1ull << slab_shift_c) - 1;
+		static const uint64_t span_bits_c = 8;
+
+		struct _Node
+		{
+			int_t start;
+			int_t end;
+			int_t high;
+			pointer_t value;
+			uint64_t left;
+			uint64_t right;
+			int32_t height;
+		};
+
+		static const size_t node_size_c = (sizeof(_Node) + 7) & ~(size_t)7;
+
+		struct _Header
+		{
+			uint64_t root = 0;
+			uint64_t count = 0;
+			std::atomic<uint32_t> writer = 0;
+			uint32_t slabs = 0;
+			uint64_t used = 0;
+		};
+
+		static constexpr size_t directory_c = (R::UnitSize - sizeof(_Header)) / sizeof(uint64_t);
+
+		R* io = nullptr;
+		uint64_t header_n = 0;
+		std::shared_ptr<std::vector<uint8_t*>> bases;
+
+		_Header& Header() const
+		{
+			return io->template Lookup<_Header>(header_n);
+		}
+
+		//Slab spans, ( first unit << span_bits_c ) | units:
+		//
+
+		uint64_t* Directory() const
+		{
+			return (uint64_t*)(&Header() + 1);
+		}
+
+		uint8_t* _Base(uint64_t slab) const
+		{
+			if constexpr (R::StableAddresses)
+			{
+				if (auto base = (*bases)[slab])
+					return base;
+			}
+
+			return io->template Lookup<typename R::Unit>(Directory()[slab] >> span_bits_c).data();
+		}
+
+		_Node& Node(uint64_t ref) const
+		{
+			return *((_Node*)(_Base((ref >> slab_shift_c) - 1) + (ref & slab_mask_c)));
+		}
+
+		static int_t End(const key_t& k)
+		{
+			return (int_t)(k.start + ((k.length) ? k.length : 1));
+		}
+
+		//Callbacks returning bool stop the query on false, others see every result:
+		//
+
+		template < typename F, typename ... t_args > static bool _Call(F& f, t_args&& ... args)
+		{
+			if constexpr (std::is_same_v<std::invoke_result_t<F&, t_args...>, bool>)
+				return f(std::forward<t_args>(args)...);
+			else
+			{
+				f(std::forward<t_args>(args)...);
+				return true;
+			}
+		}
+
+		/*
+			Balancing:
+		*/
+
+		int32_t Height(uint64_t ref) const
+		{
+			return (ref) ? Node(ref).height : 0;
+		}
+
+		void _Update(uint64_t ref)
+		{
+			auto& node = Node(ref);
+
+			node.height = 1 + (std::max)(Height(node.left), Height(node.right));
+			node.high = node.end;
+
+			if (node.left)
+				node.high = (std::max)(node.high, Node(node.left).high);
+
+			if (node.right)
+				node.high = (std::max)(node.high, Node(node.right).high);
+		}
+
+		uint64_t _RotateRight(uint64_t ref)
+		{
+			auto& node = Node(ref);
+			uint64_t left = node.left;
+
+			node.left = Node(left).right;
+			Node(left).right = ref;
+
+			_Update(ref);
+			_Update(left);
+
+			return left;
+		}
+
+		uint64_t _RotateLeft(uint64_t ref)
+		{
+			auto& node = Node(ref);
+			uint64_t right = node.right;
+
+			node.right = Node(right).left;
+			Node(right).left = ref;
+
+			_Update(ref);
+			_Update(right);
+
+			return right;
+		}
+
+		uint64_t _Balance(uint64_t ref)
+		{
+			_Update(ref);
+
+			auto& node = Node(ref);
+			int32_t balance = Height(node.left) - Height(node.right);
+
+			if (balance > 1)
+			{
+				if (Height(Node(node.left).left) < Height(Node(node.left).right))
+					node.left = _RotateLeft(node.left);
+
+				return _RotateRight(ref);
+			}
+
+			if (balance < -1)
+			{
+				if (Height(Node(node.right).right) < Height(Node(node.right).left))
+					node.right = _RotateRight(node.right);
+
+				return _RotateLeft(ref);
+			}
+
+			return ref;
+		}
+
+		//Equal segments go right, so segments inserted later come out later:
+		//
+
+		uint64_t _Insert(uint64_t ref, uint64_t fresh)
+		{
+			if (!ref)
+				return fresh;
+
+			auto& node = Node(ref);
+			auto& n = Node(fresh);
+
+			if (n.start < node.start || (n.start == node.start && n.end < node.end))
+				node.left = _Insert(node.left, fresh);
+			else
+				node.right = _Insert(node.right, fresh);
+
+			return _Balance(ref);
+		}
+
+		template < bool lock_v > pair<pointer_t*, bool> _InsertOne(const key_t& k, const pointer_t& p)
+		{
+			auto& header = Header();
+			uint64_t units = (header.slabs) ? Directory()[header.slabs - 1] & ((1ull << span_bits_c) - 1) : 0;
+
+			if (header.used + node_size_c > units * R::UnitSize)
+			{
+				if (header.slabs == directory_c)
+					throw std::runtime_error("Interval index is full");
+
+				units = 1ull << (std::min)((size_t)header.slabs, max_slab_shift_c);
+
+				typename R::Unit* unit;
+
+				if constexpr (lock_v)
+					unit = io->AllocateSpanLock(units);
+				else
+					unit = io->AllocateSpan(units);
+
+				uint64_t n = io->IndexUnit(*unit);
+
+				auto& fresh = Header();
+				Directory()[fresh.slabs] = (n << span_bits_c) | units;
+
+				if constexpr (R::StableAddresses)
+					(*bases)[fresh.slabs] = unit->data();
+
+				fresh.slabs++;
+				fresh.used = 0;
+			}
+
+			auto& h = Header();
+			uint64_t ref = ((uint64_t)h.slabs << slab_shift_c) | h.used;
+			h.used += node_size_c;
+
+			auto& node = Node(ref);
+			node.start = k.start;
+			node.end = End(k);
+			node.high = node.end;
+			node.value = p;
+			node.left = 0;
+			node.right = 0;
+			node.height = 1;
+
+			h.root = _Insert(h.root, ref);
+			h.count++;
+
+			return { &node.value, false };
+		}
+
+		void _Lock()
+		{
+			auto& writer = Header().writer;
+			uint32_t expected = 0;
+
+			while (!writer.compare_exchange_weak(expected, 1, std::memory_order_acquire))
+			{
+				expected = 0;
+				std::this_thread::yield();
+			}
+		}
+
+		void _Unlock()
+		{
+			Header().writer.store(0, std::memory_order_release);
+		}
+
+		/*
+			Queries:
+		*/
+
+		template < typename F > bool _Overlap(uint64_t ref, int_t low, int_t high, F& f) const
+		{
+			if (!ref)
+				return true;
+
+			auto& node = Node(ref);
+
+			if (node.high <= low)
+				return true;
+
+			if (!_Overlap(node.left, low, high, f))
+				return false;
+
+			if (node.start >= high)
+				return true;
+
+			if (node.end > low)
+			{
+				key_t k(node.start, (int_t)(node.end - node.start));
+
+				if (!_Call(f, k, node.value))
+					return false;
+			}
+
+			return _Overlap(node.right, low, high, f);
+		}
+
+		template < typename F > bool _Walk(uint64_t ref, F& f, int& count) const
+		{
+			if (!ref)
+				return true;
+
+			auto& node = Node(ref);
+
+			if (!_Walk(node.left, f, count))
+				return false;
+
+			count++;
+			key_t k(node.start, (int_t)(node.end - node.start));
+
+			if (!_Call(f, k, node.value))
+				return false;
+
+			return _Walk(node.right, f, count);
+		}
+
+		bool _Validate(uint64_t ref, const _Node* low, const _Node* high, uint64_t& count) const
+		{
+			if (!ref)
+				return true;
+
+			auto& node = Node(ref);
+			count++;
+
+			auto less = [](const _Node& l, const _Node& r) { return l.start < r.start || (l.start == r.start && l.end < r.end); };
+
+			if ((low && less(node, *low)) || (high && less(*high, node)))
+				return false;
+
+			if (!_Validate(node.left, low, &node, count) || !_Validate(node.right, &node, high, count))
+				return false;
+
+			int_t expected = node.end;
+
+			if (node.left)
+				expected = (std::max)(expected, Node(node.left).high);
+
+			if (node.right)
+				expected = (std::max)(expected, Node(node.right).high);
+
+			int32_t balance = Height(node.left) - Height(node.right);
+
+			return node.high == expected && node.height == 1 + (std::max)(Height(node.left), Height(node.right)) && balance >= -1 && balance <= 1;
+		}
+
+	public:
+		_IntervalIndex() {}
+
+		void Open(R* _io, size_t& _n)
+		{
+			header_n = _n++;
+			io = _io;
+
+			if (io->size() <= header_n)
+			{
+				io->template Allocate<_Header>();
+
+				/*
+					Runtime Introspection:
+				*/
+
+				auto& desc = io->GetDescriptor(header_n);
+
+				desc.type = TableType::interval_tree;
+
+				desc.standard_index.self_balanced = (uint32_t)true;
+				desc.standard_index.requires_distributed_key = (uint32_t)false;
+
+				desc.standard_index.key_sz = sizeof(key_t);
+				desc.standard_index.link_sz = sizeof(uint64_t);
+				desc.standard_index.pointer_sz = sizeof(pointer_t);
+				desc.standard_index.key_mode = key_t::mode;
+				desc.standard_index.key_type = key_t::type;
+				desc.standard_index.hash_policy = HashPolicy::undefined_hash_policy;
+
+				desc.standard_index.max_capacity = 1;
+				desc.standard_index.min_capacity = 1;
+
+				desc.standard_index.max_page = (uint32_t)node_size_c;
+				desc.standard_index.min_page = (uint16_t)node_size_c;
+
+				desc.standard_index.link_count = 2;
+			}
+			else if (io->GetDescriptor(header_n).type != TableType::interval_tree)
+				throw std::runtime_error("Index is not an interval tree");
+
+			if constexpr (R::StableAddresses)
+			{
+				bases = std::make_shared<std::vector<uint8_t*>>(directory_c, nullptr);
+
+				for (size_t i = 0; i < Header().slabs; i++)
+					(*bases)[i] = _Base(i);
+			}
+		}
+
+		uint64_t size() const
+		{
+			return Header().count;
+		}
+
+		//Calls f( segment, pointer ) for every segment overlapping [ low, high ), in start order:
+		//
+
+		template < typename F > void Overlap(F&& f, int_t low, int_t high) const
+		{
+			if (low < high)
+				_Overlap(Header().root, low, high, f);
+		}
+
+		template < typename F > void Overlap(F&& f, const key_t& k) const
+		{
+			Overlap(f, k.start, End(k));
+		}
+
+		//Every segment covering point:
+		//
+
+		template < typename F > void Stab(F&& f, int_t point) const
+		{
+			Overlap(f, point, (int_t)(point + 1));
+		}
+
+		/*
+			Index surface, segments match by overlap like _Segment::Compare but every overlapping segment is reported.
+		*/
+
+		pointer_t* Find(const key_t& k, void* ref_page = nullptr) const
+		{
+			pointer_t* result = nullptr;
+
+			Overlap([&](auto& s, auto& v)
+			{
+				result = &v;
+				return false;
+			}, k);
+
+			return result;
+		}
+
+		pointer_t* FindLock(const key_t& k, void* ref_page = nullptr) const
+		{
+			return Find(k, ref_page);
+		}
+
+		template < typename F > void MultiFind(F&& f, const key_t& k, void* ref_page = nullptr) const
+		{
+			Overlap([&](auto& s, auto& v)
+			{
+				return _Call(f, &v);
+			}, k);
+		}
+
+		//Segments overlapping anything from the start of low_k to the end of high_k:
+		//
+
+		template < typename F > void RangeFind(F&& f, const key_t& low_k, const key_t& high_k, void* ref_page = nullptr) const
+		{
+			Overlap(f, low_k.start, End(high_k));
+		}
+
+		pair<pointer_t*, bool> Insert(const key_t& k, const pointer_t& p)
+		{
+			return _InsertOne<false>(k, p);
+		}
+
+		void Insert(const gsl::span<key_t>& ks, const pointer_t& p)
+		{
+			for (auto& k : ks)
+				_InsertOne<false>(k, p);
+		}
+
+		pair<pointer_t*, bool> InsertLock(const key_t& k, const pointer_t& p)
+		{
+			_Lock();
+			auto result = _InsertOne<true>(k, p);
+			_Unlock();
+
+			return result;
+		}
+
+		void InsertLock(const gsl::span<key_t>& ks, const pointer_t& p)
+		{
+			_Lock();
+
+			for (auto& k : ks)
+				_InsertOne<true>(k, p);
+
+			_Unlock();
+		}
+
+		template < typename F > int Iterate(F&& f) const
+		{
+			int count = 0;
+			auto g = [&](auto& k, auto& v) { return _Call(f, v); };
+
+			_Walk(Header().root, g, count);
+
+			return count;
+		}
+
+		template < typename F > int IterateKV(F&& f) const
+		{
+			int count = 0;
+
+			_Walk(Header().root, f, count);
+
+			return count;
+		}
+
+		bool Validate() const
+		{
+			uint64_t count = 0;
+
+			return _Validate(Header().root, nullptr, nullptr, count) && count == Header().count;
+		}
+	};
+
+	template < typename R, typename int_t, typename pointer_t = uint64_t > using IntervalIndex = _IntervalIndex<R, int_t, pointer_t>;
+	template < typename R > using IntervalIndex32 = _IntervalIndex<R, uint32_t, uint32_t>;
+}
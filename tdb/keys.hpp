@@ -3,6 +3,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <time.h>
 #include <random>
 
@@ -13,16 +14,23 @@ namespace tdb
 {
 	using namespace std;
 
-	template <typename T1, typename T2 = T1> struct KeyT
+	/*
+		Keys are hashes of what they are constructed from, hash_t picks the hash ( Sha2Hash or FastHash ).
+	*/
+
+	template <typename T1, typename T2 = T1, typename hash_t = Sha2Hash> struct KeyT
 	{
 		static const uint8_t mode = KeyMode::key_mode_direct;
 		static const uint8_t type = KeyType::key_type_distributed;
+		static const uint8_t hash_policy = hash_t::policy;
+
+		using hash_type = hash_t;
 
 		KeyT() {}
 
 		template < typename T > KeyT(const T & t)
 		{
-			HashT(*this, t);
+			hash_t::Hash(*this, t);
 		}
 
 		void Zero()
@@ -69,7 +77,7 @@ namespace tdb
 				(*p) += e();
 			}
 
-			HashT(*this, *this);
+			hash_t::Hash(*this, *this);
 		}
 
 		int Compare(const KeyT & p,void* ref_page=nullptr, void* ref_page2 = nullptr)
@@ -159,6 +167,40 @@ namespace tdb
 	using KeyP2 = KeyPointerT2<Key24, uint32_t>;
 	using Key64 = KeyT<Key32>;
 
+	using FastKey16 = KeyT<uint64_t, uint64_t, FastHash>;
+	using FastKey32 = KeyT<Key16, Key16, FastHash>;
+	using FastKey64 = KeyT<Key32, Key32, FastHash>;
+
+	//Hash policy of a key type, keys that aren't hashes have none:
+	//
+
+	template < typename K, typename = void > struct _KeyHashPolicy
+	{
+		static const uint8_t value = HashPolicy::undefined_hash_policy;
+	};
+
+	template < typename K > struct _KeyHashPolicy<K, std::void_t<decltype(K::hash_policy)>>
+	{
+		static const uint8_t value = K::hash_policy;
+	};
+
+	//Descriptors written before the policy was recorded hold zero, their keys were hashed with SHA-2:
+	//
+
+	inline bool HashPolicyMatches(uint8_t stored, uint8_t policy)
+	{
+		return stored == policy || (stored == HashPolicy::undefined_hash_policy && policy == HashPolicy::hash_policy_sha2);
+	}
+
+	/*
+		Hashes every input into a key with the key's own hash policy, the batch form of K(in[i]).
+	*/
+
+	template < typename K, typename H > void HashBatch(gsl::span<const H> in, gsl::span<K> out)
+	{
+		K::hash_type::Batch(in, out);
+	}
+
 #pragma pack(push,1)
 	template <typename int_t> struct _IntWrapper
 	{
@@ -225,7 +267,12 @@ namespace tdb
 			auto l = (const char*)ref_page->GetObject(sz_offset);
 			auto r = (const char*)((!rs.sz_offset) ? (uint8_t*)direct_page : ref_page->GetObject(rs.sz_offset));
 
-			return strcmp(l, r);
+			//Nodes switch on -1 / 0 / 1, strcmp only promises the sign:
+			//
+
+			int c = strcmp(l, r);
+
+			return (c > 0) - (c < 0);
 		}
 	};
 
@@ -260,6 +307,155 @@ namespace tdb
 		}
 	};
 
+	/*
+		Local surrogates keep a copy of the head of their object next to the offset.
+
+		Comparisons are settled on the heads and only dereference the offsets when the heads tie,
+		so a binary search step no longer costs two object lookups. Keys are bound ( the head filled ) by BindKey before they are stored.
+		An empty head is treated as unbound and read from the object.
+	*/
+
+	template <typename R, typename int_t, size_t prefix_c = 8> struct _LocalSurrogateString
+	{
+		static const uint8_t mode = KeyMode::key_mode_local_surrogate;
+		static const uint8_t type = KeyType::key_type_sequential;
+
+		_LocalSurrogateString() {}
+		_LocalSurrogateString(int_t t) : sz_offset(t) {}
+
+		int_t sz_offset = 0;
+		char prefix[prefix_c] = {};
+
+		static void Head(char* dest, const char* s)
+		{
+			size_t i = 0;
+
+			for (; i < prefix_c && s[i]; i++)
+				dest[i] = s[i];
+
+			for (; i < prefix_c; i++)
+				dest[i] = 0;
+		}
+
+		const char* String(void* _ref_page, void* direct_page) const
+		{
+			return (const char*)((!sz_offset) ? (uint8_t*)direct_page : ((R*)_ref_page)->GetObject(sz_offset));
+		}
+
+		void Bind(void* _ref_page, void* direct_page)
+		{
+			Head(prefix, String(_ref_page, direct_page));
+		}
+
+		int Compare(const _LocalSurrogateString& rs, void* _ref_page, void* direct_page)
+		{
+			char l[prefix_c], r[prefix_c];
+
+			const char* lp = prefix;
+			const char* rp = rs.prefix;
+
+			if (!lp[0])
+			{
+				Head(l, String(_ref_page, nullptr));
+				lp = l;
+			}
+
+			if (!rp[0])
+			{
+				Head(r, rs.String(_ref_page, direct_page));
+				rp = r;
+			}
+
+			int c = memcmp(lp, rp, prefix_c);
+
+			if (c)
+				return (c > 0) ? 1 : -1;
+
+			//Both strings end inside the head:
+			//
+
+			if (memchr(lp, 0, prefix_c))
+				return 0;
+
+			c = strcmp(String(_ref_page, nullptr) + prefix_c, rs.String(_ref_page, direct_page) + prefix_c);
+
+			return (c > 0) - (c < 0);
+		}
+	};
+
+	//The head is the leading word of the key, which KeyT::Compare orders first:
+	//
+
+	template <typename R, typename int_t, typename key_t> struct _LocalSurrogateKey
+	{
+		static const uint8_t mode = KeyMode::key_mode_local_surrogate;
+		static const uint8_t type = KeyType::key_type_distributed;
+
+		static_assert(sizeof(key_t) >= sizeof(uint64_t));
+
+		_LocalSurrogateKey() {}
+		_LocalSurrogateKey(int_t t) : sz_offset(t) {}
+
+		int_t sz_offset = 0;
+		uint64_t head = 0;
+
+		key_t* Object(void* _ref_page, void* direct_page) const
+		{
+			return (key_t*)((!sz_offset) ? (uint8_t*)direct_page : ((R*)_ref_page)->GetObject(sz_offset));
+		}
+
+		static uint64_t Head(const key_t* k)
+		{
+			uint64_t h;
+			memcpy(&h, k, sizeof(h));
+
+			return h;
+		}
+
+		void Bind(void* _ref_page, void* direct_page)
+		{
+			head = Head(Object(_ref_page, direct_page));
+		}
+
+		int Compare(const _LocalSurrogateKey& rs, void* _ref_page, void* direct_page)
+		{
+			uint64_t l = (head) ? head : Head(Object(_ref_page, nullptr));
+			uint64_t r = (rs.head) ? rs.head : Head(rs.Object(_ref_page, direct_page));
+
+			if (l != r)
+				return (l > r) ? 1 : -1;
+
+			return Object(_ref_page, nullptr)->Compare(*rs.Object(_ref_page, direct_page));
+		}
+
+		bool Equal(const _LocalSurrogateKey& rs, void* _ref_page, void* direct_page)
+		{
+			uint64_t l = (head) ? head : Head(Object(_ref_page, nullptr));
+			uint64_t r = (rs.head) ? rs.head : Head(rs.Object(_ref_page, direct_page));
+
+			if (l != r)
+				return false;
+
+			return Object(_ref_page, nullptr)->Equal(*rs.Object(_ref_page, direct_page));
+		}
+	};
+
+	//Returns k ready to be stored, local surrogates come back as a bound copy:
+	//
+
+	template < typename K > decltype(auto) BindKey(const K& k, void* ref_page, void* direct_page)
+	{
+		if constexpr (K::mode == KeyMode::key_mode_local_surrogate)
+		{
+			K bound = k;
+			bound.Bind(ref_page, direct_page);
+
+			return bound;
+		}
+		else
+			return (const K&)k;
+	}
+
 	template < size_t L > std::string_view string_viewz(const char(&t)[L])
 	{
 		return std::string_view(t, L);
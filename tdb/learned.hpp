@@ -0,0 +1,483 @@
+/* Copyright (C) 2020 D8DATAWORKS - All Rights Reserved */
+
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "keys.hpp"
+#include "types.hpp"
+#include "radix.hpp"
+
+namespace tdb
+{
+	using namespace std;
+
+	/*
+		Frozen learned index over sorted integer keys, piecewise linear models with a bounded error ( PGM style ).
+
+		The keys and pointers are sorted arrays, each model maps a run of keys to their positions within epsilon_c.
+		Models are indexed the same way one level up until a single model is left, a find walks one model per level
+		and searches 2 * epsilon_c slots at each, instead of binary searching 64 KB nodes.
+
+		The key, pointer and model arrays are contiguous spans of recycler units, the header takes the index slot.
+		There is no insert, Build or BulkLoad replaces the whole index and readers must not race them.
+	*/
+
+	template < typename R, typename key_t, typename pointer_t = uint64_t, size_t epsilon_c = 64 > class _LearnedIndex
+	{
+		using traits_t = _RadixKey<key_t>;
+		using int_t = typename key_t::Key;
+
+		static_assert(!traits_t::interval, "Learned indexes hold point keys");
+		static_assert(epsilon_c > 0, "Models need some error to cover more than two keys");
+
+		static const uint64_t span_bits_c = 24;
+		static const size_t max_levels_c = 16;
+
+		//first is where the model starts, it predicts position + slope * ( key - first ) in the level below:
+		//
+
+		struct _Model
+		{
+			uint64_t first;
+			double slope;
+			uint64_t position;
+
+			uint64_t Predict(uint64_t k, uint64_t limit) const
+			{
+				if (k <= first)
+					return position;
+
+				double p = (double)position + slope * (double)(k - first);
+
+				return (p >= (double)limit) ? limit : (uint64_t)p;
+			}
+		};
+
+		static_assert(sizeof(_Model) == 24);
+
+		//Spans pack ( first unit << span_bits_c ) | units, levels[ i ] is where level i starts in the model array, level 0 models keys:
+		//
+
+		struct _Header
+		{
+			uint64_t count = 0;
+			uint64_t keys = 0;
+			uint64_t values = 0;
+			uint64_t models = 0;
+			uint64_t levels = 0;
+			uint64_t level[max_levels_c + 1] = {};
+		};
+
+		struct _Arrays
+		{
+			uint64_t* keys = nullptr;
+			pointer_t* values = nullptr;
+			_Model* models = nullptr;
+		};
+
+		R* io = nullptr;
+		uint64_t header_n = 0;
+		std::shared_ptr<_Arrays> arrays;
+
+		_Header& Header() const
+		{
+			return io->template Lookup<_Header>(header_n);
+		}
+
+		template < typename T > T* _Span(uint64_t span) const
+		{
+			return (span) ? &io->template Lookup<T>(span >> span_bits_c) : nullptr;
+		}
+
+		_Arrays _Resolve() const
+		{
+			auto& header = Header();
+
+			return { _Span<uint64_t>(header.keys), _Span<pointer_t>(header.values), _Span<_Model>(header.models) };
+		}
+
+		//Maps whose addresses never move keep the spans resolved:
+		//
+
+		_Arrays Arrays() const
+		{
+			if constexpr (R::StableAddresses)
+				return *arrays;
+			else
+				return _Resolve();
+		}
+
+		uint64_t _Allocate(uint64_t bytes)
+		{
+			uint64_t units = (std::max)(io->MapLength(bytes), (uint64_t)1);
+
+			if (units >= (1ull << span_bits_c))
+				throw std::runtime_error("Learned index span is too large");
+
+			return (io->IndexUnit(*io->AllocateSpan(units)) << span_bits_c) | units;
+		}
+
+		void _Free(uint64_t span)
+		{
+			for (uint64_t i = 0; span && i < (span & ((1ull << span_bits_c) - 1)); i++)
+				io->FreeUnit(io->template Lookup<typename R::Unit>((span >> span_bits_c) + i));
+		}
+
+		static key_t _Key(uint64_t bits)
+		{
+			if constexpr (std::is_signed_v<int_t>)
+				bits ^= 1ull << (sizeof(int_t) * 8 - 1);
+
+			return key_t((int_t)bits);
+		}
+
+		/*
+			Shrinking cone, a model grows while one slope keeps every point it covers within epsilon_c of its position.
+			point( i ) returns ( key, position ) with keys strictly increasing.
+		*/
+
+		template < typename F > static void _Fit(F&& point, size_t n, std::vector<_Model>& out)
+		{
+			const double epsilon = (double)epsilon_c;
+
+			for (size_t i = 0, j; i < n; i = j)
+			{
+				auto [x0, y0] = point(i);
+				double low = 0, high = std::numeric_limits<double>::infinity();
+
+				for (j = i + 1; j < n; j++)
+				{
+					auto [x, y] = point(j);
+
+					double dx = (double)(x - x0), dy = (double)(y - y0);
+					double l = (dy - epsilon) / dx, h = (dy + epsilon) / dx;
+
+					if (l > high || h < low)
+						break;
+
+					low = (std::max)(low, l);
+					high = (std::min)(high, h);
+				}
+
+				double slope = (j == i + 1) ? 0 : (high == std::numeric_limits<double>::infinity()) ? low : (low + high) / 2;
+
+				out.push_back({ x0, slope, y0 });
+			}
+		}
+
+		/*
+			First position in a[ 0, n ) where before is false, searched around a prediction.
+			Rounding can push a key just outside the window, the search then continues on that side.
+		*/
+
+		template < typename T, typename F > static size_t _Bound(const T* a, size_t n, uint64_t predicted, F&& before)
+		{
+			size_t low = (predicted > epsilon_c + 1) ? (size_t)predicted - epsilon_c - 1 : 0;
+			size_t high = (std::min)((size_t)n, (size_t)predicted + epsilon_c + 2);
+
+			low = (std::min)(low, high);
+
+			if (low > 0 && !before(a[low - 1]))
+				high = low, low = 0;
+			else if (high < n && (low == high || before(a[high - 1])))
+				low = high, high = n;
+
+			return std::partition_point(a + low, a + high, before) - a;
+		}
+
+		//First key position not below bits:
+		//
+
+		size_t _Position(const _Header& header, const _Arrays& a, uint64_t bits) const
+		{
+			const _Model* model = a.models + header.level[header.levels - 1];
+
+			for (size_t l = header.levels - 1; l > 0; l--)
+			{
+				const _Model* below = a.models + header.level[l - 1];
+				size_t n = (size_t)(header.level[l] - header.level[l - 1]);
+
+				size_t p = _Bound(below, n, model->Predict(bits, n), [&](const _Model& m) { return m.first <= bits; });
+
+				model = below + ((p) ? p - 1 : 0);
+			}
+
+			return _Bound(a.keys, (size_t)header.count, model->Predict(bits, header.count), [&](uint64_t k) { return k < bits; });
+		}
+
+		void _Load(std::vector<std::pair<uint64_t, pointer_t>>& kv)
+		{
+			std::vector<_Model> models;
+			std::vector<uint64_t> level = { 0 };
+
+			//Duplicate keys are modeled once at their first position:
+			//
+
+			std::vector<uint64_t> distinct;
+
+			for (uint64_t i = 0; i < kv.size(); i++)
+				if (!i || kv[i].first != kv[i - 1].first)
+					distinct.push_back(i);
+
+			_Fit([&](size_t i) { return std::make_pair(kv[distinct[i]].first, distinct[i]); }, distinct.size(), models);
+			level.push_back(models.size());
+
+			while (level.back() - level[level.size() - 2] > 1)
+			{
+				if (level.size() > max_levels_c)
+					throw std::runtime_error("Learned index has too many levels");
+
+				uint64_t begin = level[level.size() - 2], end = level.back();
+
+				_Fit([&](size_t i) { return std::make_pair(models[begin + i].first, (uint64_t)i); }, (size_t)(end - begin), models);
+				level.push_back(models.size());
+			}
+
+			_Free(Header().keys);
+			_Free(Header().values);
+			_Free(Header().models);
+
+			uint64_t keys = 0, values = 0, spans = 0;
+
+			if (kv.size())
+			{
+				keys = _Allocate(kv.size() * sizeof(uint64_t));
+				values = _Allocate(kv.size() * sizeof(pointer_t));
+				spans = _Allocate(models.size() * sizeof(_Model));
+
+				auto k = _Span<uint64_t>(keys);
+				auto v = _Span<pointer_t>(values);
+
+				for (size_t i = 0; i < kv.size(); i++)
+				{
+					k[i] = kv[i].first;
+					v[i] = kv[i].second;
+				}
+
+				std::copy(models.begin(), models.end(), _Span<_Model>(spans));
+			}
+
+			auto& header = Header();
+
+			header.count = kv.size();
+			header.keys = keys;
+			header.values = values;
+			header.models = spans;
+			header.levels = (kv.size()) ? level.size() - 1 : 0;
+
+			for (size_t i = 0; i <= max_levels_c; i++)
+				header.level[i] = (i < level.size() && kv.size()) ? level[i] : 0;
+
+			if constexpr (R::StableAddresses)
+				*arrays = _Resolve();
+		}
+
+	public:
+		_LearnedIndex() {}
+
+		void Open(R* _io, size_t& _n)
+		{
+			header_n = _n++;
+			io = _io;
+
+			if (io->size() <= header_n)
+			{
+				io->template Allocate<_Header>();
+
+				/*
+					Runtime Introspection:
+				*/
+
+				auto& desc = io->GetDescriptor(header_n);
+
+				desc.type = TableType::learned_index;
+
+				desc.standard_index.self_balanced = (uint32_t)false;
+				desc.standard_index.requires_distributed_key = (uint32_t)false;
+
+				desc.standard_index.key_sz = sizeof(key_t);
+				desc.standard_index.link_sz = sizeof(_Model);
+				desc.standard_index.pointer_sz = sizeof(pointer_t);
+				desc.standard_index.key_mode = key_t::mode;
+				desc.standard_index.key_type = key_t::type;
+				desc.standard_index.hash_policy = _KeyHashPolicy<key_t>::value;
+
+				desc.standard_index.max_capacity = (uint32_t)(2 * epsilon_c + 2);
+				desc.standard_index.min_capacity = (uint16_t)1;
+
+				desc.standard_index.max_page = (uint32_t)R::UnitSize;
+				desc.standard_index.min_page = (uint16_t)sizeof(_Model);
+
+				desc.standard_index.link_count = 0;
+			}
+			else if (io->GetDescriptor(header_n).type != TableType::learned_index)
+				throw std::runtime_error("Index is not a learned index");
+
+			if constexpr (R::StableAddresses)
+				arrays = std::make_shared<_Arrays>(_Resolve());
+		}
+
+		uint64_t size() const
+		{
+			return Header().count;
+		}
+
+		//Models per level, bottom level first:
+		//
+
+		std::vector<uint64_t> Models() const
+		{
+			auto& header = Header();
+			std::vector<uint64_t> result;
+
+			for (size_t l = 0; l < header.levels; l++)
+				result.push_back(header.level[l + 1] - header.level[l]);
+
+			return result;
+		}
+
+		/*
+			Freezes any index with IterateKV over the same keys, such as a _BTree of OrderedIntKey.
+			Pairs are sorted here, iteration order doesn't matter.
+		*/
+
+		template < typename T > void Build(const T& source)
+		{
+			std::vector<std::pair<uint64_t, pointer_t>> kv;
+
+			source.IterateKV([&](auto& k, auto& v)
+			{
+				kv.emplace_back(traits_t::Bits(k), v);
+				return true;
+			});
+
+			std::stable_sort(kv.begin(), kv.end(), [](auto& l, auto& r) { return l.first < r.first; });
+
+			_Load(kv);
+		}
+
+		template < typename T > void BulkLoad(gsl::span<T> kv, bool sorted = true)
+		{
+			std::vector<std::pair<uint64_t, pointer_t>> bits(kv.size());
+
+			for (size_t i = 0; i < kv.size(); i++)
+				bits[i] = std::make_pair(traits_t::Bits(kv[i].first), kv[i].second);
+
+			if (!sorted)
+				std::stable_sort(bits.begin(), bits.end(), [](auto& l, auto& r) { return l.first < r.first; });
+
+			_Load(bits);
+		}
+
+		pointer_t* Find(const key_t& k, void* ref_page = nullptr) const
+		{
+			auto& header = Header();
+
+			if (!header.count)
+				return nullptr;
+
+			auto a = Arrays();
+			uint64_t bits = traits_t::Bits(k);
+			size_t p = _Position(header, a, bits);
+
+			return (p < header.count && a.keys[p] == bits) ? a.values + p : nullptr;
+		}
+
+		pointer_t* FindLock(const key_t& k, void* ref_page = nullptr) const
+		{
+			return Find(k, ref_page);
+		}
+
+		template <typename F> void MultiFind(F&& f, const key_t& k, void* ref_page = nullptr) const
+		{
+			auto& header = Header();
+
+			if (!header.count)
+				return;
+
+			auto a = Arrays();
+			uint64_t bits = traits_t::Bits(k);
+
+			for (size_t p = _Position(header, a, bits); p < header.count && a.keys[p] == bits; p++)
+				if (!f(a.values + p))
+					return;
+		}
+
+		//Calls f( key, pointer ) in key order for every key from low_k to high_k:
+		//
+
+		template <typename F> void RangeFind(F&& f, const key_t& low_k, const key_t& high_k, void* ref_page = nullptr) const
+		{
+			auto& header = Header();
+
+			if (!header.count)
+				return;
+
+			auto a = Arrays();
+			uint64_t high = traits_t::Bits(high_k);
+
+			for (size_t p = _Position(header, a, traits_t::Bits(low_k)); p < header.count && a.keys[p] <= high; p++)
+			{
+				auto k = _Key(a.keys[p]);
+				f(k, a.values[p]);
+			}
+		}
+
+		template < typename F > int Iterate(F&& f) const
+		{
+			return IterateKV([&](auto& k, auto& v) { return f(v); });
+		}
+
+		template < typename F > int IterateKV(F&& f) const
+		{
+			auto& header = Header();
+			auto a = Arrays();
+			int count = 0;
+
+			for (size_t p = 0; p < header.count; p++)
+			{
+				count++;
+				auto k = _Key(a.keys[p]);
+
+				if (!f(k, a.values[p]))
+					break;
+			}
+
+			return count;
+		}
+
+		//Keys are sorted and every distinct key is found at its first position:
+		//
+
+		bool Validate() const
+		{
+			auto& header = Header();
+			auto a = Arrays();
+
+			if (!header.count)
+				return !header.levels;
+
+			if (header.level[header.levels] - header.level[header.levels - 1] != 1)
+				return false;
+
+			for (size_t p = 0; p < header.count; p++)
+			{
+				if (p && a.keys[p] < a.keys[p - 1])
+					return false;
+
+				if ((!p || a.keys[p] != a.keys[p - 1]) && _Position(header, a, a.keys[p]) != p)
+					return false;
+			}
+
+			return true;
+		}
+	};
+
+	template < typename R, typename key_t, typename pointer_t = uint64_t, size_t epsilon = 64 > using LearnedIndex = _LearnedIndex<R, key_t, pointer_t, epsilon>;
+	template < typename R, typename int_t, size_t epsilon = 64 > using LearnedIntKey = _LearnedIndex<R, _IntWrapper<int_t>, Key32, epsilon>;
+}
@@ -88,6 +88,12 @@ namespace tdb
 	template <size_t S, size_t F> using _F = _BTree<_R<S>, FuzzyHashPointerT<F> >;
 	template <size_t S, size_t F> using _SGF = _BTree<_SGR<S>, FuzzyHashPointerT<F> >;
 
+	template <size_t S, size_t F> using _TH = _BTree<_R<S>, TaggedHashPointerT<F> >;
+	template <size_t S, size_t F> using _SGTH = _BTree<_SGR<S>, TaggedHashPointerT<F> >;
+
+	template <size_t S> using _FF = _BTree<_R<S>, FastHashPointer >;
+	template <size_t S> using _SGFF = _BTree<_SGR<S>, FastHashPointer >;
+
 	template <size_t S> using _SS = _BTree<_R<S>, OrderedSurrogateStringPointer<_R<S>> >;
 	template <size_t S> using _SGSS = _BTree<_SGR<S>, OrderedSurrogateStringPointer<_SGR<S>> >;
 
@@ -111,6 +117,8 @@ namespace tdb
 	template <size_t S> using _IndexSortedSurrogateString = _Database< _R<S>, _SS<S> >;
 	template <size_t S> using _IndexSortedSurrogateKey = _Database< _R<S>, _SK<S> >;
 	template <size_t S, size_t F = 4> using _IndexFuzzyHash = _Database< _R<S>, _F<S, F> >;
+	template <size_t S, size_t F = 16> using _IndexTaggedHash = _Database< _R<S>, _TH<S, F> >;
+	template <size_t S> using _IndexFastHash = _Database< _R<S>, _FF<S> >;
 	template <size_t S, size_t F = 4> using _BigIndexFuzzyHash = _Database< _R256<S>, _F256<S, F> >;
 
 
@@ -119,6 +127,8 @@ namespace tdb
 	template <size_t S> using _IndexSortedSurrogateStringSafe = _Database< _SGR<S>, _SGSS<S> >;
 	template <size_t S> using _IndexSortedSurrogateKeySafe = _Database< _SGR<S>, _SGSK<S> >;
 	template <size_t S, size_t F = 4> using _IndexFuzzyHashSafe = _Database< _SGR<S>, _SGF<S, F> >;
+	template <size_t S, size_t F = 16> using _IndexTaggedHashSafe = _Database< _SGR<S>, _SGTH<S, F> >;
+	template <size_t S> using _IndexFastHashSafe = _Database< _SGR<S>, _SGFF<S> >;
 	template <size_t S, size_t F = 4> using _BigIndexFuzzyHashSafe = _Database< _SGR256<S>, _SGF256<S, F> >;
 
 
@@ -344,6 +354,92 @@ namespace tdb
 			return true;
 		}
 
+		/*
+			Batched InsertSizedObject, the keys of every name are hashed together with HashBatch.
+			Names already present are skipped, returns how many objects were stored.
+		*/
+
+		template <typename K, typename S, typename V, typename SZ = uint16_t> size_t InsertSizedObjectBatch(gsl::span<const S> names, gsl::span<const V> values)
+		{
+			return _InsertSizedObjectBatch<false, K, S, V, SZ>(names, values, gsl::span<K>());
+		}
+
+		template <typename K, typename S, typename V, typename SZ = uint16_t> size_t InsertSizedObjectBatchLock(gsl::span<const S> names, gsl::span<const V> values)
+		{
+			return _InsertSizedObjectBatch<true, K, S, V, SZ>(names, values, gsl::span<K>());
+		}
+
+		/*
+			Content addressed objects, every value is keyed by its own hash, keys receives them.
+		*/
+
+		template <typename K, typename V, typename SZ = uint16_t> size_t InsertContentBatchLock(gsl::span<const V> values, gsl::span<K> keys)
+		{
+			return _InsertSizedObjectBatch<true, K, V, V, SZ>(values, values, keys);
+		}
+
+		template <bool lock_v, typename K, typename S, typename V, typename SZ> size_t _InsertSizedObjectBatch(gsl::span<const S> names, gsl::span<const V> values, gsl::span<K> keys)
+		{
+			if (values.size() < names.size())
+				throw std::runtime_error("Every name needs a value");
+
+			std::vector<K> hashed;
+
+			if (keys.size() < names.size())
+			{
+				hashed.resize(names.size());
+				keys = gsl::span<K>(hashed);
+			}
+
+			HashBatch(names, keys.first(names.size()));
+
+			//Objects are written before the keys are inserted, so no index pointer is held across an allocation:
+			//
+
+			std::vector<uint64_t*> present(names.size());
+
+			if constexpr (lock_v)
+				db.Table<0>().FindBatchLock(gsl::span<const K>(keys.data(), names.size()), gsl::span<uint64_t*>(present));
+			else
+				db.Table<0>().FindBatch(gsl::span<const K>(keys.data(), names.size()), gsl::span<uint64_t*>(present));
+
+			std::vector<std::pair<K, uint64_t>> kv;
+			kv.reserve(names.size());
+
+			for (size_t i = 0; i < names.size(); i++)
+			{
+				if (present[i])
+					continue;
+
+				auto& v = values[i];
+				auto [iptr, offset] = Incidental(v.size() + sizeof(SZ));
+
+				if (!iptr)
+					continue;
+
+				auto sz = (SZ*)iptr;
+				*sz = (SZ)v.size();
+				std::copy(v.begin(), v.end(), iptr + sizeof(SZ));
+
+				kv.emplace_back(keys[i], offset);
+			}
+
+			std::vector<std::pair<uint64_t*, bool>> results(kv.size());
+
+			if constexpr (lock_v)
+				db.Table<0>().InsertBatchLock(gsl::span<std::pair<K, uint64_t>>(kv), gsl::span<std::pair<uint64_t*, bool>>(results));
+			else
+				db.Table<0>().InsertBatch(gsl::span<std::pair<K, uint64_t>>(kv), gsl::span<std::pair<uint64_t*, bool>>(results));
+
+			size_t stored = 0;
+
+			for (auto& r : results)
+				if (r.first && !r.second)
+					stored++;
+
+			return stored;
+		}
+
 		template <typename K> uint8_t* FindObject(const K& k, void* ref = nullptr)
 		{
 			auto ptr = db.Table<0>().Find(k, ref);
@@ -364,6 +460,15 @@ namespace tdb
 			return GetObject(*ptr);
 		}
 
+		template <typename K> void FindObjectBatchLock(gsl::span<const K> ks, gsl::span<uint8_t*> objects, void* ref = nullptr)
+		{
+			std::vector<uint64_t*> ptrs(ks.size());
+			db.Table<0>().FindBatchLock(ks, gsl::span<uint64_t*>(ptrs), ref);
+
+			for (size_t i = 0; i < ks.size(); i++)
+				objects[i] = (ptrs[i]) ? GetObject(*ptrs[i]) : nullptr;
+		}
+
 		template <typename K, typename SZ = uint16_t> gsl::span<uint8_t> FindSizedObject(const K& k, void* ref = nullptr)
 		{
 			auto ptr = db.Table<0>().Find(k, ref);
@@ -450,6 +555,24 @@ namespace tdb
 	using LargeHashmapL = Index<64 * 1024 * 1024, _IndexFuzzyHash<64 * 1024 * 1024, 8>>;
 	using LargeHashmapReadOnlyL = const Index<64 * 1024 * 1024, _IndexFuzzyHash<64 * 1024 * 1024, 8>>;
 
+	using LargeTaggedHashmap = Index<64 * 1024 * 1024, _IndexTaggedHash<64 * 1024 * 1024>>;
+	using LargeTaggedHashmapReadOnly = const Index<64 * 1024 * 1024, _IndexTaggedHash<64 * 1024 * 1024>>;
+
+	using LargeTaggedHashmapW = Index<64 * 1024 * 1024, _IndexTaggedHash<64 * 1024 * 1024, 32>>;
+	using LargeTaggedHashmapReadOnlyW = const Index<64 * 1024 * 1024, _IndexTaggedHash<64 * 1024 * 1024, 32>>;
+
+	using LargeTaggedHashmapSafe = Index<64 * 1024 * 1024, _IndexTaggedHashSafe<64 * 1024 * 1024>>;
+	using LargeTaggedHashmapReadOnlySafe = const Index<64 * 1024 * 1024, _IndexTaggedHashSafe<64 * 1024 * 1024>>;
+
+	//FastKey32 hashmaps, serve them with NetworkIndex<..., FastKey32>:
+	//
+
+	using LargeFastHashmap = Index<64 * 1024 * 1024, _IndexFastHash<64 * 1024 * 1024>>;
+	using LargeFastHashmapReadOnly = const Index<64 * 1024 * 1024, _IndexFastHash<64 * 1024 * 1024>>;
+
+	using LargeFastHashmapSafe = Index<64 * 1024 * 1024, _IndexFastHashSafe<64 * 1024 * 1024>>;
+	using LargeFastHashmapReadOnlySafe = const Index<64 * 1024 * 1024, _IndexFastHashSafe<64 * 1024 * 1024>>;
+
 	template < size_t C = 8, size_t G = 8 * 1024 * 1024, typename INDEX = _IndexSortedList<G> > class MapReduceT
 	{
 		std::array<INDEX, C> dbr;
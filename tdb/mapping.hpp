@@ -9,6 +9,7 @@
 #include <filesystem>
 #include <fstream>
 #include <utility>
+#include <algorithm>
 
 #include "d8u/util.hpp"
 
@@ -20,6 +21,27 @@ namespace tdb
 	namespace fs = std::filesystem;
 	using namespace d8u::util;
 
+	//Keeps mapped pages resident, false when the system refuses ( locked memory limits ):
+	//
+
+	inline bool LockPages(void* p, size_t length)
+	{
+#ifdef _WIN32
+		return VirtualLock(p, length) != 0;
+#else
+		return mlock(p, length) == 0;
+#endif
+	}
+
+	inline void UnlockPages(void* p, size_t length)
+	{
+#ifdef _WIN32
+		VirtualUnlock(p, length);
+#else
+		munlock(p, length);
+#endif
+	}
+
 
 	template <uint64_t growsize_t = 1024*1024, size_t page_t = 64*1024> class _MapFile
 	{
@@ -61,6 +83,9 @@ namespace tdb
 		}		
 
 	public:
+
+		static const bool stable_addresses = false;
+
 		std::pair<uint8_t*, uint64_t> _Incidental(size_t s)
 		{
 			if (s > page_t)
@@ -146,7 +171,7 @@ namespace tdb
 				if (growth < growsize_t)
 					growth = growsize_t;
 
-				Reserve(size() + growth - sizeof(_Header));
+				Reserve(map.size() + growth - sizeof(_Header));
 			}
 
 			Header().size = target;
@@ -216,6 +241,9 @@ namespace tdb
 		}
 
 	public:
+
+		static const bool stable_addresses = false;
+
 		std::pair<uint8_t*, uint64_t> _Incidental(size_t s)
 		{
 			return std::make_pair<nullptr, -1>;
@@ -301,6 +329,9 @@ namespace tdb
 		}
 
 	public:
+
+		static const bool stable_addresses = false;
+
 		std::pair<uint8_t*, uint64_t> _Incidental(size_t s)
 		{
 			return std::make_pair<nullptr, -1>;
@@ -415,6 +446,11 @@ namespace tdb
 
 	public:
 
+		//Growth adds maps and never moves the ones before it, pointers into the file stay valid:
+		//
+
+		static const bool stable_addresses = true;
+
 		//Allocate an unaligned fragment of mapped file space:
 		//
 
@@ -518,7 +554,7 @@ namespace tdb
 		void Resize(uint64_t target)
 		{
 			if (target + sizeof(_Header) > current)
-				Reserve(current + growsize_t);
+				Reserve(std::max(current + growsize_t, target + sizeof(_Header)));
 
 			Header().size = target;
 		}
@@ -599,8 +635,8 @@ namespace tdb
 
 			auto _start = s + sizeof(_Header);
 			auto _final = s + szof + sizeof(_Header);
-			if (_start < current && _final > current) //Block doesn't fit into map boundaries.
-				s = Header().size = current;		
+			if (_start < current && _final > current) //Block doesn't fit into map boundaries, start it at the next map so page alignment holds.
+				s = Header().size = current - sizeof(_Header);
 
 			Resize(s + szof);
 
@@ -17,8 +17,15 @@ namespace tdb
     using namespace std;
     using namespace d8u;
 
-    template <typename STORE> class NetworkIndex
+    /*
+        K is the key the binary ports carry, it must use the hash policy of the store's index.
+        HTTP paths are hashed by the index key itself.
+    */
+
+    template <typename STORE, typename K = Key32> class NetworkIndex
     {
+        static_assert(sizeof(K) == 32, "The binary protocol carries 32 byte keys");
+
         TcpServer insert;
         TcpServer find;
         HttpServer http;
@@ -108,10 +115,42 @@ namespace tdb
             , find((uint16_t)stoi(find_port.data()), ConnectionType::message,
                 [&](auto* pc, auto req, auto body, void* reply)
                 {
-                    if (req.size() != 32)
+                    if (!req.size() || req.size() % 32)
                         throw std::runtime_error("Invalid Block size");
 
-                    auto ptr = store.FindObjectLock( *( (Key32*)req.data() ) );
+                    if (req.size() > 32)
+                    {
+                        //Batched find, the reply is every object prefixed by its size, zero when missing:
+                        //
+
+                        size_t count = req.size() / 32, total = 0;
+                        std::vector<uint8_t*> objects(count);
+
+                        store.FindObjectBatchLock(gsl::span<const K>((const K*)req.data(), count), gsl::span<uint8_t*>(objects));
+
+                        for (auto ptr : objects)
+                            total += 2 + ((ptr) ? *((uint16_t*)ptr) : 0);
+
+                        std::vector<uint8_t> buffer(total);
+                        auto out = buffer.data();
+
+                        for (auto ptr : objects)
+                        {
+                            uint16_t sz = (ptr) ? *((uint16_t*)ptr) : 0;
+
+                            if (ptr)
+                                std::copy(ptr, ptr + sz + 2, out);
+                            else
+                                *((uint16_t*)out) = 0;
+
+                            out += sz + 2;
+                        }
+
+                        pc->ActivateWrite(reply, std::move(buffer));
+                        return;
+                    }
+
+                    auto ptr = store.FindObjectLock( *( (K*)req.data() ) );
 
                     if (!ptr)
                     {
@@ -130,10 +169,42 @@ namespace tdb
             , insert((uint16_t)stoi(insert_port.data()),ConnectionType::message ,
                 [&](auto* pc, auto req, auto body, void* reply)
                 {
-                    if(req.size() <= 32 || req.size() > 64*1024-2+32)
+                    if(req.size() <= 32)
                         throw std::runtime_error("Invalid Block size");
-                        
-                    auto [ptr, status] = store.InsertLock(*((Key32*)req.data()),uint64_t(0));
+
+                    if (((K*)req.data())->IsZero())
+                    {
+                        //A zero key marks a content addressed batch, objects prefixed by their size, the reply is their keys:
+                        //
+
+                        std::vector<std::string_view> objects;
+
+                        for (size_t i = 32; i < req.size(); )
+                        {
+                            if (i + 2 > req.size())
+                                throw std::runtime_error("Invalid Block size");
+
+                            uint16_t sz = *((uint16_t*)(req.data() + i));
+
+                            if (i + 2 + sz > req.size() || sz > 64 * 1024 - 2)
+                                throw std::runtime_error("Invalid Block size");
+
+                            objects.emplace_back((const char*)req.data() + i + 2, sz);
+                            i += 2 + sz;
+                        }
+
+                        std::vector<uint8_t> buffer(objects.size() * 32);
+
+                        store.InsertContentBatchLock(gsl::span<const std::string_view>(objects), gsl::span<K>((K*)buffer.data(), objects.size()));
+
+                        pc->ActivateWrite(reply, std::move(buffer));
+                        return;
+                    }
+
+                    if(req.size() > 64*1024-2+32)
+                        throw std::runtime_error("Invalid Block size");
+
+                    auto [ptr, status] = store.InsertLock(*((K*)req.data()),uint64_t(0));
 
                     std::vector<uint8_t> buffer(4);
 
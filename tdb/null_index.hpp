@@ -26,6 +26,11 @@ namespace tdb
 			return 0;
 		}
 
+		template < typename F > size_t ParallelIterate(F&& f, size_t threads = 0) const
+		{
+			return 0;
+		}
+
 		pointer_t* Find(const key_t& k, void* ref_page = nullptr) const
 		{
 			return nullptr;
@@ -45,6 +50,17 @@ namespace tdb
 			return nullptr;
 		}
 
+		void FindBatch(gsl::span<const key_t> ks, gsl::span<pointer_t*> results, void* ref_page = nullptr) const
+		{
+			for (auto& r : results)
+				r = nullptr;
+		}
+
+		void FindBatchLock(gsl::span<const key_t> ks, gsl::span<pointer_t*> results, void* ref_page = nullptr) const
+		{
+			FindBatch(ks, results, ref_page);
+		}
+
 		void InsertLock(const gsl::span<key_t>& ks, const pointer_t& p) { }
 
 		pair<pointer_t*, bool> InsertLock(const key_t& k, const pointer_t& p)
@@ -56,6 +72,27 @@ namespace tdb
 		{
 			return f(pair<pointer_t*, bool>{ nullptr, false });
 		}
+
+		size_t Erase(const key_t& k, void* ref_page = nullptr) { return 0; }
+
+		template <typename F> size_t EraseIf(F&& f, const key_t& k, void* ref_page = nullptr) { return 0; }
+
+		size_t EraseLock(const key_t& k, void* ref_page = nullptr) { return 0; }
+
+		template <typename F> size_t EraseIfLock(F&& f, const key_t& k, void* ref_page = nullptr) { return 0; }
+
+		template < typename T > void BulkLoad(gsl::span<T> kv, bool sorted = true) { }
+
+		template < typename T > void InsertBatch(gsl::span<T> kv, gsl::span<pair<pointer_t*, bool>> results)
+		{
+			for (auto& r : results)
+				r = { nullptr,false };
+		}
+
+		template < typename T > void InsertBatchLock(gsl::span<T> kv, gsl::span<pair<pointer_t*, bool>> results)
+		{
+			InsertBatch(kv, results);
+		}
 	};
 
 	template < typename R, typename N > using NullIndex = _NullIndex<R, N>;
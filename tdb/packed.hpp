@@ -0,0 +1,1018 @@
+/* Copyright (C) 2020 D8DATAWORKS - All Rights Reserved */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <type_traits>
+#include <emmintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "keys.hpp"
+#include "types.hpp"
+#include "radix.hpp"
+
+namespace tdb
+{
+	using namespace std;
+
+	/*
+		Self balancing B+tree over integer keys with compressed leaves, for dense ids where most of a full width key is zeros.
+
+		A leaf keeps its smallest key as a frame of reference and every key as the distance from it, bit packed at the
+		width of the largest distance. Sequential ids pack in a dozen or so bits instead of 64, so a leaf holds more entries
+		and the tree is shallower. Pointers stay full width, finds hand out pointer_t* like every other index.
+
+		A leaf splits when the next key doesn't fit, either its entries run out or the wider frame would overflow the bits.
+		Searches binary search the packed keys down to a window, unpack it and count the smaller keys four lanes at a time.
+
+		Inner nodes hold plain separators, locking and the leaf chain follow _BPlusTree. Erase doesn't merge, leaves emptied
+		by erases stay in the chain and fill up again.
+	*/
+
+	template < typename R, typename key_t, typename pointer_t = uint64_t, bool multi_v = true, size_t bits_c = 16 > class _PackedBPlusTree
+	{
+		using traits_t = _RadixKey<key_t>;
+		using int_t = typename key_t::Key;
+
+		static_assert(!traits_t::interval, "Packed leaves hold point keys");
+		static_assert(key_t::mode == KeyMode::key_mode_direct, "Packed leaves store key bits, not what they point to");
+		static_assert(bits_c > 0 && bits_c <= 64, "Leaves are sized for deltas of 1 to 64 bits");
+
+		//Keys in inner nodes and leaf frames are radix bits, unsigned and in key order:
+		//
+
+		struct _Head
+		{
+			uint32_t level = 0;
+			uint32_t count = 0;
+			std::atomic<uint32_t> lock = 0;
+			uint32_t width = 0;
+			uint64_t base = 0;
+			uint64_t next = 0;
+			uint64_t prev = 0;
+			uint64_t reserved[3] = { 0 };
+		};
+
+		static_assert(sizeof(_Head) == 64);
+
+		static constexpr size_t avail_c = R::UnitSize - sizeof(_Head);
+		static constexpr size_t inner_c = avail_c / (2 * sizeof(uint64_t));
+		static constexpr size_t window_c = 32;
+
+		//Leaves are sized so bits_c wide keys and the pointers run out together:
+		//
+
+		static constexpr size_t _Bins()
+		{
+			size_t bins = avail_c * 8 / (sizeof(pointer_t) * 8 + bits_c);
+
+			while (bins * sizeof(pointer_t) + (bins * bits_c + 63) / 64 * 8 > avail_c)
+				bins--;
+
+			return bins;
+		}
+
+		static constexpr size_t bin_c = _Bins();
+		static constexpr size_t word_c = (avail_c - bin_c * sizeof(pointer_t)) / 8;
+
+		struct _Inner : public _Head
+		{
+			uint64_t keys[inner_c];
+			uint64_t children[inner_c];
+		};
+
+		struct _Leaf : public _Head
+		{
+			uint64_t words[word_c];
+			pointer_t pointers[bin_c];
+		};
+
+		static_assert(sizeof(_Inner) <= R::UnitSize && sizeof(_Leaf) <= R::UnitSize);
+
+		static constexpr size_t unit_c = (sizeof(_Inner) > sizeof(_Leaf)) ? sizeof(_Inner) : sizeof(_Leaf);
+
+		R* io = nullptr;
+		uint64_t root_n = 0;
+
+		/*
+			Bit packing, value i of a width w run sits at bit i * w little endian and may straddle two words.
+		*/
+
+		static uint64_t _Mask(uint32_t w)
+		{
+			return (w >= 64) ? ~0ull : (1ull << w) - 1;
+		}
+
+		static uint32_t _Width(uint64_t d)
+		{
+			if (!d)
+				return 0;
+
+#ifdef _MSC_VER
+			unsigned long r;
+			_BitScanReverse64(&r, d);
+
+			return (uint32_t)r + 1;
+#else
+			return 64 - (uint32_t)__builtin_clzll(d);
+#endif
+		}
+
+		static uint64_t _Get(const uint64_t* words, uint32_t w, size_t i)
+		{
+			if (!w)
+				return 0;
+
+			size_t bit = i * w, word = bit >> 6, shift = bit & 63;
+			uint64_t v = words[word] >> shift;
+
+			if (shift + w > 64)
+				v |= words[word + 1] << (64 - shift);
+
+			return v & _Mask(w);
+		}
+
+		static void _Set(uint64_t* words, uint32_t w, size_t i, uint64_t v)
+		{
+			if (!w)
+				return;
+
+			size_t bit = i * w, word = bit >> 6, shift = bit & 63;
+			uint64_t m = _Mask(w);
+
+			words[word] = (words[word] & ~(m << shift)) | (v << shift);
+
+			if (shift + w > 64)
+			{
+				size_t spill = 64 - shift;
+				words[word + 1] = (words[word + 1] & ~(m >> spill)) | (v >> spill);
+			}
+		}
+
+		static size_t _Capacity(uint32_t w)
+		{
+			return (w) ? (std::min)(bin_c, word_c * 64 / w) : bin_c;
+		}
+
+		static uint64_t _KeyAt(const _Leaf& l, size_t i)
+		{
+			return l.base + _Get(l.words, l.width, i);
+		}
+
+		static key_t _Key(uint64_t bits)
+		{
+			if constexpr (std::is_signed_v<int_t>)
+				bits ^= 1ull << (sizeof(int_t) * 8 - 1);
+
+			return key_t((int_t)bits);
+		}
+
+		/*
+			Unpacks count deltas from i and counts those below d ( at or below d for upper_v ), they are sorted so that
+			is where d goes in the window. Frames up to 32 bits compare four lanes at a time.
+		*/
+
+		template < bool upper_v > static size_t _Count(const _Leaf& l, size_t i, size_t count, uint64_t d)
+		{
+			if (l.width <= 32)
+			{
+				alignas(16) uint32_t lanes[window_c];
+
+				for (size_t j = 0; j < count; j++)
+					lanes[j] = (uint32_t)_Get(l.words, l.width, i + j);
+
+				__m128i flip = _mm_set1_epi32((int)0x80000000);
+				__m128i bound = _mm_xor_si128(_mm_set1_epi32((int)(uint32_t)d), flip);
+				__m128i sum = _mm_setzero_si128();
+
+				size_t j = 0;
+
+				for (; j + 4 <= count; j += 4)
+				{
+					__m128i v = _mm_xor_si128(_mm_load_si128((const __m128i*)(lanes + j)), flip);
+
+					if constexpr (upper_v)
+						sum = _mm_add_epi32(sum, _mm_cmpgt_epi32(v, bound));
+					else
+						sum = _mm_sub_epi32(sum, _mm_cmplt_epi32(v, bound));
+				}
+
+				alignas(16) int32_t total[4];
+				_mm_store_si128((__m128i*)total, sum);
+
+				//Upper counts the lanes above d as negatives, the rest of the group is at or below it:
+				//
+
+				size_t result = (upper_v) ? (size_t)((int32_t)j + total[0] + total[1] + total[2] + total[3]) : (size_t)(total[0] + total[1] + total[2] + total[3]);
+
+				for (; j < count; j++)
+					if (lanes[j] < d || (upper_v && lanes[j] == d))
+						result++;
+
+				return result;
+			}
+
+			size_t result = 0;
+
+			for (size_t j = 0; j < count; j++)
+			{
+				uint64_t v = _Get(l.words, l.width, i + j);
+
+				if (v < d || (upper_v && v == d))
+					result++;
+			}
+
+			return result;
+		}
+
+		//First entry >= kb, or > kb for upper_v:
+		//
+
+		template < bool upper_v > static size_t _Bound(const _Leaf& l, uint64_t kb)
+		{
+			size_t count = l.count;
+
+			if (!count || kb < l.base)
+				return 0;
+
+			uint64_t d = kb - l.base;
+
+			if (d > _Mask(l.width))
+				return count;
+
+			size_t low = 0, high = count;
+
+			while (high - low > window_c)
+			{
+				size_t middle = (low + high) >> 1;
+				uint64_t v = _Get(l.words, l.width, middle);
+
+				if (v < d || (upper_v && v == d))
+					low = middle + 1;
+				else
+					high = middle;
+			}
+
+			return low + _Count<upper_v>(l, low, high - low, d);
+		}
+
+		//Moves every delta to a new frame, going up when it widens so nothing is overwritten before it is read:
+		//
+
+		static void _Repack(_Leaf& l, uint64_t base, uint32_t width)
+		{
+			size_t count = l.count;
+
+			if (width >= l.width)
+			{
+				for (size_t i = count; i-- > 0;)
+					_Set(l.words, width, i, l.base + _Get(l.words, l.width, i) - base);
+			}
+			else
+			{
+				for (size_t i = 0; i < count; i++)
+					_Set(l.words, width, i, l.base + _Get(l.words, l.width, i) - base);
+			}
+
+			l.base = base;
+			l.width = width;
+		}
+
+		static bool _Fits(const _Leaf& l, uint64_t kb)
+		{
+			if (!l.count)
+				return true;
+
+			uint64_t base = (std::min)(l.base, kb);
+			uint64_t top = (std::max)(_KeyAt(l, l.count - 1), kb);
+
+			return l.count + 1 <= _Capacity(_Width(top - base));
+		}
+
+		//Whether entries [ from, to ) of l and kb fit in one leaf:
+		//
+
+		static bool _Holds(const _Leaf& l, size_t from, size_t to, uint64_t kb)
+		{
+			if (from == to)
+				return true;
+
+			uint64_t base = (std::min)(_KeyAt(l, from), kb);
+			uint64_t top = (std::max)(_KeyAt(l, to - 1), kb);
+
+			return to - from + 1 <= _Capacity(_Width(top - base));
+		}
+
+		//The caller checked kb fits:
+		//
+
+		static pointer_t* _Place(_Leaf& l, size_t i, uint64_t kb, const pointer_t& p)
+		{
+			size_t count = l.count;
+
+			if (!count)
+			{
+				l.base = kb;
+				l.width = 0;
+			}
+			else
+			{
+				uint64_t base = (std::min)(l.base, kb);
+				uint32_t width = _Width((std::max)(_KeyAt(l, count - 1), kb) - base);
+
+				if (base != l.base || width > l.width)
+					_Repack(l, base, (std::max)(width, l.width));
+			}
+
+			for (size_t j = count; j > i; j--)
+				_Set(l.words, l.width, j, _Get(l.words, l.width, j - 1));
+
+			_Set(l.words, l.width, i, kb - l.base);
+
+			std::memmove((void*)(l.pointers + i + 1), (void*)(l.pointers + i), (count - i) * sizeof(pointer_t));
+			l.pointers[i] = p;
+			l.count = (uint32_t)(count + 1);
+
+			return l.pointers + i;
+		}
+
+		static void _Remove(_Leaf& l, size_t i)
+		{
+			size_t count = l.count;
+
+			for (size_t j = i + 1; j < count; j++)
+				_Set(l.words, l.width, j - 1, _Get(l.words, l.width, j));
+
+			std::memmove((void*)(l.pointers + i), (void*)(l.pointers + i + 1), (count - i - 1) * sizeof(pointer_t));
+			l.count = (uint32_t)(count - 1);
+		}
+
+		_Head* _Node(uint64_t id) const
+		{
+			return &io->template Lookup<_Head>(id);
+		}
+
+		_Inner* _AsInner(uint64_t id) const
+		{
+			return (_Inner*)_Node(id);
+		}
+
+		_Leaf* _AsLeaf(uint64_t id) const
+		{
+			return (_Leaf*)_Node(id);
+		}
+
+		static bool _Full(_Head* n, uint64_t kb)
+		{
+			return (n->level) ? n->count == inner_c : !_Fits(*(_Leaf*)n, kb);
+		}
+
+		template < bool lock_v > static void _Lock(_Head* n)
+		{
+			if constexpr (lock_v)
+			{
+				uint32_t expected = 0;
+
+				while (!n->lock.compare_exchange_weak(expected, 1, std::memory_order_acquire))
+				{
+					expected = 0;
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		template < bool lock_v > static void _Unlock(_Head* n)
+		{
+			if constexpr (lock_v)
+				n->lock.store(0, std::memory_order_release);
+		}
+
+		template < bool lock_v > uint64_t _Allocate(uint32_t level)
+		{
+			_Leaf* n;
+
+			if constexpr (lock_v)
+				n = &io->template RecycleLock<_Leaf>();
+			else
+				n = &io->template Recycle<_Leaf>();
+
+			n->level = level;
+
+			return io->template Index<_Leaf>(*n);
+		}
+
+		//Last child whose separator is <= kb for inserts, < kb for lookups which then walk right:
+		//
+
+		template < bool upper_v > static int _Route(const _Inner* n, uint64_t kb)
+		{
+			int low = 1;
+			int high = (int)n->count - 1;
+
+			while (low <= high)
+			{
+				int middle = (low + high) >> 1;
+
+				if (n->keys[middle] < kb || (upper_v && n->keys[middle] == kb))
+					low = middle + 1;
+				else
+					high = middle - 1;
+			}
+
+			return low - 1;
+		}
+
+		template < bool lock_v > _Leaf* _Find(uint64_t kb) const
+		{
+			_Head* n = _Node(root_n);
+			_Lock<lock_v>(n);
+
+			while (n->level)
+			{
+				_Head* child = _Node(((_Inner*)n)->children[_Route<false>((_Inner*)n, kb)]);
+
+				_Lock<lock_v>(child);
+				_Unlock<lock_v>(n);
+
+				n = child;
+			}
+
+			return (_Leaf*)n;
+		}
+
+		//Moves to the next leaf holding both locks, returns nullptr and keeps l locked at the end of the chain:
+		//
+
+		template < bool lock_v > _Leaf* _Next(_Leaf* l) const
+		{
+			if (!l->next)
+				return nullptr;
+
+			_Leaf* next = _AsLeaf(l->next);
+
+			_Lock<lock_v>(next);
+			_Unlock<lock_v>(l);
+
+			return next;
+		}
+
+		//Locked leaf holding the first entry >= kb and its position, the position is count at the end of the chain:
+		//
+
+		template < bool lock_v > std::pair<_Leaf*, size_t> _Seek(uint64_t kb) const
+		{
+			_Leaf* l = _Find<lock_v>(kb);
+			size_t i = _Bound<false>(*l, kb);
+
+			while (i == l->count)
+			{
+				_Leaf* next = _Next<lock_v>(l);
+
+				if (!next)
+					break;
+
+				l = next;
+				i = _Bound<false>(*l, kb);
+			}
+
+			return { l, i };
+		}
+
+		/*
+			The locked root is full, copy it into a new unit and make the root its parent.
+		*/
+
+		template < bool lock_v > void _Grow()
+		{
+			uint64_t copy_id = _Allocate<lock_v>(0);
+
+			_Head* root = _Node(root_n);
+			_Head* copy = _Node(copy_id);
+
+			std::memcpy((void*)copy, (void*)root, unit_c);
+			copy->lock.store(0);
+
+			_Inner* inner = (_Inner*)root;
+
+			inner->level = copy->level + 1;
+			inner->count = 1;
+			inner->width = 0;
+			inner->base = 0;
+			inner->next = 0;
+			inner->prev = 0;
+			inner->keys[0] = 0;
+			inner->children[0] = copy_id;
+		}
+
+		/*
+			Splits so the side kb goes to has room for it. Appends at the right edge start an empty leaf, ascending keys
+			then fill every leaf. Otherwise leaves split in half, unless kb would widen that half past its capacity, then
+			they split where kb goes and it joins the smaller side, which stays inside the old frame.
+			Returns the separator, the lowest key of the new leaf or kb when it starts empty.
+		*/
+
+		template < bool lock_v > uint64_t _SplitLeaf(_Leaf* a, uint64_t a_id, _Leaf* b, uint64_t b_id, uint64_t kb, bool tail)
+		{
+			size_t count = a->count;
+			size_t i = _Bound<true>(*a, kb);
+			size_t keep = count / 2;
+
+			if (tail && i == count)
+				keep = count;
+			else if (!((i > keep) ? _Holds(*a, keep, count, kb) : _Holds(*a, 0, keep, kb)))
+				keep = i;
+
+			size_t moved = count - keep;
+			uint64_t separator = kb;
+
+			if (moved)
+			{
+				separator = _KeyAt(*a, keep);
+
+				b->base = separator;
+				b->width = _Width(_KeyAt(*a, count - 1) - separator);
+
+				for (size_t j = 0; j < moved; j++)
+					_Set(b->words, b->width, j, _KeyAt(*a, keep + j) - separator);
+
+				std::memcpy((void*)b->pointers, (void*)(a->pointers + keep), moved * sizeof(pointer_t));
+			}
+
+			b->count = (uint32_t)moved;
+
+			if (moved)
+			{
+				a->count = (uint32_t)keep;
+
+				if (keep)
+					_Repack(*a, a->base, _Width(_KeyAt(*a, keep - 1) - a->base));
+			}
+
+			b->next = a->next;
+			b->prev = a_id;
+
+			if (b->next)
+			{
+				_Leaf* next = _AsLeaf(b->next);
+
+				_Lock<lock_v>(next);
+				next->prev = b_id;
+				_Unlock<lock_v>(next);
+			}
+
+			a->next = b_id;
+
+			return separator;
+		}
+
+		/*
+			Moves the upper entries of the locked child j into a new locked sibling placed after it in the parent.
+			The allocation can remap, callers refresh their node pointers.
+		*/
+
+		template < bool lock_v > uint64_t _Split(uint64_t parent_id, int j, uint64_t id, uint64_t kb, bool tail)
+		{
+			uint64_t sibling_id = _Allocate<lock_v>(_Node(id)->level);
+
+			_Inner* parent = _AsInner(parent_id);
+			_Head* n = _Node(id);
+			_Head* s = _Node(sibling_id);
+
+			_Lock<lock_v>(s);
+
+			uint64_t separator;
+
+			if (n->level)
+			{
+				_Inner* a = (_Inner*)n;
+				_Inner* b = (_Inner*)s;
+
+				size_t keep = inner_c / 2;
+				size_t moved = a->count - keep;
+
+				std::memcpy(b->keys, a->keys + keep, moved * sizeof(uint64_t));
+				std::memcpy(b->children, a->children + keep, moved * sizeof(uint64_t));
+				b->count = (uint32_t)moved;
+				a->count = (uint32_t)keep;
+
+				separator = b->keys[0];
+			}
+			else
+				separator = _SplitLeaf<lock_v>((_Leaf*)n, id, (_Leaf*)s, sibling_id, kb, tail);
+
+			size_t after = parent->count - j - 1;
+
+			std::memmove(parent->keys + j + 2, parent->keys + j + 1, after * sizeof(uint64_t));
+			std::memmove(parent->children + j + 2, parent->children + j + 1, after * sizeof(uint64_t));
+
+			parent->keys[j + 1] = separator;
+			parent->children[j + 1] = sibling_id;
+			parent->count++;
+
+			return sibling_id;
+		}
+
+		template < bool lock_v, typename F > auto _Insert(const key_t& k, const pointer_t& p, F&& f)
+		{
+			uint64_t kb = traits_t::Bits(k);
+			uint64_t id = root_n;
+
+			_Lock<lock_v>(_Node(root_n));
+
+			if (_Full(_Node(root_n), kb))
+				_Grow<lock_v>();
+
+			bool tail = true;
+
+			while (_Node(id)->level)
+			{
+				_Inner* n = _AsInner(id);
+				int j = _Route<true>(n, kb);
+				uint64_t child_id = n->children[j];
+
+				_Lock<lock_v>(_Node(child_id));
+
+				if (_Full(_Node(child_id), kb))
+				{
+					uint64_t sibling_id = _Split<lock_v>(id, j, child_id, kb, tail && j == (int)n->count - 1);
+
+					n = _AsInner(id);
+
+					if (n->keys[j + 1] <= kb)
+					{
+						_Unlock<lock_v>(_Node(child_id));
+						child_id = sibling_id;
+						j++;
+					}
+					else
+						_Unlock<lock_v>(_Node(sibling_id));
+				}
+
+				tail = tail && j == (int)n->count - 1;
+
+				_Unlock<lock_v>(n);
+				id = child_id;
+			}
+
+			_Leaf* leaf = _AsLeaf(id);
+			size_t i = _Bound<true>(*leaf, kb);
+
+			pair<pointer_t*, bool> overwrite;
+
+			if (!multi_v && i && _KeyAt(*leaf, i - 1) == kb)
+				overwrite = { leaf->pointers + i - 1, true };
+			else
+				overwrite = { _Place(*leaf, i, kb, p), false };
+
+			auto result = f(overwrite);
+
+			_Unlock<lock_v>(leaf);
+
+			return result;
+		}
+
+		template < bool lock_v, typename F > size_t _EraseIf(F&& f, const key_t& k)
+		{
+			uint64_t kb = traits_t::Bits(k);
+			auto [l, i] = _Seek<lock_v>(kb);
+
+			size_t erased = 0;
+
+			for (;;)
+			{
+				while (i < l->count && _KeyAt(*l, i) == kb)
+				{
+					if (f(l->pointers + i))
+					{
+						_Remove(*l, i);
+						erased++;
+					}
+					else
+						i++;
+				}
+
+				if (i < l->count)
+					break;
+
+				_Leaf* next = _Next<lock_v>(l);
+
+				if (!next)
+					break;
+
+				l = next;
+				i = 0;
+			}
+
+			_Unlock<lock_v>(l);
+
+			return erased;
+		}
+
+		_Leaf* _First() const
+		{
+			_Head* n = _Node(root_n);
+
+			while (n->level)
+				n = _Node(((_Inner*)n)->children[0]);
+
+			return (_Leaf*)n;
+		}
+
+		bool _Validate(uint64_t id, uint32_t level, const uint64_t* low, const uint64_t* high, uint64_t& last) const
+		{
+			_Head* n = _Node(id);
+
+			if (n->level != level || n->lock.load())
+				return false;
+
+			if (level)
+			{
+				_Inner* inner = (_Inner*)n;
+
+				if (!inner->count || inner->count > inner_c)
+					return false;
+
+				for (size_t j = 2; j < inner->count; j++)
+					if (inner->keys[j - 1] > inner->keys[j])
+						return false;
+
+				for (size_t j = 0; j < inner->count; j++)
+					if (!_Validate(inner->children[j], level - 1, (j) ? inner->keys + j : low, (j + 1 < inner->count) ? inner->keys + j + 1 : high, last))
+						return false;
+
+				return true;
+			}
+
+			_Leaf* l = (_Leaf*)n;
+
+			if (l->count > _Capacity(l->width))
+				return false;
+
+			for (size_t i = 0; i < l->count; i++)
+			{
+				uint64_t kb = _KeyAt(*l, i);
+
+				if (i)
+				{
+					uint64_t prior = _KeyAt(*l, i - 1);
+
+					if (prior > kb || (!multi_v && prior == kb))
+						return false;
+				}
+
+				if ((low && kb < *low) || (high && kb > *high))
+					return false;
+			}
+
+			if (l->prev != last || (last && _AsLeaf(last)->next != id))
+				return false;
+
+			last = id;
+
+			return true;
+		}
+
+	public:
+		_PackedBPlusTree() {}
+
+		void Open(R* _io, size_t& _n)
+		{
+			root_n = _n++;
+			io = _io;
+
+			if (io->size() <= root_n)
+			{
+				io->template Allocate<_Leaf>();
+
+				/*
+					Runtime Introspection:
+				*/
+
+				auto& desc = io->GetDescriptor(root_n);
+
+				desc.type = TableType::packed_tree;
+
+				desc.standard_index.self_balanced = (uint32_t)true;
+				desc.standard_index.requires_distributed_key = (uint32_t)false;
+
+				desc.standard_index.key_sz = sizeof(key_t);
+				desc.standard_index.link_sz = sizeof(uint64_t);
+				desc.standard_index.pointer_sz = sizeof(pointer_t);
+				desc.standard_index.key_mode = key_t::mode;
+				desc.standard_index.key_type = key_t::type;
+				desc.standard_index.hash_policy = _KeyHashPolicy<key_t>::value;
+
+				desc.standard_index.max_capacity = (uint32_t)bin_c;
+				desc.standard_index.min_capacity = (uint16_t)(word_c / sizeof(pointer_t));
+
+				desc.standard_index.max_page = (uint32_t)R::UnitSize;
+				desc.standard_index.min_page = (uint16_t)-1;
+
+				desc.standard_index.link_count = 2;
+			}
+			else if (io->GetDescriptor(root_n).type != TableType::packed_tree)
+				throw std::runtime_error("Index is not a packed tree");
+		}
+
+		bool Validate() const
+		{
+			uint64_t last = 0;
+
+			if (!_Validate(root_n, _Node(root_n)->level, nullptr, nullptr, last))
+				return false;
+
+			return !last || !_AsLeaf(last)->next;
+		}
+
+		//Levels from the root to the leaves, the same for every leaf:
+		//
+
+		size_t Depth() const
+		{
+			return _Node(root_n)->level + 1;
+		}
+
+		//Entries and the room for them at the width each leaf packs to now:
+		//
+
+		std::pair<uint64_t, uint64_t> Population() const
+		{
+			auto sum = std::make_pair(uint64_t(0), uint64_t(0));
+
+			for (_Leaf* l = _First(); l; l = (l->next) ? _AsLeaf(l->next) : nullptr)
+			{
+				sum.first += l->count;
+				sum.second += _Capacity(l->width);
+			}
+
+			return sum;
+		}
+
+		//Leaves and the bits their keys are packed to, widest first:
+		//
+
+		std::vector<uint64_t> Widths() const
+		{
+			std::vector<uint64_t> result(65);
+
+			for (_Leaf* l = _First(); l; l = (l->next) ? _AsLeaf(l->next) : nullptr)
+				result[l->width]++;
+
+			return result;
+		}
+
+		//Leaves are chained, iteration is in key order:
+		//
+
+		template < typename F > int Iterate(F&& f) const
+		{
+			int count = 0;
+
+			for (_Leaf* l = _First(); l; l = (l->next) ? _AsLeaf(l->next) : nullptr)
+				for (size_t i = 0; i < l->count; i++, count++)
+					if (!f(l->pointers[i]))
+						return count + 1;
+
+			return count;
+		}
+
+		template < typename F > int IterateKV(F&& f) const
+		{
+			int count = 0;
+
+			for (_Leaf* l = _First(); l; l = (l->next) ? _AsLeaf(l->next) : nullptr)
+			{
+				for (size_t i = 0; i < l->count; i++, count++)
+				{
+					auto k = _Key(_KeyAt(*l, i));
+
+					if (!f(k, l->pointers[i]))
+						return count + 1;
+				}
+			}
+
+			return count;
+		}
+
+		pointer_t* Find(const key_t& k, void* ref_page = nullptr) const
+		{
+			uint64_t kb = traits_t::Bits(k);
+			auto [l, i] = _Seek<false>(kb);
+
+			return (i < l->count && _KeyAt(*l, i) == kb) ? l->pointers + i : nullptr;
+		}
+
+		pointer_t* FindLock(const key_t& k, void* ref_page = nullptr) const
+		{
+			uint64_t kb = traits_t::Bits(k);
+			auto [l, i] = _Seek<true>(kb);
+
+			pointer_t* result = (i < l->count && _KeyAt(*l, i) == kb) ? l->pointers + i : nullptr;
+
+			_Unlock<true>(l);
+
+			return result;
+		}
+
+		template <typename F> void MultiFind(F&& f, const key_t& k, void* ref_page = nullptr) const
+		{
+			uint64_t kb = traits_t::Bits(k);
+			auto [l, i] = _Seek<false>(kb);
+
+			for (; l; l = _Next<false>(l), i = 0)
+			{
+				for (; i < l->count; i++)
+				{
+					if (_KeyAt(*l, i) != kb)
+						return;
+
+					if (!f(l->pointers + i))
+						return;
+				}
+			}
+		}
+
+		template <typename F> void RangeFind(F&& f, const key_t& low_k, const key_t& high_k, void* ref_page = nullptr) const
+		{
+			uint64_t high = traits_t::Bits(high_k);
+			auto [l, i] = _Seek<false>(traits_t::Bits(low_k));
+
+			for (; l; l = _Next<false>(l), i = 0)
+			{
+				for (; i < l->count; i++)
+				{
+					uint64_t kb = _KeyAt(*l, i);
+
+					if (kb > high)
+						return;
+
+					auto k = _Key(kb);
+					f(k, l->pointers[i]);
+				}
+			}
+		}
+
+		void Insert(const gsl::span<key_t>& ks, const pointer_t& p)
+		{
+			for (auto& k : ks)
+				Insert(k, p);
+		}
+
+		pair<pointer_t*, bool> Insert(const key_t& k, const pointer_t& p)
+		{
+			return _Insert<false>(k, p, [](auto r) { return r; });
+		}
+
+		void InsertLock(const gsl::span<key_t>& ks, const pointer_t& p)
+		{
+			for (auto& k : ks)
+				InsertLock(k, p);
+		}
+
+		pair<pointer_t*, bool> InsertLock(const key_t& k, const pointer_t& p)
+		{
+			return _Insert<true>(k, p, [](auto r) { return r; });
+		}
+
+		template <typename F> pair<pointer_t*, bool> InsertLockContext(const key_t& k, const pointer_t& p, F&& f)
+		{
+			return _Insert<true>(k, p, f);
+		}
+
+		/*
+			Erase removes every entry matching the key, EraseIf only those accepted by the predicate ( f(pointer_t*) -> bool ).
+			Both return the number of entries removed.
+		*/
+
+		size_t Erase(const key_t& k, void* ref_page = nullptr)
+		{
+			return _EraseIf<false>([](auto*) { return true; }, k);
+		}
+
+		template <typename F> size_t EraseIf(F&& f, const key_t& k, void* ref_page = nullptr)
+		{
+			return _EraseIf<false>(f, k);
+		}
+
+		size_t EraseLock(const key_t& k, void* ref_page = nullptr)
+		{
+			return _EraseIf<true>([](auto*) { return true; }, k);
+		}
+
+		template <typename F> size_t EraseIfLock(F&& f, const key_t& k, void* ref_page = nullptr)
+		{
+			return _EraseIf<true>(f, k);
+		}
+	};
+
+	template < typename R, typename key_t, typename pointer_t = uint64_t > using PackedIndex = _PackedBPlusTree<R, key_t, pointer_t>;
+	template < typename R, typename int_t > using PackedIntKey = _PackedBPlusTree<R, _IntWrapper<int_t>, Key32>;
+}
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "btree.hpp"
+#include "prefix.hpp"
 
 namespace tdb
 {
@@ -33,9 +34,13 @@ namespace tdb
 	template <typename R>		using MultiSurrogateStringPointer =		SimpleMultiListBuilder<64 * 1024, uint64_t, _OrderedSurrogateString<R, uint64_t> >;
 	template <typename R>		using MultiSurrogateKeyPointer32 =		SimpleMultiListBuilder<64 * 1024, uint32_t, _SurrogateKey<R, uint32_t, Key32> >;
 	template <typename R>		using MultiSurrogateKeyPointer32v =		SimpleMultiListBuilder<64 * 1024, uint32_t, _SurrogateKey<R, uint32_t, Key32>,4,true >;
+	template <typename R>		using MultiLocalSurrogateStringPointer =	SimpleMultiListBuilder<64 * 1024, uint64_t, _LocalSurrogateString<R, uint64_t> >;
+	template <typename R>		using MultiLocalSurrogateKeyPointer32 =	SimpleMultiListBuilder<64 * 1024, uint32_t, _LocalSurrogateKey<R, uint32_t, Key32> >;
 	template <typename R>		using OrderedSurrogateStringPointer =	SimpleOrderedListBuilder<64 * 1024, uint64_t, _OrderedSurrogateString<R, uint64_t> >;
 	template <typename R>		using SurrogateKeyPointer =				SimpleOrderedListBuilder<64 * 1024, uint64_t, _SurrogateKey<R, uint64_t, Key32> >;
 	template <typename R>		using SurrogateKeyPointer32 =			SimpleOrderedListBuilder<64 * 1024, uint32_t, _SurrogateKey<R, uint32_t, Key32> >;
+	template <typename R>		using OrderedLocalSurrogateStringPointer =	SimpleOrderedListBuilder<64 * 1024, uint64_t, _LocalSurrogateString<R, uint64_t> >;
+	template <typename R>		using LocalSurrogateKeyPointer =		SimpleOrderedListBuilder<64 * 1024, uint64_t, _LocalSurrogateKey<R, uint64_t, Key32> >;
 								using OrderedListPointer =				SimpleOrderedListBuilder<64 * 1024, uint64_t, Key32 >;
 
 
@@ -43,6 +48,28 @@ namespace tdb
 	template <size_t fuzzy_c> using BigFuzzyHashPointerT =	SimpleFuzzyHashBuilder<256 * 1024, uint64_t, Key32, fuzzy_c>;
 							  using FuzzyHashPointer =		SimpleFuzzyHashBuilder<64 * 1024 , uint64_t, Key32, 4>;
 							  using FuzzyHashPointer32 =	SimpleFuzzyHashBuilder<64 * 1024, uint32_t, Key32, 4>;
+							  using FastHashPointer =		SimpleFuzzyHashBuilder<64 * 1024 , uint64_t, FastKey32, 4>;
+
+	template <size_t fuzzy_c> using TaggedHashPointerT =	SimpleTaggedHashBuilder<64 * 1024, uint64_t, Key32, fuzzy_c>;
+							  using TaggedHashPointer =		SimpleTaggedHashBuilder<64 * 1024, uint64_t, Key32, 16>;
+							  using TaggedHashPointer32 =	SimpleTaggedHashBuilder<64 * 1024, uint32_t, Key32, 16>;
+
+
+	//Aligned nodes trade a few bins for key, pointer and tag arrays on cache line boundaries and a lock word on its own line:
+	//
+
+							  using AlignedOrderedListPointer =		SimpleAlignedOrderedListBuilder<64 * 1024, uint64_t, Key32 >;
+	template <typename int_t> using AlignedOrderedIntKey =			AlignedMultiListBuilder<64 * 1024, int_t, _IntWrapper<int_t>, Key32, int_t>;
+							  using AlignedFuzzyHashPointer =		SimpleAlignedFuzzyHashBuilder<64 * 1024, uint64_t, Key32, 4>;
+							  using AlignedTaggedHashPointer =		SimpleAlignedTaggedHashBuilder<64 * 1024, uint64_t, Key32, 16>;
+
+
+	//Prefix compressed blocks keep variable length string keys inline, use them with PrefixTree:
+	//
+
+	using PrefixStringPointer =			SimplePrefixBlockBuilder<64 * 1024, uint64_t>;
+	using MultiPrefixStringPointer =	SimplePrefixBlockBuilder<64 * 1024, uint64_t, 16, true>;
+	using PrefixStringPointer32 =		SimplePrefixBlockBuilder<64 * 1024, uint32_t>;
 
 
 	//Other node types can map a key to keys, or keys and pointers:
@@ -51,17 +78,37 @@ namespace tdb
 	using OrderedListKey = OrderedListBuilder<64 * 1024,uint64_t, Key32, Key32, uint64_t, 4>;
 	using OrderedListKP = OrderedListBuilder<64 * 1024,uint64_t, Key32, KeyP, uint64_t, 4>;
 	using OrderedListKP2 = OrderedListBuilder<64 * 1024,uint64_t, Key32, KeyP2, uint64_t, 4>;
+	using AlignedOrderedListKP2 = AlignedOrderedListBuilder<64 * 1024, uint64_t, Key32, KeyP2, uint64_t, 4>;
 
 
 
 	static_assert(	sizeof(OrderedSurrogateStringPointer<void>) ==	64 * 1024);
 	static_assert(	sizeof(SurrogateKeyPointer<void>) ==			64 * 1024);
+	static_assert(	sizeof(MultiLocalSurrogateStringPointer<void>) ==	64 * 1024);
+	static_assert(	sizeof(OrderedLocalSurrogateStringPointer<void>) ==	64 * 1024);
+	static_assert(	sizeof(LocalSurrogateKeyPointer<void>) ==		64 * 1024);
+	static_assert(	sizeof(MultiLocalSurrogateKeyPointer32<void>) ==	64 * 1024);
 	static_assert(	sizeof(OrderedListPointer) ==					64 * 1024);
 	static_assert(	sizeof(FuzzyHashPointerT<1>) ==					64 * 1024);
 	static_assert(	sizeof(FuzzyHashPointer) ==						64 * 1024);
+	static_assert(	sizeof(FastHashPointer) ==						64 * 1024);
+	static_assert(	sizeof(TaggedHashPointerT<32>) ==				64 * 1024);
+	static_assert(	sizeof(TaggedHashPointer) ==					64 * 1024);
+	static_assert(	sizeof(TaggedHashPointer32) ==					64 * 1024);
+	static_assert(	sizeof(PrefixStringPointer) ==					64 * 1024);
+	static_assert(	sizeof(MultiPrefixStringPointer) ==				64 * 1024);
+	static_assert(	sizeof(PrefixStringPointer32) ==				64 * 1024);
 	static_assert(	sizeof(OrderedListKey) ==						64 * 1024);
 	static_assert(	sizeof(OrderedListKP) ==						64 * 1024);
 	static_assert(	sizeof(OrderedListKP2) ==						64 * 1024);
+	static_assert(	sizeof(AlignedOrderedListPointer) ==			64 * 1024);
+	static_assert(	sizeof(AlignedOrderedIntKey<uint64_t>) ==		64 * 1024);
+	static_assert(	sizeof(AlignedFuzzyHashPointer) ==				64 * 1024);
+	static_assert(	sizeof(AlignedTaggedHashPointer) ==				64 * 1024);
+	static_assert(	sizeof(AlignedOrderedListKP2) ==				64 * 1024);
+
+	static_assert(	AlignedOrderedListKP2::pointers_offset_c % 64 == 0 && AlignedOrderedListKP2::lock_offset_c % 64 == 0);
+	static_assert(	AlignedTaggedHashPointer::lock_offset_c + 64 == 64 * 1024 - AlignedTaggedHashPointer::Bins - AlignedTaggedHashPointer::Padding);
 
 
 
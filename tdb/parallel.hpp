@@ -0,0 +1,238 @@
+/* Copyright (C) 2020 D8DATAWORKS - All Rights Reserved */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tdb
+{
+	inline size_t WorkStealingThreads(size_t threads = 0)
+	{
+		if (!threads)
+			threads = std::thread::hardware_concurrency();
+
+		return (threads) ? threads : 1;
+	}
+
+	/*
+		Work stealing walk over a tree of tasks starting at root.
+
+		Workers push the tasks they discover onto their own deque and pop them back newest first,
+		idle workers steal the oldest task of another worker, which is usually the largest remaining subtree.
+
+		f(worker, task, push) runs concurrently, push(task) schedules more work and returning false stops the walk.
+		Returns false when the walk was stopped.
+	*/
+
+	template < typename T, typename F > bool WorkStealing(const T& root, F&& f, size_t threads = 0)
+	{
+		threads = WorkStealingThreads(threads);
+
+		struct queue_t
+		{
+			std::mutex lock;
+			std::deque<T> tasks;
+		};
+
+		std::unique_ptr<queue_t[]> queues(new queue_t[threads]);
+		std::atomic<size_t> pending(1);
+		std::atomic<bool> stop(false);
+		std::exception_ptr error;
+		std::mutex error_lock;
+
+		queues[0].tasks.push_back(root);
+
+		auto worker = [&](size_t w)
+		{
+			auto push = [&](const T& t)
+			{
+				pending++;
+
+				std::lock_guard<std::mutex> lock(queues[w].lock);
+				queues[w].tasks.push_back(t);
+			};
+
+			while (pending.load())
+			{
+				T task;
+				bool found = false;
+
+				{
+					std::lock_guard<std::mutex> lock(queues[w].lock);
+
+					if (queues[w].tasks.size())
+					{
+						task = queues[w].tasks.back();
+						queues[w].tasks.pop_back();
+						found = true;
+					}
+				}
+
+				for (size_t i = 1; !found && i < threads; i++)
+				{
+					auto& victim = queues[(w + i) % threads];
+
+					std::lock_guard<std::mutex> lock(victim.lock);
+
+					if (victim.tasks.size())
+					{
+						task = victim.tasks.front();
+						victim.tasks.pop_front();
+						found = true;
+					}
+				}
+
+				if (!found)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				//A stopped walk still drains what was queued, without expanding it:
+				//
+
+				if (!stop.load(std::memory_order_relaxed))
+				{
+					try
+					{
+						if (!f(w, task, push))
+							stop = true;
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> lock(error_lock);
+
+						if (!error)
+							error = std::current_exception();
+
+						stop = true;
+					}
+				}
+
+				pending--;
+			}
+		};
+
+		if (threads == 1)
+			worker(0);
+		else
+		{
+			std::vector<std::thread> pool;
+
+			for (size_t w = 1; w < threads; w++)
+				pool.emplace_back(worker, w);
+
+			worker(0);
+
+			for (auto& t : pool)
+				t.join();
+		}
+
+		if (error)
+			std::rethrow_exception(error);
+
+		return !stop;
+	}
+
+	/*
+		Bounded queue where each of a fixed set of consumers sees every item, in push order.
+		A slot is reused once the slowest consumer is past it, so pushes block while any consumer is depth items behind.
+		Consumers take everything pushed since their last call in one go and handle it outside the lock.
+	*/
+
+	template < typename T > class BroadcastQueue
+	{
+		std::vector<T> ring;
+		std::vector<size_t> tails;
+		size_t head = 0;
+		bool closed = false;
+
+		std::mutex lock;
+		std::condition_variable readable;
+		std::condition_variable writable;
+
+		//With no consumers nothing holds a slot back:
+		//
+
+		size_t _Slowest() const
+		{
+			return (tails.size()) ? *std::min_element(tails.begin(), tails.end()) : head;
+		}
+
+	public:
+		BroadcastQueue(size_t depth, size_t consumers) : ring((depth) ? depth : 1), tails(consumers, 0) {}
+
+		void Push(T t)
+		{
+			{
+				std::unique_lock<std::mutex> l(lock);
+
+				writable.wait(l, [&]() { return head - _Slowest() < ring.size(); });
+
+				ring[head++ % ring.size()] = std::move(t);
+			}
+
+			readable.notify_all();
+		}
+
+		//Calls f on every item consumer c hasn't seen yet, false once the queue is closed and c has seen everything:
+		//
+
+		template < typename F > bool Consume(size_t c, F&& f)
+		{
+			size_t from, to;
+
+			{
+				std::unique_lock<std::mutex> l(lock);
+
+				readable.wait(l, [&]() { return closed || head != tails[c]; });
+
+				from = tails[c];
+				to = head;
+			}
+
+			if (from == to)
+				return false;
+
+			for (size_t i = from; i < to; i++)
+				f(ring[i % ring.size()]);
+
+			{
+				std::lock_guard<std::mutex> l(lock);
+				tails[c] = to;
+			}
+
+			writable.notify_all();
+
+			return true;
+		}
+
+		//Waits until every consumer has seen everything pushed so far:
+		//
+
+		void Drain()
+		{
+			std::unique_lock<std::mutex> l(lock);
+
+			writable.wait(l, [&]() { return _Slowest() == head; });
+		}
+
+		void Close()
+		{
+			{
+				std::lock_guard<std::mutex> l(lock);
+				closed = true;
+			}
+
+			readable.notify_all();
+		}
+	};
+}
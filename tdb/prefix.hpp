@@ -0,0 +1,1182 @@
+/* Copyright (C) 2020 D8DATAWORKS - All Rights Reserved */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "btree.hpp"
+
+namespace tdb
+{
+#pragma pack(push,1)
+
+	/*
+		Block of variable length string keys stored inline, laid out like an SSTable block.
+
+		Each entry is ( shared, unshared, pointer, suffix ): the key repeats the first shared bytes of the key before it
+		and only stores the rest. Every restart_c entries a restart point stores its key in full. The offsets of the restart
+		points sit at the end of the unit, so a lookup binary searches them and decodes a single run.
+
+		Edits re-encode the run they touch and shift the bytes behind it, splits and loads re-encode the whole block.
+		links[0] and links[1] chain the leaves, links[2] holds the level, inner entries point to child units.
+	*/
+
+	template < typename pointer_t, typename link_t, size_t data_c, size_t restart_c = 16, bool multi_v = false > struct _PrefixBlockNode
+	{
+		static const uint32_t type = (multi_v) ? TableType::btree_prefix_multiblock : TableType::btree_prefix_block;
+
+		static const uint32_t _guard = 0xeabc45af;
+
+		using Pointer = pointer_t;
+		using Link = link_t;
+		using Key = std::string_view;
+		using offset_t = std::conditional_t< (data_c <= 64 * 1024), uint16_t, uint32_t >;
+		using run_t = std::vector<std::pair<std::string, pointer_t>>;
+
+		static const size_t Data = data_c;
+		static const size_t Restarts = restart_c;
+		static const size_t Links = 3;
+		static const bool Multi = multi_v;
+
+		//Longest key accepted, a block that isn't full always has room for two more entries of this size:
+		//
+
+		static const size_t max_key_c = data_c / 16;
+		static const size_t max_entry_c = 10 + sizeof(pointer_t) + max_key_c;
+		static const size_t reserve_c = 2 * (max_entry_c + sizeof(offset_t));
+
+		static_assert(restart_c > 0);
+		static_assert(reserve_c * 4 < data_c, "Blocks are too small to split");
+
+		link_t links[Links] = { 0 };
+
+		uint32_t count = 0;
+
+		uint32_t used = 0;
+
+		uint32_t restarts = 0;
+
+		uint32_t guard = _guard;
+
+		uint8_t data[data_c];
+
+		void Init() {}
+
+		void Lock()
+		{
+			if (guard != 0 && guard != _guard)
+				throw std::runtime_error("Bad Node");
+
+			static constexpr auto lock_delay = std::chrono::milliseconds(5);
+
+			auto lock = (std::atomic<uint32_t>*) & guard;
+
+			uint32_t expected = _guard;
+			while (!lock->compare_exchange_weak(expected, 0, std::memory_order_acquire))
+			{
+				expected = _guard;
+				std::this_thread::sleep_for(lock_delay);
+			}
+		}
+
+		void Unlock()
+		{
+			auto lock = (std::atomic<uint32_t>*) & guard;
+
+			lock->store(_guard, std::memory_order_release);
+		}
+
+		struct Position
+		{
+			uint32_t restart = 0;
+			uint32_t index = 0;
+			uint32_t offset = 0;
+			uint32_t pointer = 0;
+			uint32_t length = 0;
+			bool valid = false;
+		};
+
+		size_t Free() const
+		{
+			return data_c - used - restarts * sizeof(offset_t);
+		}
+
+		bool Full() const
+		{
+			return Free() < reserve_c;
+		}
+
+		offset_t* Starts()
+		{
+			return (offset_t*)(data + data_c) - restarts;
+		}
+
+		const offset_t* Starts() const
+		{
+			return (const offset_t*)(data + data_c) - restarts;
+		}
+
+		uint32_t End(uint32_t r) const
+		{
+			return (r + 1 < restarts) ? Starts()[r + 1] : used;
+		}
+
+		pointer_t* PointerAt(uint32_t offset)
+		{
+			return (pointer_t*)(data + offset);
+		}
+
+		static size_t PutVarint(uint8_t* d, uint32_t v)
+		{
+			size_t n = 0;
+
+			for (; v >= 0x80; v >>= 7)
+				d[n++] = (uint8_t)(v | 0x80);
+
+			d[n++] = (uint8_t)v;
+
+			return n;
+		}
+
+		static size_t GetVarint(const uint8_t* s, uint32_t& v)
+		{
+			size_t n = 0;
+			v = 0;
+
+			for (uint32_t shift = 0;; shift += 7)
+			{
+				uint8_t b = s[n++];
+				v |= (uint32_t)(b & 0x7f) << shift;
+
+				if (!(b & 0x80))
+					return n;
+			}
+		}
+
+		//Skips the header of the entry at offset, returns the offset of its pointer:
+		//
+
+		uint32_t Header(uint32_t offset, uint32_t& shared, uint32_t& unshared) const
+		{
+			offset += (uint32_t)GetVarint(data + offset, shared);
+			offset += (uint32_t)GetVarint(data + offset, unshared);
+
+			return offset;
+		}
+
+		//key holds the previous key ( or this one ) and receives the key at offset, returns the offset of the next entry:
+		//
+
+		uint32_t Decode(uint32_t offset, char* key, uint32_t& length, uint32_t& pointer) const
+		{
+			uint32_t shared, unshared;
+
+			pointer = Header(offset, shared, unshared);
+			memcpy(key + shared, data + pointer + sizeof(pointer_t), unshared);
+			length = shared + unshared;
+
+			return pointer + sizeof(pointer_t) + unshared;
+		}
+
+		std::string_view RestartKey(uint32_t r) const
+		{
+			uint32_t shared, unshared;
+			uint32_t pointer = Header(Starts()[r], shared, unshared);
+
+			return std::string_view((const char*)data + pointer + sizeof(pointer_t), unshared);
+		}
+
+		/*
+			Finds the first entry above k ( upper_v ) or not below it and leaves its key in key.
+			before is the entry preceding it, it stays invalid at the front of the block. Past the end the result is invalid.
+		*/
+
+		template < bool upper_v > Position Seek(std::string_view k, char* key, Position& before) const
+		{
+			before = Position();
+
+			Position at;
+			at.restart = restarts;
+			at.offset = used;
+
+			if (!restarts)
+				return at;
+
+			int low = 1;
+			int high = (int)restarts - 1;
+
+			while (low <= high)
+			{
+				int middle = (low + high) >> 1;
+				int c = RestartKey(middle).compare(k);
+
+				if (c < 0 || (upper_v && c == 0))
+					low = middle + 1;
+				else
+					high = middle - 1;
+			}
+
+			uint32_t r = low - 1;
+			uint32_t end = End(r);
+
+			for (uint32_t offset = Starts()[r], index = 0; offset < used; index++)
+			{
+				if (offset == end)
+				{
+					end = End(++r);
+					index = 0;
+				}
+
+				Position e;
+				e.restart = r;
+				e.index = index;
+				e.offset = offset;
+				e.valid = true;
+
+				uint32_t next = Decode(offset, key, e.length, e.pointer);
+				int c = std::string_view(key, e.length).compare(k);
+
+				if (c > 0 || (!upper_v && c == 0))
+					return e;
+
+				before = e;
+				offset = next;
+			}
+
+			return at;
+		}
+
+		void Unpack(uint32_t r, run_t& run) const
+		{
+			char key[max_key_c];
+			uint32_t length, pointer;
+
+			for (uint32_t offset = Starts()[r], end = End(r); offset < end;)
+			{
+				offset = Decode(offset, key, length, pointer);
+
+				pointer_t p;
+				memcpy(&p, data + pointer, sizeof(pointer_t));
+
+				run.emplace_back(std::string(key, length), p);
+			}
+		}
+
+		void Unpack(run_t& run) const
+		{
+			run.reserve(run.size() + count);
+
+			for (uint32_t r = 0; r < restarts; r++)
+				Unpack(r, run);
+		}
+
+		//Encodes n entries with a restart point every stride of them, starts receives the offsets of the restart points:
+		//
+
+		static void Pack(const std::pair<std::string, pointer_t>* e, size_t n, size_t stride, std::vector<uint8_t>& out, std::vector<uint32_t>& starts)
+		{
+			for (size_t i = 0; i < n; i++)
+			{
+				auto& key = e[i].first;
+				size_t shared = 0;
+
+				if (i % stride)
+				{
+					auto& last = e[i - 1].first;
+
+					while (shared < last.size() && shared < key.size() && last[shared] == key[shared])
+						shared++;
+				}
+				else
+					starts.push_back((uint32_t)out.size());
+
+				uint8_t header[10];
+				size_t h = PutVarint(header, (uint32_t)shared);
+				h += PutVarint(header + h, (uint32_t)(key.size() - shared));
+
+				auto p = (const uint8_t*)&e[i].second;
+
+				out.insert(out.end(), header, header + h);
+				out.insert(out.end(), p, p + sizeof(pointer_t));
+				out.insert(out.end(), key.data() + shared, key.data() + key.size());
+			}
+		}
+
+		/*
+			Swaps run r ( or nothing when r is past the last run ) for the encoding of run, which can take several runs or none.
+			Returns false and leaves the block untouched when the result doesn't fit.
+		*/
+
+		bool Replace(uint32_t r, const run_t& run, int delta_count, size_t stride = restart_c)
+		{
+			std::vector<uint8_t> bytes;
+			std::vector<uint32_t> starts;
+
+			Pack(run.data(), run.size(), stride, bytes, starts);
+
+			uint32_t begin = (r < restarts) ? Starts()[r] : used;
+			uint32_t end = (r < restarts) ? End(r) : used;
+
+			int delta_r = (int)starts.size() - ((r < restarts) ? 1 : 0);
+			int64_t delta = (int64_t)bytes.size() - (int64_t)(end - begin);
+
+			if ((int64_t)used + delta + ((int64_t)restarts + delta_r) * (int64_t)sizeof(offset_t) > (int64_t)data_c)
+				return false;
+
+			//The bytes only grow when the runs don't shrink, so the data never runs over the old restart points:
+			//
+
+			memmove(data + end + delta, data + end, used - end);
+
+			if (bytes.size())
+				memcpy(data + begin, bytes.data(), bytes.size());
+
+			used = (uint32_t)(used + delta);
+
+			offset_t* old_starts = Starts();
+			restarts += delta_r;
+			offset_t* new_starts = Starts();
+
+			memmove(new_starts, old_starts, r * sizeof(offset_t));
+
+			for (size_t i = 0; i < starts.size(); i++)
+				new_starts[r + i] = (offset_t)(begin + starts[i]);
+
+			for (uint32_t i = r + (uint32_t)starts.size(); i < restarts; i++)
+				new_starts[i] = (offset_t)(new_starts[i] + delta);
+
+			count += delta_count;
+
+			return true;
+		}
+
+		void Load(const run_t& run)
+		{
+			count = 0;
+			used = 0;
+			restarts = 0;
+
+			Replace(0, run, (int)run.size());
+		}
+
+		//Offset of the pointer of entry i of run r:
+		//
+
+		uint32_t PointerOf(uint32_t r, size_t i) const
+		{
+			uint32_t shared, unshared, pointer;
+			uint32_t offset = Starts()[r];
+
+			for (;; i--)
+			{
+				pointer = Header(offset, shared, unshared);
+
+				if (!i)
+					return pointer;
+
+				offset = pointer + sizeof(pointer_t) + unshared;
+			}
+		}
+
+		/*
+			Inserts k after before, or at the front when before is invalid. The caller makes sure the block isn't full.
+			A run that overflows is cut in half, appends to the last run cut it full so ascending keys pack tightly.
+		*/
+
+		uint32_t InsertAfter(const Position& before, std::string_view k, const pointer_t& p)
+		{
+			run_t run;
+
+			uint32_t r = (before.valid) ? before.restart : 0;
+			size_t i = (before.valid) ? before.index + 1 : 0;
+
+			if (r < restarts)
+				Unpack(r, run);
+
+			run.emplace(run.begin() + i, std::string(k), p);
+
+			size_t stride = restart_c;
+
+			if (run.size() > restart_c && (r + 1 < restarts || i + 1 < run.size()))
+				stride = (run.size() + 1) / 2;
+
+			Replace(r, run, 1, stride);
+
+			return PointerOf(r + (uint32_t)(i / stride), i % stride);
+		}
+
+		//Unique blocks return the entry already holding k, multi blocks add k after its equals:
+		//
+
+		pair<pointer_t*, bool> Insert(std::string_view k, const pointer_t& p)
+		{
+			char key[max_key_c];
+			Position before, at;
+
+			if constexpr (multi_v)
+				at = Seek<true>(k, key, before);
+			else
+			{
+				at = Seek<false>(k, key, before);
+
+				if (at.valid && std::string_view(key, at.length) == k)
+					return { PointerAt(at.pointer), true };
+			}
+
+			return { PointerAt(InsertAfter(before, k, p)), false };
+		}
+
+		/*
+			Removes the entries matching k accepted by f ( f(pointer_t*) -> bool ).
+			more is set when the block ends before a larger key, the matches can then continue in the next leaf.
+		*/
+
+		template < typename F > size_t Erase(std::string_view k, F&& f, bool& more)
+		{
+			char key[max_key_c];
+			Position before;
+			Position at = Seek<false>(k, key, before);
+
+			more = true;
+
+			if (!at.valid)
+				return 0;
+
+			size_t erased = 0;
+			uint32_t r = at.restart;
+			size_t i = at.index;
+
+			while (r < restarts)
+			{
+				run_t run;
+				Unpack(r, run);
+
+				size_t j = i, removed = 0;
+
+				while (j < run.size() && run[j].first == k)
+				{
+					if (f(&run[j].second))
+					{
+						run.erase(run.begin() + j);
+						removed++;
+					}
+					else
+						j++;
+				}
+
+				bool ended = j < run.size();
+
+				if (removed)
+				{
+					Replace(r, run, -(int)removed);
+					r += (uint32_t)((run.size() + restart_c - 1) / restart_c);
+				}
+				else
+					r++;
+
+				erased += removed;
+
+				if (ended)
+				{
+					more = false;
+					break;
+				}
+
+				i = 0;
+			}
+
+			return erased;
+		}
+
+		//Walks the entries from offset in order, key must hold the previous key ( or the key at offset ):
+		//
+
+		template < typename F > bool Each(F&& f, uint32_t offset, char* key)
+		{
+			uint32_t length, pointer;
+
+			while (offset < used)
+			{
+				offset = Decode(offset, key, length, pointer);
+
+				if (!f(std::string_view(key, length), *PointerAt(pointer)))
+					return false;
+			}
+
+			return true;
+		}
+
+		template < typename F > bool Each(F&& f)
+		{
+			char key[max_key_c];
+
+			return Each(f, 0, key);
+		}
+
+		//Child unit for k in an inner block, entry is the entry of that child and last tells whether it is the last one:
+		//
+
+		template < bool upper_v > link_t Route(std::string_view k, Position& entry, bool& last) const
+		{
+			char key[max_key_c];
+			Position before;
+			Position at = Seek<upper_v>(k, key, before);
+
+			if (before.valid)
+			{
+				entry = before;
+				last = !at.valid;
+			}
+			else
+			{
+				entry = at;
+				last = count == 1;
+			}
+
+			pointer_t p;
+			memcpy(&p, data + entry.pointer, sizeof(pointer_t));
+
+			return (link_t)p;
+		}
+
+		/*
+			Moves the upper entries into the empty sibling and returns the separator for the parent.
+			Tail splits keep every entry but the last. Leaves pass up the shortest prefix of the sibling's first key
+			that is above the last key kept, equal keys pass up the key itself.
+		*/
+
+		std::string Split(_PrefixBlockNode& sibling, bool tail)
+		{
+			run_t run;
+			Unpack(run);
+
+			size_t keep = run.size() - 1;
+
+			if (!tail)
+			{
+				size_t total = 0, half = 0;
+
+				for (auto& e : run)
+					total += e.first.size() + sizeof(pointer_t) + 2;
+
+				for (keep = 0; keep + 1 < run.size() && half < total / 2; keep++)
+					half += run[keep].first.size() + sizeof(pointer_t) + 2;
+
+				if (!keep)
+					keep = 1;
+			}
+
+			auto& last = run[keep - 1].first;
+			auto& first = run[keep].first;
+
+			std::string separator = first;
+
+			if (!links[2] && last != first)
+			{
+				size_t shared = 0;
+
+				while (shared < last.size() && last[shared] == first[shared])
+					shared++;
+
+				separator = first.substr(0, shared + 1);
+			}
+
+			run_t upper(std::make_move_iterator(run.begin() + keep), std::make_move_iterator(run.end()));
+			run.resize(keep);
+
+			Load(run);
+			sibling.Load(upper);
+
+			return separator;
+		}
+
+		bool Validate() const
+		{
+			if (used + restarts * sizeof(offset_t) > data_c || restarts > count || (count && !restarts))
+				return false;
+
+			uint32_t entries = 0;
+
+			for (uint32_t r = 0; r < restarts; r++)
+			{
+				uint32_t end = End(r), run_c = 0;
+
+				if (Starts()[r] >= end || (r == 0 && Starts()[r] != 0))
+					return false;
+
+				for (uint32_t offset = Starts()[r], shared, unshared; offset < end; run_c++, entries++)
+				{
+					uint32_t start = offset;
+
+					offset = Header(offset, shared, unshared) + sizeof(pointer_t) + unshared;
+
+					if ((start == Starts()[r] && shared) || offset > end)
+						return false;
+				}
+
+				if (run_c > restart_c)
+					return false;
+			}
+
+			return entries == count;
+		}
+	};
+
+#pragma pack(pop)
+
+	template <size_t page_s, typename pointer_t, typename link_t, size_t restart_c = 16, bool multi_v = false>
+	using PrefixBlockBuilder = _PrefixBlockNode<	pointer_t,
+													link_t,
+													page_s - sizeof(link_t) * 3 - sizeof(uint32_t) * 4,
+													restart_c,
+													multi_v >;
+
+	template <size_t page_s, typename int_t, size_t restart_c = 16, bool multi_v = false> using SimplePrefixBlockBuilder = PrefixBlockBuilder<page_s, int_t, int_t, restart_c, multi_v>;
+
+	/*
+		Self balancing B+tree over prefix compressed blocks, keys are strings stored in the index itself.
+
+		The shape follows _BPlusTree: inner entries hold the lowest key under a child, the leaves are chained,
+		full blocks are split on the way down and the root never moves. Blocks fill by bytes rather than by entries.
+		Erase leaves emptied blocks in place, lookups walk over them.
+	*/
+
+	template < typename R, typename node_t > class _PrefixTree
+	{
+		using pointer_t = typename node_t::Pointer;
+		using link_t = typename node_t::Link;
+		using run_t = typename node_t::run_t;
+		using Position = typename node_t::Position;
+
+		static const size_t max_key_c = node_t::max_key_c;
+
+		static const int next_l = 0;
+		static const int prev_l = 1;
+		static const int level_l = 2;
+
+		static_assert(node_t::type == TableType::btree_prefix_block || node_t::type == TableType::btree_prefix_multiblock, "Prefix trees need prefix blocks");
+		static_assert(std::is_integral<pointer_t>::value && sizeof(pointer_t) >= sizeof(link_t), "Inner blocks keep child units in the pointers");
+
+		R* io = nullptr;
+		link_t root_n;
+
+		node_t* Node(link_t id) const
+		{
+			return &io->template Lookup<node_t>(id);
+		}
+
+		auto Root() const
+		{
+			return Node(root_n);
+		}
+
+		static size_t Level(const node_t* n)
+		{
+			return (size_t)n->links[level_l];
+		}
+
+	public:
+		_PrefixTree() {}
+
+		void Open(R* _io, size_t& _n)
+		{
+			root_n = _n++;
+			io = _io;
+
+			if (io->size() <= root_n)
+			{
+				auto r = &io->template Allocate<node_t>();
+				r->Init();
+
+				/*
+					Runtime Introspection:
+				*/
+
+				auto& desc = io->GetDescriptor(root_n);
+
+				desc.type = node_t::type;
+
+				desc.standard_index.self_balanced = (uint32_t)true;
+				desc.standard_index.requires_distributed_key = (uint32_t)false;
+
+				static_assert(max_key_c <= UINT16_MAX, "The descriptor holds the longest key in 16 bits");
+
+				desc.standard_index.key_sz = 0;
+				desc.standard_index.max_key_sz = (uint16_t)max_key_c;
+				desc.standard_index.link_sz = sizeof(link_t);
+				desc.standard_index.pointer_sz = sizeof(pointer_t);
+				desc.standard_index.key_mode = KeyMode::key_mode_direct;
+				desc.standard_index.key_type = KeyType::key_type_sequential;
+
+				desc.standard_index.max_capacity = (uint32_t)node_t::Data;
+				desc.standard_index.min_capacity = (uint16_t)0;
+
+				desc.standard_index.max_page = (uint32_t)sizeof(node_t);
+				desc.standard_index.min_page = (uint16_t)-1;
+
+				desc.standard_index.link_count = node_t::Links;
+			}
+		}
+
+	private:
+
+		template < bool lock_v > static void _Lock(node_t* n)
+		{
+			if constexpr (lock_v)
+				n->Lock();
+		}
+
+		template < bool lock_v > static void _Unlock(node_t* n)
+		{
+			if constexpr (lock_v)
+				n->Unlock();
+		}
+
+		template < bool lock_v > link_t _Allocate(size_t level)
+		{
+			node_t* n;
+
+			if constexpr (lock_v)
+				n = &io->template RecycleLock<node_t>();
+			else
+				n = &io->template Recycle<node_t>();
+
+			n->Init();
+			n->links[level_l] = (link_t)level;
+
+			return (link_t)io->template Index<node_t>(*n);
+		}
+
+		//Returns the locked leaf where a lookup of k starts:
+		//
+
+		template < bool lock_v > node_t* _Leaf(std::string_view k) const
+		{
+			node_t* n = Root();
+			_Lock<lock_v>(n);
+
+			while (Level(n))
+			{
+				Position entry;
+				bool last;
+
+				node_t* child = Node(n->template Route<false>(k, entry, last));
+
+				_Lock<lock_v>(child);
+				_Unlock<lock_v>(n);
+
+				n = child;
+			}
+
+			return n;
+		}
+
+		template < bool lock_v > node_t* _Next(node_t* n) const
+		{
+			if (!n->links[next_l])
+				return nullptr;
+
+			node_t* next = Node(n->links[next_l]);
+
+			_Lock<lock_v>(next);
+			_Unlock<lock_v>(n);
+
+			return next;
+		}
+
+		template < bool lock_v > pointer_t* _Find(std::string_view k) const
+		{
+			if (k.size() > max_key_c)
+				return nullptr;
+
+			char key[max_key_c];
+			Position before;
+
+			node_t* n = _Leaf<lock_v>(k);
+			Position at = n->template Seek<false>(k, key, before);
+
+			while (!at.valid)
+			{
+				node_t* next = _Next<lock_v>(n);
+
+				if (!next)
+					break;
+
+				n = next;
+				at = n->template Seek<false>(k, key, before);
+			}
+
+			pointer_t* result = (at.valid && std::string_view(key, at.length) == k) ? n->PointerAt(at.pointer) : nullptr;
+
+			_Unlock<lock_v>(n);
+
+			return result;
+		}
+
+		/*
+			The locked root is full, copy it into a new unit and make the root its parent.
+		*/
+
+		template < bool lock_v > void _Grow()
+		{
+			link_t copy_id = _Allocate<lock_v>(Level(Root()));
+
+			node_t* root = Root();
+			node_t* copy = Node(copy_id);
+
+			memcpy(copy->data, root->data, node_t::Data);
+			copy->count = root->count;
+			copy->used = root->used;
+			copy->restarts = root->restarts;
+
+			root->links[level_l]++;
+			root->Load(run_t{ { std::string(), (pointer_t)copy_id } });
+		}
+
+		/*
+			Moves the upper entries of the locked child into a new locked sibling placed after it in the parent.
+			Returns the sibling and its separator, the allocation can remap so callers refresh their node pointers.
+		*/
+
+		template < bool lock_v > std::pair<link_t, std::string> _Split(link_t parent_id, const Position& entry, link_t id, bool tail)
+		{
+			link_t sibling_id = _Allocate<lock_v>(Level(Node(id)));
+
+			node_t* parent = Node(parent_id);
+			node_t* n = Node(id);
+			node_t* s = Node(sibling_id);
+
+			_Lock<lock_v>(s);
+
+			std::string separator = n->Split(*s, tail);
+
+			if (!Level(n))
+			{
+				s->links[next_l] = n->links[next_l];
+				s->links[prev_l] = id;
+
+				if (s->links[next_l])
+				{
+					node_t* next = Node(s->links[next_l]);
+
+					_Lock<lock_v>(next);
+					next->links[prev_l] = sibling_id;
+					_Unlock<lock_v>(next);
+				}
+
+				n->links[next_l] = sibling_id;
+			}
+
+			parent->InsertAfter(entry, separator, (pointer_t)sibling_id);
+
+			return { sibling_id, std::move(separator) };
+		}
+
+		template < bool lock_v, typename F > auto _Insert(std::string_view k, const pointer_t& p, F&& f)
+		{
+			if (k.size() > max_key_c)
+				throw std::runtime_error("Key exceeds the block limit");
+
+			link_t id = root_n;
+
+			_Lock<lock_v>(Root());
+
+			if (Root()->Full())
+				_Grow<lock_v>();
+
+			bool tail = true;
+
+			while (Level(Node(id)))
+			{
+				node_t* n = Node(id);
+
+				Position entry;
+				bool last;
+
+				link_t child_id = n->template Route<true>(k, entry, last);
+				node_t* child = Node(child_id);
+
+				_Lock<lock_v>(child);
+
+				if (child->Full())
+				{
+					char key[max_key_c];
+					Position before;
+
+					bool append = tail && last && !child->template Seek<false>(k, key, before).valid;
+					auto [sibling_id, separator] = _Split<lock_v>(id, entry, child_id, append);
+
+					n = Node(id);
+
+					if (std::string_view(separator) <= k)
+					{
+						_Unlock<lock_v>(Node(child_id));
+						child_id = sibling_id;
+					}
+					else
+					{
+						_Unlock<lock_v>(Node(sibling_id));
+						last = false;
+					}
+				}
+
+				tail = tail && last;
+
+				_Unlock<lock_v>(n);
+				id = child_id;
+			}
+
+			node_t* leaf = Node(id);
+
+			auto overwrite = leaf->Insert(k, p);
+			auto result = f(overwrite);
+
+			_Unlock<lock_v>(leaf);
+
+			return result;
+		}
+
+		template < bool lock_v, typename F > size_t _EraseIf(F&& f, std::string_view k)
+		{
+			if (k.size() > max_key_c)
+				return 0;
+
+			node_t* n = _Leaf<lock_v>(k);
+			size_t erased = 0;
+
+			for (bool more = true; more;)
+			{
+				erased += n->Erase(k, f, more);
+
+				if (!more)
+					break;
+
+				node_t* next = _Next<lock_v>(n);
+
+				if (!next)
+					break;
+
+				n = next;
+			}
+
+			_Unlock<lock_v>(n);
+
+			return erased;
+		}
+
+		node_t* _First() const
+		{
+			node_t* n = Root();
+
+			while (Level(n))
+			{
+				pointer_t p;
+				memcpy(&p, n->data + n->PointerOf(0, 0), sizeof(pointer_t));
+
+				n = Node((link_t)p);
+			}
+
+			return n;
+		}
+
+		//Walks the leaves from the first entry not below k:
+		//
+
+		template < typename F > void _Scan(std::string_view k, F&& f) const
+		{
+			if (k.size() > max_key_c)
+				return;
+
+			char key[max_key_c];
+			Position before;
+
+			node_t* n = _Leaf<false>(k);
+			uint32_t offset = n->template Seek<false>(k, key, before).offset;
+
+			for (; n; n = _Next<false>(n), offset = 0)
+				if (!n->Each(f, offset, key))
+					return;
+		}
+
+		bool _Validate(link_t id, size_t level, const std::string* low, const std::string* high, link_t& last) const
+		{
+			node_t* n = Node(id);
+
+			if (Level(n) != level || !n->Validate())
+				return false;
+
+			if (level && !n->count)
+				return false;
+
+			run_t run;
+			n->Unpack(run);
+
+			//The first inner key is not a separator:
+			//
+
+			for (size_t i = (level) ? 1 : 0; i < run.size(); i++)
+			{
+				if (i > ((level) ? 1u : 0u))
+				{
+					int c = run[i - 1].first.compare(run[i].first);
+
+					if (c > 0 || (c == 0 && !node_t::Multi))
+						return false;
+				}
+
+				if (low && run[i].first < *low)
+					return false;
+
+				if (high && run[i].first > *high)
+					return false;
+			}
+
+			if (!level)
+			{
+				if (n->links[prev_l] != last || (last && Node(last)->links[next_l] != id))
+					return false;
+
+				last = id;
+
+				return true;
+			}
+
+			for (size_t j = 0; j < run.size(); j++)
+				if (!_Validate((link_t)run[j].second, level - 1, (j) ? &run[j].first : low, (j + 1 < run.size()) ? &run[j + 1].first : high, last))
+					return false;
+
+			return true;
+		}
+
+	public:
+
+		bool Validate() const
+		{
+			link_t last = 0;
+
+			if (!_Validate(root_n, Level(Root()), nullptr, nullptr, last))
+				return false;
+
+			return !last || !Node(last)->links[next_l];
+		}
+
+		size_t Depth() const
+		{
+			return Level(Root()) + 1;
+		}
+
+		//Bytes in use and bytes available over every block:
+		//
+
+		std::pair<uint64_t, uint64_t> Population() const
+		{
+			auto sum = std::make_pair(uint64_t(0), uint64_t(0));
+
+			std::vector<link_t> stack = { root_n };
+
+			while (stack.size())
+			{
+				node_t* n = Node(stack.back());
+				stack.pop_back();
+
+				sum.first += n->used + n->restarts * sizeof(typename node_t::offset_t);
+				sum.second += node_t::Data;
+
+				if (Level(n))
+					n->Each([&](std::string_view, pointer_t& p) { stack.push_back((link_t)p); return true; });
+			}
+
+			return sum;
+		}
+
+		template < typename F > int Iterate(F&& f) const
+		{
+			int count = 0;
+
+			for (node_t* n = _First(); n; n = (n->links[next_l]) ? Node(n->links[next_l]) : nullptr)
+				if (!n->Each([&](std::string_view, pointer_t& p) { count++; return f(p); }))
+					return count;
+
+			return count;
+		}
+
+		template < typename F > int IterateKV(F&& f) const
+		{
+			int count = 0;
+
+			for (node_t* n = _First(); n; n = (n->links[next_l]) ? Node(n->links[next_l]) : nullptr)
+				if (!n->Each([&](std::string_view k, pointer_t& p) { count++; return f(k, p); }))
+					return count;
+
+			return count;
+		}
+
+		pointer_t* Find(std::string_view k) const
+		{
+			return _Find<false>(k);
+		}
+
+		pointer_t* FindLock(std::string_view k) const
+		{
+			return _Find<true>(k);
+		}
+
+		template <typename F> void MultiFind(F&& f, std::string_view k) const
+		{
+			_Scan(k, [&](std::string_view e, pointer_t& p) { return e == k && f(&p); });
+		}
+
+		template <typename F> void RangeFind(F&& f, std::string_view low_k, std::string_view high_k) const
+		{
+			_Scan(low_k, [&](std::string_view e, pointer_t& p)
+			{
+				if (e > high_k)
+					return false;
+
+				f(e, p);
+
+				return true;
+			});
+		}
+
+		pair<pointer_t*, bool> Insert(std::string_view k, const pointer_t& p)
+		{
+			return _Insert<false>(k, p, [](auto r) { return r; });
+		}
+
+		pair<pointer_t*, bool> InsertLock(std::string_view k, const pointer_t& p)
+		{
+			return _Insert<true>(k, p, [](auto r) { return r; });
+		}
+
+		template <typename F> pair<pointer_t*, bool> InsertLockContext(std::string_view k, const pointer_t& p, F&& f)
+		{
+			return _Insert<true>(k, p, f);
+		}
+
+		size_t Erase(std::string_view k)
+		{
+			return _EraseIf<false>([](auto*) { return true; }, k);
+		}
+
+		template <typename F> size_t EraseIf(F&& f, std::string_view k)
+		{
+			return _EraseIf<false>(f, k);
+		}
+
+		size_t EraseLock(std::string_view k)
+		{
+			return _EraseIf<true>([](auto*) { return true; }, k);
+		}
+
+		template <typename F> size_t EraseIfLock(F&& f, std::string_view k)
+		{
+			return _EraseIf<true>(f, k);
+		}
+	};
+
+	template < typename R, typename N > using PrefixTree = _PrefixTree<R, N>;
+}
@@ -0,0 +1,1032 @@
+/* Copyright (C) 2020 D8DATAWORKS - All Rights Reserved */
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <type_traits>
+#include <emmintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "keys.hpp"
+#include "types.hpp"
+
+namespace tdb
+{
+	using namespace std;
+
+	/*
+		Radix bytes of integer keys, most significant first so byte order is key order.
+		Signed keys flip their sign bit, segments are ordered by where they start.
+	*/
+
+	template < typename int_t > uint64_t _RadixBits(int_t v)
+	{
+		uint64_t bits = (uint64_t)(std::make_unsigned_t<int_t>)v;
+
+		if constexpr (std::is_signed_v<int_t>)
+			bits ^= 1ull << (sizeof(int_t) * 8 - 1);
+
+		return bits;
+	}
+
+	template < typename key_t > struct _RadixKey;
+
+	template < typename int_t > struct _RadixKey< _IntWrapper<int_t> >
+	{
+		static const size_t width = sizeof(int_t);
+		static const bool interval = false;
+
+		static uint64_t Bits(const _IntWrapper<int_t>& k)
+		{
+			return _RadixBits(k.key);
+		}
+	};
+
+	template < typename int_t > struct _RadixKey< _Segment<int_t> >
+	{
+		static const size_t width = sizeof(int_t);
+		static const bool interval = true;
+
+		static uint64_t Bits(const _Segment<int_t>& k)
+		{
+			return _RadixBits(k.start);
+		}
+
+		//The last position the segment covers, empty segments cover their start:
+		//
+
+		static uint64_t Last(const _Segment<int_t>& k)
+		{
+			return _RadixBits((int_t)(k.start + ((k.length) ? k.length - 1 : 0)));
+		}
+	};
+
+	enum _RadixNodeType : uint8_t
+	{
+		radix_node4,
+		radix_node16,
+		radix_node48,
+		radix_node256,
+	};
+
+	/*
+		Inner nodes keep the whole compressed path, keys are at most 8 bytes so the prefix always fits.
+		next chains freed and retired nodes for the allocator, lookups never read it.
+	*/
+
+	struct _RadixInner
+	{
+		uint8_t type;
+		uint8_t prefix_length;
+		uint16_t count;
+		uint32_t reserved;
+		uint8_t prefix[8];
+		uint64_t next;
+	};
+
+	//Node4 and Node16 append children unsorted so a reader never sees a half shifted array:
+	//
+
+	template < size_t c > struct _RadixList : _RadixInner
+	{
+		uint8_t keys[(c < 8) ? 8 : c];
+		uint64_t children[c];
+	};
+
+	struct _RadixNode48 : _RadixInner
+	{
+		uint8_t index[256];
+		uint64_t children[48];
+	};
+
+	struct _RadixNode256 : _RadixInner
+	{
+		uint64_t children[256];
+	};
+
+	static_assert(sizeof(_RadixInner) == 24);
+	static_assert(sizeof(_RadixList<4>) == 64);
+
+	/*
+		Adaptive radix tree ( Node4 / Node16 / Node48 / Node256 ) over integer and segment keys.
+
+		Nodes and leaves are carved out of recycler units, a reference is ( unit << unit bits ) | offset and leaves set the low bit.
+		The header takes the index slot and holds the root, the bump unit and the per node type free lists.
+		Paths are compressed and leaves are created lazily, a leaf holds the full key and its pointer.
+
+		FindLock and RangeFind may run beside InsertLock. Writers serialize on the header, children are published with release
+		stores and a node that is replaced by a larger one ( or a copy with a shorter prefix ) is retired, not freed.
+		Retired nodes are reused after Reclaim, which must not race readers. Insert frees them immediately.
+
+		Keys are unique, inserting a present key returns its pointer and true like _BTree. Segment lookups return the stored
+		segment overlapping the one asked for, stored segments are expected not to overlap each other.
+	*/
+
+	template < typename R, typename key_t, typename pointer_t = uint64_t > class _RadixTree
+	{
+		using traits_t = _RadixKey<key_t>;
+
+		static const size_t width_c = traits_t::width;
+		static const size_t types_c = 4;
+
+		static_assert(width_c <= 8, "Radix keys are at most 64 bits");
+		static_assert(key_t::mode == KeyMode::key_mode_direct, "Radix trees index key bytes, not what they point to");
+
+		static constexpr size_t _Shift(size_t v)
+		{
+			size_t s = 0;
+
+			while ((1ull << s) < v)
+				s++;
+
+			return s;
+		}
+
+		static const size_t unit_shift_c = _Shift(R::UnitSize);
+		static const uint64_t offset_mask_c = (R::UnitSize - 1) & ~15ull;
+		static const uint64_t leaf_tag_c = 1;
+
+		static_assert((1ull << unit_shift_c) == R::UnitSize, "Units must be a power of two");
+
+		struct _Leaf
+		{
+			key_t key;
+			pointer_t value;
+		};
+
+		static constexpr size_t _Round(size_t v)
+		{
+			return (v + 15) & ~(size_t)15;
+		}
+
+		static const size_t leaf_size_c = _Round(sizeof(_Leaf));
+
+		static constexpr size_t type_size_c[types_c] = { _Round(sizeof(_RadixList<4>)), _Round(sizeof(_RadixList<16>)), _Round(sizeof(_RadixNode48)), _Round(sizeof(_RadixNode256)) };
+		static constexpr size_t capacity_c[types_c] = { 4, 16, 48, 256 };
+
+		//An insert allocates at most a leaf, a Node4 and one copied node:
+		//
+
+		static const size_t reserve_c = leaf_size_c + type_size_c[radix_node4] + type_size_c[radix_node256];
+
+		static_assert(reserve_c <= R::UnitSize);
+
+		struct _Header
+		{
+			uint64_t root = 0;
+			uint64_t count = 0;
+			std::atomic<uint32_t> writer = 0;
+			uint32_t reserved = 0;
+			uint64_t unit = 0;
+			uint64_t used = 0;
+			uint64_t free[types_c] = { 0 };
+			uint64_t retired[types_c] = { 0 };
+		};
+
+		R* io = nullptr;
+		uint64_t header_n = 0;
+
+		_Header& Header() const
+		{
+			return io->template Lookup<_Header>(header_n);
+		}
+
+		static uint8_t Byte(uint64_t bits, size_t depth)
+		{
+			return (uint8_t)(bits >> (8 * (width_c - 1 - depth)));
+		}
+
+		static uint64_t Place(uint8_t b, size_t depth)
+		{
+			return (uint64_t)b << (8 * (width_c - 1 - depth));
+		}
+
+		//Largest key sharing the first known bytes of path:
+		//
+
+		static uint64_t High(uint64_t path, size_t known)
+		{
+			size_t bits = 8 * (width_c - known);
+
+			return path | ((bits >= 64) ? ~0ull : ((1ull << bits) - 1));
+		}
+
+		static bool IsLeaf(uint64_t ref)
+		{
+			return (ref & leaf_tag_c) != 0;
+		}
+
+		static uint64_t _Load(const uint64_t& slot)
+		{
+			return ((const std::atomic<uint64_t>*)&slot)->load(std::memory_order_acquire);
+		}
+
+		static void _Store(uint64_t& slot, uint64_t ref)
+		{
+			((std::atomic<uint64_t>*)&slot)->store(ref, std::memory_order_release);
+		}
+
+		static int _Count(const _RadixInner* node)
+		{
+			return ((const std::atomic<uint16_t>*)&node->count)->load(std::memory_order_acquire);
+		}
+
+		static int Lowest(uint32_t mask)
+		{
+#ifdef _MSC_VER
+			unsigned long r;
+			_BitScanForward(&r, mask);
+			return (int)r;
+#else
+			return __builtin_ctz(mask);
+#endif
+		}
+
+		uint8_t* Resolve(uint64_t ref) const
+		{
+			return io->template Lookup<typename R::Unit>(ref >> unit_shift_c).data() + (ref & offset_mask_c);
+		}
+
+		_RadixInner* Inner(uint64_t ref) const
+		{
+			return (_RadixInner*)Resolve(ref);
+		}
+
+		_Leaf& Leaf(uint64_t ref) const
+		{
+			return *((_Leaf*)Resolve(ref));
+		}
+
+		/*
+			Allocation, every insert reserves room for its worst case first so nothing remaps while it holds node pointers.
+		*/
+
+		template < bool lock_v > void _Reserve()
+		{
+			auto& header = Header();
+
+			if (header.unit && header.used + reserve_c <= R::UnitSize)
+				return;
+
+			typename R::Unit* unit;
+
+			if constexpr (lock_v)
+				unit = io->AllocateSpanLock(1);
+			else
+				unit = io->AllocateSpan(1);
+
+			uint64_t n = io->IndexUnit(*unit);
+
+			auto& fresh = Header();
+			fresh.unit = n;
+			fresh.used = 0;
+		}
+
+		uint64_t _Bump(size_t size)
+		{
+			auto& header = Header();
+			uint64_t ref = (header.unit << unit_shift_c) | header.used;
+
+			header.used += size;
+
+			return ref;
+		}
+
+		_RadixInner* _Node(uint64_t& ref, uint8_t type)
+		{
+			auto& header = Header();
+
+			if (header.free[type])
+			{
+				ref = header.free[type];
+				header.free[type] = Inner(ref)->next;
+			}
+			else
+				ref = _Bump(type_size_c[type]);
+
+			auto node = Inner(ref);
+			std::memset(node, 0, type_size_c[type]);
+			node->type = type;
+
+			return node;
+		}
+
+		uint64_t _NewLeaf(const key_t& k, const pointer_t& p)
+		{
+			uint64_t ref = _Bump(leaf_size_c);
+
+			auto& leaf = Leaf(ref);
+			leaf.key = k;
+			leaf.value = p;
+
+			return ref | leaf_tag_c;
+		}
+
+		template < bool lock_v > void _Release(uint64_t ref)
+		{
+			auto& header = Header();
+			auto node = Inner(ref);
+			auto& list = (lock_v) ? header.retired[node->type] : header.free[node->type];
+
+			node->next = list;
+			list = ref;
+		}
+
+		/*
+			Children:
+		*/
+
+		uint64_t* _Child(_RadixInner* node, uint8_t b) const
+		{
+			switch (node->type)
+			{
+			case radix_node4:
+			{
+				auto list = (_RadixList<4>*)node;
+				int count = _Count(node);
+
+				for (int i = 0; i < count; i++)
+					if (list->keys[i] == b)
+						return list->children + i;
+
+				return nullptr;
+			}
+			case radix_node16:
+			{
+				auto list = (_RadixList<16>*)node;
+				int count = _Count(node);
+
+				uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8((char)b), _mm_loadu_si128((const __m128i*)list->keys)));
+				mask &= (1u << count) - 1;
+
+				return (mask) ? list->children + Lowest(mask) : nullptr;
+			}
+			case radix_node48:
+			{
+				auto n48 = (_RadixNode48*)node;
+				uint8_t i = ((std::atomic<uint8_t>*)(n48->index + b))->load(std::memory_order_acquire);
+
+				return (i) ? n48->children + i - 1 : nullptr;
+			}
+			default:
+			{
+				auto n256 = (_RadixNode256*)node;
+
+				return (_Load(n256->children[b])) ? n256->children + b : nullptr;
+			}
+			}
+		}
+
+		//Callers hold the writer side and checked the node has room:
+		//
+
+		void _AddChild(_RadixInner* node, uint8_t b, uint64_t ref)
+		{
+			uint16_t count = node->count;
+
+			switch (node->type)
+			{
+			case radix_node4:
+			{
+				auto list = (_RadixList<4>*)node;
+				list->children[count] = ref;
+				list->keys[count] = b;
+				break;
+			}
+			case radix_node16:
+			{
+				auto list = (_RadixList<16>*)node;
+				list->children[count] = ref;
+				list->keys[count] = b;
+				break;
+			}
+			case radix_node48:
+			{
+				auto n48 = (_RadixNode48*)node;
+				n48->children[count] = ref;
+				((std::atomic<uint8_t>*)(n48->index + b))->store((uint8_t)(count + 1), std::memory_order_release);
+				break;
+			}
+			default:
+				_Store(((_RadixNode256*)node)->children[b], ref);
+				break;
+			}
+
+			((std::atomic<uint16_t>*)&node->count)->store(count + 1, std::memory_order_release);
+		}
+
+		//Visits children in key byte order:
+		//
+
+		template < typename F > bool _Sorted(_RadixInner* node, F&& f) const
+		{
+			switch (node->type)
+			{
+			case radix_node4:
+			case radix_node16:
+			{
+				auto keys = (node->type == radix_node4) ? ((_RadixList<4>*)node)->keys : ((_RadixList<16>*)node)->keys;
+				auto children = (node->type == radix_node4) ? ((_RadixList<4>*)node)->children : ((_RadixList<16>*)node)->children;
+				int count = _Count(node);
+
+				uint8_t order[16];
+				for (int i = 0; i < count; i++)
+				{
+					int j = i;
+					for (; j > 0 && keys[order[j - 1]] > keys[i]; j--)
+						order[j] = order[j - 1];
+
+					order[j] = (uint8_t)i;
+				}
+
+				for (int i = 0; i < count; i++)
+					if (!f(keys[order[i]], _Load(children[order[i]])))
+						return false;
+
+				return true;
+			}
+			case radix_node48:
+			{
+				auto n48 = (_RadixNode48*)node;
+
+				for (int b = 0; b < 256; b++)
+				{
+					uint8_t i = ((std::atomic<uint8_t>*)(n48->index + b))->load(std::memory_order_acquire);
+
+					if (i && !f((uint8_t)b, _Load(n48->children[i - 1])))
+						return false;
+				}
+
+				return true;
+			}
+			default:
+			{
+				auto n256 = (_RadixNode256*)node;
+
+				for (int b = 0; b < 256; b++)
+				{
+					uint64_t child = _Load(n256->children[b]);
+
+					if (child && !f((uint8_t)b, child))
+						return false;
+				}
+
+				return true;
+			}
+			}
+		}
+
+		//The child with the largest key byte not above b, or 0:
+		//
+
+		uint64_t _Prev(_RadixInner* node, int b, uint8_t& at) const
+		{
+			switch (node->type)
+			{
+			case radix_node4:
+			case radix_node16:
+			{
+				auto keys = (node->type == radix_node4) ? ((_RadixList<4>*)node)->keys : ((_RadixList<16>*)node)->keys;
+				auto children = (node->type == radix_node4) ? ((_RadixList<4>*)node)->children : ((_RadixList<16>*)node)->children;
+				int count = _Count(node), best = -1;
+
+				for (int i = 0; i < count; i++)
+					if (keys[i] <= b && (best < 0 || keys[i] > keys[best]))
+						best = i;
+
+				if (best < 0)
+					return 0;
+
+				at = keys[best];
+				return _Load(children[best]);
+			}
+			case radix_node48:
+			{
+				auto n48 = (_RadixNode48*)node;
+
+				for (; b >= 0; b--)
+				{
+					uint8_t i = ((std::atomic<uint8_t>*)(n48->index + b))->load(std::memory_order_acquire);
+
+					if (i)
+					{
+						at = (uint8_t)b;
+						return _Load(n48->children[i - 1]);
+					}
+				}
+
+				return 0;
+			}
+			default:
+			{
+				auto n256 = (_RadixNode256*)node;
+
+				for (; b >= 0; b--)
+				{
+					if (uint64_t child = _Load(n256->children[b]))
+					{
+						at = (uint8_t)b;
+						return child;
+					}
+				}
+
+				return 0;
+			}
+			}
+		}
+
+		uint64_t _Grow(_RadixInner* node)
+		{
+			uint64_t ref;
+			auto bigger = _Node(ref, node->type + 1);
+
+			bigger->prefix_length = node->prefix_length;
+			std::memcpy(bigger->prefix, node->prefix, sizeof(node->prefix));
+
+			_Sorted(node, [&](uint8_t b, uint64_t child)
+			{
+				_AddChild(bigger, b, child);
+				return true;
+			});
+
+			return ref;
+		}
+
+		template < bool lock_v > pair<pointer_t*, bool> _Insert(const key_t& k, const pointer_t& p)
+		{
+			_Reserve<lock_v>();
+
+			auto& header = Header();
+			uint64_t bits = traits_t::Bits(k);
+			uint64_t* slot = &header.root;
+			size_t depth = 0;
+
+			while (true)
+			{
+				uint64_t ref = _Load(*slot);
+
+				if (!ref)
+				{
+					uint64_t fresh = _NewLeaf(k, p);
+					_Store(*slot, fresh);
+					header.count++;
+
+					return { &Leaf(fresh).value, false };
+				}
+
+				if (IsLeaf(ref))
+				{
+					auto& leaf = Leaf(ref);
+					uint64_t other = traits_t::Bits(leaf.key);
+
+					if (other == bits)
+						return { &leaf.value, true };
+
+					//Lazy expansion, the two leaves share bytes up to d:
+					//
+
+					size_t d = depth;
+					while (Byte(other, d) == Byte(bits, d))
+						d++;
+
+					uint64_t inner;
+					auto node = _Node(inner, radix_node4);
+
+					node->prefix_length = (uint8_t)(d - depth);
+					for (size_t i = depth; i < d; i++)
+						node->prefix[i - depth] = Byte(bits, i);
+
+					uint64_t fresh = _NewLeaf(k, p);
+					_AddChild(node, Byte(other, d), ref);
+					_AddChild(node, Byte(bits, d), fresh);
+
+					_Store(*slot, inner);
+					header.count++;
+
+					return { &Leaf(fresh).value, false };
+				}
+
+				auto node = Inner(ref);
+				size_t length = node->prefix_length, i = 0;
+
+				while (i < length && node->prefix[i] == Byte(bits, depth + i))
+					i++;
+
+				if (i < length)
+				{
+					//The compressed path diverges at i, a Node4 takes the shared part and the node keeps what follows i:
+					//
+
+					uint64_t inner;
+					auto split = _Node(inner, radix_node4);
+
+					split->prefix_length = (uint8_t)i;
+					std::memcpy(split->prefix, node->prefix, i);
+
+					uint8_t b = node->prefix[i];
+					uint64_t moved = ref;
+					_RadixInner* tail = node;
+
+					if constexpr (lock_v)
+					{
+						tail = _Node(moved, node->type);
+						std::memcpy(tail, node, type_size_c[node->type]);
+					}
+
+					tail->prefix_length = (uint8_t)(length - i - 1);
+					std::memmove(tail->prefix, node->prefix + i + 1, length - i - 1);
+
+					uint64_t fresh = _NewLeaf(k, p);
+					_AddChild(split, b, moved);
+					_AddChild(split, Byte(bits, depth + i), fresh);
+
+					_Store(*slot, inner);
+					header.count++;
+
+					if constexpr (lock_v)
+						_Release<lock_v>(ref);
+
+					return { &Leaf(fresh).value, false };
+				}
+
+				depth += length;
+
+				uint8_t b = Byte(bits, depth);
+
+				if (auto child = _Child(node, b))
+				{
+					slot = child;
+					depth++;
+					continue;
+				}
+
+				uint64_t fresh = _NewLeaf(k, p);
+
+				if (node->count < capacity_c[node->type])
+					_AddChild(node, b, fresh);
+				else
+				{
+					uint64_t bigger = _Grow(node);
+					_AddChild(Inner(bigger), b, fresh);
+
+					_Store(*slot, bigger);
+					_Release<lock_v>(ref);
+				}
+
+				header.count++;
+
+				return { &Leaf(fresh).value, false };
+			}
+		}
+
+		//Largest leaf not above bound:
+		//
+
+		_Leaf* _Floor(uint64_t ref, uint64_t path, size_t depth, uint64_t bound) const
+		{
+			if (!ref)
+				return nullptr;
+
+			if (IsLeaf(ref))
+			{
+				auto& leaf = Leaf(ref);
+
+				return (traits_t::Bits(leaf.key) <= bound) ? &leaf : nullptr;
+			}
+
+			auto node = Inner(ref);
+
+			for (size_t i = 0; i < node->prefix_length; i++)
+				path |= Place(node->prefix[i], depth + i);
+
+			depth += node->prefix_length;
+
+			if (path > bound)
+				return nullptr;
+
+			int b = (High(path, depth) <= bound) ? 255 : Byte(bound, depth);
+			uint8_t at = 0;
+
+			for (uint64_t child; b >= 0 && (child = _Prev(node, b, at)); b = (int)at - 1)
+				if (auto leaf = _Floor(child, path | Place(at, depth), depth + 1, bound))
+					return leaf;
+
+			return nullptr;
+		}
+
+		template < typename F > void _Range(uint64_t ref, uint64_t path, size_t depth, uint64_t low, uint64_t high, F&& f) const
+		{
+			if (IsLeaf(ref))
+			{
+				auto& leaf = Leaf(ref);
+				uint64_t bits = traits_t::Bits(leaf.key);
+
+				if (bits >= low && bits <= high)
+					f(leaf.key, leaf.value);
+
+				return;
+			}
+
+			auto node = Inner(ref);
+
+			for (size_t i = 0; i < node->prefix_length; i++)
+				path |= Place(node->prefix[i], depth + i);
+
+			depth += node->prefix_length;
+
+			if (High(path, depth) < low || path > high)
+				return;
+
+			_Sorted(node, [&](uint8_t b, uint64_t child)
+			{
+				uint64_t next = path | Place(b, depth);
+
+				if (next > high)
+					return false;
+
+				if (High(next, depth + 1) >= low)
+					_Range(child, next, depth + 1, low, high, f);
+
+				return true;
+			});
+		}
+
+		template < typename F > bool _Walk(uint64_t ref, F&& f, int& count) const
+		{
+			if (IsLeaf(ref))
+			{
+				count++;
+				auto& leaf = Leaf(ref);
+
+				return f(leaf.key, leaf.value);
+			}
+
+			return _Sorted(Inner(ref), [&](uint8_t b, uint64_t child)
+			{
+				return _Walk(child, f, count);
+			});
+		}
+
+		bool _Validate(uint64_t ref, uint64_t path, size_t depth, uint64_t& leaves) const
+		{
+			if (IsLeaf(ref))
+			{
+				leaves++;
+
+				uint64_t bits = traits_t::Bits(Leaf(ref).key);
+
+				return depth == 0 || (bits & ~High(0, depth)) == path;
+			}
+
+			auto node = Inner(ref);
+
+			if (node->type >= types_c || node->count < 2 || node->count > capacity_c[node->type])
+				return false;
+
+			for (size_t i = 0; i < node->prefix_length; i++)
+				path |= Place(node->prefix[i], depth + i);
+
+			depth += node->prefix_length;
+
+			if (depth >= width_c)
+				return false;
+
+			int seen = 0, last = -1;
+			bool ok = _Sorted(node, [&](uint8_t b, uint64_t child)
+			{
+				seen++;
+
+				if ((int)b <= last || !child)
+					return false;
+
+				last = b;
+
+				return _Validate(child, path | Place(b, depth), depth + 1, leaves);
+			});
+
+			return ok && seen == node->count;
+		}
+
+	public:
+		_RadixTree() {}
+
+		void Open(R* _io, size_t& _n)
+		{
+			header_n = _n++;
+			io = _io;
+
+			if (io->size() <= header_n)
+			{
+				io->template Allocate<_Header>();
+
+				/*
+					Runtime Introspection:
+				*/
+
+				auto& desc = io->GetDescriptor(header_n);
+
+				desc.type = TableType::radix_tree;
+
+				desc.standard_index.self_balanced = (uint32_t)true;
+				desc.standard_index.requires_distributed_key = (uint32_t)false;
+
+				desc.standard_index.key_sz = sizeof(key_t);
+				desc.standard_index.link_sz = sizeof(uint64_t);
+				desc.standard_index.pointer_sz = sizeof(pointer_t);
+				desc.standard_index.key_mode = key_t::mode;
+				desc.standard_index.key_type = key_t::type;
+				desc.standard_index.hash_policy = _KeyHashPolicy<key_t>::value;
+
+				desc.standard_index.max_capacity = (uint32_t)capacity_c[radix_node256];
+				desc.standard_index.min_capacity = (uint16_t)capacity_c[radix_node4];
+
+				desc.standard_index.max_page = (uint32_t)type_size_c[radix_node256];
+				desc.standard_index.min_page = (uint16_t)leaf_size_c;
+
+				desc.standard_index.link_count = 0;
+			}
+			else if (io->GetDescriptor(header_n).type != TableType::radix_tree)
+				throw std::runtime_error("Index is not a radix tree");
+		}
+
+		uint64_t size() const
+		{
+			return Header().count;
+		}
+
+		pointer_t* Find(const key_t& k, void* ref_page = nullptr) const
+		{
+			auto& header = Header();
+
+			if constexpr (traits_t::interval)
+			{
+				auto leaf = _Floor(_Load(header.root), 0, 0, traits_t::Last(k));
+
+				return (leaf && leaf->key.Compare(k, (void*)io, ref_page) == 0) ? &leaf->value : nullptr;
+			}
+			else
+			{
+				uint64_t bits = traits_t::Bits(k);
+				uint64_t ref = _Load(header.root);
+				size_t depth = 0;
+
+				//Prefixes aren't compared on the way down, the leaf holds the whole key:
+				//
+
+				while (ref && !IsLeaf(ref))
+				{
+					auto node = Inner(ref);
+					depth += node->prefix_length;
+
+					auto slot = _Child(node, Byte(bits, depth++));
+
+					if (!slot)
+						return nullptr;
+
+					ref = _Load(*slot);
+				}
+
+				if (!ref)
+					return nullptr;
+
+				auto& leaf = Leaf(ref);
+
+				return (traits_t::Bits(leaf.key) == bits) ? &leaf.value : nullptr;
+			}
+		}
+
+		pointer_t* FindLock(const key_t& k, void* ref_page = nullptr) const
+		{
+			return Find(k, ref_page);
+		}
+
+		template <typename F> void MultiFind(F&& f, const key_t& k, void* ref_page = nullptr) const
+		{
+			if (auto v = Find(k, ref_page))
+				f(v);
+		}
+
+		//Calls f( key, pointer ) in key order for every key from low_k to high_k, segments overlapping low_k included:
+		//
+
+		template <typename F> void RangeFind(F&& f, const key_t& low_k, const key_t& high_k, void* ref_page = nullptr) const
+		{
+			uint64_t root = _Load(Header().root);
+
+			if (!root)
+				return;
+
+			uint64_t low = traits_t::Bits(low_k), high;
+
+			if constexpr (traits_t::interval)
+			{
+				high = traits_t::Last(high_k);
+
+				auto leaf = _Floor(root, 0, 0, low);
+
+				if (leaf && leaf->key.Compare(low_k, (void*)io, ref_page) == 0)
+					low = traits_t::Bits(leaf->key);
+			}
+			else
+				high = traits_t::Bits(high_k);
+
+			if (low <= high)
+				_Range(root, 0, 0, low, high, f);
+		}
+
+		pair<pointer_t*, bool> Insert(const key_t& k, const pointer_t& p)
+		{
+			return _Insert<false>(k, p);
+		}
+
+		void Insert(const gsl::span<key_t>& ks, const pointer_t& p)
+		{
+			for (auto& k : ks)
+				Insert(k, p);
+		}
+
+		pair<pointer_t*, bool> InsertLock(const key_t& k, const pointer_t& p)
+		{
+			auto& writer = Header().writer;
+			uint32_t expected = 0;
+
+			while (!writer.compare_exchange_weak(expected, 1, std::memory_order_acquire))
+			{
+				expected = 0;
+				std::this_thread::yield();
+			}
+
+			auto result = _Insert<true>(k, p);
+
+			Header().writer.store(0, std::memory_order_release);
+
+			return result;
+		}
+
+		void InsertLock(const gsl::span<key_t>& ks, const pointer_t& p)
+		{
+			for (auto& k : ks)
+				InsertLock(k, p);
+		}
+
+		//Nodes retired by InsertLock become reusable, no reader may be inside the tree:
+		//
+
+		void Reclaim()
+		{
+			auto& header = Header();
+
+			for (size_t t = 0; t < types_c; t++)
+			{
+				while (uint64_t ref = header.retired[t])
+				{
+					header.retired[t] = Inner(ref)->next;
+					Inner(ref)->next = header.free[t];
+					header.free[t] = ref;
+				}
+			}
+		}
+
+		template < typename F > int Iterate(F&& f) const
+		{
+			int count = 0;
+			uint64_t root = _Load(Header().root);
+
+			if (root)
+				_Walk(root, [&](auto& k, auto& v) { return f(v); }, count);
+
+			return count;
+		}
+
+		template < typename F > int IterateKV(F&& f) const
+		{
+			int count = 0;
+			uint64_t root = _Load(Header().root);
+
+			if (root)
+				_Walk(root, f, count);
+
+			return count;
+		}
+
+		bool Validate() const
+		{
+			uint64_t root = _Load(Header().root), leaves = 0;
+
+			if (!root)
+				return Header().count == 0;
+
+			return _Validate(root, 0, 0, leaves) && leaves == Header().count;
+		}
+	};
+
+	template < typename R, typename key_t, typename pointer_t = uint64_t > using RadixTree = _RadixTree<R, key_t, pointer_t>;
+	template < typename R, typename int_t > using RadixIntKey = _RadixTree<R, _IntWrapper<int_t>, Key32>;
+	template < typename R, typename int_t > using RadixSegmentPointer = _RadixTree<R, _Segment<int_t>, uint64_t>;
+}
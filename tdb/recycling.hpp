@@ -5,6 +5,7 @@
 #include <array>
 #include <stdexcept>
 #include <atomic>
+#include <mutex>
 
 namespace tdb
 {
@@ -40,18 +41,30 @@ namespace tdb
 
 					uint8_t link_count;
 					uint8_t pointer_mode;
+					uint8_t hash_policy;
 
-					uint8_t unused[5];
+					//Longest key of a variable length index, whose key_sz is 0:
+					//
+
+					uint16_t max_key_sz;
+
+					uint8_t unused[2];
 				} standard_index;
 
 				struct
 				{
-					uint32_t flags : 32;
+					uint32_t deferred : 16;
+					uint32_t flags : 16;
 					uint32_t max_rows;
 
 					uint8_t index_count;
 
-					uint8_t unused[19];
+					uint64_t indexed;
+					uint64_t building;
+
+					uint16_t detached;
+
+					uint8_t unused[1];
 				} standard_table;
 
 				uint32_t custom[7] = { 0 };
@@ -83,9 +96,12 @@ namespace tdb
 
 		static_assert(sizeof(_Header) == 16 * 1024);
 
+		std::mutex free_lock;
+
 	public:
 
 		static const auto UnitSize = unit_t;
+		static const bool StableAddresses = M::stable_addresses;
 
 		_Descriptor& GetDescriptor(size_t dx)
 		{
@@ -237,6 +253,16 @@ namespace tdb
 			Header().inuse--;
 		}
 
+		void FreeUnitLock(Unit& u)
+		{
+			std::lock_guard<std::mutex> lock(free_lock);
+
+			u.Pointer() = Header().free;
+			Header().free = IndexUnit(u);
+
+			HeaderLock().inuse--;
+		}
+
 		void FreeIndex(uint64_t idx)
 		{
 			if(InvalidIndex(idx))
@@ -322,6 +348,52 @@ namespace tdb
 			return IndexUnit(*((Unit*)&t));
 		}
 
+		/*
+			Recycle pulls single unit objects from the free list before growing the map.
+			Units on the free list may sit beyond Header().count ( incidental pages are not counted ),
+			so they are looked up directly rather than through LookupUnit.
+		*/
+
+		template < typename T > T& Recycle()
+		{
+			static_assert(sizeof(T) <= sizeof(Unit));
+
+			if (Header().free == null_t)
+				return Allocate<T>();
+
+			auto& u = Lookup<Unit>(Header().free);
+
+			Header().free = u.Pointer();
+			Header().inuse++;
+
+			new(&u) T();
+
+			return *((T*)&u);
+		}
+
+		template < typename T > T& RecycleLock()
+		{
+			static_assert(sizeof(T) <= sizeof(Unit));
+
+			{
+				std::lock_guard<std::mutex> lock(free_lock);
+
+				if (Header().free != null_t)
+				{
+					auto& u = Lookup<Unit>(Header().free);
+
+					Header().free = u.Pointer();
+					HeaderLock().inuse++;
+
+					new(&u) T();
+
+					return *((T*)&u);
+				}
+			}
+
+			return AllocateLock<T>();
+		}
+
 		template <typename J, typename ... t_args> J& Construct(t_args ... args)
 		{
 			auto r = Allocate(sizeof(J));
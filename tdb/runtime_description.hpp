@@ -22,7 +22,10 @@ namespace tdb
 			result += "Balance Algorithm: " + ((desc.standard_index.self_balanced) ? "True" : "False") + "\r\n";
 			result += "Distributed Key: " + ((desc.standard_index.requires_distributed_key) ? "True" : "False") + "\r\n";
 
-			result += "Key Size: " + std::to_string(desc.standard_index.key_sz) + "\r\n";
+			if (desc.standard_index.key_sz)
+				result += "Key Size: " + std::to_string(desc.standard_index.key_sz) + "\r\n";
+			else
+				result += "Key Size: Variable, Up To " + std::to_string(desc.standard_index.max_key_sz) + "\r\n";
 			result += "Pointer Size: " + std::to_string(desc.standard_index.pointer_sz) + "\r\n";
 			result += "Link Size: " + std::to_string(desc.standard_index.link_sz) + "\r\n";
 			result += "Link Count: " + std::to_string(desc.standard_index.link_count) + "\r\n";
@@ -85,6 +88,20 @@ namespace tdb
 				result += "Pointer Mode: Table Row\r\n";
 				break;
 			};
+
+			switch (desc.standard_index.hash_policy)
+			{
+			default:
+			case undefined_hash_policy:
+				result += "Hash Policy: None\r\n";
+				break;
+			case hash_policy_sha2:
+				result += "Hash Policy: SHA-2\r\n";
+				break;
+			case hash_policy_fast:
+				result += "Hash Policy: Fast\r\n";
+				break;
+			};
 		};
 
 		switch (desc.type)
@@ -106,6 +123,34 @@ namespace tdb
 			result += "Type: BTREE Hashmap\r\n";
 			about_index();
 			break;
+		case btree_taggedmap:
+			result += "Type: BTREE Tagged Hashmap\r\n";
+			about_index();
+			break;
+		case btree_prefix_block:
+			result += "Type: BTREE Prefix Block\r\n";
+			about_index();
+			break;
+		case btree_prefix_multiblock:
+			result += "Type: BTREE Prefix Multiblock\r\n";
+			about_index();
+			break;
+		case radix_tree:
+			result += "Type: Adaptive Radix Tree\r\n";
+			about_index();
+			break;
+		case interval_tree:
+			result += "Type: Interval Tree\r\n";
+			about_index();
+			break;
+		case learned_index:
+			result += "Type: Learned Index\r\n";
+			about_index();
+			break;
+		case packed_tree:
+			result += "Type: Packed B+Tree\r\n";
+			about_index();
+			break;
 		case table_fixed:
 			result += "Type: Fixed TABLE\r\n";
 			break;
@@ -115,6 +160,9 @@ namespace tdb
 		case table_surrogate:
 			result += "Type: Surrogate TABLE\r\n";
 			break;
+		case reserved_slot:
+			result += "Type: Reserved\r\n";
+			break;
 		}
 
 		return result;
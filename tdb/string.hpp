@@ -122,6 +122,7 @@ namespace tdb
 			else
 			{
 				std::set<typename int_t::Key> found;
+				std::vector<int_t> batch;
 
 				for (size_t i = 0; i < k.size() - lim_c + 1; i++)
 				{
@@ -131,9 +132,11 @@ namespace tdb
 					if (found.find(kk.key) == found.end())
 					{
 						found.insert(kk.key);
-						bucket.Stream(kk, on_result);
+						batch.push_back(kk);
 					}
 				}
+
+				bucket.StreamBatch(gsl::span<const int_t>(batch.data(), batch.size()), on_result);
 			}
 
 			std::vector<V> result(_result.size());
@@ -2,31 +2,426 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 #include "types.hpp"
+#include "parallel.hpp"
+#include "host.hpp"
 
 namespace tdb
 {
 	using namespace std;
 
-	template < typename R, typename element_t, typename ... index_t > class _Table
+	/*
+		Deferred indexes skip inline maintenance for rows at or past from, BuildIndexes brings them level with the table.
+		Rows below from are already in every index, writes there stay inline.
+
+		Detached indexes skip every row, they were attached to a populated table or dropped and wait for CreateIndex.
+	*/
+
+	struct _Deferral
+	{
+		uint32_t mask = 0;
+		uint64_t from = 0;
+		uint16_t detached = 0;
+
+		bool Skips(size_t i, uint64_t row) const
+		{
+			return ((detached >> i) & 1) || (((mask >> i) & 1) && row >= from);
+		}
+	};
+
+	template < typename T, typename K, typename = void > struct _BulkLoads : std::false_type {};
+	template < typename T, typename K > struct _BulkLoads< T, K, std::void_t<typename T::Key, decltype(T::bulk_load_c)> > : std::bool_constant< std::is_same_v<typename T::Key, K> && T::bulk_load_c > {};
+
+	struct _AnyPointer
+	{
+		template < typename P > bool operator()(P*) const { return true; }
+	};
+
+	template < typename T, typename K, typename = void > struct _MultiFinds : std::false_type {};
+	template < typename T, typename K > struct _MultiFinds< T, K, std::void_t<decltype(std::declval<T&>().MultiFind(_AnyPointer(), std::declval<const K&>()))> > : std::true_type {};
+
+	//Trees say whether they keep duplicates, anything else with a MultiFind is assumed to:
+	//
+
+	template < typename T, typename K, typename = void > struct _Duplicates : _MultiFinds<T, K> {};
+	template < typename T, typename K > struct _Duplicates< T, K, std::void_t<decltype(T::multi_c)> > : std::bool_constant<T::multi_c> {};
+
+	//Indexes that can hand their units back, the only ones DropIndex takes:
+	//
+
+	template < typename T, typename = void > struct _Drops : std::false_type {};
+	template < typename T > struct _Drops< T, std::void_t<decltype(std::declval<T&>().Drop())> > : std::true_type {};
+
+	/*
+		Builds the deferred indexes from rows [from, rows) one batch at a time. Keys are pulled out of the rows by a pool of
+		threads, then each deferred index takes the batch on the calling thread. A first build into empty indexes is one batch
+		of every row, indexes that can BulkLoad sort it and load bottom up, the rest get Insert. A unique index ends up with the
+		lowest row of each key either way, the same row inline maintenance would have kept.
+
+		The table descriptor keeps the mask ( deferred ), the watermark ( indexed ) and the end of the batch in flight
+		( building ). A build that was cut short picks up at the watermark. Rows of the unfinished batch that already reached a
+		duplicate keeping index are skipped when the index can MultiFind their key, a unique index already ignores the second
+		insert.
+	*/
+
+	template < typename keys_t, typename link_t, typename ... index_t > class _IndexBuild
+	{
+		template < size_t I > using kv_t = std::vector< std::pair< std::tuple_element_t<I, keys_t>, link_t > >;
+		template < size_t ... I > static auto _Batches(std::index_sequence<I...>) -> std::tuple< kv_t<I>... >;
+
+		using batches_t = decltype(_Batches(std::index_sequence_for<index_t...>()));
+
+		template < size_t ... I > static void _Reserve(batches_t& kv, uint32_t mask, size_t n, std::index_sequence<I...>)
+		{
+			((((mask >> I) & 1) ? std::get<I>(kv).resize(n) : void()), ...);
+		}
+
+		template < size_t ... I > static void _Scatter(batches_t& kv, uint32_t mask, keys_t& ks, size_t i, link_t v, std::index_sequence<I...>)
+		{
+			((((mask >> I) & 1) ? void(std::get<I>(kv)[i] = std::make_pair(std::get<I>(ks), v)) : void()), ...);
+		}
+
+		template < typename T, typename K > static bool _Has(T& index, const K& k, link_t v)
+		{
+			bool has = false;
+
+			index.MultiFind([&](auto* p) { has = (*p == v); return !has; }, k);
+
+			return has;
+		}
+
+		template < size_t I, typename T > static void _Load(T& index, kv_t<I>& kv, const std::vector<uint8_t>& present, bool bulk, bool resumed)
+		{
+			using K = std::tuple_element_t<I, keys_t>;
+
+			size_t n = 0;
+
+			for (size_t i = 0; i < kv.size(); i++)
+			{
+				if (present[i])
+					kv[n++] = std::move(kv[i]);
+			}
+
+			kv.resize(n);
+
+			if constexpr (_BulkLoads<T, K>::value)
+			{
+				//The batch is in row order, and a unique tree's BulkLoad keeps the first pair of each key:
+				//
+
+				if (bulk)
+				{
+					index.BulkLoad(gsl::span< std::pair<K, link_t> >(kv), false);
+					return;
+				}
+			}
+
+			for (auto& e : kv)
+			{
+				if constexpr (_Duplicates<T, K>::value)
+				{
+					if (resumed && _Has(index, e.first, e.second))
+						continue;
+				}
+
+				index.Insert(e.first, e.second);
+			}
+		}
+
+		template < size_t ... I > static void _LoadAll(std::tuple<index_t...>& indexes, batches_t& kv, uint32_t mask, const std::vector<uint8_t>& present, bool bulk, bool resumed, std::index_sequence<I...>)
+		{
+			((((mask >> I) & 1) ? _Load<I>(std::get<I>(indexes), std::get<I>(kv), present, bulk, resumed) : void()), ...);
+		}
+
+	public:
+
+		//row(i, keys) fills the keys of row i, false for an empty slot. desc() resolves the table's descriptor:
+		//
+
+		template < typename D, typename F > static size_t Run(std::tuple<index_t...>& indexes, _Deferral& deferral, D&& desc, uint64_t rows, size_t threads, size_t batch, F&& row)
+		{
+			auto seq = std::index_sequence_for<index_t...>();
+			size_t built = 0;
+
+			threads = std::max<size_t>(threads, 1);
+			batch = std::max<size_t>(batch, 1);
+
+			bool resumed = desc().building > deferral.from;
+			bool bulk = !deferral.from && !resumed;
+
+			while (deferral.mask && deferral.from < rows)
+			{
+				uint64_t from = deferral.from;
+				uint64_t to = (bulk) ? rows : std::min<uint64_t>(rows, from + batch);
+				size_t n = (size_t)(to - from);
+
+				desc().building = to;
+
+				batches_t kv;
+				std::vector<uint8_t> present(n);
+
+				_Reserve(kv, deferral.mask, n, seq);
+
+				std::exception_ptr error;
+				std::mutex error_lock;
+				std::vector<std::thread> workers;
+
+				size_t step = (n + threads - 1) / threads;
+
+				for (size_t t = 0; t * step < n; t++)
+				{
+					workers.emplace_back([&, t]()
+					{
+						try
+						{
+							keys_t ks;
+
+							for (size_t i = t * step; i < std::min(n, (t + 1) * step); i++)
+							{
+								if ((present[i] = row(from + i, ks)))
+									_Scatter(kv, deferral.mask, ks, i, (link_t)(from + i), seq);
+							}
+						}
+						catch (...)
+						{
+							std::lock_guard<std::mutex> l(error_lock);
+							error = std::current_exception();
+						}
+					});
+				}
+
+				for (auto& w : workers)
+					w.join();
+
+				if (error)
+					std::rethrow_exception(error);
+
+				_LoadAll(indexes, kv, deferral.mask, present, bulk, resumed, seq);
+
+				deferral.from = to;
+				desc().indexed = to;
+
+				built += n;
+				bulk = resumed = false;
+			}
+
+			deferral.mask = 0;
+			desc().deferred = 0;
+
+			return built;
+		}
+	};
+
+	/*
+		Moves index maintenance off the writer. Each index gets its own worker that applies every row's key to it with
+		InsertLock, in append order, through a bounded queue that blocks the writer once the slowest index falls depth rows behind.
+		Workers descend from the root like any locked writer, the tail appends of ordered indexes only serve single writer Emplace.
+		Indexes lag the rows until Sync returns, which also rethrows the first insert that failed.
+	*/
+
+	template < typename keys_t, typename link_t, typename ... index_t > class _IndexPipeline
+	{
+		using row_t = std::pair<keys_t, link_t>;
+
+		std::tuple<index_t...>& indexes;
+		const _Deferral& deferral;
+		BroadcastQueue<row_t> queue;
+		std::vector<std::thread> workers;
+
+		std::mutex error_lock;
+		std::exception_ptr error;
+
+		template < size_t I > void _Worker()
+		{
+			while (queue.Consume(I, [&](row_t& row)
+			{
+				try
+				{
+					if (!deferral.Skips(I, row.second))
+						std::get<I>(indexes).InsertLock(std::get<I>(row.first), row.second);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> l(error_lock);
+
+					if (!error)
+						error = std::current_exception();
+				}
+			}));
+		}
+
+		template < size_t ... I > void _Start(std::index_sequence<I...>)
+		{
+			(workers.emplace_back([this]() { _Worker<I>(); }), ...);
+		}
+
+	public:
+
+		_IndexPipeline(std::tuple<index_t...>& _indexes, const _Deferral& _deferral, size_t depth)
+			: indexes(_indexes)
+			, deferral(_deferral)
+			, queue(depth, sizeof...(index_t))
+		{
+			_Start(std::index_sequence_for<index_t...>());
+		}
+
+		~_IndexPipeline()
+		{
+			queue.Close();
+
+			for (auto& w : workers)
+				w.join();
+		}
+
+		void Push(keys_t&& ks, link_t v)
+		{
+			queue.Push(std::make_pair(std::move(ks), v));
+		}
+
+		void Sync()
+		{
+			queue.Drain();
+
+			std::lock_guard<std::mutex> l(error_lock);
+
+			if (error)
+				std::rethrow_exception(std::exchange(error, nullptr));
+		}
+	};
+
+	/*
+		Lock free steps of concurrent appends. _ClaimLock resolves a link slot to a unit of T, the first writer to find it empty
+		marks it claimed and allocates, everyone else spins until the link lands. _GrowLock raises a capacity to at least count.
+	*/
+
+	template < typename T, typename R, typename link_t > link_t _ClaimLock(R* io, link_t& slot)
+	{
+		constexpr link_t claimed_c = (link_t)-1;
+
+		auto s = (std::atomic<link_t>*) & slot;
+
+		while (true)
+		{
+			link_t id = s->load(std::memory_order_acquire);
+
+			if (id && id != claimed_c)
+				return id;
+
+			if (!id && s->compare_exchange_strong(id, claimed_c))
+			{
+				id = (link_t)io->template Index<T>(io->template AllocateLock<T>());
+				s->store(id, std::memory_order_release);
+
+				return id;
+			}
+
+			std::this_thread::yield();
+		}
+	}
+
+	template < typename int_t > void _GrowLock(int_t& capacity, size_t count)
 	{
+		auto c = (std::atomic<int_t>*) & capacity;
+		int_t current = c->load();
+
+		while (current < (int_t)count && !c->compare_exchange_weak(current, (int_t)count));
+	}
+
+	/*
+		Index state every table shares: the indexes, which of them are deferred or detached, and the pipeline feeding them.
+		table_t only supplies its rows, through size(), _Appended() ( the row appends start at ) and _RowKeys(i, keys), which
+		fills the keys of row i and returns false for an empty slot.
+	*/
+
+	template < typename table_t, typename R, typename element_t, typename ... index_t > class _IndexedTable
+	{
+	protected:
 		using link_t = typename element_t::Link;
-		using int_t = typename element_t::Int;
-		static const size_t max_pages = element_t::max_pages;
-		static const size_t page_elements = element_t::page_elements;
-		static const size_t lookup_padding = element_t::lookup_padding;
-		static const size_t page_padding = element_t::page_padding;
+		using keys_t = std::decay_t<decltype(std::declval<element_t&>().Keys(uint64_t()))>;
+		using pipeline_t = _IndexPipeline<keys_t, link_t, index_t...>;
+
+		static_assert(sizeof...(index_t) <= 16, "The descriptor keeps deferred and detached bits for 16 indexes");
+
+		R* io = nullptr;
+		link_t root_n;
 
 		std::tuple<index_t...> indexes;
 
-		template < typename T > void InstallIndex(T& t, size_t& n)
+		std::shared_ptr<pipeline_t> pipeline;
+		_Deferral deferral;
+		std::array<size_t, sizeof...(index_t)> slots = {};
+
+		table_t& _Self()
+		{
+			return *static_cast<table_t*>(this);
+		}
+
+		auto& _Desc()
 		{
+			return io->GetDescriptor(root_n).standard_table;
+		}
+
+		/*
+			An index opened on a slot ReserveTables held starts out empty and detached. Anything that leaves one of its slots
+			reserved can't take a slot over and is refused, rather than reading the placeholder as an index.
+		*/
+
+		template < size_t I, typename T > void InstallIndex(T& t, size_t& n)
+		{
+			size_t first = slots[I] = n;
+			bool reserved = io->size() > first && io->GetDescriptor(first).type == TableType::reserved_slot;
+
 			t.Open(io, n);
+
+			if constexpr (!_Reserves<T>::value)
+			{
+				for (size_t s = first; s < n; s++)
+				{
+					if (io->GetDescriptor(s).type == TableType::reserved_slot)
+						throw std::runtime_error("Index can't attach to a reserved slot");
+				}
+
+				if (reserved)
+					deferral.detached |= 1 << I;
+			}
+		}
+
+		template < size_t ... I > void _Install(size_t& n, std::index_sequence<I...>)
+		{
+			(InstallIndex<I>(std::get<I>(indexes), n), ...);
+		}
+
+		//Opens the indexes in the slots after the table's own, picking up where the last session left the deferrals:
+		//
+
+		void _Open(size_t& n)
+		{
+			auto& desc = _Desc();
+
+			deferral.mask = desc.deferred;
+			deferral.from = desc.indexed;
+			deferral.detached = desc.detached;
+
+			_Install(n, std::index_sequence_for<index_t...>());
+
+			_Desc().detached = deferral.detached;
 		}
 
 		template<size_t I = 0, typename... Tkey,typename... Tidx> void InsertIndex(const std::tuple<Tkey...>& ks, std::tuple<Tidx...> & dx, link_t v)
 		{
-			std::get<I>(dx).Insert(std::get<I>(ks), v);
+			if (!deferral.Skips(I, v))
+				std::get<I>(dx).Insert(std::get<I>(ks), v);
 
 			if constexpr (I + 1 != sizeof...(Tidx))
 				InsertIndex<I + 1>(ks,dx,v);
@@ -34,19 +429,159 @@ namespace tdb
 
 		template<size_t I = 0, typename... Tkey, typename... Tidx> void InsertIndexLock(const std::tuple<Tkey...>& ks, std::tuple<Tidx...>& dx, link_t v)
 		{
-			std::get<I>(dx).InsertLock(std::get<I>(ks), v);
+			if (!deferral.Skips(I, v))
+				std::get<I>(dx).InsertLock(std::get<I>(ks), v);
 
 			if constexpr (I + 1 != sizeof...(Tidx))
-				InsertIndexLock<I + 1>(ks, dx);
+				InsertIndexLock<I + 1>(ks, dx, v);
 		}
 
-		void _Open(size_t & n)
+		template < bool lock_v > void _IndexRow(keys_t ks, link_t v)
 		{
-			std::apply([&](auto& ...x) { (InstallIndex(x, n), ...); }, indexes);
+			if (pipeline)
+				pipeline->Push(std::move(ks), v);
+			else if constexpr (lock_v)
+				InsertIndexLock<>(ks, indexes, v);
+			else
+				InsertIndex<>(ks, indexes, v);
 		}
 
-		R* io = nullptr;
-		link_t root_n;
+	public:
+
+		template<size_t DX> auto& Index()
+		{
+			return std::get<DX>(indexes);
+		}
+
+		//Hands index maintenance to one worker per index, rows are indexed in the background until SerialIndexes.
+		//Call Sync before reading any index:
+		//
+
+		void PipelineIndexes(size_t depth = 4096)
+		{
+			static_assert(R::StableAddresses, "Index workers need a map that never moves on growth");
+
+			SerialIndexes();
+			pipeline = std::make_shared<pipeline_t>(indexes, deferral, depth);
+		}
+
+		void SerialIndexes()
+		{
+			Sync();
+			pipeline.reset();
+		}
+
+		void Sync()
+		{
+			if (pipeline)
+				pipeline->Sync();
+		}
+
+		/*
+			Rows appended from here on skip the indexes in mask ( bit I for index I ) until BuildIndexes. Finds on those indexes
+			only see the older rows. Anything still deferred is built first.
+		*/
+
+		void DeferIndexes(uint32_t mask)
+		{
+			BuildIndexes();
+
+			deferral.mask = mask & ~(uint32_t)deferral.detached;
+			deferral.from = _Self()._Appended();
+
+			auto& desc = _Desc();
+
+			desc.deferred = deferral.mask;
+			desc.indexed = desc.building = deferral.from;
+		}
+
+		//Brings the deferred indexes up to date and back to inline maintenance, see _IndexBuild. Returns the rows scanned:
+		//
+
+		size_t BuildIndexes(size_t threads = std::thread::hardware_concurrency(), size_t batch = 1024 * 1024)
+		{
+			Sync();
+
+			return _IndexBuild<keys_t, link_t, index_t...>::Run(indexes, deferral, [&]() -> auto& { return _Desc(); }, (uint64_t)_Self().size(), threads, batch, [&](uint64_t i, keys_t& ks)
+			{
+				return _Self()._RowKeys(i, ks);
+			});
+		}
+
+		/*
+			Frees index I's units and detaches it, inserts skip it and Finds on it come back empty until CreateIndex<I>.
+			Reopening with ReserveTables in its place keeps the slot for a later schema.
+		*/
+
+		template < size_t I > void DropIndex()
+		{
+			static_assert(_Drops< std::tuple_element_t<I, std::tuple<index_t...>> >::value, "Index can't be dropped");
+
+			Sync();
+
+			std::get<I>(indexes).Drop();
+
+			deferral.detached |= 1 << I;
+			deferral.mask &= ~(1u << I);
+
+			auto& desc = _Desc();
+
+			desc.detached = deferral.detached;
+			desc.deferred = deferral.mask;
+		}
+
+		/*
+			Fills detached index I from every row and puts it back on inline maintenance. Pending deferrals are built first, then
+			the rows are read by a pool of threads and, for indexes that can, bulk loaded in one pass ( see _IndexBuild ).
+			Returns the rows scanned, 0 when the index is attached already.
+		*/
+
+		template < size_t I > size_t CreateIndex(size_t threads = std::thread::hardware_concurrency())
+		{
+			if (!((deferral.detached >> I) & 1))
+				return 0;
+
+			BuildIndexes(threads);
+
+			if (io->GetDescriptor(slots[I]).type == TableType::reserved_slot)
+			{
+				size_t n = slots[I];
+				std::get<I>(indexes).Open(io, n);
+			}
+
+			deferral.detached &= ~(1 << I);
+			deferral.mask = 1u << I;
+			deferral.from = 0;
+
+			auto& desc = _Desc();
+
+			desc.detached = deferral.detached;
+			desc.deferred = deferral.mask;
+			desc.indexed = desc.building = 0;
+
+			return BuildIndexes(threads);
+		}
+	};
+
+	template < typename R, typename element_t, typename ... index_t > class _Table : public _IndexedTable<_Table<R, element_t, index_t...>, R, element_t, index_t...>
+	{
+		using link_t = typename element_t::Link;
+		using int_t = typename element_t::Int;
+		static const size_t max_pages = element_t::max_pages;
+		static const size_t page_elements = element_t::page_elements;
+		static const size_t lookup_padding = element_t::lookup_padding;
+		static const size_t page_padding = element_t::page_padding;
+
+		using base_t = _IndexedTable<_Table<R, element_t, index_t...>, R, element_t, index_t...>;
+
+		friend base_t;
+
+		using base_t::io;
+		using base_t::root_n;
+		using base_t::indexes;
+		using base_t::pipeline;
+		using base_t::deferral;
+		using base_t::_Open;
 
 #pragma pack(push,1)
 
@@ -82,6 +617,19 @@ namespace tdb
 			return &io->template Lookup<lookup_t>(root_n);
 		}
 
+		//Row accessors for _IndexedTable:
+		//
+
+		uint64_t _Appended() { return (uint64_t)size(); }
+
+		template < typename keys_t > bool _RowKeys(uint64_t i, keys_t& ks)
+		{
+			auto p = &At(i);
+			ks = p->Keys(io->GetReference((uint8_t*)p));
+
+			return true;
+		}
+
 	public:
 
 		_Table() {}
@@ -165,13 +713,17 @@ namespace tdb
 			return At(index);
 		}
 
-		template<size_t DX> auto& Index()
-		{
-			return std::get<DX>(indexes);
-		}
+		//Single writer append, ordered indexes start ascending keys at their tail ( see _BTree ). A running pipeline makes it EmplaceLock:
+		//
 
 		template <typename ... t_args> element_t& Emplace(t_args ... args)
 		{
+			if constexpr (R::StableAddresses)
+			{
+				if (pipeline)
+					return EmplaceLock(args...);
+			}
+
 			auto r = Root();
 
 			if (r->used >= r->capacity)
@@ -185,7 +737,7 @@ namespace tdb
 
 			new(p) element_t(args...);
 
-			InsertIndex<>(p->Keys(io->GetReference((uint8_t*)p)),indexes, r->used++);
+			this->template InsertIndex<>(p->Keys(io->GetReference((uint8_t*)p)),indexes, r->used++);
 
 			return *p;
 		}
@@ -195,8 +747,16 @@ namespace tdb
 			return Find<I>(0, (void*)ref);
 		}
 
+		//The check reads index 0, which has to hold every row. Sync drains the pipeline, a deferred or detached index 0 is refused:
+		//
+
 		template <typename K, typename ... t_args> std::pair<int_t, bool> EmplaceIf(const K & k, t_args &&... args)
 		{
+			if ((deferral.mask | deferral.detached) & 1)
+				throw std::runtime_error("EmplaceIf needs index 0 up to date");
+
+			this->Sync();
+
 			auto dx = std::get<0>(indexes).Find(k);
 
 			if (!dx)
@@ -231,26 +791,41 @@ namespace tdb
 			} ,k, ref);
 		}
 
-		//TODO
-		/*template <typename ... t_args> element_t& EmplaceLock(t_args ... args)
+		/*
+			Concurrent appends reserve a row by bumping used. The first writer to reach an empty page slot claims it and allocates
+			the page ( _ClaimLock ), the others wait for the claim to resolve. Rows are built in place and then inserted into every
+			index with InsertLock, a reserved row reads as default constructed until its writer is done with it.
+			InsertLock descends from the root, so ordered indexes don't get Emplace's tail appends here.
+			Don't mix with Emplace or resize while writers are running.
+		*/
+
+		template <typename ... t_args> element_t& EmplaceLock(t_args ... args)
 		{
-			//TODO Make this lock free
-			auto r = Root();
+			static_assert(R::StableAddresses, "Concurrent appends need a map that never moves on growth");
 
-			if (r->used >= r->capacity)
-				resize(r->used + 1);
+			auto used = (std::atomic<int_t>*) & Root()->used;
+			auto index = (size_t)used->fetch_add(1);
 
-			auto page = r->used / page_elements;
-			auto element = (r->used)++ % page_elements;
+			if (index >= max_pages * page_elements)
+			{
+				used->fetch_sub(1);
+				throw std::runtime_error("Out of bounds");
+			}
 
-			auto p = &r->pages[page].elements[element];
+			auto page = index / page_elements;
+			auto element = index % page_elements;
+
+			auto id = _ClaimLock<page_t>(io, Root()->pages[page]);
+			_GrowLock(Root()->capacity, (page + 1) * page_elements);
+
+			auto p = io->template Lookup<page_t>(id).elements + element;
 
 			new(p) element_t(args...);
 
-			//std::apply([&](auto& ...x) {(InsertLockIndex(*p, x), ...); }, indexes);
+			this->template _IndexRow<true>(p->Keys(io->GetReference((uint8_t*)p)), (link_t)index);
 
 			return *p;
-		}*/
+		}
 	};
 
 
@@ -288,7 +863,7 @@ namespace tdb
 
 
 
-	template < typename R, typename element_t, typename ... index_t > class _GrowingTable
+	template < typename R, typename element_t, typename ... index_t > class _GrowingTable : public _IndexedTable<_GrowingTable<R, element_t, index_t...>, R, element_t, index_t...>
 	{
 		using link_t = typename element_t::Link;
 		using int_t = typename element_t::Int;
@@ -297,36 +872,16 @@ namespace tdb
 		static const size_t lookup_padding = element_t::lookup_padding;
 		static const size_t page_padding = element_t::page_padding;
 
-		std::tuple<index_t...> indexes;
-
-		template < typename T > void InstallIndex(T& t, size_t& n)
-		{
-			t.Open(io, n);
-		}
+		using base_t = _IndexedTable<_GrowingTable<R, element_t, index_t...>, R, element_t, index_t...>;
 
-		template<size_t I = 0, typename... Tkey, typename... Tidx> void InsertIndex(const std::tuple<Tkey...>& ks, std::tuple<Tidx...>& dx, link_t v)
-		{
-			std::get<I>(dx).Insert(std::get<I>(ks), v);
+		friend base_t;
 
-			if constexpr (I + 1 != sizeof...(Tidx))
-				InsertIndex<I + 1>(ks, dx, v);
-		}
-
-		template<size_t I = 0, typename... Tkey, typename... Tidx> void InsertIndexLock(const std::tuple<Tkey...>& ks, std::tuple<Tidx...>& dx, link_t v)
-		{
-			std::get<I>(dx).InsertLock(std::get<I>(ks), v);
-
-			if constexpr (I + 1 != sizeof...(Tidx))
-				InsertIndexLock<I + 1>(ks, dx);
-		}
-
-		void _Open(size_t& n)
-		{
-			std::apply([&](auto& ...x) { (InstallIndex(x, n), ...); }, indexes);
-		}
-
-		R* io = nullptr;
-		link_t root_n;
+		using base_t::io;
+		using base_t::root_n;
+		using base_t::indexes;
+		using base_t::pipeline;
+		using base_t::deferral;
+		using base_t::_Open;
 
 #pragma pack(push,1)
 
@@ -364,6 +919,19 @@ namespace tdb
 			return &io->template Lookup<lookup_t>(root_n);
 		}
 
+		//Row accessors for _IndexedTable:
+		//
+
+		uint64_t _Appended() { return (uint64_t)size(); }
+
+		template < typename keys_t > bool _RowKeys(uint64_t i, keys_t& ks)
+		{
+			auto p = &At(i);
+			ks = p->Keys(io->GetReference((uint8_t*)p));
+
+			return true;
+		}
+
 	public:
 
 		_GrowingTable() {}
@@ -408,7 +976,7 @@ namespace tdb
 
 			auto r = Root();
 
-			for (size_t i = 1; i < root; i++)
+			for (size_t i = 0; i < root; i++)
 			{
 				if (!r->next)
 					r->next = io->template Index<lookup_t>(io->template Allocate<lookup_t>());
@@ -463,13 +1031,14 @@ namespace tdb
 			return At(index);
 		}
 
-		template<size_t DX> auto& Index()
-		{
-			return std::get<DX>(indexes);
-		}
-
 		template <typename ... t_args> element_t& Emplace(t_args ... args)
 		{
+			if constexpr (R::StableAddresses)
+			{
+				if (pipeline)
+					return EmplaceLock(args...);
+			}
+
 			auto r = Root();
 
 			if (r->used >= r->capacity)
@@ -482,7 +1051,36 @@ namespace tdb
 
 			new(p) element_t(args...);
 
-			InsertIndex<>(p->Keys(io->GetReference((uint8_t*)p)), indexes, r->used++);
+			this->template InsertIndex<>(p->Keys(io->GetReference((uint8_t*)p)), indexes, r->used++);
+
+			return *p;
+		}
+
+		//Concurrent appends work as in _Table, lookup units further down the chain are claimed like pages:
+		//
+
+		template <typename ... t_args> element_t& EmplaceLock(t_args ... args)
+		{
+			static_assert(R::StableAddresses, "Concurrent appends need a map that never moves on growth");
+
+			auto index = (size_t)((std::atomic<int_t>*) & Root()->used)->fetch_add(1);
+
+			auto page = index / page_elements;
+			auto element = index % page_elements;
+
+			auto r = Root();
+
+			for (size_t i = 0; i < page / max_pages; i++)
+				r = &io->template Lookup<lookup_t>(_ClaimLock<lookup_t>(io, r->next));
+
+			auto id = _ClaimLock<page_t>(io, r->pages[page % max_pages]);
+			_GrowLock(Root()->capacity, (page + 1) * page_elements);
+
+			auto p = io->template Lookup<page_t>(id).elements + element;
+
+			new(p) element_t(args...);
+
+			this->template _IndexRow<true>(p->Keys(io->GetReference((uint8_t*)p)), (link_t)index);
 
 			return *p;
 		}
@@ -511,7 +1109,7 @@ namespace tdb
 		{
 			std::get<I>(indexes).MultiFind([&, f = std::move(f)](auto* dx)
 			{
-				f(At(*dx));
+				return f(At(*dx));
 			}, k, ref);
 		}
 	};
@@ -529,7 +1127,7 @@ namespace tdb
 
 	template < typename child_t, size_t page_s = 64 * 1024, typename int_t = uint64_t> using SimpleStreamTableElementBuilder = StreamTableElementBuilder<page_s, int_t, int_t, child_t>;
 
-	template < typename R, typename element_t, typename ... index_t > class _SurrogateTable
+	template < typename R, typename element_t, typename ... index_t > class _SurrogateTable : public _IndexedTable<_SurrogateTable<R, element_t, index_t...>, R, element_t, index_t...>
 	{
 		using link_t = typename element_t::Link;
 		using int_t = typename element_t::Int;
@@ -538,12 +1136,16 @@ namespace tdb
 		static const size_t lookup_padding = element_t::lookup_padding;
 		static const size_t page_padding = element_t::page_padding;
 
-		std::tuple<index_t...> indexes;
+		using base_t = _IndexedTable<_SurrogateTable<R, element_t, index_t...>, R, element_t, index_t...>;
 
-		template < typename T > void InstallIndex(T& t, size_t& n)
-		{
-			t.Open(io, n);
-		}	
+		friend base_t;
+
+		using base_t::io;
+		using base_t::root_n;
+		using base_t::indexes;
+		using base_t::pipeline;
+		using base_t::deferral;
+		using base_t::_Open;
 
 		template < typename T > void ValidateIndex(T& t, bool& n)
 		{
@@ -552,29 +1154,6 @@ namespace tdb
 			n = t.Validate();
 		}
 
-		template<size_t I = 0, typename... Tkey, typename... Tidx> void InsertIndex(const std::tuple<Tkey...>& ks, std::tuple<Tidx...>& dx, link_t v)
-		{
-			std::get<I>(dx).Insert(std::get<I>(ks), v);
-
-			if constexpr (I + 1 != sizeof...(Tidx))
-				InsertIndex<I + 1>(ks, dx, v);
-		}
-
-		template<size_t I = 0, typename... Tkey, typename... Tidx> void InsertIndexLock(const std::tuple<Tkey...>& ks, std::tuple<Tidx...>& dx, link_t v)
-		{
-			std::get<I>(dx).InsertLock(std::get<I>(ks), v);
-
-			if constexpr (I + 1 != sizeof...(Tidx))
-				InsertIndexLock<I + 1>(ks, dx,v);
-		}
-
-		void _Open(size_t& n)
-		{
-			std::apply([&](auto& ...x) { (InstallIndex(x, n), ...); }, indexes);
-		}
-
-		R* io = nullptr;
-		link_t root_n;
 
 #pragma pack(push,1)
 
@@ -610,6 +1189,37 @@ namespace tdb
 			return &io->template Lookup<lookup_t>(root_n);
 		}
 
+		//Slots past used are only filled by EmplaceAt, the populated range ends at the last non empty slot:
+		//
+
+		uint64_t _Rows()
+		{
+			auto r = Root();
+			uint64_t n = r->capacity;
+
+			while (n > (uint64_t)r->used && !io->template Lookup<page_t>(r->pages[(n - 1) / page_elements]).elements[(n - 1) % page_elements])
+				n--;
+
+			return n;
+		}
+
+		//Row accessors for _IndexedTable, empty surrogate slots are passed over:
+		//
+
+		uint64_t _Appended() { return _Rows(); }
+
+		template < typename keys_t > bool _RowKeys(uint64_t i, keys_t& ks)
+		{
+			link_t l = io->template Lookup<page_t>(Root()->pages[i / page_elements]).elements[i % page_elements];
+
+			if (!l)
+				return false;
+
+			ks = ((element_t*)io->GetObject(l))->Keys(l);
+
+			return true;
+		}
+
 	public:
 
 		_SurrogateTable() {}
@@ -649,7 +1259,7 @@ namespace tdb
 
 		size_t size() { return (size_t)Root()->capacity; }
 
-		void resize(size_t count)
+		template < bool lock_v > void _Resize(size_t count)
 		{
 			if (count > max_pages * page_elements)
 				throw std::runtime_error("Out of bounds");
@@ -664,8 +1274,21 @@ namespace tdb
 
 			r->capacity = target_page * page_elements;
 
+			//Index workers allocate nodes concurrently:
+			//
+
 			for (size_t i = start_page; i < target_page; i++)
-				r->pages[i] = io->template Index<page_t>(io->template Allocate<page_t>());
+			{
+				if (lock_v || pipeline)
+					r->pages[i] = io->template Index<page_t>(io->template AllocateLock<page_t>());
+				else
+					r->pages[i] = io->template Index<page_t>(io->template Allocate<page_t>());
+			}
+		}
+
+		void resize(size_t count)
+		{
+			_Resize<false>(count);
 		}
 
 		element_t& At(size_t index)
@@ -687,7 +1310,7 @@ namespace tdb
 			auto page = index / page_elements;
 			auto element = index % page_elements;
 
-			return (element_t*)GetObject(io->template Lookup<page_t>(Root()->pages[page]).elements[element]);
+			return (element_t*)io->GetObject(io->template Lookup<page_t>(Root()->pages[page]).elements[element]);
 		}
 
 		element_t& operator[](size_t index)
@@ -695,11 +1318,6 @@ namespace tdb
 			return At(index);
 		}
 
-		template<size_t DX> auto& Index()
-		{
-			return std::get<DX>(indexes);
-		}
-
 		template < typename F > void Iterate(F && f)
 		{
 			for (size_t i = 0; i < size(); i++)
@@ -712,7 +1330,7 @@ namespace tdb
 			auto r = Root();
 
 			if (r->used >= r->capacity)
-				resize(r->used + 1);
+				_Resize<false>(r->used + 1);
 
 			auto page = r->used / page_elements;
 			auto element = r->used % page_elements;
@@ -726,7 +1344,7 @@ namespace tdb
 
 			auto t = new(p) element_t(args...);
 
-			InsertIndex<>(t->Keys(off), indexes, r->used++);
+			this->template _IndexRow<false>(t->Keys(off), r->used++);
 
 			return *t;
 		}
@@ -736,7 +1354,7 @@ namespace tdb
 			auto r = Root();
 
 			if (index >= r->capacity)
-				resize(index);
+				_Resize<lock_v>(index);
 
 			auto page = index / page_elements;
 			auto element = index % page_elements;
@@ -750,10 +1368,7 @@ namespace tdb
 
 			auto t = new(p) element_t(args...);
 
-			if constexpr (lock_v)
-				InsertIndexLock<>(t->Keys(off), indexes, index);
-			else
-				InsertIndex<>(t->Keys(off), indexes, index);
+			this->template _IndexRow<lock_v>(t->Keys(off), index);
 
 			return *t;
 		}
@@ -773,7 +1388,7 @@ namespace tdb
 			auto r = Root();
 
 			if (index >= r->capacity)
-				resize(index);
+				_Resize<lock_v>(index);
 
 			auto page = index / page_elements;
 			auto element = index % page_elements;
@@ -788,10 +1403,7 @@ namespace tdb
 			std::copy((uint8_t*)&copy, ((uint8_t*)&copy) + size, p);
 			auto t = (element_t*)p;
 
-			if constexpr (lock_v)
-				InsertIndexLock<>(t->Keys(off), indexes, index);
-			else
-				InsertIndex<>(t->Keys(off), indexes, index);
+			this->template _IndexRow<lock_v>(t->Keys(off), index);
 
 			return *t;
 		}
@@ -5,6 +5,13 @@
 #include "builder.hpp"
 #include "bucket.hpp"
 #include "btree.hpp"
+#include "bplus.hpp"
+#include "prefix.hpp"
+#include "bloom.hpp"
+#include "radix.hpp"
+#include "interval.hpp"
+#include "learned.hpp"
+#include "packed.hpp"
 #include "null_index.hpp"
 #include "pages.hpp"
 #include "table.hpp"
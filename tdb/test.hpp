@@ -5,6 +5,7 @@
 #include "../catch.hpp"
 
 #include <filesystem>
+#include <set>
 
 #include "tdb.hpp"
 
@@ -111,6 +112,3061 @@ TEST_CASE("Range Find", "[tdb::]")
     std::filesystem::remove_all("db.dat");
 }
 
+TEST_CASE("Erase", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+
+    using Database = DatabaseBuilder < R, BTree< R, OrderedListPointer >, BTree< R, FuzzyHashPointer > >;
+
+    enum Tables { Ordered, Hashmap };
+
+    constexpr size_t key_c = 20 * 1000;
+    auto& keys = singleton<std::array<RandomKeyT<Key32>, key_c>>();
+
+    {
+        Database db("db.dat");
+        auto& ordered = db.Table<Ordered>();
+        auto& hashmap = db.Table<Hashmap>();
+
+        for (size_t i = 0; i < key_c; i++)
+        {
+            ordered.Insert(keys[i], uint64_t(i));
+            hashmap.Insert(keys[i], uint64_t(i));
+        }
+
+        auto grown = db.Header().count;
+
+        for (size_t i = 0; i < key_c; i += 2)
+        {
+            CHECK(ordered.Erase(keys[i]) == 1);
+            CHECK(hashmap.EraseLock(keys[i]) == 1);
+        }
+
+        size_t found = 0;
+        for (size_t i = 0; i < key_c; i++)
+        {
+            if (ordered.Find(keys[i]) && hashmap.Find(keys[i]))
+                found++;
+        }
+
+        CHECK(found == key_c / 2);
+
+        size_t count = 0;
+        ordered.Iterate([&](auto& v) { count++; return true; });
+
+        CHECK(count == key_c / 2);
+
+        for (size_t i = 1; i < key_c; i += 2)
+        {
+            CHECK(ordered.Erase(keys[i]) == 1);
+            CHECK(hashmap.Erase(keys[i]) == 1);
+        }
+
+        for (size_t i = 0; i < key_c; i++)
+        {
+            CHECK(!ordered.Insert(keys[i], uint64_t(i)).second);
+            CHECK(!hashmap.InsertLock(keys[i], uint64_t(i)).second);
+        }
+
+        CHECK(db.Header().count == grown);
+
+        for (size_t i = 0; i < key_c; i += 3)
+            CHECK(hashmap.Erase(keys[i]) == 1);
+
+        std::vector<RandomKeyT<Key32>> fresh(key_c / 2);
+
+        for (auto& k : fresh)
+            CHECK(!hashmap.Insert(k, uint64_t(key_c)).second);
+
+        for (size_t i = 0; i < key_c; i++)
+            CHECK(hashmap.Insert(keys[i], uint64_t(i)).second == (i % 3 != 0));
+
+        count = 0;
+        hashmap.Iterate([&](auto& v) { count++; return true; });
+
+        CHECK(count == key_c + key_c / 2);
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Erase If", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+    using K = _IntWrapper<uint64_t>;
+
+    using Database = DatabaseBuilder < R, BTree< R, SimpleOrderedListBuilder<64 * 1024, uint64_t, K> >, BTree< R, SimpleMultiListBuilder<64 * 1024, uint64_t, K> > >;
+
+    enum Tables { Ordered, Multimap };
+
+    constexpr size_t key_c = 20 * 1000;
+    constexpr uint64_t dup_c = 4;
+
+    {
+        Database db("db.dat");
+        auto& ordered = db.Table<Ordered>();
+        auto& multimap = db.Table<Multimap>();
+
+        for (uint64_t i = 0; i < key_c; i++)
+        {
+            ordered.Insert(K(i), i);
+
+            for (uint64_t j = 0; j < dup_c; j++)
+                multimap.Insert(K(i), i * dup_c + j);
+        }
+
+        //The tombstone value is refused rather than stored as a live entry:
+        //
+
+        CHECK_THROWS(ordered.Insert(K(key_c), (uint64_t)-2));
+        CHECK_THROWS(multimap.InsertLock(K(key_c), (uint64_t)-2));
+
+        //One of several duplicates, the others stay put:
+        //
+
+        for (uint64_t i = 0; i < key_c; i++)
+        {
+            auto second = [&](auto* p) { return *p == i * dup_c + 1; };
+
+            if (i % 2)
+                CHECK(multimap.EraseIfLock(second, K(i)) == 1);
+            else
+                CHECK(multimap.EraseIf(second, K(i)) == 1);
+        }
+
+        size_t kept = 0, erased = 0;
+
+        for (uint64_t i = 0; i < key_c; i++)
+        {
+            multimap.MultiFind([&](auto* p)
+            {
+                if (*p / dup_c == i)
+                    kept++;
+
+                if (*p == i * dup_c + 1)
+                    erased++;
+
+                return true;
+            }, K(i));
+        }
+
+        CHECK(kept == key_c * (dup_c - 1));
+        CHECK(erased == 0);
+
+        //Find and iteration pass over the tombstones:
+        //
+
+        size_t found = 0;
+
+        for (uint64_t i = 0; i < key_c; i++)
+        {
+            auto p = multimap.Find(K(i));
+
+            if (p && *p / dup_c == i && *p != i * dup_c + 1)
+                found++;
+        }
+
+        CHECK(found == key_c);
+
+        size_t count = 0, tombstones = 0;
+
+        multimap.IterateKV([&](auto& k, auto& v) { count++; if (v == (uint64_t)-2) tombstones++; return true; });
+
+        CHECK(count == key_c * (dup_c - 1));
+        CHECK(tombstones == 0);
+
+        //The predicate picks what goes, a rejected entry stays findable:
+        //
+
+        for (uint64_t i = 0; i < key_c; i++)
+        {
+            CHECK(ordered.EraseIf([](auto*) { return false; }, K(i)) == 0);
+            CHECK(ordered.EraseIfLock([](auto* p) { return *p % 3 == 0; }, K(i)) == (i % 3 == 0));
+        }
+
+        size_t left = 0;
+
+        for (uint64_t i = 0; i < key_c; i++)
+        {
+            auto p = ordered.Find(K(i));
+
+            if ((p != nullptr) == (i % 3 != 0))
+                left++;
+        }
+
+        CHECK(left == key_c);
+
+        count = 0;
+        ordered.Iterate([&](auto& v) { count++; return true; });
+
+        CHECK(count == key_c - (key_c + 2) / 3);
+
+        //Erase then reinsert the same key, the new entry is the only one found:
+        //
+
+        for (uint64_t i = 0; i < key_c; i += 3)
+        {
+            CHECK(multimap.Erase(K(i)) == dup_c - 1);
+            CHECK(multimap.Find(K(i)) == nullptr);
+
+            multimap.Insert(K(i), key_c * dup_c + i);
+            ordered.Insert(K(i), key_c + i);
+        }
+
+        size_t revived = 0;
+
+        for (uint64_t i = 0; i < key_c; i += 3)
+        {
+            size_t entries = 0;
+
+            multimap.MultiFind([&](auto* p) { entries++; return true; }, K(i));
+
+            auto m = multimap.Find(K(i));
+            auto o = ordered.Find(K(i));
+
+            if (entries == 1 && m && *m == key_c * dup_c + i && o && *o == key_c + i)
+                revived++;
+        }
+
+        CHECK(revived == (key_c + 2) / 3);
+
+        //Locked erases beside locked inserts, appending fresh keys while old ones are erased or replaced:
+        //
+
+        for (uint64_t i = key_c; i < 2 * key_c; i++)
+            ordered.InsertLock(K(i), i);
+
+        std::vector<std::thread> threads;
+
+        threads.emplace_back([&]()
+        {
+            for (uint64_t i = 2 * key_c; i < 3 * key_c; i++)
+                ordered.InsertLock(K(i), i);
+        });
+
+        threads.emplace_back([&]()
+        {
+            for (uint64_t i = key_c + 1; i < 2 * key_c; i += 2)
+                ordered.EraseLock(K(i));
+        });
+
+        threads.emplace_back([&]()
+        {
+            for (uint64_t i = key_c; i < 2 * key_c; i += 2)
+            {
+                ordered.EraseIfLock([&](auto* p) { return *p == i; }, K(i));
+                ordered.InsertLock(K(i), i + 1);
+            }
+        });
+
+        for (auto& t : threads)
+            t.join();
+
+        size_t settled = 0;
+
+        for (uint64_t i = key_c; i < 3 * key_c; i++)
+        {
+            auto p = ordered.Find(K(i));
+
+            if (i >= 2 * key_c)
+                settled += p && *p == i;
+            else if (i % 2)
+                settled += !p;
+            else
+                settled += p && *p == i + 1;
+        }
+
+        CHECK(settled == 2 * key_c);
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Bulk Load", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+
+    using Database = DatabaseBuilder < R, BTree< R, OrderedListPointer >, BTree< R, FuzzyHashPointer >, BTree< R, SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> > >;
+
+    enum Tables { Ordered, Hashmap, Multimap };
+
+    constexpr size_t key_c = 100 * 1000;
+    auto& keys = singleton<std::array<RandomKeyT<Key32>, key_c>>();
+
+    {
+        Database db("db.dat");
+        auto& ordered = db.Table<Ordered>();
+        auto& hashmap = db.Table<Hashmap>();
+        auto& multimap = db.Table<Multimap>();
+
+        std::vector<std::pair<Key32, uint64_t>> kv(key_c), kv2(key_c);
+        std::vector<std::pair<_IntWrapper<uint64_t>, uint64_t>> mv(key_c);
+
+        for (size_t i = 0; i < key_c; i++)
+        {
+            kv[i] = kv2[i] = std::make_pair(keys[i], uint64_t(i));
+            mv[i] = std::make_pair(_IntWrapper<uint64_t>(i / 3), uint64_t(i));
+        }
+
+        ordered.BulkLoad(gsl::span<std::pair<Key32, uint64_t>>(kv), false);
+        hashmap.BulkLoad(gsl::span<std::pair<Key32, uint64_t>>(kv2));
+        multimap.BulkLoad(gsl::span<std::pair<_IntWrapper<uint64_t>, uint64_t>>(mv));
+
+        CHECK_THROWS(ordered.BulkLoad(gsl::span<std::pair<Key32, uint64_t>>(kv)));
+
+        CHECK(ordered.Validate());
+        CHECK(hashmap.Validate());
+
+        size_t found = 0;
+        for (size_t i = 0; i < key_c; i++)
+        {
+            auto o = ordered.Find(keys[i]);
+            auto h = hashmap.Find(keys[i]);
+
+            if (o && h && *o == i && *h == i)
+                found++;
+        }
+
+        CHECK(found == key_c);
+
+        size_t count = 0;
+        ordered.Iterate([&](auto& v) { count++; return true; });
+
+        CHECK(count == key_c);
+
+        size_t dups = 0;
+        for (size_t i = 0; i < key_c / 3; i++)
+        {
+            size_t c = 0;
+            multimap.MultiFind([&](auto* p) { c++; return true; }, _IntWrapper<uint64_t>(i));
+
+            if (c == 3)
+                dups++;
+        }
+
+        CHECK(dups == key_c / 3);
+
+        RandomKeyT<Key32> extra;
+
+        ordered.Insert(extra, uint64_t(key_c));
+        CHECK(ordered.Find(extra));
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Insert Batch", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+
+    using Database = DatabaseBuilder < R, BTree< R, OrderedListPointer >, BTree< R, FuzzyHashPointer >, BTree< R, SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> > >;
+
+    enum Tables { Ordered, Hashmap, Multimap };
+
+    constexpr size_t key_c = 100 * 1000;
+    constexpr size_t thread_c = 4;
+    auto& keys = singleton<std::array<RandomKeyT<Key32>, key_c>>();
+
+    {
+        Database db("db.dat");
+        auto& ordered = db.Table<Ordered>();
+        auto& hashmap = db.Table<Hashmap>();
+        auto& multimap = db.Table<Multimap>();
+
+        for (size_t i = 0; i < key_c; i += 4)
+            ordered.Insert(keys[i], uint64_t(i));
+
+        std::vector<std::pair<Key32, uint64_t>> kv(key_c + 10);
+        std::vector<std::pair<_IntWrapper<uint64_t>, uint64_t>> mv(key_c);
+        std::vector<pair<uint64_t*, bool>> results(key_c + 10);
+
+        for (size_t i = 0; i < key_c; i++)
+        {
+            kv[i] = std::make_pair(keys[i], uint64_t(i));
+            mv[i] = std::make_pair(_IntWrapper<uint64_t>(i % 1000), uint64_t(i));
+        }
+
+        for (size_t i = 0; i < 10; i++)
+            kv[key_c + i] = std::make_pair(keys[i + 1], uint64_t(-1));
+
+        ordered.InsertBatch(gsl::span<std::pair<Key32, uint64_t>>(kv), gsl::span<pair<uint64_t*, bool>>(results));
+
+        size_t correct = 0;
+        for (size_t i = 0; i < key_c; i++)
+        {
+            if (results[i].first && *results[i].first == i && results[i].second == (i % 4 == 0))
+                correct++;
+        }
+
+        CHECK(correct == key_c);
+
+        for (size_t i = 0; i < 10; i++)
+        {
+            CHECK(results[key_c + i].second);
+            CHECK(results[key_c + i].first == results[i + 1].first);
+        }
+
+        CHECK(ordered.Validate());
+
+        size_t count = 0;
+        ordered.Iterate([&](auto& v) { count++; return true; });
+
+        CHECK(count == key_c);
+
+        multimap.InsertBatch(gsl::span<std::pair<_IntWrapper<uint64_t>, uint64_t>>(mv), gsl::span<pair<uint64_t*, bool>>(results.data(), key_c));
+
+        size_t dups = 0;
+        for (size_t i = 0; i < 1000; i++)
+        {
+            size_t c = 0;
+            multimap.MultiFind([&](auto* p) { c++; return true; }, _IntWrapper<uint64_t>(i));
+
+            if (c == key_c / 1000)
+                dups++;
+        }
+
+        CHECK(dups == 1000);
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < thread_c; t++)
+        {
+            threads.emplace_back([&, t]()
+            {
+                constexpr size_t slice_c = key_c / thread_c;
+                std::vector<pair<uint64_t*, bool>> r(slice_c);
+
+                hashmap.InsertBatchLock(gsl::span<std::pair<Key32, uint64_t>>(kv.data() + t * slice_c, slice_c), gsl::span<pair<uint64_t*, bool>>(r));
+            });
+        }
+
+        for (auto& t : threads)
+            t.join();
+
+        size_t found = 0;
+        for (size_t i = 0; i < key_c; i++)
+        {
+            auto h = hashmap.Find(keys[i]);
+
+            if (h && *h == i)
+                found++;
+        }
+
+        CHECK(found == key_c);
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Find Batch", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+
+    using Database = DatabaseBuilder < R, BTree< R, OrderedListPointer >, BTree< R, FuzzyHashPointer > >;
+
+    enum Tables { Ordered, Hashmap };
+
+    constexpr size_t key_c = 100 * 1000;
+    auto& keys = singleton<std::array<RandomKeyT<Key32>, key_c>>();
+
+    {
+        Database db("db.dat");
+        auto& ordered = db.Table<Ordered>();
+        auto& hashmap = db.Table<Hashmap>();
+
+        for (size_t i = 0; i < key_c; i += 2)
+        {
+            ordered.Insert(keys[i], uint64_t(i));
+            hashmap.Insert(keys[i], uint64_t(i));
+        }
+
+        std::vector<Key32> batch(key_c);
+        std::vector<uint64_t*> o(key_c), h(key_c), l(key_c);
+
+        for (size_t i = 0; i < key_c; i++)
+            batch[i] = static_cast<const Key32&>(keys[i]);
+
+        ordered.FindBatch(gsl::span<const Key32>(batch.data(), key_c), gsl::span<uint64_t*>(o));
+        hashmap.FindBatch(gsl::span<const Key32>(batch.data(), key_c), gsl::span<uint64_t*>(h));
+        hashmap.FindBatchLock(gsl::span<const Key32>(batch.data(), key_c), gsl::span<uint64_t*>(l));
+
+        size_t correct = 0;
+        for (size_t i = 0; i < key_c; i++)
+        {
+            if (o[i] == ordered.Find(keys[i]) && h[i] == hashmap.Find(keys[i]) && l[i] == h[i] && (i % 2 == 0) == (o[i] != nullptr))
+                correct++;
+        }
+
+        CHECK(correct == key_c);
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Parallel Iterate", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+
+    using Database = DatabaseBuilder < R, BTree< R, OrderedListPointer >, BTree< R, FuzzyHashPointer > >;
+
+    enum Tables { Ordered, Hashmap };
+
+    constexpr size_t key_c = 100 * 1000;
+    auto& keys = singleton<std::array<RandomKeyT<Key32>, key_c>>();
+
+    {
+        Database db("db.dat");
+        auto& ordered = db.Table<Ordered>();
+        auto& hashmap = db.Table<Hashmap>();
+
+        for (size_t i = 0; i < key_c; i++)
+        {
+            ordered.Insert(keys[i], uint64_t(i));
+            hashmap.Insert(keys[i], uint64_t(i));
+        }
+
+        std::atomic<size_t> count = 0;
+        CHECK(ordered.ParallelIterate([&](auto& v) { count++; return true; }, 4) == key_c);
+        CHECK(count == key_c);
+
+        auto sum = hashmap.ParallelReduceKV(uint64_t(0), [](auto& s, auto& k, auto& v) { s += v; }, [](auto& s, auto& p) { s += p; }, 4);
+        CHECK(sum == key_c * (key_c - 1) / 2);
+
+        CHECK(ordered.ParallelPopulation(4) == ordered.Population());
+        CHECK(hashmap.ParallelPopulation(4) == hashmap.Population());
+
+        size_t visited = ordered.ParallelIterateKV([&](auto& k, auto& v) { return v != key_c / 2; }, 4);
+        CHECK(visited < key_c);
+
+        CHECK(ordered.ParallelValidate(4));
+        CHECK(hashmap.Validate());
+
+        CHECK(ordered.ResetNodeLocks() == 0);
+
+        ordered.ParallelIterateNodes([&](auto& node) { node.Lock(); });
+
+        CHECK(ordered.ResetNodeLocks() > 0);
+        CHECK(ordered.ResetNodeLocks() == 0);
+
+        ordered.Insert(RandomKeyT<Key32>(), uint64_t(key_c));
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Cursor", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+
+    using Database = DatabaseBuilder < R, BTree< R, OrderedListPointer >, BTree< R, SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> > >;
+
+    enum Tables { Ordered, Multimap };
+
+    constexpr size_t key_c = 60 * 1000;
+    auto& keys = singleton<std::array<RandomKeyT<Key32>, key_c>>();
+
+    {
+        Database db("db.dat");
+        auto& ordered = db.Table<Ordered>();
+        auto& multimap = db.Table<Multimap>();
+
+        std::vector<Key32> sorted(key_c);
+
+        for (size_t i = 0; i < key_c; i++)
+        {
+            ordered.Insert(keys[i], uint64_t(i));
+            multimap.Insert(_IntWrapper<uint64_t>((i * 7919) % 1000), uint64_t(i));
+
+            sorted[i] = static_cast<const Key32&>(keys[i]);
+        }
+
+        std::sort(sorted.begin(), sorted.end(), [](auto l, auto r) { return l.Compare(r) < 0; });
+
+        auto cursor = ordered.Cursor();
+
+        size_t in_order = 0;
+        for (cursor.SeekFirst(); cursor.Valid(); cursor.Next())
+            if (cursor.Key() == sorted[in_order]) in_order++;
+
+        CHECK(in_order == key_c);
+
+        size_t reversed = 0;
+        for (cursor.SeekLast(); cursor.Valid(); cursor.Prev())
+            if (cursor.Key() == sorted[key_c - 1 - reversed]) reversed++;
+
+        CHECK(reversed == key_c);
+
+        size_t position = key_c / 2, wrong = 0;
+        cursor.Seek(sorted[position]);
+
+        for (size_t i = 0; i < 1000; i++)
+        {
+            if (i % 3 == 2) { cursor.Prev(); position--; }
+            else { cursor.Next(); position++; }
+
+            if (!cursor.Valid() || !(cursor.Key() == sorted[position]))
+                wrong++;
+        }
+
+        CHECK(wrong == 0);
+
+        size_t paged = 0;
+        ordered.Page(sorted[100], 50, 20, [&](auto& k, auto& v) { if (k == sorted[150 + paged]) paged++; return true; });
+
+        CHECK(paged == 20);
+
+        for (size_t i = 0; i < key_c; i += 2)
+            ordered.Erase(sorted[i]);
+
+        size_t odd = 0;
+        for (cursor.SeekFirst(); cursor.Valid(); cursor.Next())
+            if (cursor.Key() == sorted[odd * 2 + 1]) odd++;
+
+        CHECK(odd == key_c / 2);
+
+        auto multi = multimap.Cursor();
+        std::vector<uint64_t> forward, reverse;
+
+        for (multi.SeekFirst(); multi.Valid(); multi.Next())
+            forward.push_back(multi.Pointer());
+
+        for (multi.SeekLast(); multi.Valid(); multi.Prev())
+            reverse.push_back(multi.Pointer());
+
+        std::reverse(reverse.begin(), reverse.end());
+
+        CHECK(forward.size() == key_c);
+        CHECK(forward == reverse);
+
+        multi.Seek(_IntWrapper<uint64_t>(500));
+        CHECK(multi.Key().key == 500);
+
+        multi.Next(); multi.Next(); multi.Prev();
+        CHECK(multi.Pointer() == forward[500 * (key_c / 1000) + 1]);
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Self Balanced", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+
+    using Database = DatabaseBuilder < R, BPlusTree< R, SimpleOrderedListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >, BPlusTree< R, SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> > >;
+
+    enum Tables { Ascending, Multimap };
+
+    constexpr size_t key_c = 200 * 1000;
+
+    {
+        Database db("db.dat");
+        auto& ascending = db.Table<Ascending>();
+        auto& multimap = db.Table<Multimap>();
+
+        CHECK(db.GetDescriptor(Ascending).standard_index.self_balanced);
+
+        for (size_t i = 0; i < key_c; i++)
+        {
+            CHECK(!ascending.Insert(_IntWrapper<uint64_t>(i), uint64_t(i)).second);
+            multimap.InsertLock(_IntWrapper<uint64_t>(i % 100), uint64_t(i));
+        }
+
+        CHECK(ascending.Insert(_IntWrapper<uint64_t>(7), uint64_t(0)).second);
+        CHECK(ascending.Validate());
+        CHECK(multimap.Validate());
+
+        //Sequential keys would chain a hashing tree, here the depth stays logarithmic:
+        //
+
+        CHECK(ascending.Depth() <= 3);
+        CHECK(multimap.Depth() <= 3);
+
+        size_t found = 0;
+        for (size_t i = 0; i < key_c; i++)
+        {
+            auto p = ascending.FindLock(_IntWrapper<uint64_t>(i));
+            if (p && *p == i) found++;
+        }
+
+        CHECK(found == key_c);
+
+        size_t in_order = 0;
+        ascending.IterateKV([&](auto& k, auto& v) { if (k.key == in_order) in_order++; return true; });
+
+        CHECK(in_order == key_c);
+
+        size_t matches = 0;
+        multimap.MultiFind([&](auto* v) { if (*v % 100 == 42) matches++; return true; }, _IntWrapper<uint64_t>(42));
+
+        CHECK(matches == key_c / 100);
+
+        size_t ranged = 0;
+        ascending.RangeFind([&](auto& k, auto& v) { ranged++; }, _IntWrapper<uint64_t>(1000), _IntWrapper<uint64_t>(1999));
+
+        CHECK(ranged == 1000);
+
+        //Erasing merges the thin nodes back together:
+        //
+
+        auto grown = ascending.Population();
+
+        for (size_t i = 0; i < key_c; i++)
+            if (i % 10)
+                CHECK(ascending.EraseLock(_IntWrapper<uint64_t>(i)) == 1);
+
+        CHECK(multimap.Erase(_IntWrapper<uint64_t>(42)) == key_c / 100);
+        CHECK(!multimap.Find(_IntWrapper<uint64_t>(42)));
+
+        CHECK(ascending.Validate());
+        CHECK(multimap.Validate());
+        CHECK(ascending.Population().second < grown.second / 2);
+
+        found = 0;
+        for (size_t i = 0; i < key_c; i++)
+            if (ascending.Find(_IntWrapper<uint64_t>(i)))
+                found++;
+
+        CHECK(found == key_c / 10);
+    }
+
+    //Both trees write the same node type, the balance flag keeps either from opening the other's file:
+    //
+
+    using Unbalanced = DatabaseBuilder < R, BTree< R, SimpleOrderedListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >, BTree< R, SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> > >;
+
+    CHECK_THROWS(Unbalanced("db.dat"));
+
+    std::filesystem::remove_all("db.dat");
+
+    {
+        Unbalanced db("db.dat");
+    }
+
+    CHECK_THROWS(Database("db.dat"));
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Tagged Hashmap", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+
+    using Database = DatabaseBuilder < R, BTree< R, TaggedHashPointer >, BTree< R, TaggedHashPointerT<32> > >;
+
+    enum Tables { Narrow, Wide };
+
+    constexpr size_t key_c = 100 * 1000;
+    auto& keys = singleton<std::array<RandomKeyT<Key32>, key_c>>();
+
+    {
+        Database db("db.dat");
+        auto& narrow = db.Table<Narrow>();
+        auto& wide = db.Table<Wide>();
+
+        for (size_t i = 0; i < key_c; i++)
+        {
+            CHECK(!narrow.Insert(keys[i], uint64_t(i)).second);
+            CHECK(!wide.InsertLock(keys[i], uint64_t(i)).second);
+        }
+
+        CHECK(narrow.Insert(keys[0], uint64_t(0)).second);
+        CHECK(narrow.Validate());
+
+        size_t found = 0;
+        for (size_t i = 0; i < key_c; i++)
+        {
+            auto n = narrow.Find(keys[i]);
+            auto w = wide.FindLock(keys[i]);
+
+            if (n && w && *n == i && *w == i)
+                found++;
+        }
+
+        CHECK(found == key_c);
+
+        RandomKeyT<Key32> missing;
+        CHECK(!narrow.Find(missing));
+        CHECK(!wide.Find(missing));
+
+        for (size_t i = 0; i < key_c; i += 2)
+            CHECK(narrow.Erase(keys[i]) == 1);
+
+        size_t count = 0;
+        narrow.Iterate([&](auto& v) { count++; return true; });
+
+        CHECK(count == key_c / 2);
+
+        found = 0;
+        for (size_t i = 0; i < key_c; i++)
+            if (narrow.Find(keys[i]))
+                found++;
+
+        CHECK(found == key_c / 2);
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Local Surrogate", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+    using SIDX = BTree< R, MultiSurrogateStringPointer<R> >;
+    using LIDX = BTree< R, MultiLocalSurrogateStringPointer<R> >;
+
+    using Database = DatabaseBuilder < R, SIDX, LIDX >;
+
+    constexpr size_t lim = 20 * 1000;
+    enum Tables { Surrogate, Local };
+
+    {
+        Database db("db.dat");
+        auto& surrogate = db.Table<Surrogate>();
+        auto& local = db.Table<Local>();
+        std::vector<std::string> names;
+
+        //Shared heads make most comparisons tie on the inline prefix:
+        //
+
+        for (size_t i = 0; i < lim; i++)
+        {
+            names.push_back((i % 3) ? "Prefixed" + std::to_string(i % 1000) : std::to_string(i % 500));
+
+            auto offset = db.SetObject(std::string_view(names.back().c_str(), names.back().size() + 1)).second;
+
+            surrogate.Insert(offset, uint64_t(i));
+            local.Insert(offset, uint64_t(i));
+        }
+
+        CHECK(local.Validate());
+
+        size_t agree = 0;
+        for (size_t i = 0; i < lim; i += 7)
+        {
+            size_t s = 0, l = 0;
+
+            surrogate.MultiFind([&](auto* v) { if (names[*v] == names[i]) s++; return true; }, 0, (void*)names[i].c_str());
+            local.MultiFind([&](auto* v) { if (names[*v] == names[i]) l++; return true; }, 0, (void*)names[i].c_str());
+
+            if (l && l == s)
+                agree++;
+        }
+
+        CHECK(agree == (lim + 6) / 7);
+
+        size_t in_order = 0;
+        std::string last;
+        auto cursor = local.Cursor();
+
+        for (cursor.SeekFirst(); cursor.Valid(); cursor.Next())
+        {
+            auto& name = names[cursor.Pointer()];
+
+            if (last <= name)
+                in_order++;
+
+            last = name;
+        }
+
+        CHECK(in_order == lim);
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Prefix Compressed", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+
+    using Database = DatabaseBuilder < R, PrefixTree< R, PrefixStringPointer >, PrefixTree< R, MultiPrefixStringPointer > >;
+
+    enum Tables { Paths, Multimap };
+
+    constexpr size_t key_c = 100 * 1000;
+
+    auto path = [](size_t i) { return "/usr/share/doc/package-" + std::to_string(i % 1000) + "/file-" + std::to_string(i); };
+
+    {
+        Database db("db.dat");
+        auto& paths = db.Table<Paths>();
+        auto& multimap = db.Table<Multimap>();
+
+        CHECK(db.GetDescriptor(Paths).type == TableType::btree_prefix_block);
+        CHECK(!db.GetDescriptor(Paths).standard_index.key_sz);
+        CHECK(db.GetDescriptor(Paths).standard_index.max_key_sz > 255);
+
+        size_t raw = 0;
+        for (size_t i = 0; i < key_c; i++)
+        {
+            auto k = path((i * 7919) % key_c);
+            raw += k.size() + sizeof(uint64_t);
+
+            CHECK(!paths.Insert(k, uint64_t((i * 7919) % key_c)).second);
+            multimap.InsertLock("group-" + std::to_string(i % 100), uint64_t(i));
+        }
+
+        CHECK(paths.Insert(path(7), uint64_t(0)).second);
+        CHECK(paths.Validate());
+        CHECK(multimap.Validate());
+
+        //Shared path prefixes are stored once per entry run:
+        //
+
+        CHECK(paths.Population().first < raw / 2);
+
+        size_t found = 0;
+        for (size_t i = 0; i < key_c; i++)
+        {
+            auto p = paths.FindLock(path(i));
+            if (p && *p == i) found++;
+        }
+
+        CHECK(found == key_c);
+        CHECK(!paths.Find("/usr/share/doc/package-1/missing"));
+
+        size_t in_order = 0;
+        std::string last;
+        paths.IterateKV([&](auto k, auto& v) { if (last < k && path(v) == k) in_order++; last = k; return true; });
+
+        CHECK(in_order == key_c);
+
+        size_t matches = 0;
+        multimap.MultiFind([&](auto* v) { if (*v % 100 == 42) matches++; return true; }, "group-42");
+
+        CHECK(matches == key_c / 100);
+
+        size_t ranged = 0;
+        paths.RangeFind([&](auto k, auto& v) { ranged++; }, "/usr/share/doc/package-5/", "/usr/share/doc/package-5/~");
+
+        CHECK(ranged == key_c / 1000);
+
+        for (size_t i = 0; i < key_c; i++)
+            if (i % 10)
+                CHECK(paths.EraseLock(path(i)) == 1);
+
+        CHECK(multimap.EraseIf([](auto* v) { return *v % 200 == 42; }, "group-42") == key_c / 200);
+        CHECK(multimap.Erase("group-42") == key_c / 200);
+        CHECK(!multimap.Find("group-42"));
+
+        CHECK(paths.Validate());
+        CHECK(multimap.Validate());
+
+        found = 0;
+        for (size_t i = 0; i < key_c; i++)
+            if (paths.Find(path(i)))
+                found++;
+
+        CHECK(found == key_c / 10);
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Fast Hash", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+
+    using Database = DatabaseBuilder < R, BTree< R, FastHashPointer > >;
+    using Sha2Database = DatabaseBuilder < R, BTree< R, FuzzyHashPointer > >;
+
+    constexpr size_t key_c = 100 * 1000;
+
+    std::string text = "The quick brown fox jumps over the lazy dog, then does it again and again";
+
+    for (size_t i = 0; i <= text.size(); i++)
+    {
+        std::string_view prefix(text.data(), i);
+
+        CHECK(FastKey32(prefix).Equal(FastKey32(prefix)));
+
+        if (i)
+            CHECK(!FastKey32(prefix).Equal(FastKey32(std::string_view(text.data(), i - 1))));
+    }
+
+    CHECK(uint8_t(FastKey32::hash_policy) == HashPolicy::hash_policy_fast);
+    CHECK(uint8_t(Key32::hash_policy) == HashPolicy::hash_policy_sha2);
+
+    {
+        Database db("db.dat");
+        auto& table = db.Table<0>();
+
+        CHECK(db.GetDescriptor(0).standard_index.hash_policy == HashPolicy::hash_policy_fast);
+
+        for (size_t i = 0; i < key_c; i++)
+            CHECK(!table.Insert(FastKey32(std::to_string(i)), uint64_t(i)).second);
+
+        CHECK(table.Validate());
+
+        size_t found = 0;
+        for (size_t i = 0; i < key_c; i++)
+        {
+            auto v = table.Find(FastKey32(std::to_string(i)));
+
+            if (v && *v == i)
+                found++;
+        }
+
+        CHECK(found == key_c);
+        CHECK(!table.Find(FastKey32(std::to_string(key_c))));
+    }
+
+    //Keys hashed another way would never be found, so the mismatch is refused at open:
+    //
+
+    CHECK_THROWS(Sha2Database("db.dat"));
+
+    {
+        Database db("db.dat");
+        auto v = db.Table<0>().Find(FastKey32(std::to_string(42)));
+
+        CHECK((v && *v == 42));
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Hash Batch", "[tdb::]")
+{
+    //Every padding boundary of a single block, two blocks and a few longer messages:
+    //
+
+    std::vector<std::string> text;
+
+    for (size_t i = 0; i < 300; i++)
+    {
+        text.emplace_back(i, 'a');
+
+        for (size_t j = 0; j < i; j++)
+            text.back()[j] = char('a' + (i * 31 + j * 7) % 26);
+    }
+
+    for (size_t i = 0; i < 37; i++)
+        text.emplace_back(1000 + i * 97, char('A' + i));
+
+    std::vector<std::string_view> in(text.begin(), text.end());
+
+    std::vector<Key32> lanes4(in.size()), batch(in.size());
+    std::vector<Key16> half(in.size());
+
+    Sha256Multibuffer<_Sha256Lanes4>(gsl::span<const std::string_view>(in), gsl::span<Key32>(lanes4));
+    Sha256Multibuffer(gsl::span<const std::string_view>(in), gsl::span<Key16>(half));
+    HashBatch(gsl::span<const std::string_view>(in), gsl::span<Key32>(batch));
+
+    size_t correct = 0;
+    for (size_t i = 0; i < in.size(); i++)
+    {
+        Key32 k(in[i]);
+
+        if (k.Equal(lanes4[i]) && k.Equal(batch[i]) && Key16(in[i]).Equal(half[i]))
+            correct++;
+    }
+
+    CHECK(correct == in.size());
+
+    std::string_view abc = "abc";
+    Key32 known;
+    Sha256Multibuffer(gsl::span<const std::string_view>(&abc, 1), gsl::span<Key32>(&known, 1));
+
+    CHECK(((uint8_t*)&known)[0] == 0xba);
+    CHECK(((uint8_t*)&known)[31] == 0xad);
+}
+
+TEST_CASE("Bloom Filter", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+
+    using Database = DatabaseBuilder < R, BloomTree< R, FuzzyHashPointer >, BloomTree< R, SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> > >;
+
+    enum Tables { Hashmap, Multimap };
+
+    constexpr size_t key_c = 200 * 1000, thread_c = 4;
+    auto& keys = singleton<std::array<RandomKeyT<Key32>, key_c>>();
+    auto& missing = singleton<std::array<RandomKeyT<Key32>, key_c / 10>>();
+
+    auto false_positives = [&](auto& table)
+    {
+        size_t passed = 0;
+
+        for (auto& k : missing)
+            if (table.MayContain(k))
+                passed++;
+
+        return passed;
+    };
+
+    {
+        Database db("db.dat");
+        auto& hashmap = db.Table<Hashmap>();
+        auto& multimap = db.Table<Multimap>();
+
+        CHECK(!hashmap.Find(keys[0]));
+        CHECK(!hashmap.MayContain(keys[0]));
+
+        //The filter starts with room for a few thousand keys and grows as they arrive:
+        //
+
+        for (size_t i = 0; i < key_c; i++)
+        {
+            CHECK(!hashmap.Insert(keys[i], uint64_t(i)).second);
+            multimap.Insert(_IntWrapper<uint64_t>(i % 1000), uint64_t(i));
+        }
+
+        CHECK(hashmap.FilterPopulation().first == key_c);
+        CHECK(hashmap.FilterPopulation().second >= key_c);
+
+        size_t found = 0;
+        for (size_t i = 0; i < key_c; i++)
+        {
+            auto v = hashmap.Find(keys[i]);
+
+            if (v && *v == i)
+                found++;
+        }
+
+        CHECK(found == key_c);
+        CHECK(false_positives(hashmap) < missing.size() / 50);
+
+        size_t hits = 0;
+        multimap.MultiFind([&](auto* v) { hits++; return true; }, _IntWrapper<uint64_t>(7));
+        multimap.MultiFind([&](auto* v) { hits++; return true; }, _IntWrapper<uint64_t>(1000));
+
+        CHECK(hits == key_c / 1000);
+
+        std::vector<Key32> batch;
+
+        for (size_t i = 0; i < 1000; i++)
+            batch.push_back(static_cast<const Key32&>(keys[i]));
+
+        for (size_t i = 0; i < 1000; i++)
+            batch.push_back(static_cast<const Key32&>(missing[i]));
+
+        std::vector<uint64_t*> results(batch.size());
+        hashmap.FindBatch(gsl::span<const Key32>(batch), gsl::span<uint64_t*>(results));
+
+        size_t correct = 0;
+        for (size_t i = 0; i < batch.size(); i++)
+            if ((i < 1000) ? (results[i] && *results[i] == i) : !results[i])
+                correct++;
+
+        CHECK(correct == batch.size());
+    }
+
+    {
+        Database db("db.dat");
+        auto& hashmap = db.Table<Hashmap>();
+
+        size_t found = 0;
+        for (size_t i = 0; i < key_c; i++)
+            if (hashmap.FindLock(keys[i]))
+                found++;
+
+        CHECK(found == key_c);
+
+        //Concurrent inserts double the filter in place instead of rebuilding it:
+        //
+
+        auto& more = singleton<std::array<RandomKeyT<Key32>, key_c * 2>>();
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < thread_c; t++)
+        {
+            threads.emplace_back([&, t]()
+            {
+                for (size_t i = t; i < more.size(); i += thread_c)
+                    hashmap.InsertLock(more[i], uint64_t(i));
+            });
+        }
+
+        for (auto& t : threads)
+            t.join();
+
+        CHECK(!hashmap.FilterSaturated());
+        CHECK(hashmap.FilterPopulation().first == key_c * 3);
+        CHECK(hashmap.FilterPopulation().second >= key_c * 3);
+        CHECK(false_positives(hashmap) < missing.size() / 20);
+
+        found = 0;
+        for (size_t i = 0; i < more.size(); i++)
+            if (hashmap.MayContain(more[i]))
+                found++;
+
+        CHECK(found == more.size());
+
+        hashmap.RebuildFilter(thread_c);
+
+        CHECK(!hashmap.FilterSaturated());
+        CHECK(hashmap.FilterPopulation().first == key_c * 3);
+        CHECK(false_positives(hashmap) < missing.size() / 50);
+
+        found = 0;
+        for (size_t i = 0; i < more.size(); i++)
+        {
+            auto v = hashmap.FindLock(more[i]);
+
+            if (v && *v == i)
+                found++;
+        }
+
+        CHECK(found == more.size());
+        CHECK(hashmap.Validate());
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Hot Levels", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+
+    using Database = DatabaseBuilder < R, BTree< R, OrderedListPointer >, BTree< R, FuzzyHashPointer >, BTree< R, FuzzyHashPointer, 1, (size_t)-1, 0 > >;
+
+    enum Tables { Ordered, Hashmap, Cold };
+
+    constexpr size_t key_c = 200 * 1000;
+    auto& keys = singleton<std::array<RandomKeyT<Key32>, key_c>>();
+
+    auto found = [&](auto& table, size_t from, size_t step)
+    {
+        size_t hits = 0;
+
+        for (size_t i = from; i < key_c; i += step)
+        {
+            auto v = table.Find(keys[i]);
+
+            if (v && *v == i)
+                hits++;
+        }
+
+        return hits;
+    };
+
+    {
+        Database db("db.dat");
+        auto& ordered = db.Table<Ordered>();
+        auto& hashmap = db.Table<Hashmap>();
+        auto& cold = db.Table<Cold>();
+
+        for (size_t i = 0; i < key_c; i++)
+        {
+            ordered.Insert(keys[i], uint64_t(i));
+            hashmap.InsertLock(keys[i], uint64_t(i));
+            cold.Insert(keys[i], uint64_t(i));
+        }
+
+        CHECK(found(ordered, 0, 1) == key_c);
+        CHECK(found(hashmap, 0, 1) == key_c);
+        CHECK(found(cold, 0, 1) == key_c);
+
+        //Locking can be refused under a low locked memory limit, the lookups don't depend on it:
+        //
+
+        hashmap.PinHot();
+        CHECK(cold.PinHot() == 0);
+
+        CHECK(found(hashmap, 0, 1) == key_c);
+
+        hashmap.UnpinHot();
+
+        //Erasing reclaims emptied nodes, the cached links to them have to go too:
+        //
+
+        for (size_t i = 0; i < key_c; i++)
+        {
+            if (i % 8)
+            {
+                CHECK(ordered.Erase(keys[i]) == 1);
+                CHECK(hashmap.EraseLock(keys[i]) == 1);
+            }
+        }
+
+        CHECK(found(ordered, 0, 8) == key_c / 8);
+        CHECK(found(hashmap, 0, 8) == key_c / 8);
+        CHECK(found(hashmap, 1, 8) == 0);
+
+        for (size_t i = 0; i < key_c; i++)
+        {
+            if (i % 8)
+            {
+                CHECK(!ordered.Insert(keys[i], uint64_t(i)).second);
+                CHECK(!hashmap.InsertLock(keys[i], uint64_t(i)).second);
+            }
+        }
+
+        CHECK(found(ordered, 0, 1) == key_c);
+        CHECK(found(hashmap, 0, 1) == key_c);
+        CHECK(ordered.Validate());
+        CHECK(hashmap.Validate());
+
+        std::vector<Key32> batch;
+
+        for (size_t i = 0; i < 1000; i++)
+            batch.push_back(static_cast<const Key32&>(keys[i]));
+
+        std::vector<uint64_t*> results(batch.size());
+        hashmap.FindBatch(gsl::span<const Key32>(batch), gsl::span<uint64_t*>(results));
+
+        size_t correct = 0;
+        for (size_t i = 0; i < batch.size(); i++)
+            if (results[i] && *results[i] == i)
+                correct++;
+
+        CHECK(correct == batch.size());
+    }
+
+    {
+        Database db("db.dat");
+
+        CHECK(found(db.Table<Ordered>(), 0, 1) == key_c);
+        CHECK(found(db.Table<Hashmap>(), 0, 1) == key_c);
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Radix Tree", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+
+    using Database = DatabaseBuilder < R, RadixTree< R, _IntWrapper<uint64_t> >, RadixSegmentPointer< R, uint64_t >, RadixTree< R, _IntWrapper<int32_t> > >;
+
+    enum Tables { Ids, Segments, Signed };
+
+    constexpr size_t key_c = 200 * 1000, thread_c = 4;
+
+    std::vector<uint64_t> ids(key_c);
+    std::set<uint64_t> sorted;
+
+    //Half dense sequential ids, half spread over the whole key space:
+    //
+
+    for (size_t i = 0; i < key_c; i++)
+    {
+        ids[i] = (i % 2) ? (i * 0x9e3779b97f4a7c15ull) : i;
+        sorted.insert(ids[i]);
+    }
+
+    {
+        Database db("db.dat");
+        auto& radix = db.Table<Ids>();
+        auto& segments = db.Table<Segments>();
+        auto& signed_keys = db.Table<Signed>();
+
+        CHECK(!radix.Find(_IntWrapper<uint64_t>(0)));
+
+        for (size_t i = 0; i < key_c; i++)
+            CHECK(!radix.Insert(ids[i], uint64_t(i)).second);
+
+        CHECK(radix.size() == key_c);
+        CHECK(radix.Insert(ids[7], 0).second);
+
+        size_t found = 0;
+        for (size_t i = 0; i < key_c; i++)
+        {
+            auto v = radix.Find(ids[i]);
+
+            if (v && *v == i)
+                found++;
+        }
+
+        CHECK(found == key_c);
+        CHECK(!radix.Find(_IntWrapper<uint64_t>(key_c * 2)));
+        CHECK(!radix.Find(_IntWrapper<uint64_t>(3 * 0x9e3779b97f4a7c15ull + 1)));
+
+        std::vector<uint64_t> range;
+        radix.RangeFind([&](auto& k, auto& v) { range.push_back(k.key); }, _IntWrapper<uint64_t>(1000), _IntWrapper<uint64_t>(1ull << 62));
+
+        std::vector<uint64_t> expected(sorted.lower_bound(1000), sorted.upper_bound(1ull << 62));
+        CHECK(range == expected);
+
+        std::vector<uint64_t> all;
+        CHECK(radix.IterateKV([&](auto& k, auto& v) { all.push_back(k.key); return true; }) == key_c);
+        CHECK(std::equal(all.begin(), all.end(), sorted.begin(), sorted.end()));
+        CHECK(radix.Validate());
+
+        //Segments are found by any position they cover:
+        //
+
+        for (uint64_t i = 0; i < 10000; i++)
+            CHECK(!segments.Insert(_Segment<uint64_t>(i * 10, 5), i).second);
+
+        size_t covered = 0, gaps = 0;
+        for (uint64_t i = 0; i < 10000; i++)
+        {
+            auto v = segments.Find(_Segment<uint64_t>(i * 10 + 3, 1));
+
+            if (v && *v == i)
+                covered++;
+
+            if (!segments.Find(_Segment<uint64_t>(i * 10 + 6, 3)))
+                gaps++;
+        }
+
+        CHECK(covered == 10000);
+        CHECK(gaps == 10000);
+
+        size_t overlapping = 0;
+        segments.RangeFind([&](auto& k, auto& v) { overlapping++; }, _Segment<uint64_t>(102, 1), _Segment<uint64_t>(150, 1));
+        CHECK(overlapping == 6);
+
+        for (int32_t i = -500; i <= 500; i++)
+            signed_keys.Insert(_IntWrapper<int32_t>(i), uint64_t(i + 500));
+
+        int32_t last = -501;
+        bool ordered = true;
+        signed_keys.IterateKV([&](auto& k, auto& v) { ordered = ordered && k.key == last + 1; last = k.key; return true; });
+
+        CHECK(ordered);
+        CHECK(last == 500);
+        CHECK(db.Validate());
+    }
+
+    {
+        Database db("db.dat");
+        auto& radix = db.Table<Ids>();
+
+        size_t found = 0;
+        for (size_t i = 0; i < key_c; i++)
+            if (radix.FindLock(ids[i]))
+                found++;
+
+        CHECK(found == key_c);
+
+        //Readers run beside writers, grown and split nodes are retired until Reclaim:
+        //
+
+        std::atomic<size_t> misses = 0;
+        std::vector<std::thread> threads;
+
+        for (size_t t = 0; t < thread_c; t++)
+        {
+            threads.emplace_back([&, t]()
+            {
+                for (size_t i = t; i < key_c; i += thread_c)
+                {
+                    radix.InsertLock(_IntWrapper<uint64_t>(ids[i] + (1ull << 40)), uint64_t(i));
+
+                    if (!radix.FindLock(ids[(i * 7) % key_c]))
+                        misses++;
+                }
+            });
+        }
+
+        for (auto& t : threads)
+            t.join();
+
+        radix.Reclaim();
+
+        CHECK(misses == 0);
+        CHECK(radix.size() == key_c * 2);
+        CHECK(radix.Validate());
+
+        found = 0;
+        for (size_t i = 0; i < key_c; i++)
+        {
+            auto v = radix.Find(_IntWrapper<uint64_t>(ids[i] + (1ull << 40)));
+
+            if (v && *v == i)
+                found++;
+        }
+
+        CHECK(found == key_c);
+        CHECK(db.GetDescriptor(Ids).type == TableType::radix_tree);
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Interval Index", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using Segment = _Segment<uint64_t>;
+
+#pragma pack(push, 1)
+    struct Extents
+    {
+        Extents() {}
+
+        static size_t Size(uint64_t _id, const std::vector<Segment>& runs)
+        {
+            return sizeof(Extents) + runs.size() * sizeof(Segment);
+        }
+
+        Extents(uint64_t _id, const std::vector<Segment>& runs) : id(_id), count((uint16_t)runs.size())
+        {
+            std::copy(runs.begin(), runs.end(), (Segment*)(this + 1));
+        }
+
+        auto Keys(uint64_t n)
+        {
+            return std::make_tuple(gsl::span<Segment>((Segment*)(this + 1), count));
+        }
+
+        uint64_t id = 0;
+        uint16_t count = 0;
+    };
+#pragma pack(pop)
+
+    using R = AsyncMap<>;
+    using E = SimpleSurrogateTableBuilder <Extents>;
+
+    using Database = DatabaseBuilder < R, IntervalIndex< R, uint64_t >, SurrogateTable< R, E, IntervalIndex< R, uint64_t > > >;
+
+    enum Tables { Runs, Files };
+
+    constexpr size_t run_c = 50 * 1000, query_c = 1000, file_c = 2000;
+
+    std::vector<Segment> runs(run_c);
+
+    for (size_t i = 0; i < run_c; i++)
+        runs[i] = Segment((i * 7919) % 1000000, 1 + (i * 104729) % 1000);
+
+    //Every run overlapping [ low, high ), by brute force:
+    //
+
+    auto expected = [&](uint64_t low, uint64_t high)
+    {
+        std::vector<uint64_t> result;
+
+        for (size_t i = 0; i < run_c; i++)
+            if (runs[i].start < high && runs[i].start + runs[i].length > low)
+                result.push_back(i);
+
+        return result;
+    };
+
+    {
+        Database db("db.dat");
+        auto& intervals = db.Table<Runs>();
+
+        for (size_t i = 0; i < run_c; i++)
+            CHECK(intervals.Insert(runs[i], uint64_t(i)).first);
+
+        CHECK(intervals.size() == run_c);
+        CHECK(intervals.Validate());
+
+        size_t matched = 0, ordered = 0;
+        for (size_t q = 0; q < query_c; q++)
+        {
+            uint64_t low = (q * 15485863) % 1000000, high = low + (q % 3) * 500 + 1;
+
+            std::vector<uint64_t> found;
+            uint64_t last = 0;
+            bool in_order = true;
+
+            intervals.Overlap([&](auto& k, auto& v)
+            {
+                in_order = in_order && k.start >= last;
+                last = k.start;
+                found.push_back(v);
+            }, low, high);
+
+            std::sort(found.begin(), found.end());
+
+            if (found == expected(low, high))
+                matched++;
+
+            if (in_order)
+                ordered++;
+        }
+
+        CHECK(matched == query_c);
+        CHECK(ordered == query_c);
+
+        size_t stabbed = 0;
+        intervals.Stab([&](auto& k, auto& v) { stabbed++; }, 500000);
+        CHECK(stabbed == expected(500000, 500001).size());
+
+        size_t streamed = 0;
+        intervals.MultiFind([&](auto* v) { return ++streamed < 3; }, Segment(0, 1000000));
+        CHECK(streamed == 3);
+
+        auto v = intervals.Find(Segment(runs[42].start, 1));
+        CHECK(v);
+        CHECK(runs[*v].start <= runs[42].start);
+        CHECK(runs[*v].start + runs[*v].length > runs[42].start);
+        CHECK(!intervals.Find(Segment(2000000, 10)));
+    }
+
+    {
+        Database db("db.dat");
+        auto& intervals = db.Table<Runs>();
+        auto& files = db.Table<Files>();
+
+        CHECK(intervals.Validate());
+
+        size_t count = 0;
+        intervals.RangeFind([&](auto& k, auto& v) { count++; }, Segment(1000, 1), Segment(2000, 1));
+        CHECK(count == expected(1000, 2001).size());
+
+        //Files sharing blocks, every file holding a block is found:
+        //
+
+        for (uint64_t i = 0; i < file_c; i++)
+            files.Emplace(i, std::vector<Segment>{ Segment(i * 100, 50), Segment((i % 10) * 100000, 10) });
+
+        std::set<uint64_t> sharing;
+        files.MultiFind<0>([&](auto& e) { sharing.insert(uint64_t(e.id)); return true; }, Segment(300005, 1));
+
+        std::set<uint64_t> intersecting;
+        files.FindRange<0>([&](auto& e) { intersecting.insert(uint64_t(e.id)); }, Segment(1025, 1), Segment(1200, 1));
+
+        CHECK(sharing.size() == file_c / 10);
+        CHECK(*sharing.begin() == 3);
+        CHECK(intersecting == std::set<uint64_t>{ 10, 11, 12 });
+        CHECK(db.Validate());
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Learned Index", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+
+    using Database = DatabaseBuilder < R, BTree< R, SimpleOrderedListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t> > >, LearnedIndex< R, _IntWrapper<uint64_t> >, LearnedIndex< R, _IntWrapper<int64_t>, uint64_t, 8 > >;
+
+    enum Tables { Ids, Learned, Signed };
+
+    constexpr size_t key_c = 200 * 1000;
+
+    std::vector<uint64_t> ids(key_c);
+    std::set<uint64_t> sorted;
+
+    //Dense sequential ids, ids spread over the whole key space and a quadratic cluster:
+    //
+
+    for (size_t i = 0; i < key_c; i++)
+    {
+        ids[i] = (i % 3 == 0) ? i : (i % 3 == 1) ? i * 0x9e3779b97f4a7c15ull : (1ull << 40) + i * i;
+        sorted.insert(ids[i]);
+    }
+
+    {
+        Database db("db.dat");
+        auto& tree = db.Table<Ids>();
+        auto& learned = db.Table<Learned>();
+
+        learned.Build(tree);
+        CHECK(learned.size() == 0);
+        CHECK(!learned.Find(_IntWrapper<uint64_t>(0)));
+        CHECK(learned.Validate());
+
+        for (size_t i = 0; i < key_c; i++)
+            tree.Insert(ids[i], uint64_t(i));
+
+        learned.Build(tree);
+
+        CHECK(learned.size() == key_c);
+        CHECK(learned.Validate());
+        CHECK(learned.Models().back() == 1);
+        CHECK(learned.Models()[0] < key_c / 8);
+
+        size_t found = 0;
+        for (size_t i = 0; i < key_c; i++)
+        {
+            auto v = learned.Find(ids[i]);
+
+            if (v && *v == i)
+                found++;
+        }
+
+        CHECK(found == key_c);
+        CHECK(!learned.Find(_IntWrapper<uint64_t>(key_c * 2)));
+        CHECK(!learned.Find(_IntWrapper<uint64_t>(4 * 0x9e3779b97f4a7c15ull + 1)));
+        CHECK(!learned.Find(_IntWrapper<uint64_t>(-1)));
+
+        std::vector<uint64_t> range;
+        learned.RangeFind([&](auto& k, auto& v) { range.push_back(k.key); }, _IntWrapper<uint64_t>(1000), _IntWrapper<uint64_t>(1ull << 62));
+
+        std::vector<uint64_t> expected(sorted.lower_bound(1000), sorted.upper_bound(1ull << 62));
+        CHECK(range == expected);
+
+        std::vector<uint64_t> all;
+        CHECK(learned.IterateKV([&](auto& k, auto& v) { all.push_back(k.key); return true; }) == key_c);
+        CHECK(std::equal(all.begin(), all.end(), sorted.begin(), sorted.end()));
+    }
+
+    {
+        Database db("db.dat");
+        auto& learned = db.Table<Learned>();
+        auto& signed_keys = db.Table<Signed>();
+
+        CHECK(learned.Validate());
+
+        size_t found = 0;
+        for (size_t i = 0; i < key_c; i += 7)
+        {
+            auto v = learned.Find(ids[i]);
+
+            if (v && *v == i)
+                found++;
+        }
+
+        CHECK(found == (key_c + 6) / 7);
+
+        //Three of every key, loaded out of order:
+        //
+
+        std::vector<std::pair<_IntWrapper<int64_t>, uint64_t>> kv(key_c);
+
+        for (size_t i = 0; i < key_c; i++)
+            kv[i] = std::make_pair(_IntWrapper<int64_t>((int64_t)((i * 7919) % key_c / 3) - 10000), uint64_t(i));
+
+        signed_keys.BulkLoad(gsl::span<std::pair<_IntWrapper<int64_t>, uint64_t>>(kv), false);
+
+        CHECK(signed_keys.size() == key_c);
+        CHECK(signed_keys.Validate());
+
+        size_t copies = 0;
+        signed_keys.MultiFind([&](auto* v) { copies++; return true; }, _IntWrapper<int64_t>(-10000));
+        CHECK(copies == 3);
+
+        std::vector<int64_t> negative;
+        signed_keys.RangeFind([&](auto& k, auto& v) { negative.push_back(k.key); }, _IntWrapper<int64_t>(-10001), _IntWrapper<int64_t>(-9998));
+        CHECK(negative == std::vector<int64_t>{ -10000, -10000, -10000, -9999, -9999, -9999, -9998, -9998, -9998 });
+        CHECK(!signed_keys.Find(_IntWrapper<int64_t>(-10001)));
+        CHECK(db.Validate());
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Aligned Nodes", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    //Arrays on line boundaries and the lock word alone on its line:
+    //
+
+    auto offset = [](auto& node, auto& member) { return (size_t)((uint8_t*)&member - (uint8_t*)&node); };
+
+    {
+        auto node = std::make_unique<AlignedOrderedListKP2>();
+
+        CHECK(offset(*node, node->keys) == 0);
+        CHECK(offset(*node, node->pointers) % 64 == 0);
+        CHECK(offset(*node, node->footer_guard) % 64 == 0);
+        CHECK(offset(*node, node->footer_guard) > offset(*node, node->count));
+        CHECK(offset(*node, node->footer_guard) + 64 == sizeof(AlignedOrderedListKP2) - AlignedOrderedListKP2::Padding);
+        CHECK(node->count == 0);
+        CHECK(node->Leaf());
+    }
+
+    {
+        auto node = std::make_unique<AlignedTaggedHashPointer>();
+
+        CHECK(offset(*node, node->pointers) % 64 == 0);
+        CHECK(offset(*node, node->footer_guard) % 64 == 0);
+        CHECK(offset(*node, node->tags) == offset(*node, node->footer_guard) + 64);
+    }
+
+    //Arrays ending on a boundary aren't padded:
+    //
+
+    {
+        using L = _NodeLayout<uint64_t, uint64_t, uint64_t, uint64_t, 64, 4, 64>;
+
+        size_t pointers = L::pointers_offset_c, lock = L::lock_offset_c, size = L::size_c;
+
+        CHECK(pointers == 64 * sizeof(uint64_t));
+        CHECK(lock == 64 * sizeof(uint64_t) * 2 + 64);
+        CHECK(sizeof(L) == size);
+    }
+
+    using R = AsyncMap<>;
+
+    using Database = DatabaseBuilder < R, BTree< R, AlignedOrderedListPointer >, BTree< R, AlignedFuzzyHashPointer >, BTree< R, AlignedTaggedHashPointer >, BTree< R, AlignedOrderedIntKey<uint64_t> > >;
+
+    enum Tables { Ordered, Hashmap, Tagged, Ints };
+
+    constexpr size_t key_c = 200 * 1000, thread_c = 4;
+    auto& keys = singleton<std::array<RandomKeyT<Key32>, key_c>>();
+
+    auto found = [&](auto& table)
+    {
+        size_t hits = 0;
+
+        for (size_t i = 0; i < key_c; i++)
+        {
+            auto v = table.Find(keys[i]);
+
+            if (v && *v == i)
+                hits++;
+        }
+
+        return hits;
+    };
+
+    {
+        Database db("db.dat");
+        auto& ordered = db.Table<Ordered>();
+        auto& hashmap = db.Table<Hashmap>();
+        auto& tagged = db.Table<Tagged>();
+        auto& ints = db.Table<Ints>();
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < thread_c; t++)
+        {
+            threads.emplace_back([&, t]()
+            {
+                for (size_t i = t; i < key_c; i += thread_c)
+                {
+                    ordered.InsertLock(keys[i], uint64_t(i));
+                    hashmap.InsertLock(keys[i], uint64_t(i));
+                    tagged.InsertLock(keys[i], uint64_t(i));
+                }
+            });
+        }
+
+        for (auto& t : threads)
+            t.join();
+
+        for (uint64_t i = 0; i < key_c; i++)
+            ints.Insert(_IntWrapper<uint64_t>(i * 3), keys[i]);
+
+        CHECK(found(ordered) == key_c);
+        CHECK(found(hashmap) == key_c);
+        CHECK(found(tagged) == key_c);
+
+        CHECK(ordered.Erase(keys[7]));
+        CHECK(!ordered.Find(keys[7]));
+
+        size_t range = 0;
+        ints.RangeFind([&](auto& k, auto& v) { range++; }, _IntWrapper<uint64_t>(300), _IntWrapper<uint64_t>(600));
+        CHECK(range == 101);
+        CHECK(db.Validate());
+    }
+
+    {
+        Database db("db.dat");
+        auto& ordered = db.Table<Ordered>();
+        auto& tagged = db.Table<Tagged>();
+        auto& ints = db.Table<Ints>();
+
+        CHECK(found(ordered) == key_c - 1);
+        CHECK(found(tagged) == key_c);
+
+        auto v = ints.Find(_IntWrapper<uint64_t>(300));
+        CHECK(v);
+        CHECK(std::memcmp(v, &keys[100], sizeof(Key32)) == 0);
+        CHECK(db.Validate());
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Snapshots", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+
+    using Database = DatabaseBuilder < R, BTree< R, OrderedListPointer >, BTree< R, FuzzyHashPointer > >;
+
+    enum Tables { Ordered, Hashmap };
+
+    constexpr size_t key_c = 40 * 1000;
+    auto& keys = singleton<std::array<RandomKeyT<Key32>, key_c>>();
+
+    {
+        Database db("db.dat");
+        auto& ordered = db.Table<Ordered>();
+        auto& hashmap = db.Table<Hashmap>();
+
+        for (size_t i = 0; i < key_c / 2; i++)
+        {
+            ordered.Insert(keys[i], uint64_t(i));
+            hashmap.Insert(keys[i], uint64_t(i));
+        }
+
+        uint64_t before = db.Header().inuse, pinned = 0;
+
+        {
+            auto first = db.Snapshot();
+
+            CHECK(ordered.Snapshots() == 1);
+
+            std::atomic<size_t> scans = 0;
+            std::atomic<bool> consistent = true;
+
+            std::thread reader([&]()
+            {
+                auto& view = first.Table<Ordered>();
+
+                for (size_t j = 0; j < 4; j++, scans++)
+                {
+                    size_t count = 0;
+                    view.IterateKV([&](auto& k, auto& v) { count++; return true; });
+
+                    if (count != key_c / 2)
+                        consistent = false;
+                }
+            });
+
+            for (size_t i = key_c / 2; i < key_c; i++)
+            {
+                ordered.Insert(keys[i], uint64_t(i));
+                hashmap.InsertLock(keys[i], uint64_t(i));
+            }
+
+            reader.join();
+
+            CHECK(scans == 4);
+            CHECK(consistent);
+
+            auto second = db.Snapshot();
+
+            for (size_t i = 0; i < key_c / 2; i += 2)
+            {
+                CHECK(ordered.Erase(keys[i]) == 1);
+                CHECK(hashmap.EraseLock(keys[i]) == 1);
+            }
+
+            *ordered.Find(keys[1]) = 7;
+
+            CHECK(ordered.Snapshots() == 2);
+
+            size_t old_found = 0, new_found = 0, live_found = 0;
+
+            for (size_t i = 0; i < key_c; i++)
+            {
+                if (first.Table<Ordered>().Find(keys[i]) && first.Table<Hashmap>().Find(keys[i]))
+                    old_found++;
+
+                if (second.Table<Ordered>().Find(keys[i]) && second.Table<Hashmap>().Find(keys[i]))
+                    new_found++;
+
+                if (ordered.Find(keys[i]) && hashmap.Find(keys[i]))
+                    live_found++;
+            }
+
+            CHECK(old_found == key_c / 2);
+            CHECK(new_found == key_c);
+            CHECK(live_found == key_c - key_c / 4);
+
+            CHECK(*first.Table<Ordered>().Find(keys[1]) == 1);
+            CHECK(*second.Table<Ordered>().Find(keys[1]) == 1);
+            CHECK(*ordered.Find(keys[1]) == 7);
+
+            pinned = db.Header().inuse;
+
+            first.Release();
+
+            CHECK(ordered.Snapshots() == 1);
+            CHECK(*second.Table<Hashmap>().Find(keys[key_c - 1]) == key_c - 1);
+
+            CHECK(db.Validate());
+        }
+
+        CHECK(ordered.Snapshots() == 0);
+
+        ordered.Insert(keys[0], uint64_t(0));
+        hashmap.Insert(keys[0], uint64_t(0));
+
+        size_t live_found = 0;
+
+        for (size_t i = 0; i < key_c; i++)
+            if (ordered.Find(keys[i]) && hashmap.Find(keys[i]))
+                live_found++;
+
+        CHECK(live_found == key_c - key_c / 4 + 1);
+        CHECK(db.Validate());
+
+        //The copies only the snapshots reached went back to the recycler with the first writes after release:
+        //
+
+        CHECK(db.Header().inuse < pinned);
+        CHECK(db.Header().inuse > before);
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Packed Tree", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+    using N = SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>>;
+
+    using Database = DatabaseBuilder < R, BPlusTree< R, N >, PackedIndex< R, _IntWrapper<uint64_t> >, _PackedBPlusTree< R, _IntWrapper<int64_t>, uint64_t, false >, PackedIndex< R, _IntWrapper<uint64_t> > >;
+
+    enum Tables { Plain, Packed, Signed, Shared };
+
+    constexpr size_t dense_c = 200 * 1000;
+    constexpr size_t key_c = 300 * 1000;
+
+    //Dense ids first, then ids spread over the whole key space:
+    //
+
+    std::vector<uint64_t> ids(key_c);
+
+    for (size_t i = 0; i < key_c; i++)
+        ids[i] = (i < dense_c) ? i : i * 0x9e3779b97f4a7c15ull;
+
+    {
+        Database db("db.dat");
+        auto& plain = db.Table<Plain>();
+        auto& packed = db.Table<Packed>();
+
+        CHECK(!packed.Find(_IntWrapper<uint64_t>(0)));
+        CHECK(packed.Validate());
+
+        for (size_t i = 0; i < dense_c; i++)
+        {
+            plain.Insert(ids[i], uint64_t(i));
+            packed.Insert(ids[i], uint64_t(i));
+        }
+
+        //Sequential ids pack to a few bits and fill leaves well past what full width keys fit:
+        //
+
+        auto widths = packed.Widths();
+        size_t leaves = 0;
+
+        for (auto w : widths)
+            leaves += w;
+
+        CHECK(packed.Population().first == dense_c);
+        CHECK(leaves * 3 < plain.Population().second / N::Bins * 2);
+        CHECK(widths[63] + widths[64] == 0);
+
+        for (size_t i = dense_c; i < key_c; i++)
+        {
+            plain.Insert(ids[i], uint64_t(i));
+            packed.Insert(ids[i], uint64_t(i));
+        }
+
+        CHECK(packed.Validate());
+        CHECK(packed.Population().first == key_c);
+        CHECK(packed.Depth() <= plain.Depth());
+
+        size_t found = 0;
+        for (size_t i = 0; i < key_c; i++)
+        {
+            auto v = packed.Find(ids[i]);
+
+            if (v && *v == i)
+                found++;
+        }
+
+        CHECK(found == key_c);
+        CHECK(!packed.Find(_IntWrapper<uint64_t>(dense_c)));
+        CHECK(!packed.Find(_IntWrapper<uint64_t>(-1)));
+
+        //Duplicates are kept, the way multi list nodes keep them:
+        //
+
+        for (size_t i = 0; i < 3; i++)
+            CHECK(!packed.Insert(_IntWrapper<uint64_t>(7), uint64_t(1000 + i)).second);
+
+        size_t sevens = 0;
+        packed.MultiFind([&](auto* v) { sevens++; return true; }, _IntWrapper<uint64_t>(7));
+
+        CHECK(sevens == 4);
+
+        std::vector<uint64_t> order;
+        packed.IterateKV([&](auto& k, auto& v) { order.push_back(k.key); return true; });
+
+        CHECK(order.size() == key_c + 3);
+        CHECK(std::is_sorted(order.begin(), order.end()));
+
+        size_t range = 0;
+        packed.RangeFind([&](auto& k, auto& v) { range++; }, _IntWrapper<uint64_t>(1000), _IntWrapper<uint64_t>(1999));
+
+        CHECK(range == 1000);
+
+        for (size_t i = 0; i < dense_c; i += 2)
+            CHECK(packed.Erase(ids[i]) == 1);
+
+        CHECK(packed.EraseIf([](auto* v) { return *v >= 1000; }, _IntWrapper<uint64_t>(7)) == 3);
+        CHECK(packed.Validate());
+
+        found = 0;
+        for (size_t i = 0; i < key_c; i++)
+            if (packed.Find(ids[i]))
+                found++;
+
+        CHECK(found == key_c - dense_c / 2);
+
+        for (size_t i = 0; i < dense_c; i += 2)
+            packed.Insert(ids[i], uint64_t(i));
+
+        CHECK(packed.Validate());
+        CHECK(packed.Population().first == key_c);
+
+        //Signed keys order below zero, unique trees hand back the entry already there:
+        //
+
+        auto& signed_keys = db.Table<Signed>();
+
+        for (int64_t i = 0; i < 100000; i++)
+            CHECK(!signed_keys.Insert(_IntWrapper<int64_t>((i % 2) ? -i : i * 1000), uint64_t(i)).second);
+
+        auto again = signed_keys.Insert(_IntWrapper<int64_t>(-99999), uint64_t(0));
+
+        CHECK(again.second);
+        CHECK(*again.first == 99999);
+        CHECK(signed_keys.Validate());
+
+        std::vector<int64_t> signed_order;
+        signed_keys.IterateKV([&](auto& k, auto& v) { signed_order.push_back(k.key); return true; });
+
+        CHECK(signed_order.size() == 100000);
+        CHECK(std::is_sorted(signed_order.begin(), signed_order.end()));
+        CHECK(signed_order.front() == -99999);
+        CHECK(signed_order.back() == 99998000);
+
+        //Writers on separate threads:
+        //
+
+        auto& shared = db.Table<Shared>();
+        constexpr size_t threads_c = 4;
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < threads_c; t++)
+        {
+            threads.emplace_back([&, t]()
+            {
+                for (size_t i = t; i < key_c; i += threads_c)
+                    shared.InsertLock(ids[i], uint64_t(i));
+            });
+        }
+
+        for (auto& t : threads)
+            t.join();
+
+        CHECK(shared.Validate());
+
+        found = 0;
+        for (size_t i = 0; i < key_c; i++)
+        {
+            auto v = shared.FindLock(ids[i]);
+
+            if (v && *v == i)
+                found++;
+        }
+
+        CHECK(found == key_c);
+        CHECK(db.Validate());
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Sequential Appends", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    using R = AsyncMap<>;
+    using U = SimpleOrderedListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>>;
+    using M = SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>>;
+
+    using Database = DatabaseBuilder < R, BTree< R, U >, BTree< R, M > >;
+
+    enum Tables { Unique, Multi };
+
+    constexpr size_t key_c = 300 * 1000;
+
+    std::map<uint64_t, uint64_t> expected;
+
+    auto found = [&](auto& table)
+    {
+        size_t hits = 0;
+
+        for (auto& e : expected)
+        {
+            auto v = table.Find(_IntWrapper<uint64_t>(e.first));
+
+            if (v && *v == e.second)
+                hits++;
+        }
+
+        return hits;
+    };
+
+    {
+        Database db("db.dat");
+        auto& unique = db.Table<Unique>();
+        auto& multi = db.Table<Multi>();
+
+        //Even ids ascending, each one lands past the tail:
+        //
+
+        for (uint64_t i = 0; i < key_c; i++)
+        {
+            auto r = unique.Insert(_IntWrapper<uint64_t>(i * 2), i);
+            CHECK((r.first && !r.second));
+            expected[i * 2] = i;
+        }
+
+        CHECK(found(unique) == key_c);
+
+        //Odd ids below the tail take the full descent, then appending resumes:
+        //
+
+        for (uint64_t i = 0; i < key_c; i += 3)
+        {
+            unique.Insert(_IntWrapper<uint64_t>(i * 2 + 1), i);
+            expected[i * 2 + 1] = i;
+        }
+
+        for (uint64_t i = key_c; i < key_c + 10000; i++)
+        {
+            unique.Insert(_IntWrapper<uint64_t>(i * 2), i);
+            expected[i * 2] = i;
+        }
+
+        auto top = expected.rbegin()->first;
+
+        CHECK(unique.Insert(_IntWrapper<uint64_t>(top), 0).second);
+        CHECK(found(unique) == expected.size());
+        CHECK(unique.Validate());
+
+        //Emptying the end of the path reclaims the tail, appends must find their way again:
+        //
+
+        for (uint64_t i = key_c - 20000; i < key_c + 10000; i++)
+        {
+            CHECK(unique.Erase(_IntWrapper<uint64_t>(i * 2)) == 1);
+            expected.erase(i * 2);
+        }
+
+        CHECK(found(unique) == expected.size());
+
+        for (uint64_t i = key_c - 20000; i < key_c + 20000; i++)
+        {
+            CHECK(!unique.Insert(_IntWrapper<uint64_t>(i * 2), i + 1).second);
+            expected[i * 2] = i + 1;
+        }
+
+        CHECK(found(unique) == expected.size());
+        CHECK(unique.Validate());
+
+        //Copy on write replaces the path under a snapshot:
+        //
+
+        {
+            auto snapshot = db.Snapshot();
+
+            for (uint64_t i = key_c + 20000; i < key_c + 30000; i++)
+            {
+                unique.Insert(_IntWrapper<uint64_t>(i * 2), i);
+                expected[i * 2] = i;
+            }
+
+            CHECK(!snapshot.Table<Unique>().Find(_IntWrapper<uint64_t>((key_c + 20000) * 2)));
+            CHECK(snapshot.Table<Unique>().Find(_IntWrapper<uint64_t>((key_c + 20000) * 2 - 2)));
+        }
+
+        for (uint64_t i = key_c + 30000; i < key_c + 40000; i++)
+        {
+            unique.Insert(_IntWrapper<uint64_t>(i * 2), i);
+            expected[i * 2] = i;
+        }
+
+        CHECK(found(unique) == expected.size());
+
+        size_t listed = 0;
+        unique.IterateKV([&](auto& k, auto& v) { if (expected.count(k.key) && expected[k.key] == v) listed++; return true; });
+
+        CHECK(listed == expected.size());
+
+        //Duplicates of the highest key keep appending in the multi list:
+        //
+
+        for (uint64_t i = 0; i < key_c; i++)
+            for (uint64_t j = 0; j < 3; j++)
+                multi.Insert(_IntWrapper<uint64_t>(i), i * 3 + j);
+
+        size_t all = 0;
+
+        for (uint64_t i = 0; i < key_c; i++)
+        {
+            size_t c = 0;
+            multi.MultiFind([&](auto* v) { if (*v / 3 == i) c++; return true; }, _IntWrapper<uint64_t>(i));
+
+            if (c == 3)
+                all++;
+        }
+
+        CHECK(all == key_c);
+        CHECK(db.Validate());
+    }
+
+    {
+        Database db("db.dat");
+        auto& unique = db.Table<Unique>();
+
+        CHECK(found(unique) == expected.size());
+
+        unique.Insert(_IntWrapper<uint64_t>((key_c + 40000) * 2), 1);
+        CHECK(unique.Find(_IntWrapper<uint64_t>((key_c + 40000) * 2)));
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Concurrent Emplace", "[tdb::]")
+{
+#pragma pack(push, 1)
+    struct Row
+    {
+        Row() {}
+
+        Row(uint64_t _id, uint64_t _group) : id(_id), group(_group) {}
+
+        auto Keys(uint64_t n)
+        {
+            return std::make_tuple(_IntWrapper<uint64_t>(id * 0x9e3779b97f4a7c15ull), _IntWrapper<uint64_t>(group));
+        }
+
+        uint64_t id = 0;
+        uint64_t group = 0;
+    };
+#pragma pack(pop)
+
+    using R = AsyncMap<>;
+    using U = BTree< R, SimpleOrderedListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+    using G = BPlusTree< R, SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+
+    using Database = DatabaseBuilder < R, FixedTable<R, SimpleTableElementBuilder<Row>, U, G>, StreamingTable<R, SimpleStreamTableElementBuilder<Row>, U, G> >;
+
+    enum Tables { Fixed, Streaming };
+    enum Indexes { Id, Group };
+
+    constexpr size_t row_c = 128 * 1024;
+    constexpr size_t group_c = 256;
+
+    auto complete = [&](auto& table, size_t rows)
+    {
+        std::vector<uint8_t> seen(rows);
+        size_t distinct = 0, found = 0, grouped = 0;
+
+        for (size_t i = 0; i < rows; i++)
+        {
+            auto id = table[i].id;
+
+            if (id < rows && !seen[id]++)
+                distinct++;
+
+            auto e = table.template Find<Id>(_IntWrapper<uint64_t>(i * 0x9e3779b97f4a7c15ull));
+
+            if (e && e->id == i)
+                found++;
+        }
+
+        for (uint64_t g : { (size_t)0, (size_t)7, group_c - 1 })
+            table.template MultiFind<Group>([&](auto& e) { if (e.group == g) grouped++; return true; }, _IntWrapper<uint64_t>(g));
+
+        return table.size() == rows && distinct == rows && found == rows && grouped == 3 * row_c / group_c;
+    };
+
+    //The same rows from 1 up to 32 writers:
+    //
+
+    for (size_t threads : { 1, 2, 4, 8, 16, 32 })
+    {
+        std::filesystem::remove_all("db.dat");
+
+        {
+            Database db("db.dat");
+            auto& fixed = db.Table<Fixed>();
+            auto& streaming = db.Table<Streaming>();
+
+            std::vector<std::thread> writers;
+
+            for (size_t t = 0; t < threads; t++)
+            {
+                writers.emplace_back([&, t]()
+                {
+                    for (uint64_t i = t; i < row_c; i += threads)
+                    {
+                        fixed.EmplaceLock(i, i % group_c);
+                        streaming.EmplaceLock(i, i % group_c);
+                    }
+                });
+            }
+
+            for (auto& w : writers)
+                w.join();
+
+            CHECK(complete(fixed, row_c));
+            CHECK(complete(streaming, row_c));
+
+            //Single writer appends carry on after the reserved rows:
+            //
+
+            fixed.Emplace(row_c, 1);
+            streaming.Emplace(row_c, 1);
+
+            CHECK(fixed.Find<Id>(_IntWrapper<uint64_t>(row_c * 0x9e3779b97f4a7c15ull)) == &fixed[row_c]);
+            CHECK(streaming.Find<Id>(_IntWrapper<uint64_t>(row_c * 0x9e3779b97f4a7c15ull)) == &streaming[row_c]);
+        }
+
+        {
+            Database db("db.dat");
+
+            CHECK(complete(db.Table<Fixed>(), row_c + 1));
+            CHECK(complete(db.Table<Streaming>(), row_c + 1));
+        }
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Index Pipeline", "[tdb::]")
+{
+#pragma pack(push, 1)
+    struct Named
+    {
+        Named() {}
+
+        static size_t Size(uint64_t _id, uint64_t _group, const char* _name)
+        {
+            return sizeof(Named) + strlen(_name) + 1;
+        }
+
+        Named(uint64_t _id, uint64_t _group, const char* _name) : id(_id), group(_group)
+        {
+            std::copy(_name, _name + strlen(_name) + 1, (char*)(this + 1));
+        }
+
+        auto Keys(uint64_t n)
+        {
+            return std::make_tuple(_IntWrapper<uint64_t>(id * 0x9e3779b97f4a7c15ull), _IntWrapper<uint64_t>(group), _IntWrapper<uint64_t>(id));
+        }
+
+        const char* Name() const { return (const char*)(this + 1); }
+
+        uint64_t id = 0;
+        uint64_t group = 0;
+    };
+
+    struct Row
+    {
+        Row() {}
+
+        Row(uint64_t _id, uint64_t _group) : id(_id), group(_group) {}
+
+        auto Keys(uint64_t n)
+        {
+            return std::make_tuple(_IntWrapper<uint64_t>(id), _IntWrapper<uint64_t>(group));
+        }
+
+        uint64_t id = 0;
+        uint64_t group = 0;
+    };
+#pragma pack(pop)
+
+    using R = AsyncMap<>;
+    using U = BTree< R, SimpleOrderedListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+    using G = BPlusTree< R, SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+    using P = PackedIndex< R, _IntWrapper<uint64_t> >;
+
+    using Database = DatabaseBuilder < R, SurrogateTable<R, SimpleSurrogateTableBuilder<Named>, U, G, P>, FixedTable<R, SimpleTableElementBuilder<Row>, U, G> >;
+
+    enum Tables { Surrogate, Fixed };
+    enum Indexes { Id, Group, Packed };
+
+    constexpr size_t row_c = 100 * 1000;
+    constexpr size_t group_c = 64;
+
+    auto name = [](uint64_t i) { return std::to_string(i * 31); };
+
+    auto complete = [&](auto& table, size_t rows)
+    {
+        size_t found = 0, packed = 0, grouped = 0;
+
+        for (uint64_t i = 0; i < rows; i++)
+        {
+            auto e = table.template Find<Id>(_IntWrapper<uint64_t>(i * 0x9e3779b97f4a7c15ull));
+
+            if (e && e->id == i && name(i) == e->Name())
+                found++;
+
+            auto dx = table.template Index<Packed>().Find(_IntWrapper<uint64_t>(i));
+
+            if (dx && table[*dx].id == i)
+                packed++;
+        }
+
+        table.template MultiFind<Group>([&](auto& e) { if (e.group == 5) grouped++; return true; }, _IntWrapper<uint64_t>(5));
+
+        return found == rows && packed == rows && grouped == (rows + group_c - 1 - 5) / group_c;
+    };
+
+    std::filesystem::remove_all("db.dat");
+
+    {
+        Database db("db.dat");
+        auto& table = db.Table<Surrogate>();
+
+        //A shallow queue so the writer keeps waiting on the slowest index:
+        //
+
+        table.PipelineIndexes(256);
+
+        for (uint64_t i = 0; i < row_c; i++)
+            table.Emplace(i, i % group_c, name(i).c_str());
+
+        table.Sync();
+
+        CHECK(complete(table, row_c));
+
+        //Back to inline indexing:
+        //
+
+        table.SerialIndexes();
+
+        for (uint64_t i = row_c; i < 2 * row_c; i++)
+            table.Emplace(i, i % group_c, name(i).c_str());
+
+        CHECK(complete(table, 2 * row_c));
+
+        //Still pipelined when the database closes, the workers finish before the indexes go away:
+        //
+
+        table.PipelineIndexes();
+
+        for (uint64_t i = 2 * row_c; i < 3 * row_c; i++)
+            table.Emplace(i, i % group_c, name(i).c_str());
+    }
+
+    {
+        Database db("db.dat");
+
+        CHECK(complete(db.Table<Surrogate>(), 3 * row_c));
+    }
+
+    std::filesystem::remove_all("db.dat");
+
+    //Concurrent writers feed the same workers:
+    //
+
+    {
+        Database db("db.dat");
+        auto& table = db.Table<Fixed>();
+
+        table.PipelineIndexes(1024);
+
+        std::vector<std::thread> writers;
+
+        for (size_t t = 0; t < 4; t++)
+        {
+            writers.emplace_back([&, t]()
+            {
+                for (uint64_t i = t; i < row_c; i += 4)
+                    table.EmplaceLock(i, i % group_c);
+            });
+        }
+
+        for (auto& w : writers)
+            w.join();
+
+        table.Sync();
+
+        size_t found = 0;
+
+        for (uint64_t i = 0; i < row_c; i++)
+        {
+            auto e = table.Find<Id>(_IntWrapper<uint64_t>(i));
+
+            if (e && e->id == i)
+                found++;
+        }
+
+        CHECK(found == row_c);
+
+        auto [at, existed] = table.EmplaceIf((uint64_t)7, (uint64_t)7);
+
+        CHECK(existed);
+        CHECK(table[at].id == 7);
+
+        std::tie(at, existed) = table.EmplaceIf((uint64_t)row_c, (uint64_t)0);
+
+        CHECK(!existed);
+        CHECK(at == row_c);
+
+        table.Sync();
+
+        CHECK(table.Find<Id>(_IntWrapper<uint64_t>(row_c)) == &table[row_c]);
+
+        //Rows skipping index 0 would let a second row with the same key through:
+        //
+
+        table.DeferIndexes(1 << Id);
+
+        CHECK_THROWS(table.EmplaceIf((uint64_t)row_c + 1, (uint64_t)0));
+
+        table.BuildIndexes();
+
+        std::tie(at, existed) = table.EmplaceIf((uint64_t)row_c, (uint64_t)0);
+
+        CHECK(existed);
+        CHECK(at == row_c);
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Deferred Index Build", "[tdb::]")
+{
+    static std::atomic<uint64_t> poison = (uint64_t)-1;
+
+#pragma pack(push, 1)
+    struct Row
+    {
+        Row() {}
+
+        Row(uint64_t _id, uint64_t _group) : id(_id), group(_group) {}
+
+        auto Keys(uint64_t n)
+        {
+            if (id == poison)
+                throw std::runtime_error("Poisoned row");
+
+            return std::make_tuple(_IntWrapper<uint64_t>(id), _IntWrapper<uint64_t>(group));
+        }
+
+        uint64_t id = 0;
+        uint64_t group = 0;
+    };
+
+    struct Named
+    {
+        Named() {}
+
+        static size_t Size(uint64_t _id, uint64_t _group, const char* _name)
+        {
+            return sizeof(Named) + strlen(_name) + 1;
+        }
+
+        Named(uint64_t _id, uint64_t _group, const char* _name) : id(_id), group(_group)
+        {
+            std::copy(_name, _name + strlen(_name) + 1, (char*)(this + 1));
+        }
+
+        auto Keys(uint64_t n)
+        {
+            return std::make_tuple(_IntWrapper<uint64_t>(id), _IntWrapper<uint64_t>(group), _IntWrapper<uint64_t>(id * 0x9e3779b97f4a7c15ull));
+        }
+
+        uint64_t id = 0;
+        uint64_t group = 0;
+    };
+#pragma pack(pop)
+
+    using R = AsyncMap<>;
+    using U = BTree< R, SimpleOrderedListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+    using G = BPlusTree< R, SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+    using P = PackedIndex< R, _IntWrapper<uint64_t> >;
+
+    using Database = DatabaseBuilder < R, FixedTable<R, SimpleTableElementBuilder<Row>, U, G>, SurrogateTable<R, SimpleSurrogateTableBuilder<Named>, U, G, P> >;
+
+    enum Tables { Fixed, Surrogate };
+    enum Indexes { Id, Group, Packed };
+
+    constexpr size_t row_c = 100 * 1000;
+    constexpr size_t group_c = 64;
+
+    //Every row once in every index, duplicates would show up in the group count:
+    //
+
+    auto complete = [&](auto& table, size_t rows)
+    {
+        size_t found = 0, grouped = 0;
+
+        for (uint64_t i = 0; i < rows; i++)
+        {
+            auto e = table.template Find<Id>(_IntWrapper<uint64_t>(i));
+
+            if (e && e->id == i)
+                found++;
+        }
+
+        table.template MultiFind<Group>([&](auto& e) { if (e.group == 5) grouped++; return true; }, _IntWrapper<uint64_t>(5));
+
+        return found == rows && grouped == (rows + group_c - 1 - 5) / group_c;
+    };
+
+    std::filesystem::remove_all("db.dat");
+
+    {
+        Database db("db.dat");
+        auto& fixed = db.Table<Fixed>();
+        auto& surrogate = db.Table<Surrogate>();
+
+        //Empty indexes are bulk loaded where the index supports it:
+        //
+
+        fixed.DeferIndexes(1 << Id | 1 << Group);
+        surrogate.DeferIndexes(1 << Id | 1 << Group | 1 << Packed);
+
+        for (uint64_t i = 0; i < row_c; i++)
+        {
+            fixed.Emplace(i, i % group_c);
+            surrogate.Emplace(i, i % group_c, std::to_string(i).c_str());
+        }
+
+        CHECK(fixed.Find<Id>(_IntWrapper<uint64_t>(7)) == nullptr);
+        CHECK(surrogate.Find<Id>(_IntWrapper<uint64_t>(7)) == nullptr);
+
+        CHECK(fixed.BuildIndexes(4) == row_c);
+        CHECK(surrogate.BuildIndexes(4) >= row_c);
+
+        CHECK(complete(fixed, row_c));
+        CHECK(complete(surrogate, row_c));
+
+        size_t packed = 0;
+
+        for (uint64_t i = 0; i < row_c; i++)
+        {
+            auto dx = surrogate.Index<Packed>().Find(_IntWrapper<uint64_t>(i * 0x9e3779b97f4a7c15ull));
+
+            if (dx && surrogate[*dx].id == i)
+                packed++;
+        }
+
+        CHECK(packed == row_c);
+
+        //Deferring only the group index, ids stay inline:
+        //
+
+        fixed.DeferIndexes(1 << Group);
+
+        for (uint64_t i = row_c; i < 2 * row_c; i++)
+            fixed.Emplace(i, i % group_c);
+
+        CHECK(fixed.Find<Id>(_IntWrapper<uint64_t>(2 * row_c - 1)) == &fixed[2 * row_c - 1]);
+        CHECK(complete(fixed, row_c));
+
+        CHECK(fixed.BuildIndexes(3, 7000) == row_c);
+        CHECK(complete(fixed, 2 * row_c));
+
+        //A build that stops half way:
+        //
+
+        fixed.DeferIndexes(1 << Id | 1 << Group);
+
+        for (uint64_t i = 2 * row_c; i < 3 * row_c; i++)
+            fixed.Emplace(i, i % group_c);
+
+        poison = 2 * row_c + row_c / 2;
+
+        CHECK_THROWS(fixed.BuildIndexes(2, 10000));
+
+        CHECK(fixed.Find<Id>(_IntWrapper<uint64_t>(2 * row_c + 10)) == &fixed[2 * row_c + 10]);
+        CHECK(fixed.Find<Id>(_IntWrapper<uint64_t>(3 * row_c - 1)) == nullptr);
+    }
+
+    //Resumed from the file after a reopen, rows appended meanwhile are still deferred:
+    //
+
+    {
+        Database db("db.dat");
+        auto& fixed = db.Table<Fixed>();
+
+        poison = (uint64_t)-1;
+
+        fixed.Emplace(3 * row_c, 3 * row_c % group_c);
+
+        CHECK(fixed.Find<Id>(_IntWrapper<uint64_t>(3 * row_c)) == nullptr);
+
+        fixed.BuildIndexes(2, 10000);
+
+        CHECK(complete(fixed, 3 * row_c + 1));
+        CHECK(complete(db.Table<Surrogate>(), row_c));
+
+        //Built indexes are maintained inline again:
+        //
+
+        fixed.Emplace(3 * row_c + 1, 0);
+
+        CHECK(fixed.Find<Id>(_IntWrapper<uint64_t>(3 * row_c + 1)) == &fixed[3 * row_c + 1]);
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Deferred Unique Index", "[tdb::]")
+{
+#pragma pack(push, 1)
+    struct Row
+    {
+        Row() {}
+
+        Row(uint64_t _id) : id(_id) {}
+
+        auto Keys(uint64_t n)
+        {
+            return std::make_tuple(_IntWrapper<uint64_t>(id));
+        }
+
+        uint64_t id = 0;
+    };
+#pragma pack(pop)
+
+    using R = AsyncMap<>;
+    using U = BTree< R, SimpleOrderedListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+    using T = FixedTable<R, SimpleTableElementBuilder<Row>, U>;
+
+    using Database = DatabaseBuilder < R, T, T >;
+
+    enum Tables { Inline, Deferred };
+
+    constexpr size_t row_c = 50 * 1000;
+    constexpr size_t key_c = 1000;
+
+    std::filesystem::remove_all("db.dat");
+
+    {
+        Database db("db.dat");
+        auto& inline_built = db.Table<Inline>();
+        auto& deferred = db.Table<Deferred>();
+
+        deferred.DeferIndexes(1);
+
+        //Every key shows up row_c / key_c times, in reverse so the sort has to keep row order among equal keys:
+        //
+
+        for (uint64_t i = 0; i < row_c; i++)
+        {
+            inline_built.Emplace(key_c - 1 - i % key_c);
+            deferred.Emplace(key_c - 1 - i % key_c);
+        }
+
+        CHECK(deferred.BuildIndexes(4) == row_c);
+
+        std::vector<std::pair<uint64_t, uint64_t>> expected, built;
+
+        inline_built.Index<0>().IterateKV([&](auto& k, auto& v) { expected.emplace_back(k.key, v); return true; });
+        deferred.Index<0>().IterateKV([&](auto& k, auto& v) { built.emplace_back(k.key, v); return true; });
+
+        std::sort(expected.begin(), expected.end());
+        std::sort(built.begin(), built.end());
+
+        CHECK(expected.size() == key_c);
+        CHECK(built == expected);
+
+        //The first row holding each key wins:
+        //
+
+        CHECK(deferred.Find<0>(_IntWrapper<uint64_t>(key_c - 1)) == &deferred[0]);
+        CHECK(deferred.Find<0>(_IntWrapper<uint64_t>(0)) == &deferred[key_c - 1]);
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
+TEST_CASE("Attach Index", "[tdb::]")
+{
+#pragma pack(push, 1)
+    struct Row
+    {
+        Row() {}
+
+        Row(uint64_t _id, uint64_t _group) : id(_id), group(_group) {}
+
+        auto Keys(uint64_t n)
+        {
+            return std::make_tuple(_IntWrapper<uint64_t>(id), _IntWrapper<uint64_t>(group));
+        }
+
+        uint64_t id = 0;
+        uint64_t group = 0;
+    };
+
+    struct Named
+    {
+        Named() {}
+
+        static size_t Size(uint64_t _id, uint64_t _group, const char* _name)
+        {
+            return sizeof(Named) + strlen(_name) + 1;
+        }
+
+        Named(uint64_t _id, uint64_t _group, const char* _name) : id(_id), group(_group)
+        {
+            std::copy(_name, _name + strlen(_name) + 1, (char*)(this + 1));
+        }
+
+        auto Keys(uint64_t n)
+        {
+            return std::make_tuple(_IntWrapper<uint64_t>(id), _IntWrapper<uint64_t>(group));
+        }
+
+        uint64_t id = 0;
+        uint64_t group = 0;
+    };
+#pragma pack(pop)
+
+    using R = AsyncMap<>;
+    using U = BTree< R, SimpleOrderedListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+    using M = BTree< R, SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+    using G = BPlusTree< R, SimpleMultiListBuilder<64 * 1024, uint64_t, _IntWrapper<uint64_t>> >;
+    using S = ReserveTables<R, 1>;
+
+    //Only indexes that free their units can be dropped:
+    //
+
+    static_assert(_Drops<U>::value && _Drops<M>::value && !_Drops<G>::value);
+
+    //Version one holds the group index's slot, version two fills it:
+    //
+
+    using V1 = DatabaseBuilder < R, FixedTable<R, SimpleTableElementBuilder<Row>, U, S>, SurrogateTable<R, SimpleSurrogateTableBuilder<Named>, U, S> >;
+    using V2 = DatabaseBuilder < R, FixedTable<R, SimpleTableElementBuilder<Row>, U, M>, SurrogateTable<R, SimpleSurrogateTableBuilder<Named>, U, M> >;
+    using Refused = DatabaseBuilder < R, FixedTable<R, SimpleTableElementBuilder<Row>, U, G>, SurrogateTable<R, SimpleSurrogateTableBuilder<Named>, U, G> >;
+
+    enum Tables { Fixed, Surrogate };
+    enum Indexes { Id, Group };
+
+    constexpr size_t row_c = 50 * 1000;
+    constexpr size_t group_c = 64;
+
+    auto grouped = [&](auto& table)
+    {
+        size_t result = 0;
+
+        table.template MultiFind<Group>([&](auto& e) { if (e.group == 5) result++; return true; }, _IntWrapper<uint64_t>(5));
+
+        return result;
+    };
+
+    auto expected = [&](size_t rows) { return (rows + group_c - 1 - 5) / group_c; };
+
+    auto append = [&](auto& db, uint64_t from, uint64_t to)
+    {
+        for (uint64_t i = from; i < to; i++)
+        {
+            db.template Table<Fixed>().Emplace(i, i % group_c);
+            db.template Table<Surrogate>().Emplace(i, i % group_c, std::to_string(i).c_str());
+        }
+    };
+
+    std::filesystem::remove_all("db.dat");
+
+    {
+        V1 db("db.dat");
+
+        append(db, 0, row_c);
+
+        CHECK(db.Table<Fixed>().Find<Id>(_IntWrapper<uint64_t>(7))->id == 7);
+    }
+
+    //Only a tree that can take the slot over is let in:
+    //
+
+    CHECK_THROWS(Refused("db.dat"));
+
+    {
+        V2 db("db.dat");
+        auto& fixed = db.Table<Fixed>();
+        auto& surrogate = db.Table<Surrogate>();
+
+        append(db, row_c, row_c + 1);
+
+        CHECK(grouped(fixed) == 0);
+        CHECK(grouped(surrogate) == 0);
+        CHECK(fixed.Find<Id>(_IntWrapper<uint64_t>(row_c))->id == row_c);
+
+        CHECK(fixed.CreateIndex<Group>(4) == row_c + 1);
+        CHECK(surrogate.CreateIndex<Group>(4) >= row_c + 1);
+        CHECK(fixed.CreateIndex<Group>(4) == 0);
+
+        CHECK(grouped(fixed) == expected(row_c + 1));
+        CHECK(grouped(surrogate) == expected(row_c + 1));
+
+        //Maintained inline from here on:
+        //
+
+        append(db, row_c + 1, 2 * row_c);
+
+        CHECK(grouped(fixed) == expected(2 * row_c));
+        CHECK(grouped(surrogate) == expected(2 * row_c));
+
+        //Dropping hands the nodes back:
+        //
+
+        uint64_t before = db.Header().inuse;
+
+        fixed.DropIndex<Group>();
+
+        CHECK(db.Header().inuse < before);
+        CHECK(grouped(fixed) == 0);
+
+        append(db, 2 * row_c, 2 * row_c + 5);
+
+        CHECK(grouped(fixed) == 0);
+        CHECK(grouped(surrogate) == expected(2 * row_c + 5));
+        CHECK(fixed.Find<Id>(_IntWrapper<uint64_t>(2 * row_c + 4))->id == 2 * row_c + 4);
+    }
+
+    //The dropped slot reads as reserved again:
+    //
+
+    {
+        V1 db("db.dat");
+
+        append(db, 2 * row_c + 5, 2 * row_c + 10);
+
+        CHECK(db.Table<Fixed>().Find<Id>(_IntWrapper<uint64_t>(2 * row_c + 9))->id == 2 * row_c + 9);
+    }
+
+    {
+        V2 db("db.dat");
+        auto& fixed = db.Table<Fixed>();
+
+        CHECK(grouped(fixed) == 0);
+        CHECK(grouped(db.Table<Surrogate>()) == expected(2 * row_c + 10));
+
+        CHECK(fixed.CreateIndex<Group>(2) == 2 * row_c + 10);
+        CHECK(grouped(fixed) == expected(2 * row_c + 10));
+
+        //Dropped and created again in one session:
+        //
+
+        fixed.DropIndex<Group>();
+
+        CHECK(fixed.CreateIndex<Group>(2) == 2 * row_c + 10);
+        CHECK(grouped(fixed) == expected(2 * row_c + 10));
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
 TEST_CASE("Network Layer", "[tdb::]")
 {
     //NETWORK LAYER TODO
@@ -211,6 +211,57 @@ TEST_CASE("Simple Hashmap", "[tdb::]")
     std::filesystem::remove_all("db.dat");
 }
 
+TEST_CASE("Batched Sized Objects", "[tdb::]")
+{
+    std::filesystem::remove_all("db.dat");
+
+    {
+        LargeHashmap dx("db.dat");
+
+        constexpr size_t object_c = 10 * 1000;
+
+        std::vector<std::string> names(object_c), values(object_c);
+
+        for (size_t i = 0; i < object_c; i++)
+        {
+            names[i] = "object " + std::to_string(i);
+            values[i] = "value " + std::to_string(i * 3);
+        }
+
+        std::vector<std::string_view> n(names.begin(), names.end()), v(values.begin(), values.end());
+
+        CHECK(dx.InsertSizedObjectBatchLock<Key32>(gsl::span<const std::string_view>(n), gsl::span<const std::string_view>(v)) == object_c);
+        CHECK(dx.InsertSizedObjectBatch<Key32>(gsl::span<const std::string_view>(n), gsl::span<const std::string_view>(v)) == 0);
+
+        size_t found = 0;
+        for (size_t i = 0; i < object_c; i++)
+        {
+            auto obj = dx.FindSizedObject(Key32(names[i]));
+
+            if (std::string_view((const char*)obj.data(), obj.size()) == values[i])
+                found++;
+        }
+
+        CHECK(found == object_c);
+
+        std::vector<Key32> content(object_c);
+        CHECK(dx.InsertContentBatchLock(gsl::span<const std::string_view>(v), gsl::span<Key32>(content)) == object_c);
+
+        found = 0;
+        for (size_t i = 0; i < object_c; i++)
+        {
+            auto obj = dx.FindSizedObjectLock(content[i]);
+
+            if (content[i].Equal(Key32(values[i])) && std::string_view((const char*)obj.data(), obj.size()) == values[i])
+                found++;
+        }
+
+        CHECK(found == object_c);
+    }
+
+    std::filesystem::remove_all("db.dat");
+}
+
 TEST_CASE("10,000 Inserts", "[tdb::]")
 {
     constexpr auto lim = 10 * 1000;
@@ -14,6 +14,15 @@ namespace tdb
 		table_fixed,
 		table_dynamic,
 		table_surrogate,
+
+		btree_taggedmap,
+		btree_prefix_block,
+		btree_prefix_multiblock,
+		radix_tree,
+		interval_tree,
+		learned_index,
+		packed_tree,
+		reserved_slot,
 	};
 
 	enum KeyMode : uint8_t
@@ -32,6 +41,13 @@ namespace tdb
 		key_type_mixed,
 	};
 
+	enum HashPolicy : uint8_t
+	{
+		undefined_hash_policy,
+		hash_policy_sha2,
+		hash_policy_fast,
+	};
+
 	enum PointerMode : uint8_t
 	{
 		undefined_pointer_mode,